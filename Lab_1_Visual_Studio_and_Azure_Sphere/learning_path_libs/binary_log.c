@@ -0,0 +1,119 @@
+#include "binary_log.h"
+
+static void LogFlushHandler(EventLoopTimer* eventLoopTimer);
+
+// GNU ld defines __start_<section> for sections with C identifier names
+extern const char __start_lp_log_fmt[] __attribute__((weak));
+
+// LP_LOG is called from the event loop and from worker threads. Writers take ringLock, the event loop is the
+// only reader and writes out the records between ringTail and ringHead without it.
+static pthread_mutex_t ringLock = PTHREAD_MUTEX_INITIALIZER;
+static LP_LOG_RECORD ring[LP_LOG_RING_RECORDS];
+static size_t ringHead = 0;	// next record to write
+static size_t ringTail = 0;	// next record to flush
+static uint32_t droppedRecords = 0;
+
+static LP_TIMER logFlushTimer = {
+	.period = { 1, 0 },
+	.slack = { 0, 500 * 1000 * 1000 },	// flushing is not time critical, share other timers' wakeups
+	.name = "logFlush",
+	.handler = LogFlushHandler
+};
+
+static uint32_t LogTimestamp(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	// In 64 bits, a 32 bit time_t would overflow after 35 minutes. The timestamp wraps as documented.
+	return (uint32_t)((uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u);
+}
+
+/// <summary>
+///     Records a log entry. Called by the LP_LOG macro from any thread, the format is not expanded here.
+/// </summary>
+void lp_logRecord(const char* format, uint32_t argCount, const uint32_t* args) {
+	uint32_t timestamp = LogTimestamp();
+
+	pthread_mutex_lock(&ringLock);
+
+	size_t next = (ringHead + 1) % LP_LOG_RING_RECORDS;
+	if (next == ringTail) {
+		droppedRecords++;
+		pthread_mutex_unlock(&ringLock);
+		return;
+	}
+
+	LP_LOG_RECORD* record = &ring[ringHead];
+	record->formatId = (uint32_t)(format - __start_lp_log_fmt);
+	record->timestamp = timestamp;
+	record->argCount = argCount > LP_LOG_MAX_ARGS ? LP_LOG_MAX_ARGS : argCount;
+	if (record->argCount > 0) {
+		memcpy(record->args, args, record->argCount * sizeof(uint32_t));
+	}
+	ringHead = next;
+
+	pthread_mutex_unlock(&ringLock);
+}
+
+static void WriteRecord(const LP_LOG_RECORD* record) {
+	// LPLOG:<formatId><timestamp><argCount><args...> as hex, decoded by tools/Utilities/lp_log_decode.py
+	char line[8 + 8 + 8 + 2 + LP_LOG_MAX_ARGS * 8 + 2];
+	int len = snprintf(line, sizeof(line), "LPLOG:%08X%08X%02X", record->formatId, record->timestamp, record->argCount);
+
+	for (uint32_t i = 0; i < record->argCount; i++) {
+		len += snprintf(line + len, sizeof(line) - (size_t)len, "%08X", record->args[i]);
+	}
+
+	Log_Debug("%s\n", line);
+}
+
+/// <summary>
+///     Writes all pending records to the debug output. Call from the event loop thread.
+/// </summary>
+void lp_logFlush(void) {
+	pthread_mutex_lock(&ringLock);
+	size_t head = ringHead;
+	pthread_mutex_unlock(&ringLock);
+
+	// Writers do not touch the records from ringTail to head until ringTail moves past them
+	for (size_t tail = ringTail; tail != head; tail = (tail + 1) % LP_LOG_RING_RECORDS) {
+		WriteRecord(&ring[tail]);
+	}
+
+	pthread_mutex_lock(&ringLock);
+	ringTail = head;
+	uint32_t dropped = droppedRecords;
+	droppedRecords = 0;
+	pthread_mutex_unlock(&ringLock);
+
+	if (dropped > 0) {
+		LP_LOG_RECORD droppedRecord = { .formatId = LP_LOG_DROPPED_ID, .timestamp = LogTimestamp(), .argCount = 1, .args = { dropped } };
+		WriteRecord(&droppedRecord);
+	}
+}
+
+/// <summary>
+///     Starts flushing the ring from the event loop every second, call once at init. Does nothing without LP_LOG_BINARY.
+/// </summary>
+bool lp_logStart(void) {
+#ifdef LP_LOG_BINARY
+	return lp_startTimer(&logFlushTimer);
+#else
+	return true;
+#endif
+}
+
+/// <summary>
+///     Stops the flush timer and writes the records still pending
+/// </summary>
+void lp_logStop(void) {
+	lp_stopTimer(&logFlushTimer);
+	lp_logFlush();
+}
+
+static void LogFlushHandler(EventLoopTimer* eventLoopTimer) {
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+		return;
+	}
+	lp_logFlush();
+}
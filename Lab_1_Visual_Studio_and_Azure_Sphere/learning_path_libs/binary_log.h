@@ -0,0 +1,96 @@
+#pragma once
+
+#include "terminate.h"
+#include "timer.h"
+#include <applibs/log.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+Deferred-format binary logging.
+
+With LP_LOG_BINARY defined, LP_LOG records the format string ID plus the raw 32 bit arguments into a
+ring buffer and formatting happens offline. The format strings are placed in the lp_log_fmt ELF section,
+tools/Utilities/lp_log_decode.py extracts them from the application ELF and decodes the captured
+"LPLOG:" debug output. Without LP_LOG_BINARY, LP_LOG is a plain Log_Debug call.
+
+Arguments are recorded as 32 bit words, so %d, %u, %x, %c and %f (single precision) are supported.
+Up to LP_LOG_MAX_ARGS arguments per call. LP_LOG may be called from any thread, the ring is flushed from
+the event loop once the app calls lp_logStart at init, lp_logStop writes out what is left at exit.
+
+LP_LOG is used for the messages logged on every telemetry send and device twin report. The one-off
+start up and error messages stay on Log_Debug, most of them print %s strings that a record cannot carry.
+*/
+
+#define LP_LOG_MAX_ARGS 6
+#define LP_LOG_RING_RECORDS 128
+#define LP_LOG_DROPPED_ID 0xFFFFFFFF	// format id of the record reporting dropped records
+
+typedef struct {
+	uint32_t formatId;
+	uint32_t timestamp;		// microseconds since boot, wraps
+	uint32_t argCount;
+	uint32_t args[LP_LOG_MAX_ARGS];
+} LP_LOG_RECORD;
+
+void lp_logRecord(const char* format, uint32_t argCount, const uint32_t* args);
+void lp_logFlush(void);
+bool lp_logStart(void);
+void lp_logStop(void);
+
+static inline uint32_t lp_logArgInt(uint32_t value) { return value; }
+static inline uint32_t lp_logArgFloat(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+static inline uint32_t lp_logArgDouble(double value) { return lp_logArgFloat((float)value); }
+static inline uint32_t lp_logArgPtr(const void* value) { return (uint32_t)(uintptr_t)value; }
+
+#define LP_LOG_ARG(x) _Generic((x), \
+	float: lp_logArgFloat, \
+	double: lp_logArgDouble, \
+	char*: lp_logArgPtr, \
+	const char*: lp_logArgPtr, \
+	void*: lp_logArgPtr, \
+	const void*: lp_logArgPtr, \
+	default: lp_logArgInt)(x)
+
+#ifdef LP_LOG_BINARY
+
+#define LP_LOG_FORMAT(fmt) static const char _lpLogFmt[] __attribute__((section("lp_log_fmt"), used)) = fmt
+
+#define LP_LOG_COUNT(...) LP_LOG_COUNT_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, _)
+#define LP_LOG_COUNT_(f, a1, a2, a3, a4, a5, a6, n, ...) n
+#define LP_LOG_CAT(a, b) LP_LOG_CAT_(a, b)
+#define LP_LOG_CAT_(a, b) a##b
+
+#define LP_LOG(...) LP_LOG_CAT(LP_LOG_, LP_LOG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+
+#define LP_LOG_0(fmt) do { LP_LOG_FORMAT(fmt); lp_logRecord(_lpLogFmt, 0, NULL); } while (0)
+#define LP_LOG_1(fmt, a1) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1) }; lp_logRecord(_lpLogFmt, 1, _lpArgs); } while (0)
+#define LP_LOG_2(fmt, a1, a2) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2) }; lp_logRecord(_lpLogFmt, 2, _lpArgs); } while (0)
+#define LP_LOG_3(fmt, a1, a2, a3) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3) }; lp_logRecord(_lpLogFmt, 3, _lpArgs); } while (0)
+#define LP_LOG_4(fmt, a1, a2, a3, a4) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3), LP_LOG_ARG(a4) }; \
+	lp_logRecord(_lpLogFmt, 4, _lpArgs); } while (0)
+#define LP_LOG_5(fmt, a1, a2, a3, a4, a5) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3), LP_LOG_ARG(a4), LP_LOG_ARG(a5) }; \
+	lp_logRecord(_lpLogFmt, 5, _lpArgs); } while (0)
+#define LP_LOG_6(fmt, a1, a2, a3, a4, a5, a6) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3), LP_LOG_ARG(a4), LP_LOG_ARG(a5), LP_LOG_ARG(a6) }; \
+	lp_logRecord(_lpLogFmt, 6, _lpArgs); } while (0)
+
+#else
+
+#define LP_LOG(...) Log_Debug(__VA_ARGS__)
+
+#endif // LP_LOG_BINARY
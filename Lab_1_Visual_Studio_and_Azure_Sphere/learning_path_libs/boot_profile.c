@@ -0,0 +1,149 @@
+#include "boot_profile.h"
+
+static LP_BOOT_PHASE_RECORD phases[LP_BOOT_PROFILE_MAX_PHASES];
+static size_t phaseCount = 0;
+static int openPhases[LP_BOOT_PROFILE_MAX_DEPTH];	// index in phases of each open phase, -1 if not recorded
+static int depth = 0;
+static struct timespec bootEnd;
+static bool bootDone = false;
+
+static double ElapsedMs(const struct timespec* from, const struct timespec* to) {
+	return (double)(to->tv_sec - from->tv_sec) * 1000.0 + (double)(to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+/// <summary>
+///     Starts a phase, use LP_BOOT_PHASE. Returns 1 so the phase body runs once.
+/// </summary>
+int lp_bootPhaseBegin(const char* name) {
+	int index = -1;
+
+	if (phaseCount < LP_BOOT_PROFILE_MAX_PHASES && depth < LP_BOOT_PROFILE_MAX_DEPTH && !bootDone) {
+		index = (int)phaseCount++;
+		phases[index].name = name;
+		phases[index].depth = depth;
+		phases[index].durationMs = 0;
+		clock_gettime(CLOCK_MONOTONIC, &phases[index].start);
+	}
+
+	if (depth < LP_BOOT_PROFILE_MAX_DEPTH) {
+		openPhases[depth] = index;
+	}
+	depth++;
+	return 1;
+}
+
+/// <summary>
+///     Ends the innermost phase. Returns 0 to leave the LP_BOOT_PHASE loop.
+/// </summary>
+int lp_bootPhaseEnd(void) {
+	struct timespec now;
+
+	if (depth == 0) {
+		return 0;
+	}
+	depth--;
+
+	if (depth < LP_BOOT_PROFILE_MAX_DEPTH && openPhases[depth] >= 0) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		phases[openPhases[depth]].durationMs = ElapsedMs(&phases[openPhases[depth]].start, &now);
+	}
+	return 0;
+}
+
+/// <summary>
+///     Time from the start of the first phase to lp_bootProfileDone
+/// </summary>
+double lp_bootProfileTotalMs(void) {
+	struct timespec now;
+
+	if (phaseCount == 0) {
+		return 0;
+	}
+	if (!bootDone) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return ElapsedMs(&phases[0].start, &now);
+	}
+	return ElapsedMs(&phases[0].start, &bootEnd);
+}
+
+/// <summary>
+///     Writes the path of a phase, its name prefixed with the names of the phases it is nested in
+/// </summary>
+static int PhasePath(size_t index, char* buffer, size_t bufferSize) {
+	const char* names[LP_BOOT_PROFILE_MAX_DEPTH];
+	int wanted = phases[index].depth;
+	int len = 0;
+
+	// The enclosing phase of each level is the closest earlier phase one level up
+	for (size_t i = index + 1; i-- > 0 && wanted >= 0;) {
+		if (phases[i].depth == wanted) {
+			names[wanted--] = phases[i].name;
+		}
+	}
+
+	for (int level = 0; level <= phases[index].depth && (size_t)len < bufferSize; level++) {
+		len += snprintf(buffer + len, bufferSize - (size_t)len, level == 0 ? "%s" : "/%s", names[level]);
+	}
+	return len;
+}
+
+/// <summary>
+///     Duration of the phase with the given path, e.g. "init/devKit". -1 if it was not recorded.
+/// </summary>
+double lp_bootPhaseMs(const char* path) {
+	char phasePath[128];
+
+	for (size_t i = 0; i < phaseCount; i++) {
+		PhasePath(i, phasePath, sizeof(phasePath));
+		if (strcmp(phasePath, path) == 0) {
+			return phases[i].durationMs;
+		}
+	}
+	return -1;
+}
+
+/// <summary>
+///     Ends the profile and logs the summary, later phases are not recorded
+/// </summary>
+void lp_bootProfileDone(void) {
+	if (bootDone) {
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &bootEnd);
+	bootDone = true;
+
+	if (phaseCount == 0) {
+		return;
+	}
+
+	Log_Debug("Boot profile: %.1f ms, started %.1f ms after device boot\n", lp_bootProfileTotalMs(),
+		ElapsedMs(&(struct timespec){0, 0}, &phases[0].start));
+	for (size_t i = 0; i < phaseCount; i++) {
+		Log_Debug("  %*s%-*s %8.1f ms\n", phases[i].depth * 2, "", 24 - phases[i].depth * 2, phases[i].name, phases[i].durationMs);
+	}
+}
+
+/// <summary>
+///     Formats the profile as a JSON telemetry message. Returns the length, 0 if it did not fit.
+/// </summary>
+size_t lp_bootProfileToJson(char* buffer, size_t bufferSize) {
+	char phasePath[128];
+	int len = snprintf(buffer, bufferSize, "{\"BootTimeMs\":%.1f,\"BootPhasesMs\":{", lp_bootProfileTotalMs());
+
+	for (size_t i = 0; i < phaseCount && len > 0 && (size_t)len < bufferSize; i++) {
+		PhasePath(i, phasePath, sizeof(phasePath));
+		len += snprintf(buffer + len, bufferSize - (size_t)len, "%s\"%s\":%.1f", i == 0 ? "" : ",", phasePath, phases[i].durationMs);
+	}
+
+	if (len > 0 && (size_t)len < bufferSize) {
+		len += snprintf(buffer + len, bufferSize - (size_t)len, "}}");
+	}
+
+	if (len <= 0 || (size_t)len >= bufferSize) {
+		if (bufferSize > 0) {
+			buffer[0] = '\0';
+		}
+		return 0;
+	}
+	return (size_t)len;
+}
@@ -0,0 +1,188 @@
+#include "telemetry.h"
+
+static int JsonEncode(LP_TELEMETRY_FIELD* fields[], size_t fieldCount, char* buffer, size_t bufferLen);
+
+const LP_TELEMETRY_ENCODER lp_telemetryJsonEncoder = {
+	.contentType = "application/json",
+	.contentEncoding = "utf-8",
+	.encode = JsonEncode
+};
+
+static LP_TELEMETRY_FIELD** _telemetryFields = NULL;
+static size_t _telemetryFieldCount = 0;
+
+void lp_openTelemetrySet(LP_TELEMETRY_FIELD* telemetryFields[], size_t telemetryFieldCount) {
+	_telemetryFields = telemetryFields;
+	_telemetryFieldCount = telemetryFieldCount;
+
+	for (size_t i = 0; i < _telemetryFieldCount; i++) {
+		if (_telemetryFields[i]->type != LP_TYPE_INT && _telemetryFields[i]->type != LP_TYPE_FLOAT && _telemetryFields[i]->type != LP_TYPE_BOOL) {
+			Log_Debug("\n\nTelemetry field '%s' missing type information.\nInclude .type option in LP_TELEMETRY_FIELD definition.\nValid types include LP_TYPE_BOOL, LP_TYPE_INT, LP_TYPE_FLOAT.\n\n", _telemetryFields[i]->name);
+			lp_terminate(ExitCode_OpenTelemetry);
+			return;
+		}
+		_telemetryFields[i]->hasValue = false;
+		_telemetryFields[i]->encoded = false;
+	}
+}
+
+void lp_closeTelemetrySet(void) {
+	_telemetryFields = NULL;
+	_telemetryFieldCount = 0;
+}
+
+void lp_setTelemetryInt(LP_TELEMETRY_FIELD* telemetryField, int value) {
+	telemetryField->value.i = value;
+	telemetryField->hasValue = true;
+}
+
+void lp_setTelemetryFloat(LP_TELEMETRY_FIELD* telemetryField, float value) {
+	telemetryField->value.f = value;
+	telemetryField->hasValue = true;
+}
+
+void lp_setTelemetryBool(LP_TELEMETRY_FIELD* telemetryField, bool value) {
+	telemetryField->value.b = value;
+	telemetryField->hasValue = true;
+}
+
+static time_t MonotonicSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+/// <summary>
+///     True if the field moved by at least its deltaThreshold, or was silent for maxSilence seconds, since it was last encoded
+/// </summary>
+static bool IsPending(const LP_TELEMETRY_FIELD* field, time_t now) {
+	if (!field->hasValue) {
+		return false;
+	}
+	if (!field->encoded || field->deltaThreshold <= 0) {
+		return true;
+	}
+	if (field->maxSilence > 0 && now - field->lastEncodedTime >= field->maxSilence) {
+		return true;
+	}
+
+	switch (field->type) {
+	case LP_TYPE_INT:
+		return fabsf((float)(field->value.i - field->lastEncoded.i)) >= field->deltaThreshold;
+	case LP_TYPE_FLOAT:
+		return isnan(field->value.f) != isnan(field->lastEncoded.f) || fabsf(field->value.f - field->lastEncoded.f) >= field->deltaThreshold;
+	case LP_TYPE_BOOL:
+		return field->value.b != field->lastEncoded.b;
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+///     Collects the pending fields of the telemetry set, returns the pending count. Returns 0 if only
+///     piggyback fields are pending.
+/// </summary>
+static size_t GetPendingFields(LP_TELEMETRY_FIELD* pending[]) {
+	time_t now = MonotonicSeconds();
+	size_t pendingCount = 0;
+	bool triggered = false;
+
+	for (size_t i = 0; i < _telemetryFieldCount; i++) {
+		if (IsPending(_telemetryFields[i], now)) {
+			pending[pendingCount++] = _telemetryFields[i];
+			triggered |= !_telemetryFields[i]->piggyback;
+		}
+	}
+	return triggered ? pendingCount : 0;
+}
+
+static void MarkEncoded(LP_TELEMETRY_FIELD* pending[], size_t pendingCount) {
+	time_t now = MonotonicSeconds();
+
+	for (size_t i = 0; i < pendingCount; i++) {
+		pending[i]->lastEncoded = pending[i]->value;
+		pending[i]->lastEncodedTime = now;
+		pending[i]->encoded = true;
+	}
+}
+
+/// <summary>
+///     Encodes the fields of the telemetry set that are pending. Returns the encoded length,
+///     0 if no field is pending, or -1 if the buffer is too small.
+/// </summary>
+int lp_encodeTelemetry(const LP_TELEMETRY_ENCODER* encoder, char* buffer, size_t bufferLen) {
+	LP_TELEMETRY_FIELD* pending[_telemetryFieldCount > 0 ? _telemetryFieldCount : 1];
+	size_t pendingCount = GetPendingFields(pending);
+
+	if (pendingCount == 0) {
+		return 0;
+	}
+
+	int len = encoder->encode(pending, pendingCount, buffer, bufferLen);
+
+	if (len > 0) {
+		MarkEncoded(pending, pendingCount);
+	}
+
+	return len;
+}
+
+/// <summary>
+///     Encodes the pending fields and sends them to Azure IoT, the fields are only marked as encoded once sent.
+///     Returns the sent length, 0 if no field is pending, or -1 if encoding or sending failed.
+/// </summary>
+int lp_sendTelemetry(const LP_TELEMETRY_ENCODER* encoder) {
+	static char buffer[LP_TELEMETRY_MAX_BYTES];
+	LP_TELEMETRY_FIELD* pending[_telemetryFieldCount > 0 ? _telemetryFieldCount : 1];
+	size_t pendingCount = GetPendingFields(pending);
+
+	if (pendingCount == 0) {
+		return 0;
+	}
+
+	int len = encoder->encode(pending, pendingCount, buffer, sizeof(buffer));
+
+	if (len <= 0) {
+		Log_Debug("ERROR: telemetry does not fit into %d bytes\n", LP_TELEMETRY_MAX_BYTES);
+		return -1;
+	}
+
+	if (!lp_sendMsgBytes((const unsigned char*)buffer, (size_t)len, encoder->contentType, encoder->contentEncoding)) {
+		return -1;
+	}
+
+	MarkEncoded(pending, pendingCount);
+	return len;
+}
+
+/// <summary>
+///     JSON encoder, numbers and booleans are written unquoted
+/// </summary>
+static int JsonEncode(LP_TELEMETRY_FIELD* fields[], size_t fieldCount, char* buffer, size_t bufferLen) {
+	char* p = buffer;
+	const char* end = buffer + bufferLen;
+
+	for (size_t i = 0; i < fieldCount; i++) {
+		// ,"name": the first ',' is replaced by lp_jsonClose
+		p = lp_jsonAppendLiteral(p, end, ",\"", 2);
+		p = lp_jsonAppendLiteral(p, end, fields[i]->name, strlen(fields[i]->name));
+		p = lp_jsonAppendLiteral(p, end, "\":", 2);
+
+		switch (fields[i]->type) {
+		case LP_TYPE_INT:
+			p = lp_jsonAppendInt(p, end, fields[i]->value.i);
+			break;
+		case LP_TYPE_FLOAT:
+			p = lp_jsonAppendFloat(p, end, fields[i]->value.f, fields[i]->precision);
+			break;
+		case LP_TYPE_BOOL:
+			p = fields[i]->value.b ? lp_jsonAppendLiteral(p, end, "true", 4) : lp_jsonAppendLiteral(p, end, "false", 5);
+			break;
+		default:
+			p = lp_jsonAppendLiteral(p, end, "null", 4);
+			break;
+		}
+	}
+
+	return lp_jsonClose(buffer, p, end);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "device_twins.h"
+#include "telemetry_template.h"
+#include "terminate.h"
+#include <applibs/log.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/*
+Declarative telemetry model.
+
+Each telemetry value is an LP_TELEMETRY_FIELD, registered as a set like the device twin bindings. Sensor code
+sets the field values, lp_encodeTelemetry serializes the set with a pluggable encoder. lp_sendTelemetry encodes
+and sends it with the content type of the encoder, JSON or binary CBOR, selectable per message.
+
+Fields are reported by exception. A field is only encoded when it has a value and it moved by at least
+deltaThreshold since it was last encoded (deltaThreshold 0 encodes every time), or when maxSilence seconds
+passed since it was last encoded. A piggyback field, e.g. a message counter, never triggers a message on its
+own and is only encoded along with other pending fields. Nothing is encoded when no field is pending.
+
+	static LP_TELEMETRY_FIELD temperature = { .name = "Temperature", .type = LP_TYPE_FLOAT, .precision = 2,
+		.deltaThreshold = 0.5f, .maxSilence = 600 };
+*/
+
+typedef union {
+	int i;
+	float f;
+	bool b;
+} LP_TELEMETRY_VALUE;
+
+struct _telemetryField {
+	const char* name;
+	valueType type;				// LP_TYPE_INT, LP_TYPE_FLOAT or LP_TYPE_BOOL
+	const char* unit;			// metadata, e.g. "degC", not sent by the JSON encoder
+	int precision;				// decimals for LP_TYPE_FLOAT
+	float deltaThreshold;		// minimum change since last encoded, 0 = always encode
+	int maxSilence;				// seconds after which the field is encoded even if unchanged, 0 = no limit
+	bool piggyback;				// only encoded along with other pending fields
+	LP_TELEMETRY_VALUE value;
+	LP_TELEMETRY_VALUE lastEncoded;
+	time_t lastEncodedTime;		// CLOCK_MONOTONIC seconds
+	bool hasValue;
+	bool encoded;
+};
+
+typedef struct _telemetryField LP_TELEMETRY_FIELD;
+
+typedef struct {
+	const char* contentType;
+	const char* contentEncoding;
+	/// returns the encoded length, or -1 if the buffer is too small
+	int (*encode)(LP_TELEMETRY_FIELD* fields[], size_t fieldCount, char* buffer, size_t bufferLen);
+} LP_TELEMETRY_ENCODER;
+
+#define LP_TELEMETRY_MAX_BYTES 512	// encode buffer size of lp_sendTelemetry
+
+extern const LP_TELEMETRY_ENCODER lp_telemetryJsonEncoder;
+extern const LP_TELEMETRY_ENCODER lp_telemetryCborEncoder;
+
+void lp_openTelemetrySet(LP_TELEMETRY_FIELD* telemetryFields[], size_t telemetryFieldCount);
+void lp_closeTelemetrySet(void);
+
+void lp_setTelemetryInt(LP_TELEMETRY_FIELD* telemetryField, int value);
+void lp_setTelemetryFloat(LP_TELEMETRY_FIELD* telemetryField, float value);
+void lp_setTelemetryBool(LP_TELEMETRY_FIELD* telemetryField, bool value);
+
+int lp_encodeTelemetry(const LP_TELEMETRY_ENCODER* encoder, char* buffer, size_t bufferLen);
+int lp_sendTelemetry(const LP_TELEMETRY_ENCODER* encoder);
@@ -66,7 +66,7 @@
 #endif // SEEED_STUDIO
 
 
-#define JSON_MESSAGE_BYTES 128  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+#define JSON_MESSAGE_BYTES 512  // Number of bytes to allocate for the JSON telemetry message for IoT Central
 
 // Forward signatures
 static void InitPeripheralsAndHandlers(void);
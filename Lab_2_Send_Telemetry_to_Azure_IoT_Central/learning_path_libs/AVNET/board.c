@@ -1,41 +1,164 @@
 #include "board.h"
 
+static LP_TELEMETRY_FIELD temperatureTelemetry = { .name = "Temperature", .type = LP_TYPE_FLOAT, .unit = "degC", .precision = 2, .deltaThreshold = 0.2f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD humidityTelemetry = { .name = "Humidity", .type = LP_TYPE_FLOAT, .unit = "%", .precision = 1, .deltaThreshold = 1.0f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD pressureTelemetry = { .name = "Pressure", .type = LP_TYPE_FLOAT, .unit = "hPa", .precision = 1, .deltaThreshold = 0.5f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD lightTelemetry = { .name = "Light", .type = LP_TYPE_INT, .unit = "lux", .deltaThreshold = 10, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD msgIdTelemetry = { .name = "MsgId", .type = LP_TYPE_INT, .piggyback = true };
+
+static LP_TELEMETRY_FIELD temperatureMinTelemetry = { .name = "TemperatureMin", .type = LP_TYPE_FLOAT, .unit = "degC", .precision = 2, .deltaThreshold = 0.2f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD temperatureMaxTelemetry = { .name = "TemperatureMax", .type = LP_TYPE_FLOAT, .unit = "degC", .precision = 2, .deltaThreshold = 0.2f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD temperatureStdDevTelemetry = { .name = "TemperatureStdDev", .type = LP_TYPE_FLOAT, .unit = "degC", .precision = 2, .deltaThreshold = 0.1f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD pressureMinTelemetry = { .name = "PressureMin", .type = LP_TYPE_FLOAT, .unit = "hPa", .precision = 1, .deltaThreshold = 0.5f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD pressureMaxTelemetry = { .name = "PressureMax", .type = LP_TYPE_FLOAT, .unit = "hPa", .precision = 1, .deltaThreshold = 0.5f, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD pressureStdDevTelemetry = { .name = "PressureStdDev", .type = LP_TYPE_FLOAT, .unit = "hPa", .precision = 2, .deltaThreshold = 0.1f, .maxSilence = 600 };
+
+static LP_TELEMETRY_FIELD* telemetrySet[] = { &temperatureTelemetry, &temperatureMinTelemetry, &temperatureMaxTelemetry, &temperatureStdDevTelemetry,
+	&humidityTelemetry, &pressureTelemetry, &pressureMinTelemetry, &pressureMaxTelemetry, &pressureStdDevTelemetry, &lightTelemetry, &msgIdTelemetry };
+
+// The sensors are sampled every second, each telemetry message carries the aggregates of the samples since the last message.
+// The I2C transfers block for up to the 100 ms bus timeout, the sensors are read on a worker thread.
+static void SampleSensorsHandler(EventLoopTimer* eventLoopTimer);
+static void ReadSensors(LP_WORK_ITEM* item);
+static void SensorsRead(LP_WORK_ITEM* item);
+
+typedef struct {
+	bool pressureUpdated;		// AvnetSkSensorUpdate read a new temperature and pressure
+	float temperature;
+	float pressure;
+	AngularRateDegreesPerSecond angularRate;
+	AccelerationMilligForce acceleration;
+} SensorSample;
+
+static SensorSample sensorSample;		// written by ReadSensors, read in SensorsRead
+static SensorSample latestSample;		// event loop copy
+
+static LP_WORK_ITEM sampleSensorsWork = { .name = "sampleSensors", .work = ReadSensors, .done = SensorsRead };
+
+static LP_TIMER sampleSensorsTimer = { .period = { 1, 0 }, .slack = { 0, 100 * 1000 * 1000 }, .name = "sampleSensorsTimer", .handler = SampleSensorsHandler };
+
+static LP_AGGREGATOR temperatureAggregate = { .type = LP_WINDOW_TUMBLING };
+static LP_AGGREGATOR pressureAggregate = { .type = LP_WINDOW_TUMBLING };
 
 /// <summary>
-///     Reads telemetry and returns the length of JSON data.
+///     Reads the sensors, runs on a worker thread
 /// </summary>
-int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
+static void ReadSensors(LP_WORK_ITEM* item) {
+	// false while no new pressure sample is available
+	sensorSample.pressureUpdated = AvnetSkSensorUpdate();
+	sensorSample.temperature = GetTemperature();
+	sensorSample.pressure = GetPressure();
+	sensorSample.angularRate = GetAngularRate();
+	sensorSample.acceleration = GetAcceleration();
+}
+
+/// <summary>
+///     Adds the sensor readings to the aggregation windows, on the event loop
+/// </summary>
+static void SensorsRead(LP_WORK_ITEM* item) {
+	latestSample = sensorSample;
+
+	if (latestSample.pressureUpdated) {
+		lp_aggregateAdd(&temperatureAggregate, latestSample.temperature);
+		lp_aggregateAdd(&pressureAggregate, latestSample.pressure);
+	}
+}
+
+static void SampleSensors(void) {
+	// Skipped until the sensors are initialized and calibrated, and while the previous sample is still being read
+	if (AvnetSkSensorsReady()) {
+		lp_submitWork(&sampleSensorsWork);
+	}
+}
+
+static void SampleSensorsHandler(EventLoopTimer* eventLoopTimer) {
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+		return;
+	}
+	SampleSensors();
+}
+
+/// <summary>
+///     Sets the mean, min, max and standard deviation fields and starts a new window
+/// </summary>
+static void SetAggregateTelemetry(LP_AGGREGATOR* aggregator, LP_TELEMETRY_FIELD* mean, LP_TELEMETRY_FIELD* min, LP_TELEMETRY_FIELD* max, LP_TELEMETRY_FIELD* stdDev) {
+	LP_AGGREGATE aggregate;
+
+	if (lp_aggregateGet(aggregator, &aggregate)) {
+		lp_setTelemetryFloat(mean, aggregate.mean);
+		lp_setTelemetryFloat(min, aggregate.min);
+		lp_setTelemetryFloat(max, aggregate.max);
+		lp_setTelemetryFloat(stdDev, aggregate.stddev);
+	}
+	lp_aggregateReset(aggregator);
+}
+
+/// <summary>
+///     Reads the sensors into the telemetry fields
+/// </summary>
+static void ReadTelemetry(void) {
 	static int msgId = 0;
-	float temperature;
 	float humidity;
-	float pressure;
 	int light = 0;
 
-	AvnetSkSensorUpdate(); // Important - this must be called immediately before reading the telemetry
-
-	AngularRateDegreesPerSecond ardps = GetAngularRate();
-	AccelerationMilligForce amgf = GetAcceleration();
+	// The latest sample is at most one sample period old
+	AngularRateDegreesPerSecond ardps = latestSample.angularRate;
+	AccelerationMilligForce amgf = latestSample.acceleration;
 	
 	Log_Debug("\nLSM6DSO: Angular rate [degrees per second] : %4.2f, %4.2f, %4.2f", ardps.x, ardps.y, ardps.z);
 	Log_Debug("\nLSM6DSO: Acceleration [millig force]  : %.4lf, %.4lf, %.4lf\n", amgf.x, amgf.y, amgf.z);
 
-	pressure = GetPressure();
-	temperature = GetTemperature();
 	//light = GetLightLevel();
 
 	int rnd = (rand() % 10) - 5;
 	humidity = (float)(50.0 + rnd);
 
-	static const char* MsgTemplate = "{ \"Temperature\": \"%3.2f\", \"Humidity\": \"%3.1f\", \"Pressure\":\"%3.1f\", \"Light\":%d, \"MsgId\":%d }";
-	return snprintf(msgBuffer, bufferLen, MsgTemplate, temperature, humidity, pressure, light, msgId++);
+	SetAggregateTelemetry(&temperatureAggregate, &temperatureTelemetry, &temperatureMinTelemetry, &temperatureMaxTelemetry, &temperatureStdDevTelemetry);
+	SetAggregateTelemetry(&pressureAggregate, &pressureTelemetry, &pressureMinTelemetry, &pressureMaxTelemetry, &pressureStdDevTelemetry);
+	lp_setTelemetryFloat(&humidityTelemetry, humidity);
+	lp_setTelemetryInt(&lightTelemetry, light);
+	lp_setTelemetryInt(&msgIdTelemetry, msgId++);
+}
+
+/// <summary>
+///     Reads telemetry and returns the length of JSON data, 0 if no field changed beyond its deltaThreshold
+/// </summary>
+int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
+	ReadTelemetry();
+	return lp_encodeTelemetry(&lp_telemetryJsonEncoder, msgBuffer, bufferLen);
+}
+
+/// <summary>
+///     Reads telemetry and sends it with the encoder, JSON or CBOR. Returns the sent length, 0 if no field
+///     changed beyond its deltaThreshold, or -1 if sending failed.
+/// </summary>
+int lp_sendDevKitTelemetry(const LP_TELEMETRY_ENCODER* encoder) {
+	ReadTelemetry();
+	return lp_sendTelemetry(encoder);
+}
+
+/// <summary>
+///     The handler is called once the sensors are initialized and calibrated, set it before lp_initializeDevKit
+/// </summary>
+void lp_setDevKitReadyHandler(void (*readyHandler)(bool ready)) {
+	setSensorsReadyHandler(readyHandler);
 }
 
 bool lp_initializeDevKit(void) {
 
 	srand((unsigned int)time(NULL)); // seed the random number generator for fake telemetry
 
+	lp_openTelemetrySet(telemetrySet, NELEMS(telemetrySet));
+
 	if (initI2c() == -1) {
-		return -1;
+		return false;
+	}
+
+	if (!lp_startTimer(&sampleSensorsTimer)) {
+		closeI2c();
+		lp_closeTelemetrySet();
+		return false;
 	}
 
 	//OpenADC();
@@ -44,6 +167,9 @@ bool lp_initializeDevKit(void) {
 }
 
 bool lp_closeDevKit(void) {
+	lp_stopTimer(&sampleSensorsTimer);
+	lp_waitForWork(&sampleSensorsWork);
+	lp_closeTelemetrySet();
 	closeI2c();
 	return true;
 }
@@ -5,7 +5,10 @@
 #include <stdlib.h>
 #include <time.h>
 #include "hw/azure_sphere_learning_path.h"
+#include "../telemetry.h"
 
 int lp_readTelemetry(char* msgBuffer, size_t bufferLen);
+int lp_sendDevKitTelemetry(const LP_TELEMETRY_ENCODER* encoder);
 bool lp_initializeDevKit(void);
+void lp_setDevKitReadyHandler(void (*readyHandler)(bool ready));
 bool lp_closeDevKit(void);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "binary_log.h"
 #include "device_twins.h"
 #include "direct_methods.h"
 #include "globals.h"
@@ -8,7 +9,6 @@
 #include "timer.h"
 #include <applibs/log.h>
 #include <applibs/networking.h>
-#include <azure_sphere_provisioning.h>
 #include <errno.h>
 #include <iothub_client_options.h>
 #include <iothub_device_client_ll.h>
@@ -17,10 +17,23 @@
 
 //extern IOTHUB_DEVICE_CLIENT_LL_HANDLE iothubClientHandle;
 
+typedef enum {
+	LP_AZURE_DISCONNECTED,
+	LP_AZURE_PROVISIONING,
+	LP_AZURE_CONNECTING,
+	LP_AZURE_AUTHENTICATED,
+	LP_AZURE_BACKOFF
+} LP_AZURE_CONNECTION_STATE;
+
 bool lp_sendMsg(const char* msg);
+bool lp_sendMsgBytes(const unsigned char* data, size_t length, const char* contentType, const char* contentEncoding);
 void lp_startCloudToDevice(void);
 void lp_stopCloudToDevice(void);
+void lp_azureClientActivity(void);
 void lp_setConnectionString(const char* connectionString); // Note, do not use Connection Strings for Production - this is here for lab workaround
 IOTHUB_DEVICE_CLIENT_LL_HANDLE lp_getAzureIotClientHandle(void);
 bool lp_connectToAzureIot(void);
+bool lp_isAzureClientReady(void);
+LP_AZURE_CONNECTION_STATE lp_getAzureConnectionState(void);
+void lp_setAzureConnectionStateHandler(void (*handler)(LP_AZURE_CONNECTION_STATE state));
 bool lp_isNetworkReady(void);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <applibs/log.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+Boot phase profiler.
+
+LP_BOOT_PHASE runs the statement or block that follows it as a named phase and records its CLOCK_MONOTONIC
+start and duration. Phases nest, a phase inside another is recorded as its sub-phase:
+
+	LP_BOOT_PHASE("init") {
+		LP_BOOT_PHASE("devKit") lp_initializeDevKit();
+		LP_BOOT_PHASE("timers") lp_startTimerSet(timerSet, NELEMS(timerSet));
+	}
+	lp_bootProfileDone();
+
+lp_bootProfileDone logs the summary. lp_bootProfileToJson formats it for a one-off telemetry message,
+phases are keyed by their path, e.g. "init/devKit". Do not leave a phase block with return, break or goto,
+the phase would not end. Phases after LP_BOOT_PROFILE_MAX_PHASES are not recorded.
+*/
+
+#define LP_BOOT_PROFILE_MAX_PHASES 32
+#define LP_BOOT_PROFILE_MAX_DEPTH 4
+
+#define LP_BOOT_PHASE(name) for (int _lpBootPhase = lp_bootPhaseBegin(name); _lpBootPhase; _lpBootPhase = lp_bootPhaseEnd())
+
+typedef struct {
+	const char* name;
+	int depth;					// 0 for top level phases
+	struct timespec start;
+	double durationMs;
+} LP_BOOT_PHASE_RECORD;
+
+int lp_bootPhaseBegin(const char* name);
+int lp_bootPhaseEnd(void);
+void lp_bootProfileDone(void);
+double lp_bootProfileTotalMs(void);
+double lp_bootPhaseMs(const char* path);
+size_t lp_bootProfileToJson(char* buffer, size_t bufferSize);
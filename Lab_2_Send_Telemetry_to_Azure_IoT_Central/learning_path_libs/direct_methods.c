@@ -13,6 +13,76 @@ void lp_closeDirectMethodSet(void) {
 	_directMethodCount = 0;
 }
 
+/// <summary>
+///     Formats the response into the buffer. A message is written after the opening quote and escaped in place.
+///     False if it did not fit, the response is then empty.
+/// </summary>
+static bool SetResponse(LP_DIRECT_METHOD_RESPONSE* response, bool isJson, const char* format, va_list args) {
+	size_t offset = isJson ? 0 : 1;
+	char* text = response->buffer + offset;
+	int len = vsnprintf(text, response->size - offset, format, args);
+
+	response->length = 0;
+	response->overflow = len < 0 || (size_t)len >= response->size - offset;
+	if (response->overflow) {
+		return false;
+	}
+
+	if (isJson) {
+		response->length = (size_t)len;
+		return true;
+	}
+
+	size_t escapes = 0;
+	for (int i = 0; i < len; i++) {
+		if (text[i] == '"' || text[i] == '\\') {
+			escapes++;
+		}
+	}
+
+	// Both quotes, no terminator, the SDK takes the length
+	if ((size_t)len + escapes + 2 > response->size) {
+		response->overflow = true;
+		return false;
+	}
+
+	// Backwards, so every character moves at most once
+	for (size_t src = (size_t)len, dst = (size_t)len + escapes; src-- > 0;) {
+		char c = (unsigned char)text[src] < 0x20 ? ' ' : text[src];
+		text[--dst] = c;
+		if (c == '"' || c == '\\') {
+			text[--dst] = '\\';
+		}
+	}
+
+	response->buffer[0] = '"';
+	response->buffer[1 + len + escapes] = '"';
+	response->length = (size_t)len + escapes + 2;
+	return true;
+}
+
+/// <summary>
+///     Sets the response to a message, sent as a JSON string
+/// </summary>
+bool lp_setDirectMethodMessage(LP_DIRECT_METHOD_RESPONSE* response, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	bool result = SetResponse(response, false, format, args);
+	va_end(args);
+	return result;
+}
+
+/// <summary>
+///     Sets the response to a JSON value, e.g. an object, sent as formatted
+/// </summary>
+bool lp_setDirectMethodJson(LP_DIRECT_METHOD_RESPONSE* response, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	bool result = SetResponse(response, true, format, args);
+	va_end(args);
+	return result;
+}
+
 /*
 This implementation of Direct Methods expects a JSON Payload Object
 */
@@ -24,108 +94,97 @@ int lp_azureDirectMethodHandler(const char* method_name, const unsigned char* pa
 	const char* methodErrorMsg = "Method Error";
 	const char* mallocFailedMsg = "Memory Allocation failed";
 	const char* invalidJsonMsg = "Invalid JSON";
+	const char* responseTooLargeMsg = "Response too large";
 
-	LP_DirectMethodResponseCode responseCode = LP_METHOD_NOT_FOUND;
-	char* responseMsg = NULL;
-
+	char payloadStack[LP_DIRECT_METHOD_PAYLOAD_STACK_BYTES];
+	char* payLoadString = NULL;
 	LP_DIRECT_METHOD_BINDING* directMethodBinding = NULL;
-
-	const char* responseMessage = methodNotFoundMsg;
+	LP_DIRECT_METHOD_RESPONSE response = { 0 };
 	int result = LP_METHOD_NOT_FOUND;
-	size_t responseMessageLength;
 
 	JSON_Value* root_value = NULL;
 	JSON_Object* jsonObject = NULL;
 
-	// Prepare the payload for the response. This is a heap allocated null terminated string.
-	// The Azure IoT Hub SDK is responsible of freeing it.
+	// The response buffer is the only allocation, the Azure IoT Hub SDK is responsible of freeing it.
 	*responsePayload = NULL;  // Response payload content.
 	*responsePayloadSize = 0; // Response payload content size.
 
-	char* payLoadString = (char*)malloc(payloadSize + 1);
+	// The response goes out with the next DoWork
+	lp_azureClientActivity();
+
+	// loop through array of DirectMethodBindings looking for a matching method name
+	for (int i = 0; i < _directMethodCount; i++) {
+		if (strcmp(method_name, _directMethods[i]->methodName) == 0) {
+			directMethodBinding = _directMethods[i];
+			break;
+		}
+	}
+
+	// Never below the default, the error messages must fit
+	response.size = directMethodBinding != NULL && directMethodBinding->responseBytes > LP_DIRECT_METHOD_RESPONSE_BYTES ?
+		directMethodBinding->responseBytes : LP_DIRECT_METHOD_RESPONSE_BYTES;
+	response.buffer = (char*)malloc(response.size);
+	if (response.buffer == NULL) {
+		Log_Debug("ERROR: %s for the %s response\n", mallocFailedMsg, method_name);
+		return LP_METHOD_FAILED;
+	}
+
+	// parson wants a null terminated string, small payloads are copied to the stack
+	payLoadString = payloadSize < sizeof(payloadStack) ? payloadStack : (char*)malloc(payloadSize + 1);
 	if (payLoadString == NULL) {
-		responseMessage = mallocFailedMsg;
+		lp_setDirectMethodMessage(&response, "%s", mallocFailedMsg);
 		result = LP_METHOD_FAILED;
 		goto cleanup;
 	}
 
-	memcpy(payLoadString, payload, payloadSize);
+	if (payloadSize > 0) {
+		memcpy(payLoadString, payload, payloadSize);
+	}
 	payLoadString[payloadSize] = 0; //null terminate string
 
 	root_value = json_parse_string(payLoadString);
 	if (root_value == NULL) {
-		responseMessage = invalidJsonMsg;
+		lp_setDirectMethodMessage(&response, "%s", invalidJsonMsg);
 		result = LP_METHOD_FAILED;
 		goto cleanup;
 	}
 
 	jsonObject = json_value_get_object(root_value);
 	if (jsonObject == NULL) {
-		responseMessage = invalidJsonMsg;
+		lp_setDirectMethodMessage(&response, "%s", invalidJsonMsg);
 		result = LP_METHOD_FAILED;
 		goto cleanup;
 	}
 
-	// loop through array of DirectMethodBindings looking for a matching method name
-	for (int i = 0; i < _directMethodCount; i++) {
-		if (strcmp(method_name, _directMethods[i]->methodName) == 0) {
-			directMethodBinding = _directMethods[i];
-			break;
-		}
-	}
-
 	if (directMethodBinding != NULL && directMethodBinding->handler != NULL) {	// was a LP_DIRECT_METHOD_BINDING found
 
-		responseCode = directMethodBinding->handler(jsonObject, directMethodBinding, &responseMsg);
+		result = (int)directMethodBinding->handler(jsonObject, directMethodBinding, &response);
 
-		result = (int)responseCode;
-
-		switch (responseCode)
-		{
-		case LP_METHOD_SUCCEEDED:	// 200
-			responseMessage = strlen(responseMsg) == 0 ? methodSucceededMsg : responseMsg;
-			break;
-		case LP_METHOD_FAILED:		// 500
-			responseMessage = strlen(responseMsg) == 0 ? methodErrorMsg : responseMsg;
-			break;
-		case LP_METHOD_NOT_FOUND:
-			break;
+		if (response.overflow) {
+			lp_setDirectMethodMessage(&response, "%s", responseTooLargeMsg);
+			result = LP_METHOD_FAILED;
 		}
+		else if (response.length == 0) {
+			lp_setDirectMethodMessage(&response, "%s", result == LP_METHOD_SUCCEEDED ? methodSucceededMsg :
+				result == LP_METHOD_FAILED ? methodErrorMsg : methodNotFoundMsg);
+		}
+	}
+	else {
+		lp_setDirectMethodMessage(&response, "%s", methodNotFoundMsg);
 	}
 
 cleanup:
 
-	// Prepare the payload for the response.
-	// The Azure IoT Hub SDK is responsible of freeing it.
-	responseMessageLength = strlen(responseMessage);
-	*responsePayloadSize = responseMessageLength + 2; // add two as going to wrap the message with quotes for JSON
-
-	*responsePayload = (unsigned char*)malloc(*responsePayloadSize);
-	if (*responsePayload != NULL) {
-		// response message needs to be wrapped in quotes as it is part of the JSON payload object
-		memcpy(*responsePayload, "\"", 1);
-		memcpy(*responsePayload + 1, responseMessage, responseMessageLength);
-		memcpy(*responsePayload + responseMessageLength + 1, "\"", 1);
-	}
-	else {
-		*responsePayloadSize = 0;
-	}
+	*responsePayload = (unsigned char*)response.buffer;
+	*responsePayloadSize = response.length;
 
 	if (root_value != NULL) {
 		json_value_free(root_value);
 	}
 
-	if (payLoadString != NULL) {
+	if (payLoadString != NULL && payLoadString != payloadStack) {
 		free(payLoadString);
-		payLoadString = NULL;
-	}
-
-	if (directMethodBinding != NULL) {
-		if (responseMsg != NULL) { // there was memory allocated for a response message so free it now
-			free(responseMsg);
-			responseMsg = NULL;
-		}
 	}
 
 	return result;
-}
\ No newline at end of file
+}
@@ -59,6 +59,8 @@ void DisposeEventLoopTimer(EventLoopTimer *timer);
 
 /// <summary>
 /// The timer callback should call this function to consume the timer event.
+/// All timers of an event loop share one timerfd, which is read once per wakeup
+/// before the callbacks run, so this no longer makes a system call.
 /// </summary>
 /// <param name="timer">Successfully allocated timer.</param>
 /// <returns>0 on success, -1 on failure, in which case errno contains more information.</returns>
@@ -90,6 +92,28 @@ int SetEventLoopTimerPeriod(EventLoopTimer *timer, const struct timespec *period
 /// <seealso cref="DisarmEventLoopTimer" />
 int SetEventLoopTimerOneShot(EventLoopTimer *timer, const struct timespec *delay);
 
+/// <summary>
+/// Let the timer expire up to slack after its deadline, so that timers of the same
+/// event loop whose windows overlap are run in one wakeup. Periodic timers keep their
+/// period on average, the slack only delays individual expiries.
+/// </summary>
+/// <param name="timer">LP_TIMER previously allocated with <see cref="CreateEventLoopPeriodicTimer" />
+/// or <see cref="CreateEventLoopDisarmedTimer" />.</param>
+/// <param name="slack">Tolerated delay, NULL or zero for none.</param>
+/// <returns>0 on success, -1 on failure, in which case errno contains more
+/// information.</returns>
+int SetEventLoopTimerSlack(EventLoopTimer *timer, const struct timespec *slack);
+
+/// <summary>
+/// Name the timer, the handler stats record its calls under this name when LP_HANDLER_STATS is defined.
+/// </summary>
+/// <param name="timer">LP_TIMER previously allocated with <see cref="CreateEventLoopPeriodicTimer" />
+/// or <see cref="CreateEventLoopDisarmedTimer" />.</param>
+/// <param name="name">Name, must outlive the timer.</param>
+/// <returns>0 on success, -1 on failure, in which case errno contains more
+/// information.</returns>
+int SetEventLoopTimerName(EventLoopTimer *timer, const char *name);
+
 /// <summary>
 /// Disarm an existing event loop timer.
 /// </summary>
@@ -0,0 +1,164 @@
+#include "telemetry.h"
+
+/*
+CBOR (RFC 7049) telemetry encoder. The field set is written as a map of text string keys to
+integers, booleans and floats. A float is written as half precision (3 bytes) when it rounds to
+the same value at the field precision, otherwise as single precision (5 bytes).
+*/
+
+static int CborEncode(LP_TELEMETRY_FIELD* fields[], size_t fieldCount, char* buffer, size_t bufferLen);
+
+const LP_TELEMETRY_ENCODER lp_telemetryCborEncoder = {
+	.contentType = "application/cbor",
+	.contentEncoding = NULL,
+	.encode = CborEncode
+};
+
+#define CBOR_UNSIGNED	0x00
+#define CBOR_NEGATIVE	0x20
+#define CBOR_TEXT		0x60
+#define CBOR_MAP		0xA0
+#define CBOR_FALSE		0xF4
+#define CBOR_TRUE		0xF5
+#define CBOR_HALF		0xF9
+#define CBOR_FLOAT		0xFA
+
+static const double precisionScale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+/// <summary>
+///     Writes a major type with its argument in the shortest form. Returns NULL if there is no room.
+/// </summary>
+static uint8_t* AppendHeader(uint8_t* p, const uint8_t* end, uint8_t majorType, uint32_t argument) {
+	int len = argument < 24 ? 1 : argument <= 0xFF ? 2 : argument <= 0xFFFF ? 3 : 5;
+
+	if (p == NULL || end - p < len) {
+		return NULL;
+	}
+
+	switch (len) {
+	case 1:
+		*p++ = (uint8_t)(majorType | argument);
+		break;
+	case 2:
+		*p++ = majorType | 24;
+		*p++ = (uint8_t)argument;
+		break;
+	case 3:
+		*p++ = majorType | 25;
+		*p++ = (uint8_t)(argument >> 8);
+		*p++ = (uint8_t)argument;
+		break;
+	default:
+		*p++ = majorType | 26;
+		*p++ = (uint8_t)(argument >> 24);
+		*p++ = (uint8_t)(argument >> 16);
+		*p++ = (uint8_t)(argument >> 8);
+		*p++ = (uint8_t)argument;
+		break;
+	}
+
+	return p;
+}
+
+static uint8_t* AppendBytes(uint8_t* p, const uint8_t* end, const void* data, size_t len) {
+	if (p == NULL || (size_t)(end - p) < len) {
+		return NULL;
+	}
+	memcpy(p, data, len);
+	return p + len;
+}
+
+/// <summary>
+///     Converts to IEEE 754 half precision, returns false if value is outside the normal half range
+/// </summary>
+static bool FloatToHalf(float value, uint16_t* half) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if ((bits & 0x7FFFFFFF) == 0) {
+		*half = sign;
+		return true;
+	}
+
+	// half subnormals are not used
+	if (exponent < 1 || exponent > 30) {
+		return false;
+	}
+
+	// round to nearest, a mantissa carry moves into the exponent
+	uint32_t rounded = (((uint32_t)exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1);
+	if (rounded >= 0x7C00) {
+		return false;
+	}
+
+	*half = (uint16_t)(sign | rounded);
+	return true;
+}
+
+static float HalfToFloat(uint16_t half) {
+	if ((half & 0x7FFF) == 0) {
+		return (half & 0x8000) ? -0.0f : 0.0f;
+	}
+	float value = ldexpf((float)((half & 0x3FF) | 0x400), ((half >> 10) & 0x1F) - 15 - 10);
+	return (half & 0x8000) ? -value : value;
+}
+
+static uint8_t* AppendFloat(uint8_t* p, const uint8_t* end, float value, int precision) {
+	uint16_t half;
+
+	if (precision < 0) {
+		precision = 0;
+	} else if (precision >= NELEMS(precisionScale)) {
+		precision = NELEMS(precisionScale) - 1;
+	}
+
+	// float times scale is exact in double, llrint rounds half to even like the JSON encoder
+	if (FloatToHalf(value, &half) && llrint(HalfToFloat(half) * precisionScale[precision]) == llrint(value * precisionScale[precision])) {
+		uint8_t encoded[] = { CBOR_HALF, (uint8_t)(half >> 8), (uint8_t)half };
+		return AppendBytes(p, end, encoded, sizeof(encoded));
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint8_t encoded[] = { CBOR_FLOAT, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits };
+	return AppendBytes(p, end, encoded, sizeof(encoded));
+}
+
+/// <summary>
+///     CBOR encoder, returns the encoded length or -1 if the buffer is too small
+/// </summary>
+static int CborEncode(LP_TELEMETRY_FIELD* fields[], size_t fieldCount, char* buffer, size_t bufferLen) {
+	uint8_t* p = (uint8_t*)buffer;
+	const uint8_t* end = p + bufferLen;
+
+	p = AppendHeader(p, end, CBOR_MAP, (uint32_t)fieldCount);
+
+	for (int i = 0; i < fieldCount; i++) {
+		size_t nameLength = strlen(fields[i]->name);
+		p = AppendHeader(p, end, CBOR_TEXT, (uint32_t)nameLength);
+		p = AppendBytes(p, end, fields[i]->name, nameLength);
+
+		switch (fields[i]->type) {
+		case LP_TYPE_INT:
+			// negative integers are encoded as -1 - n
+			p = fields[i]->value.i < 0
+				? AppendHeader(p, end, CBOR_NEGATIVE, (uint32_t)(-1 - fields[i]->value.i))
+				: AppendHeader(p, end, CBOR_UNSIGNED, (uint32_t)fields[i]->value.i);
+			break;
+		case LP_TYPE_FLOAT:
+			p = AppendFloat(p, end, fields[i]->value.f, fields[i]->precision);
+			break;
+		case LP_TYPE_BOOL:
+			p = AppendBytes(p, end, fields[i]->value.b ? &(uint8_t){ CBOR_TRUE } : &(uint8_t){ CBOR_FALSE }, 1);
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	return p == NULL ? -1 : (int)(p - (uint8_t*)buffer);
+}
@@ -64,7 +64,7 @@
 #include "learning_path_libs/SEEED_STUDIO/board.h"
 #endif // SEEED_STUDIO
 
-#define JSON_MESSAGE_BYTES 128  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+#define JSON_MESSAGE_BYTES 512  // Number of bytes to allocate for the JSON telemetry message for IoT Central
 
 // Forward signatures
 static void InitPeripheralsAndHandlers(void);
@@ -290,6 +290,7 @@ static void InitPeripheralsAndHandlers(void)
 	lp_openPeripheralGpioSet(peripheralGpioSet, NELEMS(peripheralGpioSet));
 
 	lp_startTimerSet(timerSet, NELEMS(timerSet));
+	lp_logStart();
 }
 
 /// <summary>
@@ -301,6 +302,7 @@ static void ClosePeripheralsAndHandlers(void)
 
 	lp_stopTimerSet();
 	lp_stopCloudToDevice();
+	lp_logStop();
 
 	lp_closePeripheralGpioSet();
 
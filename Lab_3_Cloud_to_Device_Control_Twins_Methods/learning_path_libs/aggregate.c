@@ -0,0 +1,123 @@
+#include "aggregate.h"
+
+static void AddToMoments(LP_AGGREGATOR* aggregator, float value) {
+	// Welford running mean and sum of squared differences
+	aggregator->count++;
+	double delta = value - aggregator->mean;
+	aggregator->mean += delta / aggregator->count;
+	aggregator->m2 += delta * (value - aggregator->mean);
+}
+
+static void RemoveFromMoments(LP_AGGREGATOR* aggregator, float value) {
+	if (aggregator->count <= 1) {
+		aggregator->count = 0;
+		aggregator->mean = 0.0;
+		aggregator->m2 = 0.0;
+		return;
+	}
+
+	double mean = (aggregator->mean * aggregator->count - value) / (aggregator->count - 1);
+	aggregator->m2 -= (value - aggregator->mean) * (value - mean);
+	aggregator->mean = mean;
+	aggregator->count--;
+}
+
+/// <summary>
+///     Adds the sample to a monotonic queue, samples that can no longer be the minimum (or maximum) are dropped
+/// </summary>
+static void PushMonotonic(LP_AGGREGATOR* aggregator, uint32_t* queue, size_t head, size_t* size, float value, bool isMin) {
+	while (*size > 0) {
+		float back = aggregator->samples[queue[(head + *size - 1) % aggregator->length] % aggregator->length];
+		if (isMin ? back < value : back > value) {
+			break;
+		}
+		(*size)--;
+	}
+	queue[(head + *size) % aggregator->length] = aggregator->sequence;
+	(*size)++;
+}
+
+static void AddSliding(LP_AGGREGATOR* aggregator, float value) {
+	size_t slot = aggregator->sequence % aggregator->length;
+
+	// The oldest sample leaves the window, it can only be at the front of the queues
+	if (aggregator->count == aggregator->length) {
+		uint32_t expired = aggregator->sequence - (uint32_t)aggregator->length;
+
+		RemoveFromMoments(aggregator, aggregator->samples[slot]);
+		if (aggregator->minSize > 0 && aggregator->minQueue[aggregator->minHead] == expired) {
+			aggregator->minHead = (aggregator->minHead + 1) % aggregator->length;
+			aggregator->minSize--;
+		}
+		if (aggregator->maxSize > 0 && aggregator->maxQueue[aggregator->maxHead] == expired) {
+			aggregator->maxHead = (aggregator->maxHead + 1) % aggregator->length;
+			aggregator->maxSize--;
+		}
+	}
+
+	aggregator->samples[slot] = value;
+	PushMonotonic(aggregator, aggregator->minQueue, aggregator->minHead, &aggregator->minSize, value, true);
+	PushMonotonic(aggregator, aggregator->maxQueue, aggregator->maxHead, &aggregator->maxSize, value, false);
+	aggregator->sequence++;
+
+	AddToMoments(aggregator, value);
+}
+
+void lp_aggregateReset(LP_AGGREGATOR* aggregator) {
+	aggregator->count = 0;
+	aggregator->sequence = 0;
+	aggregator->mean = 0.0;
+	aggregator->m2 = 0.0;
+	aggregator->minHead = aggregator->minSize = 0;
+	aggregator->maxHead = aggregator->maxSize = 0;
+}
+
+/// <summary>
+///     Adds a sample to the window, samples that are not finite are ignored
+/// </summary>
+void lp_aggregateAdd(LP_AGGREGATOR* aggregator, float value) {
+	if (!isfinite(value)) {
+		return;
+	}
+
+	if (aggregator->type == LP_WINDOW_SLIDING) {
+		if (aggregator->length == 0) {
+			return;
+		}
+		AddSliding(aggregator, value);
+	} else {
+		if (aggregator->count == 0 || value < aggregator->min) {
+			aggregator->min = value;
+		}
+		if (aggregator->count == 0 || value > aggregator->max) {
+			aggregator->max = value;
+		}
+		AddToMoments(aggregator, value);
+	}
+
+	aggregator->last = value;
+}
+
+/// <summary>
+///     Summarizes the window. Returns false if the window holds no samples.
+/// </summary>
+bool lp_aggregateGet(const LP_AGGREGATOR* aggregator, LP_AGGREGATE* aggregate) {
+	if (aggregator->count == 0) {
+		return false;
+	}
+
+	aggregate->count = aggregator->count;
+	aggregate->mean = (float)aggregator->mean;
+	aggregate->stddev = aggregator->m2 > 0.0 ? (float)sqrt(aggregator->m2 / aggregator->count) : 0.0f;
+	aggregate->last = aggregator->last;
+
+	if (aggregator->type == LP_WINDOW_SLIDING) {
+		aggregate->min = aggregator->samples[aggregator->minQueue[aggregator->minHead] % aggregator->length];
+		aggregate->max = aggregator->samples[aggregator->maxQueue[aggregator->maxHead] % aggregator->length];
+	} else {
+		aggregate->min = aggregator->min;
+		aggregate->max = aggregator->max;
+	}
+
+	return true;
+}
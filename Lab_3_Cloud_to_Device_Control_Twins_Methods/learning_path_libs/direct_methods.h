@@ -2,6 +2,23 @@
 
 #include "azure_iot.h"
 #include "peripheral_gpio.h"
+#include <stdarg.h>
+
+/*
+Direct method handlers write their response into a buffer allocated once per call, the Azure IoT SDK takes
+ownership of it. Set the response with lp_setDirectMethodMessage, sent as a JSON string, or
+lp_setDirectMethodJson, sent as is, e.g. a JSON object. A handler may also write JSON straight into
+buffer and set length, or overflow if it did not fit. The buffer holds LP_DIRECT_METHOD_RESPONSE_BYTES unless
+the binding asks for more with responseBytes. A handler that sets no response gets "Method Succeeded" or "Method Error".
+
+	static LP_DirectMethodResponseCode StatusHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* binding, LP_DIRECT_METHOD_RESPONSE* response) {
+		lp_setDirectMethodJson(response, "{\"uptime\":%d}", uptime);
+		return LP_METHOD_SUCCEEDED;
+	}
+*/
+
+#define LP_DIRECT_METHOD_RESPONSE_BYTES 128
+#define LP_DIRECT_METHOD_PAYLOAD_STACK_BYTES 256		// larger payloads are copied to the heap for parsing
 
 typedef enum 
 {
@@ -10,14 +27,24 @@ typedef enum
 	LP_METHOD_NOT_FOUND = 404
 } LP_DirectMethodResponseCode;
 
+typedef struct {
+	char* buffer;
+	size_t size;
+	size_t length;		// bytes of buffer sent, the quotes included for a message
+	bool overflow;		// the last response set did not fit
+} LP_DIRECT_METHOD_RESPONSE;
+
 struct _directMethodBinding {
 	const char* methodName;
-	LP_DirectMethodResponseCode(*handler)(JSON_Object* json, struct _directMethodBinding* peripheral, char** responseMsg);
+	LP_DirectMethodResponseCode(*handler)(JSON_Object* json, struct _directMethodBinding* peripheral, LP_DIRECT_METHOD_RESPONSE* response);
+	size_t responseBytes;		// optional, for responses longer than LP_DIRECT_METHOD_RESPONSE_BYTES
 };
 
 typedef struct _directMethodBinding LP_DIRECT_METHOD_BINDING;
 
 void lp_openDirectMethodSet(LP_DIRECT_METHOD_BINDING* directMethods[], size_t directMethodCount);
 void lp_closeDirectMethodSet(void);
+bool lp_setDirectMethodMessage(LP_DIRECT_METHOD_RESPONSE* response, const char* format, ...) __attribute__((format(printf, 2, 3)));
+bool lp_setDirectMethodJson(LP_DIRECT_METHOD_RESPONSE* response, const char* format, ...) __attribute__((format(printf, 2, 3)));
 int lp_azureDirectMethodHandler(const char* method_name, const unsigned char* payload, size_t payloadSize,
 	unsigned char** responsePayload, size_t* responsePayloadSize, void* userContextCallback);
@@ -0,0 +1,138 @@
+#include "hub_cache.h"
+
+#define HUB_CACHE_MAGIC 0x48554231	// "HUB1"
+
+typedef struct {
+	uint32_t magic;
+	uint32_t failures;		// connection attempts in a row that failed with this entry
+	char scopeId[LP_HUB_CACHE_SCOPE_ID_SIZE];
+	LP_HUB_CACHE_ENTRY entry;
+	uint32_t checksum;
+} HubCacheRecord;
+
+static uint32_t Checksum(const HubCacheRecord* record) {
+	const uint8_t* bytes = (const uint8_t*)record;
+	uint32_t hash = 2166136261u;	// FNV-1a
+
+	for (size_t i = 0; i < offsetof(HubCacheRecord, checksum); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static bool ReadRecord(HubCacheRecord* record) {
+	int fd = Storage_OpenMutableFile();
+	if (fd < 0) {
+		Log_Debug("ERROR: Storage_OpenMutableFile: errno=%d (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	ssize_t len = pread(fd, record, sizeof(*record), LP_HUB_CACHE_FILE_OFFSET);
+	close(fd);
+
+	return len == sizeof(*record) && record->magic == HUB_CACHE_MAGIC && record->checksum == Checksum(record) &&
+		record->entry.hostname[0] != '\0' &&
+		memchr(record->scopeId, '\0', sizeof(record->scopeId)) != NULL &&
+		memchr(record->entry.hostname, '\0', sizeof(record->entry.hostname)) != NULL &&
+		memchr(record->entry.deviceId, '\0', sizeof(record->entry.deviceId)) != NULL;
+}
+
+static bool WriteRecord(HubCacheRecord* record) {
+	record->checksum = Checksum(record);
+
+	int fd = Storage_OpenMutableFile();
+	if (fd < 0) {
+		Log_Debug("ERROR: Storage_OpenMutableFile: errno=%d (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	ssize_t len = pwrite(fd, record, sizeof(*record), LP_HUB_CACHE_FILE_OFFSET);
+	close(fd);
+
+	if (len != sizeof(*record)) {
+		Log_Debug("ERROR: Could not save the IoT Hub cache: errno=%d (%s)\n", errno, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+///     Returns the cached hub for this ID scope, false when the device has to provision
+/// </summary>
+bool lp_hubCacheLoad(const char* scopeId, LP_HUB_CACHE_ENTRY* entry) {
+	HubCacheRecord record;
+
+	if (scopeId == NULL || !ReadRecord(&record) || strcmp(record.scopeId, scopeId) != 0 ||
+		record.failures >= LP_HUB_CACHE_MAX_FAILURES) {
+		return false;
+	}
+
+	*entry = record.entry;
+	return true;
+}
+
+/// <summary>
+///     Remembers the hub the device authenticated with after provisioning
+/// </summary>
+bool lp_hubCacheStore(const char* scopeId, const char* hostname, const char* deviceId) {
+	HubCacheRecord record;
+
+	if (scopeId == NULL || hostname == NULL || deviceId == NULL ||
+		strlen(scopeId) >= sizeof(record.scopeId) ||
+		strlen(hostname) >= sizeof(record.entry.hostname) ||
+		strlen(deviceId) >= sizeof(record.entry.deviceId)) {
+		return false;
+	}
+
+	// Unused bytes are zeroed, they are part of the checksum
+	memset(&record, 0, sizeof(record));
+	record.magic = HUB_CACHE_MAGIC;
+	strcpy(record.scopeId, scopeId);
+	strcpy(record.entry.hostname, hostname);
+	strcpy(record.entry.deviceId, deviceId);
+
+	return WriteRecord(&record);
+}
+
+/// <summary>
+///     The cached hub authenticated the device, earlier failures are forgotten
+/// </summary>
+void lp_hubCacheConnected(void) {
+	HubCacheRecord record;
+
+	// Only written when there is something to reset, every write wears the flash
+	if (ReadRecord(&record) && record.failures != 0) {
+		record.failures = 0;
+		WriteRecord(&record);
+	}
+}
+
+/// <summary>
+///     A connection with the cached hub failed for another reason than the network or the credentials
+/// </summary>
+void lp_hubCacheConnectFailed(void) {
+	HubCacheRecord record;
+
+	if (!ReadRecord(&record)) {
+		return;
+	}
+
+	if (record.failures + 1 >= LP_HUB_CACHE_MAX_FAILURES) {
+		Log_Debug("INFO: Dropping the cached IoT Hub %s, the device provisions again\n", record.entry.hostname);
+		lp_hubCacheInvalidate();
+		return;
+	}
+
+	record.failures++;
+	WriteRecord(&record);
+}
+
+/// <summary>
+///     Drops the entry, the hub rejected the device
+/// </summary>
+void lp_hubCacheInvalidate(void) {
+	HubCacheRecord record;
+
+	memset(&record, 0, sizeof(record));
+	WriteRecord(&record);
+}
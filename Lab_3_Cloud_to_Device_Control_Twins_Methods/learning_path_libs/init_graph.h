@@ -0,0 +1,47 @@
+#pragma once
+
+#include <applibs/log.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/*
+Dependency ordered initialization.
+
+Each subsystem is an LP_INIT_NODE listing the nodes it depends on. lp_startInitGraph starts every node whose
+dependencies are done, the others start as soon as their last dependency completes, so independent subsystems
+progress side by side. A synchronous node is done when its start function returns true. An asynchronous node
+only starts its work, e.g. a timer state machine or a thread, and reports completion with lp_initNodeDone.
+Nodes depending on a failed node do not start.
+
+The ready handler runs once, when every critical node is done. Nodes that are not critical, e.g. the real-time
+core handshake, can complete after the app reported ready.
+
+	static LP_INIT_NODE gpioNode = { .name = "gpio", .start = OpenGpios };
+	static LP_INIT_NODE cloudNode = { .name = "cloud", .start = StartCloud, .async = true, .critical = true,
+		.dependsOn = (LP_INIT_NODE*[]){ &gpioNode, NULL } };
+*/
+
+typedef enum {
+	LP_INIT_PENDING,
+	LP_INIT_RUNNING,
+	LP_INIT_DONE,
+	LP_INIT_FAILED
+} LP_INIT_STATE;
+
+struct _initNode {
+	const char* name;
+	bool (*start)(void);			// false on failure, NULL for nodes that only group dependencies
+	struct _initNode** dependsOn;	// NULL terminated, NULL for none
+	bool async;						// completes with lp_initNodeDone
+	bool critical;					// the app is ready when all critical nodes are done
+	LP_INIT_STATE state;
+	struct timespec startTime;
+	struct timespec doneTime;
+};
+
+typedef struct _initNode LP_INIT_NODE;
+
+void lp_startInitGraph(LP_INIT_NODE* initSet[], size_t initCount, void (*readyHandler)(void));
+void lp_initNodeDone(LP_INIT_NODE* node, bool success);
+bool lp_isInitReady(void);
@@ -0,0 +1,236 @@
+#include "worker_pool.h"
+
+static void CompletionHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context);
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t workFinished = PTHREAD_COND_INITIALIZER;
+
+// Both queues are FIFO lists through the items' next, protected by poolLock
+static LP_WORK_ITEM* workHead = NULL;
+static LP_WORK_ITEM* workTail = NULL;
+static LP_WORK_ITEM* completedHead = NULL;
+static LP_WORK_ITEM* completedTail = NULL;
+
+static pthread_t workers[LP_WORKER_POOL_THREADS];
+static int workerCount = 0;
+static bool stopping = false;
+static int completionEventFd = -1;
+static EventRegistration* completionRegistration = NULL;
+
+static void Append(LP_WORK_ITEM** head, LP_WORK_ITEM** tail, LP_WORK_ITEM* item) {
+	item->next = NULL;
+	if (*tail == NULL) {
+		*head = item;
+	}
+	else {
+		(*tail)->next = item;
+	}
+	*tail = item;
+}
+
+static LP_WORK_ITEM* TakeFirst(LP_WORK_ITEM** head, LP_WORK_ITEM** tail) {
+	LP_WORK_ITEM* item = *head;
+
+	if (item != NULL) {
+		*head = item->next;
+		if (*head == NULL) {
+			*tail = NULL;
+		}
+		item->next = NULL;
+	}
+	return item;
+}
+
+static void* WorkerThread(void* context) {
+	uint64_t completed = 1;
+
+	pthread_mutex_lock(&poolLock);
+
+	while (!stopping) {
+		LP_WORK_ITEM* item = TakeFirst(&workHead, &workTail);
+		if (item == NULL) {
+			pthread_cond_wait(&workQueued, &poolLock);
+			continue;
+		}
+
+		item->state = LP_WORK_RUNNING;
+		pthread_mutex_unlock(&poolLock);
+
+		item->work(item);
+
+		pthread_mutex_lock(&poolLock);
+		item->state = LP_WORK_COMPLETED;
+		Append(&completedHead, &completedTail, item);
+		pthread_cond_broadcast(&workFinished);
+
+		// The eventfd counter adds up, one read on the event loop takes all completions
+		if (write(completionEventFd, &completed, sizeof(completed)) != sizeof(completed)) {
+			Log_Debug("ERROR: could not signal the completion of %s: %s (%d).\n", item->name, strerror(errno), errno);
+		}
+	}
+
+	pthread_mutex_unlock(&poolLock);
+	return NULL;
+}
+
+/// <summary>
+///     Creates the completion eventfd and the worker threads, called with poolLock held
+/// </summary>
+static bool StartWorkerPool(void) {
+	completionEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (completionEventFd == -1) {
+		Log_Debug("ERROR: could not create the worker pool eventfd: %s (%d).\n", strerror(errno), errno);
+		return false;
+	}
+
+	completionRegistration = EventLoop_RegisterIo(lp_getTimerEventLoop(), completionEventFd, EventLoop_Input, CompletionHandler, NULL);
+	if (completionRegistration == NULL) {
+		Log_Debug("ERROR: could not register the worker pool eventfd: %s (%d).\n", strerror(errno), errno);
+		close(completionEventFd);
+		completionEventFd = -1;
+		return false;
+	}
+
+	stopping = false;
+	for (workerCount = 0; workerCount < LP_WORKER_POOL_THREADS; workerCount++) {
+		if (pthread_create(&workers[workerCount], NULL, WorkerThread, NULL) != 0) {
+			Log_Debug("ERROR: could not start worker thread %d.\n", workerCount);
+			break;
+		}
+	}
+
+	return workerCount > 0;
+}
+
+/// <summary>
+///     Runs the done functions of the completed items on the event loop thread
+/// </summary>
+static void CompletionHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context) {
+	uint64_t completions;
+
+	if (read(completionEventFd, &completions, sizeof(completions)) == -1) {
+		return;
+	}
+
+	for (;;) {
+		pthread_mutex_lock(&poolLock);
+		LP_WORK_ITEM* item = TakeFirst(&completedHead, &completedTail);
+		if (item != NULL) {
+			item->state = LP_WORK_IDLE;
+		}
+		pthread_mutex_unlock(&poolLock);
+
+		if (item == NULL) {
+			break;
+		}
+
+		// Idle before done, so done can submit the item again
+		if (item->done != NULL) {
+#ifdef LP_HANDLER_STATS
+			struct timespec start;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			const char* name = item->name;		// done may resubmit the item
+#endif
+			item->done(item);
+#ifdef LP_HANDLER_STATS
+			lp_handlerStatsRecord(lp_handlerStats(name), NULL, &start);
+#endif
+		}
+	}
+}
+
+/// <summary>
+///     Queues the item for a worker thread. False if it is already in flight or the pool could not start.
+/// </summary>
+bool lp_submitWork(LP_WORK_ITEM* item) {
+	bool queued = false;
+
+	if (item == NULL || item->work == NULL) {
+		return false;
+	}
+
+	pthread_mutex_lock(&poolLock);
+
+	if (item->state == LP_WORK_IDLE && (workerCount > 0 || StartWorkerPool())) {
+		item->state = LP_WORK_QUEUED;
+		Append(&workHead, &workTail, item);
+		pthread_cond_signal(&workQueued);
+		queued = true;
+	}
+
+	pthread_mutex_unlock(&poolLock);
+	return queued;
+}
+
+/// <summary>
+///     True from lp_submitWork until the done function of the item ran
+/// </summary>
+bool lp_isWorkPending(const LP_WORK_ITEM* item) {
+	pthread_mutex_lock(&poolLock);
+	bool pending = item->state != LP_WORK_IDLE;
+	pthread_mutex_unlock(&poolLock);
+	return pending;
+}
+
+/// <summary>
+///     Blocks until the work function of the item finished or is no longer queued, for shutdown.
+///     A queued item is removed, done does not run for it.
+/// </summary>
+void lp_waitForWork(LP_WORK_ITEM* item) {
+	pthread_mutex_lock(&poolLock);
+
+	if (item->state == LP_WORK_QUEUED) {
+		LP_WORK_ITEM** link = &workHead;
+		workTail = NULL;
+		while (*link != NULL) {
+			if (*link == item) {
+				*link = item->next;
+				continue;
+			}
+			workTail = *link;
+			link = &(*link)->next;
+		}
+		item->state = LP_WORK_IDLE;
+	}
+
+	while (item->state == LP_WORK_RUNNING) {
+		pthread_cond_wait(&workFinished, &poolLock);
+	}
+
+	pthread_mutex_unlock(&poolLock);
+}
+
+/// <summary>
+///     Lets the workers finish their current item and stops them, queued and completed items are dropped
+/// </summary>
+void lp_stopWorkerPool(void) {
+	pthread_mutex_lock(&poolLock);
+	stopping = true;
+	pthread_cond_broadcast(&workQueued);
+	int count = workerCount;
+	pthread_mutex_unlock(&poolLock);
+
+	for (int i = 0; i < count; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	pthread_mutex_lock(&poolLock);
+	for (LP_WORK_ITEM* item; (item = TakeFirst(&workHead, &workTail)) != NULL;) {
+		item->state = LP_WORK_IDLE;
+	}
+	for (LP_WORK_ITEM* item; (item = TakeFirst(&completedHead, &completedTail)) != NULL;) {
+		item->state = LP_WORK_IDLE;
+	}
+	workerCount = 0;
+	pthread_mutex_unlock(&poolLock);
+
+	if (completionRegistration != NULL) {
+		EventLoop_UnregisterIo(lp_getTimerEventLoop(), completionRegistration);
+		completionRegistration = NULL;
+	}
+	if (completionEventFd != -1) {
+		close(completionEventFd);
+		completionEventFd = -1;
+	}
+}
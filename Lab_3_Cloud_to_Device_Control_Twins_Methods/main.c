@@ -63,7 +63,7 @@
 #include "learning_path_libs/SEEED_STUDIO/board.h"
 #endif // SEEED_STUDIO
 
-#define JSON_MESSAGE_BYTES 128  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+#define JSON_MESSAGE_BYTES 512  // Number of bytes to allocate for the JSON telemetry message for IoT Central
 
 // Forward signatures
 static void InitPeripheralGpiosAndHandlers(void);
@@ -71,12 +71,13 @@ static void ClosePeripheralGpiosAndHandlers(void);
 static void Led1BlinkHandler(EventLoopTimer* eventLoopTimer);
 static void Led2OffHandler(EventLoopTimer* eventLoopTimer);
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer);
+static void DeviceTwinTelemetryPeriodHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
 static void ButtonPressCheckHandler(EventLoopTimer* eventLoopTimer);
 static void NetworkConnectionStatusHandler(EventLoopTimer* eventLoopTimer);
 static void ResetDeviceHandler(EventLoopTimer* eventLoopTimer);
 static void DeviceTwinBlinkRateHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
 static void DeviceTwinRelay1Handler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
-static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, char** responseMsg);
+static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, LP_DIRECT_METHOD_RESPONSE* response);
 
 static char msgBuffer[JSON_MESSAGE_BYTES] = { 0 };
 
@@ -116,8 +117,9 @@ static LP_TIMER measureSensorTimer = { .period = { 10, 0 }, .name = "measureSens
 static LP_TIMER resetDeviceOneShotTimer = { .period = { 0, 0 }, .name = "resetDeviceOneShotTimer", .handler = ResetDeviceHandler };
 
 // Azure IoT Device Twins
-static LP_DEVICE_TWIN_BINDING led1BlinkRate = { .twinProperty = "LedBlinkRate", .twinType = LP_TYPE_INT, .handler = DeviceTwinBlinkRateHandler };
-static LP_DEVICE_TWIN_BINDING relay1DeviceTwin = { .twinProperty = "Relay1", .twinType = LP_TYPE_BOOL, .handler = DeviceTwinRelay1Handler };
+static LP_DEVICE_TWIN_BINDING led1BlinkRate = { .twinProperty = "LedBlinkRate", .twinType = LP_TYPE_INT, .handler = DeviceTwinBlinkRateHandler, .deltaThreshold = 1 };
+static LP_DEVICE_TWIN_BINDING relay1DeviceTwin = { .twinProperty = "Relay1", .twinType = LP_TYPE_BOOL, .handler = DeviceTwinRelay1Handler, .deltaThreshold = 1 };
+static LP_DEVICE_TWIN_BINDING telemetryPeriod = { .twinProperty = "TelemetryPeriod", .twinType = LP_TYPE_INT, .handler = DeviceTwinTelemetryPeriodHandler, .deltaThreshold = 1 };
 static LP_DEVICE_TWIN_BINDING buttonPressed = { .twinProperty = "ButtonPressed", .twinType = LP_TYPE_STRING };
 static LP_DEVICE_TWIN_BINDING deviceResetUtc = { .twinProperty = "DeviceResetUTC", .twinType = LP_TYPE_STRING };
 
@@ -127,7 +129,7 @@ static LP_DIRECT_METHOD_BINDING resetDevice = { .methodName = "ResetMethod", .ha
 // Initialize Sets
 LP_PERIPHERAL_GPIO* PeripheralGpioSet[] = { &buttonA, &buttonB, &led1, &led2, &networkConnectedLed, &relay1 };
 LP_TIMER* timerSet[] = { &led1BlinkTimer, &led2BlinkOffOneShotTimer, &buttonPressCheckTimer, &networkConnectionStatusTimer, &resetDeviceOneShotTimer, &measureSensorTimer };
-LP_DEVICE_TWIN_BINDING* deviceTwinBindingSet[] = { &led1BlinkRate, &buttonPressed, &relay1DeviceTwin, &deviceResetUtc };
+LP_DEVICE_TWIN_BINDING* deviceTwinBindingSet[] = { &telemetryPeriod, &led1BlinkRate, &buttonPressed, &relay1DeviceTwin, &deviceResetUtc };
 LP_DIRECT_METHOD_BINDING* directMethodBindingSet[] = { &resetDevice };
 
 
@@ -222,6 +224,24 @@ static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 	}
 }
 
+/// <summary>
+/// Set the telemetry period in seconds using Device Twin "TelemetryPeriod": {"value": 60}, the sensors are sampled
+/// every second in between and each message carries the aggregates of the samples since the last message
+/// </summary>
+static void DeviceTwinTelemetryPeriodHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding)
+{
+	int seconds = *(int*)deviceTwinBinding->twinState;
+
+	if (seconds > 0 && seconds <= 3600)
+	{
+		lp_changeTimer(&measureSensorTimer, &(struct timespec){ seconds, 0 });
+	}
+	else
+	{
+		Log_Debug("\nTelemetryPeriod out of range: %d\n", seconds);
+	}
+}
+
 /// <summary>
 /// Read Button LP_PERIPHERAL_GPIO returns pressed state
 /// </summary>
@@ -376,15 +396,11 @@ static void ResetDeviceHandler(EventLoopTimer* eventLoopTimer)
 /// <summary>
 /// Start Device Power Restart Direct Method 'ResetMethod' {"reset_timer":5}
 /// </summary>
-static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, char** responseMsg)
+static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, LP_DIRECT_METHOD_RESPONSE* response)
 {
 	const char propertyName[] = "reset_timer";
-	const size_t responseLen = 60; // Allocate and initialize a response message buffer. The calling function is responsible for the freeing memory
 	static struct timespec period;
 
-	*responseMsg = (char*)malloc(responseLen);
-	memset(*responseMsg, 0, responseLen);
-
 	if (!json_object_has_value_of_type(json, propertyName, JSONNumber))
 	{
 		return LP_METHOD_FAILED;
@@ -397,7 +413,7 @@ static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, L
 		lp_deviceTwinReportState(&deviceResetUtc, lp_getCurrentUtc(msgBuffer, sizeof(msgBuffer)));			// LP_TYPE_STRING
 
 		// Create Direct Method Response
-		snprintf(*responseMsg, responseLen, "%s called. Reset in %d seconds", directMethodBinding->methodName, seconds);
+		lp_setDirectMethodMessage(response, "%s called. Reset in %d seconds", directMethodBinding->methodName, seconds);
 
 		// Set One Shot LP_TIMER
 		period = (struct timespec){ .tv_sec = seconds, .tv_nsec = 0 };
@@ -407,7 +423,7 @@ static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, L
 	}
 	else
 	{
-		snprintf(*responseMsg, responseLen, "%s called. Reset Failed. Seconds out of range: %d", directMethodBinding->methodName, seconds);
+		lp_setDirectMethodMessage(response, "%s called. Reset Failed. Seconds out of range: %d", directMethodBinding->methodName, seconds);
 		return LP_METHOD_FAILED;
 	}
 }
@@ -425,6 +441,7 @@ static void InitPeripheralGpiosAndHandlers(void)
 	lp_openDirectMethodSet(directMethodBindingSet, NELEMS(directMethodBindingSet));
 
 	lp_startTimerSet(timerSet, NELEMS(timerSet));
+	lp_logStart();
 	lp_startCloudToDevice();
 }
 
@@ -437,6 +454,7 @@ static void ClosePeripheralGpiosAndHandlers(void)
 
 	lp_stopTimerSet();
 	lp_stopCloudToDevice();
+	lp_logStop();
 
 	lp_closePeripheralGpioSet();
 	lp_closeDeviceTwinSet();
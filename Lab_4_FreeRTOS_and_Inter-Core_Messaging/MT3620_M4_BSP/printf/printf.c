@@ -30,6 +30,7 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -82,6 +83,12 @@
 #define PRINTF_MAX_FLOAT  1e9
 #endif
 
+// define this to do the %f conversion in single precision (float) math only,
+// on an FPU without double support (e.g. Cortex-M4F) this avoids the software
+// double emulation. Precision is limited to the ~7 significant digits of a float
+// default: undefined (double precision)
+// #define PRINTF_FTOA_SINGLE_PRECISION
+
 // support for the long long types (%llu or %p)
 // default: activated
 #ifndef PRINTF_DISABLE_SUPPORT_LONG_LONG
@@ -115,6 +122,13 @@
 // import float.h for DBL_MAX
 #if defined(PRINTF_SUPPORT_FLOAT)
 #include <float.h>
+
+// floating point type used by the %f conversion
+#if defined(PRINTF_FTOA_SINGLE_PRECISION)
+typedef float printf_float_t;
+#else
+typedef double printf_float_t;
+#endif
 #endif
 
 
@@ -277,6 +291,57 @@ static size_t _ntoa_format(out_fct_type out, char* buffer, size_t idx, size_t ma
 }
 
 
+// decimal digit pairs "00" to "99", two digits are converted per division
+static const char _dec_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+
+// internal reversed decimal conversion of a 'long', returns the new length of buf
+// the lowest digits are kept if maxlen is reached
+static size_t _dec_rev_long(char* buf, size_t len, size_t maxlen, unsigned long value)
+{
+  while ((value >= 100U) && (len + 1U < maxlen)) {
+    const unsigned int pair = (unsigned int)(value % 100U) * 2U;
+    value /= 100U;
+    buf[len++] = _dec_pairs[pair + 1U];
+    buf[len++] = _dec_pairs[pair];
+  }
+  if ((value >= 10U) && (len + 1U < maxlen)) {
+    buf[len++] = _dec_pairs[value * 2U + 1U];
+    buf[len++] = _dec_pairs[value * 2U];
+  }
+  else if (len < maxlen) {
+    buf[len++] = (char)('0' + (value % 10U));
+  }
+  return len;
+}
+
+
+// internal reversed decimal conversion of a 'long long'
+#if defined(PRINTF_SUPPORT_LONG_LONG)
+static size_t _dec_rev_long_long(char* buf, size_t len, size_t maxlen, unsigned long long value)
+{
+  // the 'long long' division is a library call on 32 bit targets, only use it while the value doesn't fit into a 'long'
+  while ((value > ULONG_MAX) && (len + 1U < maxlen)) {
+    const unsigned int pair = (unsigned int)(value % 100U) * 2U;
+    value /= 100U;
+    buf[len++] = _dec_pairs[pair + 1U];
+    buf[len++] = _dec_pairs[pair];
+  }
+  return _dec_rev_long(buf, len, maxlen, (unsigned long)value);
+}
+#endif  // PRINTF_SUPPORT_LONG_LONG
+
+
 // internal itoa for 'long' type
 static size_t _ntoa_long(out_fct_type out, char* buffer, size_t idx, size_t maxlen, unsigned long value, bool negative, unsigned long base, unsigned int prec, unsigned int width, unsigned int flags)
 {
@@ -290,11 +355,16 @@ static size_t _ntoa_long(out_fct_type out, char* buffer, size_t idx, size_t maxl
 
   // write if precision != 0 and value is != 0
   if (!(flags & FLAGS_PRECISION) || value) {
-    do {
-      const char digit = (char)(value % base);
-      buf[len++] = digit < 10 ? '0' + digit : (flags & FLAGS_UPPERCASE ? 'A' : 'a') + digit - 10;
-      value /= base;
-    } while (value && (len < PRINTF_NTOA_BUFFER_SIZE));
+    if (base == 10U) {
+      len = _dec_rev_long(buf, len, PRINTF_NTOA_BUFFER_SIZE, value);
+    }
+    else {
+      do {
+        const char digit = (char)(value % base);
+        buf[len++] = digit < 10 ? '0' + digit : (flags & FLAGS_UPPERCASE ? 'A' : 'a') + digit - 10;
+        value /= base;
+      } while (value && (len < PRINTF_NTOA_BUFFER_SIZE));
+    }
   }
 
   return _ntoa_format(out, buffer, idx, maxlen, buf, len, negative, (unsigned int)base, prec, width, flags);
@@ -315,11 +385,16 @@ static size_t _ntoa_long_long(out_fct_type out, char* buffer, size_t idx, size_t
 
   // write if precision != 0 and value is != 0
   if (!(flags & FLAGS_PRECISION) || value) {
-    do {
-      const char digit = (char)(value % base);
-      buf[len++] = digit < 10 ? '0' + digit : (flags & FLAGS_UPPERCASE ? 'A' : 'a') + digit - 10;
-      value /= base;
-    } while (value && (len < PRINTF_NTOA_BUFFER_SIZE));
+    if (base == 10U) {
+      len = _dec_rev_long_long(buf, len, PRINTF_NTOA_BUFFER_SIZE, value);
+    }
+    else {
+      do {
+        const char digit = (char)(value % base);
+        buf[len++] = digit < 10 ? '0' + digit : (flags & FLAGS_UPPERCASE ? 'A' : 'a') + digit - 10;
+        value /= base;
+      } while (value && (len < PRINTF_NTOA_BUFFER_SIZE));
+    }
   }
 
   return _ntoa_format(out, buffer, idx, maxlen, buf, len, negative, (unsigned int)base, prec, width, flags);
@@ -336,33 +411,38 @@ static size_t _etoa(out_fct_type out, char* buffer, size_t idx, size_t maxlen, d
 
 
 // internal ftoa for fixed decimal floating point
-static size_t _ftoa(out_fct_type out, char* buffer, size_t idx, size_t maxlen, double value, unsigned int prec, unsigned int width, unsigned int flags)
+// with PRINTF_FTOA_SINGLE_PRECISION the value is converted to float once it is known to be in range, and all math is done in float
+static size_t _ftoa(out_fct_type out, char* buffer, size_t idx, size_t maxlen, double dvalue, unsigned int prec, unsigned int width, unsigned int flags)
 {
   char buf[PRINTF_FTOA_BUFFER_SIZE];
   size_t len  = 0U;
-  double diff = 0.0;
+  printf_float_t value;
+  printf_float_t diff  = 0;
+  const printf_float_t half = (printf_float_t)0.5;
 
   // powers of 10
-  static const double pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+  static const printf_float_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
 
-  // test for special values
-  if (value != value)
+  // test for special values, on the double argument: a finite double beyond FLT_MAX is not inf
+  if (dvalue != dvalue)
     return _out_rev(out, buffer, idx, maxlen, "nan", 3, width, flags);
-  if (value < -DBL_MAX)
+  if (dvalue < -DBL_MAX)
     return _out_rev(out, buffer, idx, maxlen, "fni-", 4, width, flags);
-  if (value > DBL_MAX)
+  if (dvalue > DBL_MAX)
     return _out_rev(out, buffer, idx, maxlen, (flags & FLAGS_PLUS) ? "fni+" : "fni", (flags & FLAGS_PLUS) ? 4U : 3U, width, flags);
 
   // test for very large values
   // standard printf behavior is to print EVERY whole number digit -- which could be 100s of characters overflowing your buffers == bad
-  if ((value > PRINTF_MAX_FLOAT) || (value < -PRINTF_MAX_FLOAT)) {
+  if ((dvalue > PRINTF_MAX_FLOAT) || (dvalue < -PRINTF_MAX_FLOAT)) {
 #if defined(PRINTF_SUPPORT_EXPONENTIAL)
-    return _etoa(out, buffer, idx, maxlen, value, prec, width, flags);
+    return _etoa(out, buffer, idx, maxlen, dvalue, prec, width, flags);
 #else
     return 0U;
 #endif
   }
 
+  value = (printf_float_t)dvalue;
+
   // test for negative
   bool negative = false;
   if (value < 0) {
@@ -381,19 +461,19 @@ static size_t _ftoa(out_fct_type out, char* buffer, size_t idx, size_t maxlen, d
   }
 
   int whole = (int)value;
-  double tmp = (value - whole) * pow10[prec];
+  printf_float_t tmp = (value - (printf_float_t)whole) * pow10[prec];
   unsigned long frac = (unsigned long)tmp;
-  diff = tmp - frac;
+  diff = tmp - (printf_float_t)frac;
 
-  if (diff > 0.5) {
+  if (diff > half) {
     ++frac;
     // handle rollover, e.g. case 0.99 with prec 1 is 1.0
-    if (frac >= pow10[prec]) {
+    if (frac >= (unsigned long)pow10[prec]) {
       frac = 0;
       ++whole;
     }
   }
-  else if (diff < 0.5) {
+  else if (diff < half) {
   }
   else if ((frac == 0U) || (frac & 1U)) {
     // if halfway, round up if odd OR if last digit is 0
@@ -401,25 +481,19 @@ static size_t _ftoa(out_fct_type out, char* buffer, size_t idx, size_t maxlen, d
   }
 
   if (prec == 0U) {
-    diff = value - (double)whole;
-    if ((!(diff < 0.5) || (diff > 0.5)) && (whole & 1)) {
+    diff = value - (printf_float_t)whole;
+    if ((!(diff < half) || (diff > half)) && (whole & 1)) {
       // exactly 0.5 and ODD, then round up
       // 1.5 -> 2, but 2.5 -> 2
       ++whole;
     }
   }
   else {
-    unsigned int count = prec;
     // now do fractional part, as an unsigned number
-    while (len < PRINTF_FTOA_BUFFER_SIZE) {
-      --count;
-      buf[len++] = (char)(48U + (frac % 10U));
-      if (!(frac /= 10U)) {
-        break;
-      }
-    }
+    const size_t start = len;
+    len = _dec_rev_long(buf, len, PRINTF_FTOA_BUFFER_SIZE, frac);
     // add extra 0s
-    while ((len < PRINTF_FTOA_BUFFER_SIZE) && (count-- > 0U)) {
+    while ((len < PRINTF_FTOA_BUFFER_SIZE) && (len - start < prec)) {
       buf[len++] = '0';
     }
     if (len < PRINTF_FTOA_BUFFER_SIZE) {
@@ -429,12 +503,7 @@ static size_t _ftoa(out_fct_type out, char* buffer, size_t idx, size_t maxlen, d
   }
 
   // do whole part, number is reversed
-  while (len < PRINTF_FTOA_BUFFER_SIZE) {
-    buf[len++] = (char)(48 + (whole % 10));
-    if (!(whole /= 10)) {
-      break;
-    }
-  }
+  len = _dec_rev_long(buf, len, PRINTF_FTOA_BUFFER_SIZE, (unsigned long)whole);
 
   // pad leading zeros
   if (!(flags & FLAGS_LEFT) && (flags & FLAGS_ZEROPAD)) {
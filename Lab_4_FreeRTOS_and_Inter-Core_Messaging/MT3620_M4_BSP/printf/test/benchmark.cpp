@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// \brief printf host micro-benchmark
+//
+// Reports the cycles (x86 TSC ticks, nanoseconds on other hosts) per
+// conversion of the integer and %f paths, the libc snprintf is measured as
+// reference. Build the %f single precision mode with
+// -DPRINTF_FTOA_SINGLE_PRECISION:
+//
+//   g++ -std=c++11 -O2 test/benchmark.cpp -o benchmark && ./benchmark
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+namespace test {
+  // use functions in own test namespace to avoid stdio conflicts
+  #include "../printf.h"
+  #include "../printf.c"
+} // namespace test
+
+// the libc functions are measured as reference
+#undef printf
+#undef snprintf
+
+
+void test::_putchar(char character)
+{
+  (void)character;
+}
+
+
+static unsigned long long cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+#define ITERATIONS 1000000U
+
+// prevents the compiler from dropping the conversions
+static volatile char sink;
+
+
+template <typename T>
+static void run(const char* name, const char* format, const T* values, size_t count)
+{
+  char buffer[64];
+
+  unsigned long long start = cycles();
+  for (unsigned int i = 0U; i < ITERATIONS; ++i) {
+    test::snprintf_(buffer, sizeof(buffer), format, values[i % count]);
+    sink = buffer[0];
+  }
+  const unsigned long long own = cycles() - start;
+
+  start = cycles();
+  for (unsigned int i = 0U; i < ITERATIONS; ++i) {
+    ::snprintf(buffer, sizeof(buffer), format, values[i % count]);
+    sink = buffer[0];
+  }
+  const unsigned long long libc = cycles() - start;
+
+  ::printf("%-24s %-8s %8.1f cycles/conversion (libc %8.1f)\n", name, format, (double)own / ITERATIONS, (double)libc / ITERATIONS);
+}
+
+
+int main(void)
+{
+  static const int small_ints[]   = { 0, 7, 42, -13, 99, 250, -1, 64 };
+  static const int large_ints[]   = { 2147483647, -1234567890, 987654321, 1000000000, -999999999, 31415926, 27182818, -16180339 };
+  static const long long ll_ints[] = { 9223372036854775807LL, -1234567890123456789LL, 4294967296LL, 100000000000LL };
+  static const unsigned int hex[] = { 0xDEADBEEFU, 0x12U, 0xCAFEU, 0x80000000U };
+  static const double floats[]    = { 23.45, -1.5, 1013.25, 0.001, 45.678, -273.15, 99.995, 3.14159 };
+
+#if defined(PRINTF_FTOA_SINGLE_PRECISION)
+  ::printf("%%f conversion: single precision\n");
+#else
+  ::printf("%%f conversion: double precision\n");
+#endif
+
+  run("int, 1-3 digits",   "%d",   small_ints, 8U);
+  run("int, 8-10 digits",  "%d",   large_ints, 8U);
+  run("long long",         "%lld", ll_ints,    4U);
+  run("hex",               "%x",   hex,        4U);
+  run("float, default",    "%f",   floats,     8U);
+  run("float, 2 decimals", "%.2f", floats,     8U);
+
+  return 0;
+}
@@ -31,6 +31,7 @@
 #include "catch.hpp"
 
 #include <string.h>
+#include <stdlib.h>
 #include <sstream>
 #include <math.h>
 
@@ -1097,7 +1098,12 @@ TEST_CASE("float", "[]" ) {
   REQUIRE(!strcmp(buffer, "3.1415"));
 
   test::sprintf(buffer, "%.3f", 30343.1415354);
+#ifndef PRINTF_FTOA_SINGLE_PRECISION
   REQUIRE(!strcmp(buffer, "30343.142"));
+#else
+  // the float nearest to 30343.1415354 is 30343.140625
+  REQUIRE(!strcmp(buffer, "30343.141"));
+#endif
 
   test::sprintf(buffer, "%.0f", 34.1415354);
   REQUIRE(!strcmp(buffer, "34"));
@@ -1114,6 +1120,7 @@ TEST_CASE("float", "[]" ) {
   test::sprintf(buffer, "%.2f", 42.8952);
   REQUIRE(!strcmp(buffer, "42.90"));
 
+#ifndef PRINTF_FTOA_SINGLE_PRECISION
   test::sprintf(buffer, "%.9f", 42.8952);
   REQUIRE(!strcmp(buffer, "42.895200000"));
 
@@ -1129,6 +1136,18 @@ TEST_CASE("float", "[]" ) {
   // a perfect working float should return the whole number
   test::sprintf(buffer, "%.12f", 42.89522387654321);
   REQUIRE(!strcmp(buffer, "42.895223877000"));
+#else
+  // a float holds about 7 significant digits, so ask for no more
+  test::sprintf(buffer, "%.5f", 42.8952);
+  REQUIRE(!strcmp(buffer, "42.89520"));
+
+  test::sprintf(buffer, "%.5f", 42.895223);
+  REQUIRE(!strcmp(buffer, "42.89522"));
+
+  // the precision is still truncated to 9 digits
+  test::sprintf(buffer, "%.12f", 42.5);
+  REQUIRE(!strcmp(buffer, "42.500000000000"));
+#endif
 
   test::sprintf(buffer, "%6.2f", 42.8952);
   REQUIRE(!strcmp(buffer, " 42.90"));
@@ -1148,8 +1167,13 @@ TEST_CASE("float", "[]" ) {
   test::sprintf(buffer, "%f", 42167.0);
   REQUIRE(!strcmp(buffer, "42167.000000"));
 
+#ifndef PRINTF_FTOA_SINGLE_PRECISION
   test::sprintf(buffer, "%.9f", -12345.987654321);
   REQUIRE(!strcmp(buffer, "-12345.987654321"));
+#else
+  test::sprintf(buffer, "%.3f", -12345.987654321);
+  REQUIRE(!strcmp(buffer, "-12345.987"));
+#endif
 
   test::sprintf(buffer, "%.1f", 3.999);
   REQUIRE(!strcmp(buffer, "4.0"));
@@ -1212,6 +1236,21 @@ TEST_CASE("float", "[]" ) {
   REQUIRE(!strcmp(buffer, ""));
 #endif
 
+  // out of range for a float, still a finite double: not inf, also with PRINTF_FTOA_SINGLE_PRECISION
+  test::sprintf(buffer, "%.1f", 3.5e39);
+#ifndef PRINTF_DISABLE_SUPPORT_EXPONENTIAL
+  REQUIRE(!strcmp(buffer, "3.5e+39"));
+#else
+  REQUIRE(!strcmp(buffer, ""));
+#endif
+
+  test::sprintf(buffer, "%.2f", -2.5e300);
+#ifndef PRINTF_DISABLE_SUPPORT_EXPONENTIAL
+  REQUIRE(!strcmp(buffer, "-2.50e+300"));
+#else
+  REQUIRE(!strcmp(buffer, ""));
+#endif
+
   // brute force float
   bool fail = false;
   std::stringstream str;
@@ -1230,15 +1269,84 @@ TEST_CASE("float", "[]" ) {
   str.setf(std::ios::scientific, std::ios::floatfield);
   for (float i = -1e20; i < 1e20; i += 1e15) {
     test::sprintf(buffer, "%.5f", i);
+#ifndef PRINTF_FTOA_SINGLE_PRECISION
     str.str("");
     str << i;
     fail = fail || !!strcmp(buffer, str.str().c_str());
+#else
+    // the mantissa is rounded in float, allow one unit in the last digit
+    fail = fail || fabs(strtod(buffer, NULL) - (double)i) > fabs((double)i) * 1e-5;
+#endif
   }
   REQUIRE(!fail);
 #endif
 }
 
 
+TEST_CASE("decimal digit pairs", "[]" ) {
+  char buffer[100];
+
+  test::sprintf(buffer, "%d %d %d %d %d %d", 0, 9, 10, 99, 100, 101);
+  REQUIRE(!strcmp(buffer, "0 9 10 99 100 101"));
+
+  test::sprintf(buffer, "%d %d %d %d", 1000, 9999, 10000, 123456789);
+  REQUIRE(!strcmp(buffer, "1000 9999 10000 123456789"));
+
+  test::sprintf(buffer, "%d %d", -2147483647, 2147483647);
+  REQUIRE(!strcmp(buffer, "-2147483647 2147483647"));
+
+  test::sprintf(buffer, "%u %u", 4294967295U, 1000000000U);
+  REQUIRE(!strcmp(buffer, "4294967295 1000000000"));
+
+  test::sprintf(buffer, "%08d|%-6d|%6d|%.5d", 1020, 305, -1, 70);
+  REQUIRE(!strcmp(buffer, "00001020|305   |    -1|00070"));
+
+  test::sprintf(buffer, "%llu", 18446744073709551615ULL);
+  REQUIRE(!strcmp(buffer, "18446744073709551615"));
+
+  test::sprintf(buffer, "%lld %lld", -9223372036854775807LL - 1, 4294967296LL);
+  REQUIRE(!strcmp(buffer, "-9223372036854775808 4294967296"));
+
+  test::sprintf(buffer, "%llu %llu", 10000000000000000000ULL, 100000000000ULL);
+  REQUIRE(!strcmp(buffer, "10000000000000000000 100000000000"));
+}
+
+
+TEST_CASE("float digit pairs", "[]" ) {
+  char buffer[100];
+
+  test::sprintf(buffer, "%.6f", 1.000001);
+  REQUIRE(!strcmp(buffer, "1.000001"));
+
+  test::sprintf(buffer, "%.4f", 10.0101);
+  REQUIRE(!strcmp(buffer, "10.0101"));
+
+  test::sprintf(buffer, "%.2f", 99.995);
+  REQUIRE(!strcmp(buffer, "100.00"));
+
+  test::sprintf(buffer, "%.3f", -0.05);
+  REQUIRE(!strcmp(buffer, "-0.050"));
+
+#ifndef PRINTF_FTOA_SINGLE_PRECISION
+  test::sprintf(buffer, "%.9f", 987654321.123456789);
+  REQUIRE(!strcmp(buffer, "987654321.123456836"));
+#else
+  // a float has no fraction digits at this magnitude, 987654336 is exact
+  test::sprintf(buffer, "%.9f", 987654336.0);
+  REQUIRE(!strcmp(buffer, "987654336.000000000"));
+
+  test::sprintf(buffer, "%.6f", 98765.4321);
+  REQUIRE(!strcmp(buffer, "98765.429688"));
+
+  test::sprintf(buffer, "%.2f", 16777216.0);
+  REQUIRE(!strcmp(buffer, "16777216.00"));
+#endif
+
+  test::sprintf(buffer, "%010.2f", -23.5);
+  REQUIRE(!strcmp(buffer, "-000023.50"));
+}
+
+
 TEST_CASE("types", "[]" ) {
   char buffer[100];
 
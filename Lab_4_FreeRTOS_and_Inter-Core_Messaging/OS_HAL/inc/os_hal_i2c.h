@@ -143,6 +143,16 @@ typedef enum {
 	OS_HAL_I2C_ISU_MAX
 } i2c_num;
 
+/** Completion callback of an asynchronous transfer, called in interrupt
+ *  context with 0 or the negative error code of the transfer.
+ */
+typedef void (*i2c_async_callback)(void *user_data, int result);
+
+/** Transfers longer than the 8 byte FIFO go through DMA, place their
+ *  buffers in SYSRAM.
+ */
+#define OS_HAL_I2C_DMA_BUFFER __attribute__((section(".sysram")))
+
 /**
   * @}
   */
@@ -253,6 +263,56 @@ int mtk_os_hal_i2c_write(i2c_num bus_num, u8 device_addr, u8 *buffer, u16 len);
 int mtk_os_hal_i2c_write_read(i2c_num bus_num, u8 device_addr,
 			      u8 *wr_buf, u8 *rd_buf, u16 wr_len, u16 rd_len);
 
+/**
+ *  @brief Start an I2C master write then read and return without waiting,
+ *  e.g. to drain a sensor FIFO by DMA while the caller does other work.
+ *  A zero wr_len or rd_len starts a plain read or write.
+ *  There is no timeout, a caller that stops waiting for the callback calls
+ *  mtk_os_hal_i2c_async_abort.
+ *
+ *  @param [in] bus_num : I2C ISU Port number,
+ *  it can be OS_HAL_I2C_ISU0~OS_HAL_I2C_ISU4.
+ *
+ *  @param [in] device_addr : slave device address.
+ *
+ *  @param [in] wr_buf : write data buffer, in SYSRAM if wr_len > 8.
+ *
+ *  @param [in] rd_buf : read data buffer, in SYSRAM if rd_len > 8.
+ *
+ *  @param [in] wr_len : write data length.
+ *
+ *  @param [in] rd_len : read data length.
+ *
+ *  @param [in] callback : called in interrupt context when the transfer
+ *  completed, the buffers must stay valid until then.
+ *
+ *  @param [in] user_data : passed to callback.
+ *
+ *  @return -#I2C_EBUSY if a transfer is in flight on the bus.\n
+ *  @return other negative value means the transfer did not start.
+ *
+ *  @return "0" if the transfer started.
+ */
+int mtk_os_hal_i2c_write_read_async(i2c_num bus_num, u8 device_addr,
+				    u8 *wr_buf, u8 *rd_buf, u16 wr_len, u16 rd_len,
+				    i2c_async_callback callback, void *user_data);
+
+/**
+ *  @brief Abort the asynchronous transfer in flight, e.g. when its callback
+ *  did not come in time. The controller is reset and the bus released, the
+ *  callback is not called.
+ *
+ *  @param [in] bus_num : I2C ISU Port number,
+ *  it can be OS_HAL_I2C_ISU0~OS_HAL_I2C_ISU4.
+ *
+ *  @return -#I2C_EINVAL if no asynchronous transfer is in flight, its
+ *  callback has been called.\n
+ *  @return other negative value means fail.
+ *
+ *  @return "0" if the transfer was aborted.
+ */
+int mtk_os_hal_i2c_async_abort(i2c_num bus_num);
+
 /**
  *  @brief Set I2C slave address before transfer when I2C hardware
  *  controller is set as a slave role, it which means does not call
@@ -36,6 +36,7 @@
 #ifdef OSAI_FREERTOS
 #include <FreeRTOS.h>
 #include <semphr.h>
+#include <task.h>
 #endif
 
 #include "nvic.h"
@@ -95,34 +96,116 @@ struct mtk_i2c_ctrl_rtos {
 #else
 	volatile u8 xfer_completion;
 #endif
+
+	/* claimed by a transfer, from before its setup until it completed */
+	volatile bool busy;
+
+	/* asynchronous transfer, completed by callback instead of xfer_completion */
+	struct i2c_msg async_msgs[2];
+	i2c_async_callback async_callback;
+	void *async_user_data;
 };
 
 static struct mtk_i2c_ctrl_rtos g_i2c_ctrl_rtos[OS_HAL_I2C_ISU_MAX];
 struct mtk_i2c_controller g_i2c_ctrl[OS_HAL_I2C_ISU_MAX];
 struct mtk_i2c_private g_i2c_mdata[OS_HAL_I2C_ISU_MAX];
 
+/* Masks the I2C and DMA interrupts, and the scheduler with FreeRTOS */
+static u32 _mtk_os_hal_i2c_lock(void)
+{
+#ifdef OSAI_FREERTOS
+	taskENTER_CRITICAL();
+	return 0;
+#else
+	u32 primask = __get_PRIMASK();
+
+	__disable_irq();
+	return primask;
+#endif
+}
+
+static void _mtk_os_hal_i2c_unlock(u32 primask)
+{
+#ifdef OSAI_FREERTOS
+	(void)primask;
+	taskEXIT_CRITICAL();
+#else
+	__set_PRIMASK(primask);
+#endif
+}
+
+/* Claims the bus for one transfer. Every entry point claims it before it
+ * touches the controller, so a second caller cannot change the messages of
+ * a transfer in flight.
+ */
+static int _mtk_os_hal_i2c_claim(struct mtk_i2c_ctrl_rtos *ctrl_rtos)
+{
+	int ret = I2C_OK;
+	u32 primask = _mtk_os_hal_i2c_lock();
+
+	if (ctrl_rtos->busy)
+		ret = -I2C_EBUSY;
+	else
+		ctrl_rtos->busy = true;
+
+	_mtk_os_hal_i2c_unlock(primask);
+
+	return ret;
+}
+
+static void _mtk_os_hal_i2c_release(struct mtk_i2c_ctrl_rtos *ctrl_rtos)
+{
+	ctrl_rtos->busy = false;
+}
+
+/* Called in interrupt context once per transfer, when the I2C or the DMA
+ * engine is done with it.
+ */
+static void _mtk_os_hal_i2c_complete_from_isr(
+	struct mtk_i2c_ctrl_rtos *ctrl_rtos)
+{
+	i2c_async_callback callback = ctrl_rtos->async_callback;
+	int ret;
+
+	/* late completion of a transfer that timed out or was aborted */
+	if (!ctrl_rtos->busy)
+		return;
+
+	if (callback) {
+		ret = mtk_mhal_i2c_result_handle(ctrl_rtos->i2c);
+		if (ret)
+			mtk_mhal_i2c_init_hw(ctrl_rtos->i2c);
+
+		ctrl_rtos->async_callback = NULL;
+		_mtk_os_hal_i2c_release(ctrl_rtos);
+		callback(ctrl_rtos->async_user_data, ret);
+		return;
+	}
+
+#ifdef OSAI_FREERTOS
+	BaseType_t x_higher_priority_task_woken = pdFALSE;
+
+	xSemaphoreGiveFromISR(ctrl_rtos->xfer_completion,
+			      &x_higher_priority_task_woken);
+	portYIELD_FROM_ISR(x_higher_priority_task_woken);
+#else
+	ctrl_rtos->xfer_completion++;
+#endif
+}
+
 static void _mtk_os_hal_i2c_irq_handler(int bus_num)
 {
 	u8 ret = 0;
 	struct mtk_i2c_ctrl_rtos *ctrl_rtos = &g_i2c_ctrl_rtos[bus_num];
 	struct mtk_i2c_controller *i2c = ctrl_rtos->i2c;
-#ifdef OSAI_FREERTOS
-	BaseType_t x_higher_priority_task_woken = pdFALSE;
-#endif
+
 	ret = mtk_mhal_i2c_irq_handle(i2c);
 
 	/* 1. FIFO mode: return completion done in I2C irq handler
 	 * 2. DMA mode: return completion done in DMA irq handler
 	 */
-	if (!ret) {
-#ifdef OSAI_FREERTOS
-		xSemaphoreGiveFromISR(ctrl_rtos->xfer_completion,
-				      &x_higher_priority_task_woken);
-		portYIELD_FROM_ISR(x_higher_priority_task_woken);
-#else
-		ctrl_rtos->xfer_completion++;
-#endif
-	}
+	if (!ret)
+		_mtk_os_hal_i2c_complete_from_isr(ctrl_rtos);
 }
 
 static void _mtk_os_hal_i2c0_irq_event(void)
@@ -204,24 +287,12 @@ static void _mtk_os_hal_i2c_free_irq(int bus_num)
 
 static int _mtk_os_hal_i2c_dma_done_callback(void *data)
 {
-#ifdef OSAI_FREERTOS
-	BaseType_t x_higher_priority_task_woken = pdFALSE;
-	struct mtk_i2c_ctrl_rtos *ctrl_rtos;
-
-	ctrl_rtos = (struct mtk_i2c_ctrl_rtos *)data;
-
-	/* while using DMA mode, release semaphore in this callback */
-	xSemaphoreGiveFromISR(ctrl_rtos->xfer_completion,
-			      &x_higher_priority_task_woken);
-	portYIELD_FROM_ISR(x_higher_priority_task_woken);
-
-	return 0;
-#else
 	struct mtk_i2c_ctrl_rtos *ctrl_rtos = data;
 
-	ctrl_rtos->xfer_completion++;
+	/* while using DMA mode, complete the transfer in this callback */
+	_mtk_os_hal_i2c_complete_from_isr(ctrl_rtos);
+
 	return 0;
-#endif
 }
 
 static int _mtk_os_hal_i2c_wait_for_completion_timeout(
@@ -245,6 +316,9 @@ static int _mtk_os_hal_i2c_wait_for_completion_timeout(
 	return 0;
 }
 
+/* Runs the transfer set up by the caller, which claimed the bus, and
+ * releases the bus.
+ */
 int _mtk_os_hal_i2c_transfer(struct mtk_i2c_ctrl_rtos *ctrl_rtos, int bus_num)
 {
 	int ret = I2C_OK;
@@ -252,6 +326,13 @@ int _mtk_os_hal_i2c_transfer(struct mtk_i2c_ctrl_rtos *ctrl_rtos, int bus_num)
 
 	i2c = ctrl_rtos->i2c;
 
+	/* drop a completion given after an aborted transfer was released */
+#ifdef OSAI_FREERTOS
+	xSemaphoreTake(ctrl_rtos->xfer_completion, 0);
+#else
+	ctrl_rtos->xfer_completion = 0;
+#endif
+
 	ret = mtk_mhal_i2c_trigger_transfer(i2c);
 	if (ret) {
 		printf("i2c%d trigger transfer fail\n", bus_num);
@@ -272,6 +353,7 @@ int _mtk_os_hal_i2c_transfer(struct mtk_i2c_ctrl_rtos *ctrl_rtos, int bus_num)
 	}
 
 err_exit:
+	_mtk_os_hal_i2c_release(ctrl_rtos);
 
 	return ret;
 }
@@ -404,6 +486,10 @@ int mtk_os_hal_i2c_read(i2c_num bus_num, u8 device_addr, u8 *buffer, u16 len)
 		return -I2C_EPTR;
 	}
 
+	ret = _mtk_os_hal_i2c_claim(ctrl_rtos);
+	if (ret)
+		return ret;
+
 	i2c->msg_num = 1;
 	i2c->dma_en = false;
 	i2c->i2c_mode = I2C_MASTER_MODE;
@@ -449,6 +535,10 @@ int   mtk_os_hal_i2c_write(i2c_num bus_num, u8 device_addr, u8 *buffer, u16 len)
 		return -I2C_EPTR;
 	}
 
+	ret = _mtk_os_hal_i2c_claim(ctrl_rtos);
+	if (ret)
+		return ret;
+
 	i2c->msg_num = 1;
 	i2c->dma_en = false;
 	i2c->i2c_mode = I2C_MASTER_MODE;
@@ -495,6 +585,10 @@ int mtk_os_hal_i2c_write_read(i2c_num bus_num, u8 device_addr,
 		return -I2C_EPTR;
 	}
 
+	ret = _mtk_os_hal_i2c_claim(ctrl_rtos);
+	if (ret)
+		return ret;
+
 	i2c->msg_num = 2;
 	i2c->dma_en = false;
 	i2c->i2c_mode = I2C_MASTER_MODE;
@@ -520,6 +614,114 @@ int mtk_os_hal_i2c_write_read(i2c_num bus_num, u8 device_addr,
 	return ret;
 }
 
+int mtk_os_hal_i2c_write_read_async(i2c_num bus_num, u8 device_addr,
+				    u8 *wr_buf, u8 *rd_buf, u16 wr_len, u16 rd_len,
+				    i2c_async_callback callback, void *user_data)
+{
+	struct mtk_i2c_ctrl_rtos *ctrl_rtos;
+	struct mtk_i2c_controller *i2c;
+	struct i2c_msg *msgs;
+	int ret = I2C_OK;
+
+	if (bus_num >= OS_HAL_I2C_ISU_MAX || !callback ||
+	    (wr_len == 0 && rd_len == 0))
+		return -I2C_EINVAL;
+
+#ifndef OSAI_ENABLE_DMA
+	if (wr_len > PIO_I2C_MAX_LEN || rd_len > PIO_I2C_MAX_LEN) {
+		printf("Error! buf length should be less than or equal to %d\n", PIO_I2C_MAX_LEN);
+		return -I2C_EINVAL;
+	}
+#endif
+
+	ctrl_rtos = &g_i2c_ctrl_rtos[bus_num];
+
+	i2c = ctrl_rtos->i2c;
+	if (!i2c) {
+		printf("i2c%d *i2c is NULL Pointer\n", bus_num);
+		return -I2C_EPTR;
+	}
+
+	ret = _mtk_os_hal_i2c_claim(ctrl_rtos);
+	if (ret)
+		return ret;
+
+	i2c->msg_num = 0;
+	i2c->dma_en = false;
+	i2c->i2c_mode = I2C_MASTER_MODE;
+	i2c->irq_stat = 0;
+
+	/* the messages must outlive this call, a zero length leaves out the
+	 * write or the read
+	 */
+	msgs = ctrl_rtos->async_msgs;
+	if (wr_len) {
+		msgs[i2c->msg_num].addr = device_addr;
+		msgs[i2c->msg_num].flags = I2C_MASTER_WR;
+		msgs[i2c->msg_num].len = wr_len;
+		msgs[i2c->msg_num].buf = wr_buf;
+		i2c->msg_num++;
+	}
+	if (rd_len) {
+		msgs[i2c->msg_num].addr = device_addr;
+		msgs[i2c->msg_num].flags = I2C_MASTER_RD;
+		msgs[i2c->msg_num].len = rd_len;
+		msgs[i2c->msg_num].buf = rd_buf;
+		i2c->msg_num++;
+	}
+
+	i2c->msg = msgs;
+
+	ctrl_rtos->async_user_data = user_data;
+	ctrl_rtos->async_callback = callback;
+
+	ret = mtk_mhal_i2c_trigger_transfer(i2c);
+	if (ret) {
+		printf("i2c%d trigger transfer fail\n", bus_num);
+		ctrl_rtos->async_callback = NULL;
+		_mtk_os_hal_i2c_release(ctrl_rtos);
+	}
+
+	return ret;
+}
+
+int mtk_os_hal_i2c_async_abort(i2c_num bus_num)
+{
+	struct mtk_i2c_ctrl_rtos *ctrl_rtos;
+	struct mtk_i2c_controller *i2c;
+	bool in_flight;
+	u32 primask;
+
+	if (bus_num >= OS_HAL_I2C_ISU_MAX)
+		return -I2C_EINVAL;
+
+	ctrl_rtos = &g_i2c_ctrl_rtos[bus_num];
+
+	i2c = ctrl_rtos->i2c;
+	if (!i2c) {
+		printf("i2c%d *i2c is NULL Pointer\n", bus_num);
+		return -I2C_EPTR;
+	}
+
+	/* the completion clears the callback in interrupt context, whichever
+	 * of the two clears it owns the end of the transfer
+	 */
+	primask = _mtk_os_hal_i2c_lock();
+	in_flight = ctrl_rtos->async_callback != NULL;
+	ctrl_rtos->async_callback = NULL;
+	_mtk_os_hal_i2c_unlock(primask);
+
+	if (!in_flight)
+		return -I2C_EINVAL;
+
+	printf("i2c%d async transfer aborted\n", bus_num);
+	mtk_mhal_i2c_dump_register(i2c);
+	mtk_mhal_i2c_init_hw(i2c);
+	_mtk_os_hal_i2c_release(ctrl_rtos);
+
+	return I2C_OK;
+}
+
 int mtk_os_hal_i2c_set_slave_addr(i2c_num bus_num, u8 slv_addr)
 {
 	int ret = I2C_OK;
@@ -571,6 +773,10 @@ int mtk_os_hal_i2c_slave_tx(i2c_num bus_num, u8 *buffer, u16 len, u32 time_out)
 		return -I2C_EPTR;
 	}
 
+	ret = _mtk_os_hal_i2c_claim(ctrl_rtos);
+	if (ret)
+		return ret;
+
 	i2c->msg_num = 1;
 	i2c->dma_en = false;
 	i2c->i2c_mode = I2C_SLAVE_MODE;
@@ -616,6 +822,10 @@ int mtk_os_hal_i2c_slave_rx(i2c_num bus_num, u8 *buffer, u16 len, u32 time_out)
 		return -I2C_EPTR;
 	}
 
+	ret = _mtk_os_hal_i2c_claim(ctrl_rtos);
+	if (ret)
+		return ret;
+
 	i2c->msg_num = 1;
 	i2c->dma_en = false;
 	i2c->i2c_mode = I2C_SLAVE_MODE;
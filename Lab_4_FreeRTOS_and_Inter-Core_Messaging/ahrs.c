@@ -0,0 +1,117 @@
+#include "ahrs.h"
+
+#define DEG_TO_RAD	0.0174532925f
+#define RAD_TO_DEG	57.2957795f
+
+static float inv_sqrt(float x) {
+	return 1.0f / sqrtf(x);
+}
+
+static void normalize_quaternion(float q[4]) {
+	float norm = inv_sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+	for (int i = 0; i < 4; i++) {
+		q[i] *= norm;
+	}
+}
+
+/// <summary>
+///     Starts from the accelerometer tilt with zero heading, the filter would need seconds to get there from identity
+/// </summary>
+static void init_from_accel(ahrs_t* ahrs, float ax, float ay, float az) {
+	float half_roll = 0.5f * atan2f(ay, az);
+	float half_pitch = 0.5f * atan2f(-ax, sqrtf(ay * ay + az * az));
+	float cr = cosf(half_roll), sr = sinf(half_roll);
+	float cp = cosf(half_pitch), sp = sinf(half_pitch);
+
+	ahrs->q[0] = cr * cp;
+	ahrs->q[1] = sr * cp;
+	ahrs->q[2] = cr * sp;
+	ahrs->q[3] = -sr * sp;
+	ahrs->initialized = true;
+}
+
+void ahrs_init(ahrs_t* ahrs, float sample_rate_hz, float beta) {
+	ahrs->q[0] = 1.0f;
+	ahrs->q[1] = ahrs->q[2] = ahrs->q[3] = 0.0f;
+	ahrs->beta = beta;
+	ahrs->sample_period_s = 1.0f / sample_rate_hz;
+	ahrs->initialized = false;
+}
+
+/// <summary>
+///     Advances the orientation by one sample period. A zero acceleration, e.g. free fall, skips the correction step.
+/// </summary>
+void ahrs_update_imu(ahrs_t* ahrs, const float gyro_dps[3], const float accel_mg[3]) {
+	float* q = ahrs->q;
+	float gx = gyro_dps[0] * DEG_TO_RAD;
+	float gy = gyro_dps[1] * DEG_TO_RAD;
+	float gz = gyro_dps[2] * DEG_TO_RAD;
+	float ax = accel_mg[0];
+	float ay = accel_mg[1];
+	float az = accel_mg[2];
+	float accel_norm_sq = ax * ax + ay * ay + az * az;
+
+	if (!ahrs->initialized) {
+		if (accel_norm_sq > 0.0f) {
+			init_from_accel(ahrs, ax, ay, az);
+		}
+		return;
+	}
+
+	// rate of change of the quaternion from the gyroscope
+	float q_dot[4] = {
+		0.5f * (-q[1] * gx - q[2] * gy - q[3] * gz),
+		0.5f * (q[0] * gx + q[2] * gz - q[3] * gy),
+		0.5f * (q[0] * gy - q[1] * gz + q[3] * gx),
+		0.5f * (q[0] * gz + q[1] * gy - q[2] * gx)
+	};
+
+	if (accel_norm_sq > 0.0f) {
+		float norm = inv_sqrt(accel_norm_sq);
+		ax *= norm;
+		ay *= norm;
+		az *= norm;
+
+		// gradient of the error between measured and estimated gravity
+		float q0q0 = q[0] * q[0], q1q1 = q[1] * q[1], q2q2 = q[2] * q[2], q3q3 = q[3] * q[3];
+		float s[4] = {
+			4.0f * q[0] * q2q2 + 2.0f * q[2] * ax + 4.0f * q[0] * q1q1 - 2.0f * q[1] * ay,
+			4.0f * q[1] * q3q3 - 2.0f * q[3] * ax + 4.0f * q0q0 * q[1] - 2.0f * q[0] * ay - 4.0f * q[1] + 8.0f * q[1] * q1q1 + 8.0f * q[1] * q2q2 + 4.0f * q[1] * az,
+			4.0f * q0q0 * q[2] + 2.0f * q[0] * ax + 4.0f * q[2] * q3q3 - 2.0f * q[3] * ay - 4.0f * q[2] + 8.0f * q[2] * q1q1 + 8.0f * q[2] * q2q2 + 4.0f * q[2] * az,
+			4.0f * q1q1 * q[3] - 2.0f * q[1] * ax + 4.0f * q2q2 * q[3] - 2.0f * q[2] * ay
+		};
+		float s_norm_sq = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3];
+
+		// at the exact solution the gradient vanishes
+		if (s_norm_sq > 0.0f) {
+			float step = ahrs->beta * inv_sqrt(s_norm_sq);
+			for (int i = 0; i < 4; i++) {
+				q_dot[i] -= step * s[i];
+			}
+		}
+	}
+
+	for (int i = 0; i < 4; i++) {
+		q[i] += q_dot[i] * ahrs->sample_period_s;
+	}
+	normalize_quaternion(q);
+}
+
+/// <summary>
+///     Roll and yaw in -180..180 degrees, pitch in -90..90 degrees
+/// </summary>
+void ahrs_get_euler_deg(const ahrs_t* ahrs, float* roll, float* pitch, float* yaw) {
+	const float* q = ahrs->q;
+	float sin_pitch = 2.0f * (q[0] * q[2] - q[1] * q[3]);
+
+	if (sin_pitch > 1.0f) {
+		sin_pitch = 1.0f;
+	} else if (sin_pitch < -1.0f) {
+		sin_pitch = -1.0f;
+	}
+
+	*roll = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]), 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2])) * RAD_TO_DEG;
+	*pitch = asinf(sin_pitch) * RAD_TO_DEG;
+	*yaw = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]), 1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3])) * RAD_TO_DEG;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+
+/*
+Orientation estimation from gyroscope and accelerometer samples, Madgwick's gradient descent filter
+for IMUs without a magnetometer.
+
+The gyro rate is integrated as a quaternion and each update steps the quaternion towards the
+attitude where gravity points along the measured acceleration, beta sets the step size. Roll and
+pitch converge to the accelerometer tilt, yaw is the integrated heading and drifts with the
+remaining gyro bias. All arithmetic is single precision for the Cortex-M4F FPU.
+*/
+
+#define AHRS_DEFAULT_BETA		0.1f	// rad/s, higher converges faster and passes more accelerometer noise
+
+typedef struct {
+	float q[4];					// w, x, y, z, rotation from the sensor frame to the earth frame
+	float beta;
+	float sample_period_s;
+	bool initialized;
+} ahrs_t;
+
+void ahrs_init(ahrs_t* ahrs, float sample_rate_hz, float beta);
+void ahrs_update_imu(ahrs_t* ahrs, const float gyro_dps[3], const float accel_mg[3]);
+void ahrs_get_euler_deg(const ahrs_t* ahrs, float* roll, float* pitch, float* yaw);
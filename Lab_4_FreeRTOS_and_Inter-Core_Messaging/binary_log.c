@@ -0,0 +1,77 @@
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "binary_log.h"
+
+/* Defined in linker.ld at the start of the non-loaded lp_log_fmt section */
+extern const char __start_lp_log_fmt[];
+
+static LP_LOG_RECORD ring[LP_LOG_RING_RECORDS];
+static volatile uint32_t ring_head;	/* next record to write */
+static volatile uint32_t ring_tail;	/* next record to flush */
+static volatile uint32_t dropped_records;
+
+/*
+ * Records a log entry. Called by the LP_LOG macro from any task, the format is not expanded here.
+ */
+void binary_log_record(const char* format, uint32_t arg_count, const uint32_t* args)
+{
+	LP_LOG_RECORD* record;
+	uint32_t next;
+
+	if (arg_count > LP_LOG_MAX_ARGS)
+		arg_count = LP_LOG_MAX_ARGS;
+
+	taskENTER_CRITICAL();
+
+	next = (ring_head + 1) % LP_LOG_RING_RECORDS;
+	if (next == ring_tail) {
+		dropped_records++;
+		taskEXIT_CRITICAL();
+		return;
+	}
+
+	record = &ring[ring_head];
+	record->format_id = (uint32_t)(format - __start_lp_log_fmt);
+	record->timestamp = xTaskGetTickCount();
+	record->arg_count = arg_count;
+	if (arg_count > 0)
+		memcpy(record->args, args, arg_count * sizeof(uint32_t));
+	ring_head = next;
+
+	taskEXIT_CRITICAL();
+}
+
+static void write_record(const LP_LOG_RECORD* record)
+{
+	uint32_t i;
+
+	/* LPLOG:<format_id><timestamp><arg_count><args...> as hex, decoded by tools/Utilities/lp_log_decode.py */
+	printf("LPLOG:%08X%08X%02X", record->format_id, record->timestamp, record->arg_count);
+	for (i = 0; i < record->arg_count; i++)
+		printf("%08X", record->args[i]);
+	printf("\n");
+}
+
+/*
+ * Writes all pending records to the UART. Call from a low priority task.
+ */
+void binary_log_flush(void)
+{
+	LP_LOG_RECORD dropped = { .format_id = LP_LOG_DROPPED_ID, .arg_count = 1 };
+
+	while (ring_tail != ring_head) {
+		write_record(&ring[ring_tail]);
+		ring_tail = (ring_tail + 1) % LP_LOG_RING_RECORDS;
+	}
+
+	if (dropped_records > 0) {
+		taskENTER_CRITICAL();
+		dropped.args[0] = dropped_records;
+		dropped_records = 0;
+		taskEXIT_CRITICAL();
+
+		dropped.timestamp = xTaskGetTickCount();
+		write_record(&dropped);
+	}
+}
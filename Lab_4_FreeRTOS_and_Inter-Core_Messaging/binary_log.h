@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "printf.h"
+
+/*
+Deferred-format binary logging.
+
+With LP_LOG_BINARY defined, LP_LOG records the format string ID plus the raw 32 bit arguments into a
+ring buffer and formatting happens offline. The format strings are placed in the lp_log_fmt ELF section,
+which linker.ld keeps out of the loaded image. tools/Utilities/lp_log_decode.py extracts them from
+the application ELF and decodes the captured "LPLOG:" UART output. Records are written out by
+binary_log_flush from a low priority task. Without LP_LOG_BINARY, LP_LOG is a plain printf call.
+
+Arguments are recorded as 32 bit words, so %d, %u, %x, %c and %f (single precision) are supported.
+Up to LP_LOG_MAX_ARGS arguments per call.
+*/
+
+#define LP_LOG_MAX_ARGS 6
+#define LP_LOG_RING_RECORDS 64
+#define LP_LOG_DROPPED_ID 0xFFFFFFFF	// format id of the record reporting dropped records
+
+typedef struct {
+	uint32_t format_id;
+	uint32_t timestamp;		// FreeRTOS ticks since the scheduler started
+	uint32_t arg_count;
+	uint32_t args[LP_LOG_MAX_ARGS];
+} LP_LOG_RECORD;
+
+void binary_log_record(const char* format, uint32_t arg_count, const uint32_t* args);
+void binary_log_flush(void);
+
+static inline uint32_t binary_log_arg_int(uint32_t value) { return value; }
+static inline uint32_t binary_log_arg_float(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+static inline uint32_t binary_log_arg_double(double value) { return binary_log_arg_float((float)value); }
+static inline uint32_t binary_log_arg_ptr(const void* value) { return (uint32_t)(uintptr_t)value; }
+
+#define LP_LOG_ARG(x) _Generic((x), \
+	float: binary_log_arg_float, \
+	double: binary_log_arg_double, \
+	char*: binary_log_arg_ptr, \
+	const char*: binary_log_arg_ptr, \
+	void*: binary_log_arg_ptr, \
+	const void*: binary_log_arg_ptr, \
+	default: binary_log_arg_int)(x)
+
+#ifdef LP_LOG_BINARY
+
+#define LP_LOG_FORMAT(fmt) static const char _lpLogFmt[] __attribute__((section("lp_log_fmt"), used)) = fmt
+
+#define LP_LOG_COUNT(...) LP_LOG_COUNT_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, _)
+#define LP_LOG_COUNT_(f, a1, a2, a3, a4, a5, a6, n, ...) n
+#define LP_LOG_CAT(a, b) LP_LOG_CAT_(a, b)
+#define LP_LOG_CAT_(a, b) a##b
+
+#define LP_LOG(...) LP_LOG_CAT(LP_LOG_, LP_LOG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+
+#define LP_LOG_0(fmt) do { LP_LOG_FORMAT(fmt); binary_log_record(_lpLogFmt, 0, NULL); } while (0)
+#define LP_LOG_1(fmt, a1) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1) }; binary_log_record(_lpLogFmt, 1, _lpArgs); } while (0)
+#define LP_LOG_2(fmt, a1, a2) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2) }; binary_log_record(_lpLogFmt, 2, _lpArgs); } while (0)
+#define LP_LOG_3(fmt, a1, a2, a3) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3) }; binary_log_record(_lpLogFmt, 3, _lpArgs); } while (0)
+#define LP_LOG_4(fmt, a1, a2, a3, a4) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3), LP_LOG_ARG(a4) }; \
+	binary_log_record(_lpLogFmt, 4, _lpArgs); } while (0)
+#define LP_LOG_5(fmt, a1, a2, a3, a4, a5) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3), LP_LOG_ARG(a4), LP_LOG_ARG(a5) }; \
+	binary_log_record(_lpLogFmt, 5, _lpArgs); } while (0)
+#define LP_LOG_6(fmt, a1, a2, a3, a4, a5, a6) do { LP_LOG_FORMAT(fmt); \
+	const uint32_t _lpArgs[] = { LP_LOG_ARG(a1), LP_LOG_ARG(a2), LP_LOG_ARG(a3), LP_LOG_ARG(a4), LP_LOG_ARG(a5), LP_LOG_ARG(a6) }; \
+	binary_log_record(_lpLogFmt, 6, _lpArgs); } while (0)
+
+#else
+
+#define LP_LOG(...) printf(__VA_ARGS__)
+
+#endif // LP_LOG_BINARY
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+Online gyroscope bias estimator.
+
+Every gyro sample is fed with the matching accelerometer sample and device temperature. While the
+accelerometer reads a steady 1 g the gyro samples accumulate in a running mean and variance (Welford).
+A window of GYRO_BIAS_WINDOW_SAMPLES quiet samples is the zero rate offset at that temperature and is
+blended into a table of temperature bins. Motion restarts the window. The bias for a temperature comes
+from its bin, or is interpolated from the nearest calibrated bins.
+
+The bins are plain data so the application can persist them and restore them on the next boot.
+*/
+
+#define GYRO_BIAS_TEMPERATURE_BINS		12
+#define GYRO_BIAS_BIN_MIN_DEGC			0.0f	// first bin is 0 to 5 degC, last bin is 55 to 60 degC
+#define GYRO_BIAS_BIN_WIDTH_DEGC		5.0f
+#define GYRO_BIAS_WINDOW_SAMPLES		25		// 2 seconds at 12.5 Hz
+#define GYRO_BIAS_MAX_STDDEV_DPS		0.5f	// per axis, more noise than this means the device is turning
+#define GYRO_BIAS_MAX_ACCEL_DEVIATION_MG	50.0f	// |a| must stay within this of 1 g
+#define GYRO_BIAS_MAX_ACCEL_STEP_MG		20.0f	// and each axis within this of the previous sample
+#define GYRO_BIAS_MAX_BIN_WEIGHT		16		// windows averaged per bin, older windows fade out
+#define GYRO_BIAS_SAVE_DELTA_DPS		0.05f	// bin change that makes the table worth saving again
+
+typedef struct {
+	float bias_dps[3];
+	uint16_t weight;		// number of windows blended into bias_dps, 0 = not calibrated
+} gyro_bias_bin_t;
+
+typedef struct {
+	gyro_bias_bin_t bins[GYRO_BIAS_TEMPERATURE_BINS];
+
+	// current stationary window
+	uint32_t count;
+	float mean_dps[3];
+	float m2[3];
+	float temperature_sum_degC;
+	float last_accel_mg[3];
+	bool has_last_accel;
+
+	// bias of each bin when the table was last saved
+	float saved_dps[GYRO_BIAS_TEMPERATURE_BINS][3];
+	bool saved_valid[GYRO_BIAS_TEMPERATURE_BINS];
+} gyro_bias_t;
+
+void gyro_bias_init(gyro_bias_t* estimator);
+void gyro_bias_restore(gyro_bias_t* estimator, const gyro_bias_bin_t bins[GYRO_BIAS_TEMPERATURE_BINS]);
+bool gyro_bias_update(gyro_bias_t* estimator, const float gyro_dps[3], const float accel_mg[3], float temperature_degC);
+bool gyro_bias_get(const gyro_bias_t* estimator, float temperature_degC, float bias_dps[3]);
+bool gyro_bias_is_calibrated(const gyro_bias_t* estimator, float temperature_degC);
+bool gyro_bias_needs_save(const gyro_bias_t* estimator);
+void gyro_bias_mark_saved(gyro_bias_t* estimator);
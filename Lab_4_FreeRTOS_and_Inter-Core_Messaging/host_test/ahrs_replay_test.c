@@ -0,0 +1,190 @@
+/* Host replay of an IMU trace through the real-time core orientation pipeline. The raw samples of
+   imu_trace.csv are served by a register file fake of the LSM6DSO, read by lsm6dso_read_imu with the
+   gyro bias estimator, and fused by ahrs_update_imu as ImuTask does. Roll, pitch and yaw must follow
+   the reference orientation of the trace. */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ahrs.h"
+#include "../lsm6dso_driver.h"
+#include "../lsm6dso_reg.h"
+#include "check.h"
+
+#define MAX_SAMPLES 20000
+
+// roll and pitch follow the accelerometer, yaw only integrates the bias corrected gyro
+#define MAX_TILT_ERROR_DEG 2.0
+#define MEAN_TILT_ERROR_DEG 0.5
+#define MAX_YAW_ERROR_DEG 3.0
+#define MEAN_YAW_ERROR_DEG 1.0
+
+// the device is back at rest from 37 s, the tilt has settled 3 s later; with the bias removed the heading
+// drifts by less than 0.05 dps over the last 5 s, the uncorrected bias of the trace would drift 0.75 deg
+#define SETTLED_FROM_S 40.0
+#define MAX_SETTLED_TILT_ERROR_DEG 0.5
+#define MAX_SETTLED_YAW_DRIFT_DEG 0.25
+
+typedef struct {
+	double time_s;
+	int16_t temperature;
+	int16_t gyro[3];
+	int16_t accel[3];
+	float roll;
+	float pitch;
+	float yaw;
+} TRACE_SAMPLE;
+
+static TRACE_SAMPLE trace[MAX_SAMPLES];
+static size_t traceCount;
+
+// LSM6DSO registers, the output burst from STATUS_REG is served from the trace
+static uint8_t registers[256];
+static size_t nextSample;
+static size_t currentSample;
+static unsigned long polls;
+
+static bool LoadTrace(const char *path)
+{
+	char line[256];
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL) {
+		perror(path);
+		return false;
+	}
+	while (fgets(line, sizeof(line), file) != NULL && traceCount < MAX_SAMPLES) {
+		TRACE_SAMPLE *s = &trace[traceCount];
+
+		if (sscanf(line, "%lf,%hd,%hd,%hd,%hd,%hd,%hd,%hd,%f,%f,%f", &s->time_s, &s->temperature, &s->gyro[0],
+				&s->gyro[1], &s->gyro[2], &s->accel[0], &s->accel[1], &s->accel[2], &s->roll, &s->pitch,
+				&s->yaw) == 11) {
+			traceCount++;
+		}
+	}
+	fclose(file);
+	return traceCount > 0;
+}
+
+static void PutInt16(uint8_t *out, int16_t value)
+{
+	out[0] = (uint8_t)((uint16_t)value & 0xFF);
+	out[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+int32_t i2c_write(int *fD, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+	for (uint16_t i = 0; i < len; i++) {
+		registers[(uint8_t)(reg + i)] = buf[i];
+	}
+	// the software reset completes at once
+	registers[LSM6DSO_CTRL3_C] &= (uint8_t)~0x01;
+	return 0;
+}
+
+// Polled at twice the ODR, every other burst has new data
+int32_t i2c_read(int *fD, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+	if (reg == LSM6DSO_STATUS_REG) {
+		registers[LSM6DSO_STATUS_REG] = 0;
+		if (polls++ % 2 == 1 && nextSample < traceCount) {
+			const TRACE_SAMPLE *s = &trace[nextSample];
+
+			currentSample = nextSample++;
+			registers[LSM6DSO_STATUS_REG] = 0x07; // XLDA, GDA, TDA
+			PutInt16(&registers[LSM6DSO_OUT_TEMP_L], s->temperature);
+			for (int axis = 0; axis < 3; axis++) {
+				PutInt16(&registers[LSM6DSO_OUTX_L_G + 2 * axis], s->gyro[axis]);
+				PutInt16(&registers[LSM6DSO_OUTX_L_A + 2 * axis], s->accel[axis]);
+			}
+		}
+	}
+	for (uint16_t i = 0; i < len; i++) {
+		buf[i] = registers[(uint8_t)(reg + i)];
+	}
+	return 0;
+}
+
+static double AngleError(double estimate, double reference)
+{
+	return fabs(fmod(estimate - reference + 540.0, 360.0) - 180.0);
+}
+
+static void TestReplay(void)
+{
+	ahrs_t ahrs;
+	float accel_mg[3];
+	float gyro_dps[3];
+	size_t fused = 0;
+	size_t settled = 0;
+	double tiltSum = 0, tiltMax = 0;
+	double yawSum = 0, yawMax = 0;
+	double settledTiltMax = 0;
+	double settledYaw = 0;
+	double settledYawDrift = 0;
+
+	registers[LSM6DSO_WHO_AM_I] = LSM6DSO_ID;
+	CHECK(lsm6dso_init(i2c_write, i2c_read) == 0);
+
+	// the trace is 104 Hz, 4 g and 2000 dps
+	CHECK(registers[LSM6DSO_CTRL1_XL] >> 4 == LSM6DSO_XL_ODR_104Hz);
+	CHECK((registers[LSM6DSO_CTRL1_XL] >> 2 & 0x03) == LSM6DSO_4g);
+	CHECK(registers[LSM6DSO_CTRL2_G] >> 4 == LSM6DSO_GY_ODR_104Hz);
+	CHECK((registers[LSM6DSO_CTRL2_G] >> 1 & 0x07) == LSM6DSO_2000dps);
+
+	ahrs_init(&ahrs, LSM6DSO_ODR_HZ, AHRS_DEFAULT_BETA);
+	while (nextSample < traceCount) {
+		if (!lsm6dso_read_imu(accel_mg, gyro_dps)) {
+			continue;
+		}
+		ahrs_update_imu(&ahrs, gyro_dps, accel_mg);
+		fused++;
+
+		const TRACE_SAMPLE *s = &trace[currentSample];
+		float roll, pitch, yaw;
+		ahrs_get_euler_deg(&ahrs, &roll, &pitch, &yaw);
+
+		double tilt = fmax(AngleError(roll, s->roll), AngleError(pitch, s->pitch));
+		double heading = AngleError(yaw, s->yaw);
+
+		tiltSum += tilt;
+		tiltMax = fmax(tiltMax, tilt);
+		yawSum += heading;
+		yawMax = fmax(yawMax, heading);
+		if (s->time_s >= SETTLED_FROM_S) {
+			if (settled++ == 0) {
+				settledYaw = yaw;
+			}
+			settledTiltMax = fmax(settledTiltMax, tilt);
+			settledYawDrift = fmax(settledYawDrift, AngleError(yaw, settledYaw));
+		}
+	}
+
+	printf("%zu samples fused, tilt error %.2f deg mean %.2f deg max, yaw error %.2f deg mean %.2f deg max, "
+		"at rest tilt error %.2f deg max, yaw drift %.3f deg\n",
+		fused, tiltSum / (double)fused, tiltMax, yawSum / (double)fused, yawMax, settledTiltMax, settledYawDrift);
+
+	CHECK(fused == traceCount);
+	CHECK(settled > 0);
+	CHECK(tiltSum / (double)fused <= MEAN_TILT_ERROR_DEG);
+	CHECK(tiltMax <= MAX_TILT_ERROR_DEG);
+	CHECK(yawSum / (double)fused <= MEAN_YAW_ERROR_DEG);
+	CHECK(yawMax <= MAX_YAW_ERROR_DEG);
+	CHECK(settledTiltMax <= MAX_SETTLED_TILT_ERROR_DEG);
+	CHECK(settledYawDrift <= MAX_SETTLED_YAW_DRIFT_DEG);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2 || !LoadTrace(argv[1])) {
+		fprintf(stderr, "usage: %s imu_trace.csv\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	TestReplay();
+
+	return CheckResult("AHRS replay");
+}
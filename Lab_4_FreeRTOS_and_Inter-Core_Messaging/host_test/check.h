@@ -0,0 +1,30 @@
+/* Checks of the host tests. CHECK reports a failed condition with its file and line and counts it,
+   CheckResult ends main with the count. */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                       \
+	do {                                                                                       \
+		if (!(condition)) {                                                                    \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);     \
+			failures++;                                                                        \
+		}                                                                                      \
+	} while (0)
+
+/// <summary>
+///     Prints the outcome of the checks of `name`, returns the exit status of main
+/// </summary>
+static inline int CheckResult(const char *name)
+{
+	if (failures != 0) {
+		fprintf(stderr, "%d %s check(s) failed\n", failures, name);
+		return EXIT_FAILURE;
+	}
+	printf("all %s checks passed\n", name);
+	return EXIT_SUCCESS;
+}
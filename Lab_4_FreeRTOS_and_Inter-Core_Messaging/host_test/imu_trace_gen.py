@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Writes the IMU trace replayed by ahrs_replay_test.
+
+The trace is the raw LSM6DSO output at 104 Hz, 4 g and 2000 dps full scale, as lsm6dso_read_imu reads
+it, for a known motion: held tilts, turns in heading, a change of tilt and a wobble while turning.
+The gyro has a constant bias and white noise, the accelerometer white noise, both are quantized to
+the sensor LSB. Every sample carries the reference orientation, roll, pitch and yaw in degrees.
+
+    python3 imu_trace_gen.py > imu_trace.csv
+"""
+
+import math
+import random
+
+ODR_HZ = 104.0
+DURATION_S = 45.0
+
+GYRO_MDPS_PER_LSB = 70.0
+ACCEL_MG_PER_LSB = 0.122
+GRAVITY_MG = 1000.0
+
+GYRO_BIAS_DPS = (0.30, -0.20, 0.15)
+GYRO_NOISE_DPS = 0.07
+ACCEL_NOISE_MG = 3.0
+
+# time, roll, pitch, yaw; the device moves smoothly from one pose to the next
+KEYFRAMES = [
+    (0.0, 20.0, -10.0, 0.0),
+    (5.0, 20.0, -10.0, 0.0),
+    (10.0, 20.0, -10.0, 90.0),
+    (14.0, 20.0, -10.0, 90.0),
+    (19.0, -30.0, 15.0, 90.0),
+    (23.0, -30.0, 15.0, 90.0),
+    (33.0, -30.0, 15.0, -60.0),
+    (37.0, 0.0, 0.0, -60.0),
+    (45.0, 0.0, 0.0, -60.0),
+]
+
+# roll and pitch wobble on top of the turn from 23 to 33 s
+WOBBLE_START_S = 23.0
+WOBBLE_END_S = 33.0
+
+
+def smoothstep(u):
+    return u * u * (3.0 - 2.0 * u)
+
+
+def euler_deg(t):
+    for (t0, r0, p0, y0), (t1, r1, p1, y1) in zip(KEYFRAMES, KEYFRAMES[1:]):
+        if t <= t1:
+            s = smoothstep((t - t0) / (t1 - t0))
+            roll, pitch, yaw = r0 + s * (r1 - r0), p0 + s * (p1 - p0), y0 + s * (y1 - y0)
+            break
+    else:
+        roll, pitch, yaw = KEYFRAMES[-1][1:]
+
+    if WOBBLE_START_S < t < WOBBLE_END_S:
+        u = (t - WOBBLE_START_S) / (WOBBLE_END_S - WOBBLE_START_S)
+        envelope = math.sin(math.pi * u) ** 2
+        roll += 15.0 * envelope * math.sin(2.0 * math.pi * 0.5 * (t - WOBBLE_START_S))
+        pitch += 10.0 * envelope * math.sin(2.0 * math.pi * 0.3 * (t - WOBBLE_START_S))
+    return roll, pitch, yaw
+
+
+def multiply(a, b):
+    return (
+        a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+        a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+        a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+        a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0],
+    )
+
+
+def conjugate(q):
+    return (q[0], -q[1], -q[2], -q[3])
+
+
+def quaternion(t):
+    """Rotation from the sensor frame to the earth frame, yaw about z, then pitch about y, then roll about x."""
+    roll, pitch, yaw = (math.radians(a) / 2.0 for a in euler_deg(t))
+    qx = (math.cos(roll), math.sin(roll), 0.0, 0.0)
+    qy = (math.cos(pitch), 0.0, math.sin(pitch), 0.0)
+    qz = (math.cos(yaw), 0.0, 0.0, math.sin(yaw))
+    return multiply(multiply(qz, qy), qx)
+
+
+def angular_rate_dps(t):
+    """Body frame rate, q_dot = q * (0, w) / 2."""
+    h = 1e-5
+    q = quaternion(t)
+    q_dot = [(a - b) / (2.0 * h) for a, b in zip(quaternion(t + h), quaternion(t - h))]
+    w = multiply(conjugate(q), q_dot)
+    return [math.degrees(2.0 * c) for c in w[1:]]
+
+
+def gravity_mg(t):
+    """Specific force in the sensor frame at rest, +1 g along the earth z axis."""
+    q = quaternion(t)
+    a = multiply(multiply(conjugate(q), (0.0, 0.0, 0.0, GRAVITY_MG)), q)
+    return a[1:]
+
+
+def lsb(value, per_lsb):
+    return max(-32768, min(32767, int(round(value / per_lsb))))
+
+
+def main():
+    rng = random.Random(1)
+
+    print("# LSM6DSO at %g Hz, 4 g, 2000 dps, written by imu_trace_gen.py" % ODR_HZ)
+    print("# gyro bias %s dps, gyro noise %g dps, accel noise %g mg" % (GYRO_BIAS_DPS, GYRO_NOISE_DPS, ACCEL_NOISE_MG))
+    print("time_s,temp,gx,gy,gz,ax,ay,az,roll_deg,pitch_deg,yaw_deg")
+
+    for i in range(int(DURATION_S * ODR_HZ)):
+        t = i / ODR_HZ
+        temperature_degc = 30.0 + 0.5 * t / DURATION_S
+        gyro = [w + b + rng.gauss(0.0, GYRO_NOISE_DPS) for w, b in zip(angular_rate_dps(t), GYRO_BIAS_DPS)]
+        accel = [a + rng.gauss(0.0, ACCEL_NOISE_MG) for a in gravity_mg(t)]
+        roll, pitch, yaw = euler_deg(t)
+        yaw = (yaw + 180.0) % 360.0 - 180.0
+
+        print("%.4f,%d,%d,%d,%d,%d,%d,%d,%.2f,%.2f,%.2f" % (
+            t, int(round((temperature_degc - 25.0) * 256.0)),
+            *(lsb(g * 1000.0, GYRO_MDPS_PER_LSB) for g in gyro),
+            *(lsb(a, ACCEL_MG_PER_LSB) for a in accel),
+            roll, pitch, yaw))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,155 @@
+/* Host tests of the LSM6DSO batch conversion kernels. The portable lane_lo / lane_hi / ssat versions of
+   the DSP instructions and every kernel are compared with the scalar reference for every int16 input,
+   with aligned and unaligned starts and odd counts. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lsm6dso_reg.h"
+
+// the packed helpers are static
+#include "../lsm6dso_convert.c"
+#include "check.h"
+
+#define INPUTS 65536
+#define SENTINEL 0x5A
+
+// values for the other lane of a pair
+static const int16_t otherLane[] = { 0, 1, -1, 2, -2, 127, -128, 6400, -6400, 32767, -32768, 32766, -32767, 12345, -23456 };
+
+static int16_t inputs[INPUTS + 2];
+
+static int32_t SaturatingAdd16(int32_t a, int32_t b)
+{
+	int32_t sum = a + b;
+	return sum > INT16_MAX ? INT16_MAX : sum < INT16_MIN ? INT16_MIN : sum;
+}
+
+static uint32_t Pair(int16_t lo, int16_t hi)
+{
+	return ((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo;
+}
+
+static bool SameFloat(float a, float b)
+{
+	return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Every int16 in each lane, next to a set of values in the other lane
+static void TestPackedInstructions(void)
+{
+	int mismatches = 0;
+
+	for (int32_t x = INT16_MIN; x <= INT16_MAX; x++) {
+		for (size_t j = 0; j < sizeof(otherLane) / sizeof(otherLane[0]); j++) {
+			int16_t y = otherLane[j];
+			uint32_t lo = Pair((int16_t)x, y);
+			uint32_t hi = Pair(y, (int16_t)x);
+
+			mismatches += lane_lo(lo) != x || lane_hi(lo) != y || lane_lo(hi) != y || lane_hi(hi) != x;
+
+			// SMULBB and SMULTB multiply one half of the pair by the bottom half of the other operand
+			mismatches += (int32_t)__SMULBB(lo, LSM6DSO_FS4_UG_PER_LSB) != x * LSM6DSO_FS4_UG_PER_LSB;
+			mismatches += (int32_t)__SMULTB(hi, LSM6DSO_FS4_UG_PER_LSB) != x * LSM6DSO_FS4_UG_PER_LSB;
+			mismatches += (int32_t)__SMULBB(lo, Pair(y, -5)) != x * y;
+			mismatches += (int32_t)__SMULTB(lo, Pair(y, -5)) != y * y;
+
+			mismatches += (int32_t)__QADD16(lo, Pair(y, y)) != (int32_t)Pair((int16_t)SaturatingAdd16(x, y),
+																		(int16_t)SaturatingAdd16(y, y));
+			mismatches += (int32_t)__QADD16(hi, Pair(y, y)) != (int32_t)Pair((int16_t)SaturatingAdd16(y, y),
+																		(int16_t)SaturatingAdd16(x, y));
+
+			mismatches += __SSAT(x + y, 16) != SaturatingAdd16(x, y);
+		}
+		mismatches += __SSAT(x * 4, 16) != SaturatingAdd16(x * 4, 0);
+	}
+	CHECK(mismatches == 0);
+}
+
+// Converts inputs[offset, offset + count) with every kernel and compares with the scalar reference
+static int CheckKernels(size_t offset, size_t count)
+{
+	static float floats[INPUTS + 1];
+	static int32_t ints[INPUTS + 1];
+	static int16_t q8[INPUTS + 1];
+	const int16_t *raw = &inputs[offset];
+	int mismatches = 0;
+
+	memset(floats, SENTINEL, sizeof(floats));
+	lsm6dso_convert_accel_mg(raw, floats, count);
+	for (size_t i = 0; i < count; i++) {
+		mismatches += !SameFloat(floats[i], lsm6dso_from_fs4_to_mg(raw[i]));
+	}
+	mismatches += ((uint8_t *)&floats[count])[0] != SENTINEL;
+
+	memset(floats, SENTINEL, sizeof(floats));
+	lsm6dso_convert_gyro_dps(raw, floats, count);
+	for (size_t i = 0; i < count; i++) {
+		mismatches += !SameFloat(floats[i], lsm6dso_from_fs2000_to_mdps(raw[i]) / 1000.0f);
+	}
+	mismatches += ((uint8_t *)&floats[count])[0] != SENTINEL;
+
+	memset(floats, SENTINEL, sizeof(floats));
+	lsm6dso_convert_temperature_degC(raw, floats, count);
+	for (size_t i = 0; i < count; i++) {
+		mismatches += !SameFloat(floats[i], lsm6dso_from_lsb_to_celsius(raw[i]));
+	}
+	mismatches += ((uint8_t *)&floats[count])[0] != SENTINEL;
+
+	memset(ints, SENTINEL, sizeof(ints));
+	lsm6dso_convert_accel_ug(raw, ints, count);
+	for (size_t i = 0; i < count; i++) {
+		mismatches += ints[i] != raw[i] * LSM6DSO_FS4_UG_PER_LSB;
+	}
+	mismatches += ((uint8_t *)&ints[count])[0] != SENTINEL;
+
+	memset(ints, SENTINEL, sizeof(ints));
+	lsm6dso_convert_gyro_mdps(raw, ints, count);
+	for (size_t i = 0; i < count; i++) {
+		mismatches += ints[i] != raw[i] * LSM6DSO_FS2000_MDPS_PER_LSB;
+	}
+	mismatches += ((uint8_t *)&ints[count])[0] != SENTINEL;
+
+	memset(q8, SENTINEL, sizeof(q8));
+	lsm6dso_convert_temperature_q8(raw, q8, count);
+	for (size_t i = 0; i < count; i++) {
+		mismatches += q8[i] != SaturatingAdd16(raw[i], LSM6DSO_TEMPERATURE_OFFSET_Q8);
+	}
+	mismatches += ((uint8_t *)&q8[count])[0] != SENTINEL;
+
+	return mismatches;
+}
+
+static void TestKernels(void)
+{
+	for (int32_t i = 0; i < INPUTS; i++) {
+		inputs[i] = (int16_t)(INT16_MIN + i);
+	}
+	inputs[INPUTS] = INT16_MAX;
+	inputs[INPUTS + 1] = INT16_MIN;
+
+	// whole pairs from an aligned start, an odd count from an unaligned start, and short tails
+	CHECK(CheckKernels(0, INPUTS) == 0);
+	CHECK(CheckKernels(1, INPUTS - 1) == 0);
+	CHECK(CheckKernels(1, INPUTS) == 0);
+	CHECK(CheckKernels(INPUTS - 3, 3) == 0);
+	CHECK(CheckKernels(7, 1) == 0);
+	CHECK(CheckKernels(7, 0) == 0);
+
+	// 127.996 degC is the largest Q8.8 value, readings above it saturate
+	int16_t hot[2] = { INT16_MAX, 103 * 256 - 1 };
+	int16_t q8[2];
+	lsm6dso_convert_temperature_q8(hot, q8, 2);
+	CHECK(q8[0] == INT16_MAX);
+	CHECK(q8[1] == 128 * 256 - 1);
+}
+
+int main(void)
+{
+	TestPackedInstructions();
+	TestKernels();
+
+	return CheckResult("conversion");
+}
@@ -0,0 +1,3 @@
+/* Host stand-in for mt3620.h, the sources under test use nothing from it. */
+
+#pragma once
@@ -0,0 +1,3 @@
+/* Host stand-in for os_hal_uart.h, the sources under test use nothing from it. */
+
+#pragma once
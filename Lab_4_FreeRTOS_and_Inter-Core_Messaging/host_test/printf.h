@@ -0,0 +1,5 @@
+/* Host stand-in for the embedded printf, printf is the C library one. */
+
+#pragma once
+
+#include <stdio.h>
@@ -1,20 +1,29 @@
 #include "i2c.h"
 
-static uint8_t i2c_tx_buf[I2C_MAX_LEN];
-static uint8_t i2c_rx_buf[I2C_MAX_LEN];
-
+/*
+ * The buffers are the calling task's own, the bus manager stages them through its SYSRAM DMA buffers,
+ * so tasks can read and write concurrently.
+ */
 int32_t i2c_write(int* fD, uint8_t reg, uint8_t* buf, uint16_t len) {
+	uint8_t tx_buf[I2C_MAX_LEN];
+
 	if (buf == NULL)
 		return -1;
 
 	if (len > (I2C_MAX_LEN - 1))
 		return -1;
 
-	i2c_tx_buf[0] = reg;
-	if (buf && len)
-		memcpy(&i2c_tx_buf[1], buf, len);
-	mtk_os_hal_i2c_write(i2c_port_num, i2c_lsm6dso_addr, i2c_tx_buf, len + 1);
-	return 0;
+	i2c_transaction_t transaction = {
+		.op = I2C_BUS_WRITE,
+		.addr = i2c_lsm6dso_addr,
+		.wr_buf = tx_buf,
+		.wr_len = len + 1
+	};
+
+	tx_buf[0] = reg;
+	if (len)
+		memcpy(&tx_buf[1], buf, len);
+	return i2c_bus_transfer(i2c_port_num, &transaction, I2C_BUS_PRIORITY_NORMAL);
 }
 
 int32_t i2c_read(int* fD, uint8_t reg, uint8_t* buf, uint16_t len) {
@@ -24,10 +33,16 @@ int32_t i2c_read(int* fD, uint8_t reg, uint8_t* buf, uint16_t len) {
 	if (len > (I2C_MAX_LEN))
 		return -1;
 
-	mtk_os_hal_i2c_write_read(i2c_port_num, i2c_lsm6dso_addr,
-		&reg, i2c_rx_buf, 1, len);
-	memcpy(buf, i2c_rx_buf, len);
-	return 0;
+	i2c_transaction_t transaction = {
+		.op = I2C_BUS_WRITE_READ,
+		.addr = i2c_lsm6dso_addr,
+		.wr_buf = &reg,
+		.wr_len = 1,
+		.rd_buf = buf,
+		.rd_len = len
+	};
+
+	return i2c_bus_transfer(i2c_port_num, &transaction, I2C_BUS_PRIORITY_NORMAL);
 }
 
 void i2c_enum(void) {
@@ -37,24 +52,25 @@ void i2c_enum(void) {
 	printf("[ISU%d] Enumerate I2C Bus, Start\n", i2c_port_num);
 	for (i = 0; i < 0x80; i += 2) {
 		printf("[ISU%d] Address:0x%02X, ", i2c_port_num, i);
-		if (mtk_os_hal_i2c_read(i2c_port_num, i, &data, 1) == 0)
+		i2c_transaction_t transaction = {
+			.op = I2C_BUS_READ,
+			.addr = i,
+			.rd_buf = &data,
+			.rd_len = 1
+		};
+
+		if (i2c_bus_transfer(i2c_port_num, &transaction, I2C_BUS_PRIORITY_NORMAL) == 0)
 			printf("Found 0x%02X\n", i);
 	}
 	printf("[ISU%d] Enumerate I2C Bus, Finish\n\n", i2c_port_num);
 }
 
 int i2c_init(void) {
-	/* Allocate I2C buffer */
-	//i2c_tx_buf = pvPortMalloc(I2C_MAX_LEN);
-	//i2c_rx_buf = pvPortMalloc(I2C_MAX_LEN);
-	if (i2c_tx_buf == NULL || i2c_rx_buf == NULL) {
-		printf("Failed to allocate I2C buffer!\n");
+	/* MT3620 I2C Init, all transfers go through the bus manager task */
+	if (i2c_bus_init(i2c_port_num, i2c_speed, I2C_BUS_TASK_PRIORITY) != 0) {
+		printf("Failed to start the I2C bus manager!\n");
 		return -1;
 	}
 
-	/* MT3620 I2C Init */
-	mtk_os_hal_i2c_ctrl_init(i2c_port_num);
-	mtk_os_hal_i2c_speed_init(i2c_port_num, i2c_speed);
-
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "i2c_bus.h"
+
+#include "queue.h"
+#include "semphr.h"
+
+typedef struct {
+	QueueHandle_t queues[I2C_BUS_PRIORITY_COUNT];
+	SemaphoreHandle_t pending;		// one count per queued transaction, over all priorities
+	TaskHandle_t task;
+
+	// given by the completion callback of the transfer in flight
+	SemaphoreHandle_t transfer_done;
+	volatile int transfer_result;
+} i2c_bus_t;
+
+static i2c_bus_t buses[OS_HAL_I2C_ISU_MAX];
+
+// DMA buffers of each bus, only touched by its manager task
+static uint8_t tx_staging[OS_HAL_I2C_ISU_MAX][I2C_BUS_MAX_LEN] OS_HAL_I2C_DMA_BUFFER;
+static uint8_t rx_staging[OS_HAL_I2C_ISU_MAX][I2C_BUS_MAX_LEN] OS_HAL_I2C_DMA_BUFFER;
+
+/// <summary>
+///     Completion callback of the os_hal asynchronous transfer, in interrupt context
+/// </summary>
+static void transfer_done_from_isr(void* user_data, int result) {
+	i2c_bus_t* bus = user_data;
+	BaseType_t higher_priority_task_woken = pdFALSE;
+
+	bus->transfer_result = result;
+	xSemaphoreGiveFromISR(bus->transfer_done, &higher_priority_task_woken);
+	portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+/// <summary>
+///     Runs one transaction through the SYSRAM buffers of the bus, the read data is copied out on success.
+///     A transfer that does not complete in I2C_BUS_TIMEOUT_MS is aborted, which resets the controller.
+/// </summary>
+static int execute(i2c_num bus_num, i2c_transaction_t* transaction) {
+	i2c_bus_t* bus = &buses[bus_num];
+	uint8_t* tx = tx_staging[bus_num];
+	uint8_t* rx = rx_staging[bus_num];
+	uint16_t wr_len = transaction->op != I2C_BUS_READ ? transaction->wr_len : 0;
+	uint16_t rd_len = transaction->op != I2C_BUS_WRITE ? transaction->rd_len : 0;
+
+	if (wr_len != 0) {
+		memcpy(tx, transaction->wr_buf, wr_len);
+	}
+
+	int result = mtk_os_hal_i2c_write_read_async(bus_num, transaction->addr, tx, rx, wr_len, rd_len, transfer_done_from_isr, bus);
+	if (result != 0) {
+		return result;
+	}
+
+	if (xSemaphoreTake(bus->transfer_done, pdMS_TO_TICKS(I2C_BUS_TIMEOUT_MS)) != pdTRUE) {
+		if (mtk_os_hal_i2c_async_abort(bus_num) == 0) {
+			return -I2C_ETIMEDOUT;
+		}
+		// the callback came between the timeout and the abort
+		xSemaphoreTake(bus->transfer_done, 0);
+	}
+
+	result = bus->transfer_result;
+	if (result == 0 && rd_len != 0) {
+		memcpy(transaction->rd_buf, rx, rd_len);
+	}
+	return result;
+}
+
+/// <summary>
+///     Every transaction of the chain fits the staging buffers and has the buffers its op uses
+/// </summary>
+static bool is_valid_chain(const i2c_transaction_t* transaction) {
+	for (; transaction != NULL; transaction = transaction->next) {
+		bool writes = transaction->op != I2C_BUS_READ;
+		bool reads = transaction->op != I2C_BUS_WRITE;
+
+		if (transaction->op > I2C_BUS_WRITE_READ ||
+			(writes && (transaction->wr_buf == NULL || transaction->wr_len == 0 || transaction->wr_len > I2C_BUS_MAX_LEN)) ||
+			(reads && (transaction->rd_buf == NULL || transaction->rd_len == 0 || transaction->rd_len > I2C_BUS_MAX_LEN))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+///     The next transaction by priority, FIFO within a priority
+/// </summary>
+static i2c_transaction_t* next_transaction(i2c_bus_t* bus) {
+	i2c_transaction_t* transaction = NULL;
+
+	for (int priority = I2C_BUS_PRIORITY_COUNT - 1; priority >= 0; priority--) {
+		if (xQueueReceive(bus->queues[priority], &transaction, 0) == pdTRUE) {
+			break;
+		}
+	}
+	return transaction;
+}
+
+static void bus_task(void* parameters) {
+	i2c_num bus_num = (i2c_num)(uintptr_t)parameters;
+	i2c_bus_t* bus = &buses[bus_num];
+
+	while (1) {
+		xSemaphoreTake(bus->pending, portMAX_DELAY);
+
+		i2c_transaction_t* first = next_transaction(bus);
+		if (first == NULL) {
+			continue;
+		}
+
+		// Each transfer runs from the FIFO or DMA while this task waits for its completion callback,
+		// the chain holds the bus until its last transaction
+		int result = 0;
+		for (i2c_transaction_t* transaction = first; transaction != NULL && result == 0; transaction = transaction->next) {
+			result = execute(bus_num, transaction);
+		}
+		first->result = result;
+
+		if (first->done != NULL) {
+			first->done(first, first->context);
+		}
+		if (first->done_sem != NULL) {
+			xSemaphoreGive(first->done_sem);
+		}
+	}
+}
+
+/// <summary>
+///     Initializes the ISU as I2C master and starts its manager task. The task mostly waits on the
+///     bus, run it above the tasks that submit so the next transaction starts as soon as one ends.
+/// </summary>
+int i2c_bus_init(i2c_num bus_num, enum i2c_speed_kHz speed, UBaseType_t task_priority) {
+	if (bus_num >= OS_HAL_I2C_ISU_MAX) {
+		return -I2C_EINVAL;
+	}
+
+	i2c_bus_t* bus = &buses[bus_num];
+	if (bus->task != NULL) {
+		return 0;
+	}
+
+	int ret = mtk_os_hal_i2c_ctrl_init(bus_num);
+	if (ret == 0) {
+		ret = mtk_os_hal_i2c_speed_init(bus_num, speed);
+	}
+	if (ret != 0) {
+		return ret;
+	}
+
+	for (int priority = 0; priority < I2C_BUS_PRIORITY_COUNT; priority++) {
+		bus->queues[priority] = xQueueCreate(I2C_BUS_QUEUE_LENGTH, sizeof(i2c_transaction_t*));
+	}
+	bus->pending = xSemaphoreCreateCounting(I2C_BUS_QUEUE_LENGTH * I2C_BUS_PRIORITY_COUNT, 0);
+	bus->transfer_done = xSemaphoreCreateBinary();
+
+	if (bus->queues[I2C_BUS_PRIORITY_NORMAL] == NULL || bus->queues[I2C_BUS_PRIORITY_HIGH] == NULL || bus->pending == NULL ||
+		bus->transfer_done == NULL ||
+		xTaskCreate(bus_task, "I2C Bus Task", I2C_BUS_STACK_WORDS, (void*)(uintptr_t)bus_num, task_priority, &bus->task) != pdPASS) {
+		return -I2C_EPTR;
+	}
+
+	return 0;
+}
+
+/// <summary>
+///     Queues a transaction or chain and returns, -I2C_EBUSY if the queue for the priority is full,
+///     -I2C_EINVAL if a transfer is longer than I2C_BUS_MAX_LEN
+/// </summary>
+int i2c_bus_submit(i2c_num bus_num, i2c_transaction_t* transaction, i2c_bus_priority_t priority) {
+	if (bus_num >= OS_HAL_I2C_ISU_MAX || transaction == NULL || priority >= I2C_BUS_PRIORITY_COUNT ||
+		!is_valid_chain(transaction)) {
+		return -I2C_EINVAL;
+	}
+
+	i2c_bus_t* bus = &buses[bus_num];
+	if (bus->task == NULL) {
+		return -I2C_EINVAL;
+	}
+
+	if (xQueueSend(bus->queues[priority], &transaction, 0) != pdTRUE) {
+		return -I2C_EBUSY;
+	}
+	xSemaphoreGive(bus->pending);
+
+	return 0;
+}
+
+/// <summary>
+///     Runs a transaction or chain through the manager and waits for it on a semaphore of its own, done
+///     is left to the caller. The manager bounds every transfer, waiting I2C_BUS_TRANSFER_TIMEOUT_MS
+///     means its task no longer runs.
+/// </summary>
+int i2c_bus_transfer(i2c_num bus_num, i2c_transaction_t* transaction, i2c_bus_priority_t priority) {
+	SemaphoreHandle_t done_sem = xSemaphoreCreateBinary();
+	if (done_sem == NULL) {
+		return -I2C_EPTR;
+	}
+	transaction->done_sem = done_sem;
+
+	int ret = i2c_bus_submit(bus_num, transaction, priority);
+	if (ret == 0) {
+		// the queued transaction points into the caller's stack, it cannot be given up
+		BaseType_t completed = xSemaphoreTake(done_sem, pdMS_TO_TICKS(I2C_BUS_TRANSFER_TIMEOUT_MS));
+		configASSERT(completed == pdTRUE);
+		ret = transaction->result;
+	}
+
+	transaction->done_sem = NULL;
+	vSemaphoreDelete(done_sem);
+	return ret;
+}
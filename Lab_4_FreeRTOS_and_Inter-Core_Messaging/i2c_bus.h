@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "os_hal_i2c.h"
+
+/*
+I2C bus manager, one FreeRTOS task per ISU bus that owns the bus and runs queued transactions.
+
+Any task submits transaction descriptors. The manager takes high priority transactions before
+normal ones and runs a chain of linked transactions back to back, so a register write and the read
+that depends on it are not interleaved with another device. The submitter is told about completion
+by a callback in the manager task, a semaphore, or both. i2c_bus_transfer is the blocking form for
+drivers that expect a synchronous read_reg/write_reg.
+
+The manager starts each transfer asynchronously and waits for its completion callback. A transfer that
+does not complete in I2C_BUS_TIMEOUT_MS is aborted and the controller reset, so a lost interrupt fails
+the chain with -I2C_ETIMEDOUT instead of holding the bus.
+
+Descriptors and buffers belong to the submitter and must stay valid until completion. Transfers longer
+than the 8 byte I2C FIFO are done by DMA from SYSRAM, the manager task stages every transfer through SYSRAM
+buffers of its bus, so the submitter's buffers can be anywhere, e.g. on its stack.
+*/
+
+#define I2C_BUS_QUEUE_LENGTH		8		// per priority
+#define I2C_BUS_STACK_WORDS			256
+#define I2C_BUS_MAX_LEN				64		// bytes per write or read, the size of the staging buffers
+#define I2C_BUS_TIMEOUT_MS			100		// per transfer, 64 bytes take 6 ms at 100 kHz
+#define I2C_BUS_TRANSFER_TIMEOUT_MS	5000	// i2c_bus_transfer, well above a full queue of timed out transfers
+
+typedef enum {
+	I2C_BUS_WRITE,
+	I2C_BUS_READ,
+	I2C_BUS_WRITE_READ
+} i2c_bus_op_t;
+
+typedef enum {
+	I2C_BUS_PRIORITY_NORMAL,
+	I2C_BUS_PRIORITY_HIGH,
+	I2C_BUS_PRIORITY_COUNT
+} i2c_bus_priority_t;
+
+typedef struct i2c_transaction {
+	i2c_bus_op_t op;
+	uint8_t addr;					// 7 bit device address
+	uint8_t* wr_buf;
+	uint16_t wr_len;
+	uint8_t* rd_buf;
+	uint16_t rd_len;
+	struct i2c_transaction* next;	// runs right after this one, a failure skips the rest of the chain
+
+	// completion, set on the first transaction of a chain
+	void (*done)(struct i2c_transaction* transaction, void* context);
+	void* context;
+	SemaphoreHandle_t done_sem;		// given when not NULL
+
+	int result;						// 0 or the negative os_hal_i2c error of the chain
+} i2c_transaction_t;
+
+int i2c_bus_init(i2c_num bus, enum i2c_speed_kHz speed, UBaseType_t task_priority);
+int i2c_bus_submit(i2c_num bus, i2c_transaction_t* transaction, i2c_bus_priority_t priority);
+int i2c_bus_transfer(i2c_num bus, i2c_transaction_t* transaction, i2c_bus_priority_t priority);
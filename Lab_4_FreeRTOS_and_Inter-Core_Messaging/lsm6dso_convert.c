@@ -0,0 +1,161 @@
+#include <string.h>
+
+#include "lsm6dso_convert.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "mt3620.h"
+
+/* Signed 16 x 16 multiplies of the bottom or top half of op1 by the bottom half of op2, not in CMSIS */
+static inline uint32_t __SMULBB(uint32_t op1, uint32_t op2)
+{
+	uint32_t result;
+
+	__ASM ("smulbb %0, %1, %2" : "=r" (result) : "r" (op1), "r" (op2));
+	return result;
+}
+
+static inline uint32_t __SMULTB(uint32_t op1, uint32_t op2)
+{
+	uint32_t result;
+
+	__ASM ("smultb %0, %1, %2" : "=r" (result) : "r" (op1), "r" (op2));
+	return result;
+}
+#else
+/*
+ * Portable versions of the Cortex-M4 DSP instructions used below, for cores without the DSP
+ * extension and for testing the kernels on a host.
+ */
+static inline int32_t lane_lo(uint32_t x) { return (int16_t)(x & 0xFFFF); }
+static inline int32_t lane_hi(uint32_t x) { return (int16_t)(x >> 16); }
+
+static inline int32_t ssat(int32_t value, uint32_t bits)
+{
+	const int32_t max = (int32_t)((1UL << (bits - 1)) - 1);
+
+	return value > max ? max : value < -max - 1 ? -max - 1 : value;
+}
+
+/* Signed 16 x 16 multiply, bottom half by bottom half */
+static inline uint32_t __SMULBB(uint32_t op1, uint32_t op2)
+{
+	return (uint32_t)(lane_lo(op1) * lane_lo(op2));
+}
+
+/* Signed 16 x 16 multiply, top half by bottom half */
+static inline uint32_t __SMULTB(uint32_t op1, uint32_t op2)
+{
+	return (uint32_t)(lane_hi(op1) * lane_lo(op2));
+}
+
+/* Dual 16 bit saturating add */
+static inline uint32_t __QADD16(uint32_t op1, uint32_t op2)
+{
+	return ((uint32_t)(uint16_t)ssat(lane_hi(op1) + lane_hi(op2), 16) << 16) |
+		(uint16_t)ssat(lane_lo(op1) + lane_lo(op2), 16);
+}
+
+#define __SSAT(ARG1, ARG2) ssat((ARG1), (ARG2))
+#endif
+
+/*
+ * Two adjacent raw values in one register, raw[0] in the bottom half. memcpy compiles to a single
+ * load, the M4 allows unaligned word loads.
+ */
+static inline uint32_t load_pair(const int16_t *raw)
+{
+	uint32_t pair;
+
+	memcpy(&pair, raw, sizeof(pair));
+	return pair;
+}
+
+static inline void store_pair(int16_t *out, uint32_t pair)
+{
+	memcpy(out, &pair, sizeof(pair));
+}
+
+/*
+ * out[i] = raw[i] * scale. SMULBB and SMULTB multiply the bottom and the top half of the loaded pair,
+ * one word load and no sign extension per two values. Each is still one product: the M4 has no dual
+ * 16 x 16 multiply with two 32 bit results, QADD16 below is the only two lane instruction here.
+ */
+static void scale_pairs(const int16_t *raw, int32_t *out, size_t count, int16_t scale)
+{
+	const uint32_t scale_lo = (uint16_t)scale;
+	size_t i = 0;
+
+	for (; i + 1 < count; i += 2) {
+		uint32_t pair = load_pair(&raw[i]);
+
+		out[i] = (int32_t)__SMULBB(pair, scale_lo);
+		out[i + 1] = (int32_t)__SMULTB(pair, scale_lo);
+	}
+	if (i < count) {
+		out[i] = (int32_t)raw[i] * scale;
+	}
+}
+
+/* Scalar, the float multiply has no packed form on the M4 */
+void lsm6dso_convert_accel_mg(const int16_t *raw, float *mg, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		mg[i] = (float)raw[i] * 0.122f;
+	}
+}
+
+/*
+ * raw * 70 is exact as an integer and as a float, so converting the integer product and dividing
+ * gives the bits of lsm6dso_from_fs2000_to_mdps(raw) / 1000.0f. The products are formed as in
+ * scale_pairs, the conversion and the division stay one value at a time.
+ */
+void lsm6dso_convert_gyro_dps(const int16_t *raw, float *dps, size_t count)
+{
+	const uint32_t scale_lo = LSM6DSO_FS2000_MDPS_PER_LSB;
+	size_t i = 0;
+
+	for (; i + 1 < count; i += 2) {
+		uint32_t pair = load_pair(&raw[i]);
+
+		dps[i] = (float)(int32_t)__SMULBB(pair, scale_lo) / 1000.0f;
+		dps[i + 1] = (float)(int32_t)__SMULTB(pair, scale_lo) / 1000.0f;
+	}
+	if (i < count) {
+		dps[i] = (float)((int32_t)raw[i] * LSM6DSO_FS2000_MDPS_PER_LSB) / 1000.0f;
+	}
+}
+
+/* Dividing by 256 and adding 25 are both exact in single precision */
+void lsm6dso_convert_temperature_degC(const int16_t *raw, float *degC, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		degC[i] = (float)raw[i] * (1.0f / 256.0f) + 25.0f;
+	}
+}
+
+void lsm6dso_convert_accel_ug(const int16_t *raw, int32_t *ug, size_t count)
+{
+	scale_pairs(raw, ug, count, LSM6DSO_FS4_UG_PER_LSB);
+}
+
+void lsm6dso_convert_gyro_mdps(const int16_t *raw, int32_t *mdps, size_t count)
+{
+	scale_pairs(raw, mdps, count, LSM6DSO_FS2000_MDPS_PER_LSB);
+}
+
+/*
+ * degC in Q8.8, two samples per saturating add. Readings above 128 degC, outside the sensor
+ * range, saturate at 127.996 degC.
+ */
+void lsm6dso_convert_temperature_q8(const int16_t *raw, int16_t *degC_q8, size_t count)
+{
+	const uint32_t offset_pair = ((uint32_t)LSM6DSO_TEMPERATURE_OFFSET_Q8 << 16) | LSM6DSO_TEMPERATURE_OFFSET_Q8;
+	size_t i = 0;
+
+	for (; i + 1 < count; i += 2) {
+		store_pair(&degC_q8[i], __QADD16(load_pair(&raw[i]), offset_pair));
+	}
+	if (i < count) {
+		degC_q8[i] = (int16_t)__SSAT((int32_t)raw[i] + LSM6DSO_TEMPERATURE_OFFSET_Q8, 16);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef __LSM6DSO_CONVERT_H__
+#define __LSM6DSO_CONVERT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Batch conversion of LSM6DSO raw samples, e.g. interleaved x, y, z axes or a block of FIFO words.
+ * count is the number of raw values.
+ *
+ * The float kernels return the same bits as the single precision reference formulas of lsm6dso_reg.c,
+ * lsm6dso_from_fs4_to_mg, lsm6dso_from_fs2000_to_mdps / 1000.0f and lsm6dso_from_lsb_to_celsius.
+ * The fixed point kernels return the exact value in integer units and do not touch the FPU.
+ */
+
+#define LSM6DSO_FS4_UG_PER_LSB			122		/* 0.122 mg */
+#define LSM6DSO_FS2000_MDPS_PER_LSB		70
+#define LSM6DSO_TEMPERATURE_OFFSET_Q8	(25 * 256)	/* 0 LSB is 25 degC, 256 LSB per degC */
+
+void lsm6dso_convert_accel_mg(const int16_t *raw, float *mg, size_t count);
+void lsm6dso_convert_gyro_dps(const int16_t *raw, float *dps, size_t count);
+void lsm6dso_convert_temperature_degC(const int16_t *raw, float *degC, size_t count);
+
+void lsm6dso_convert_accel_ug(const int16_t *raw, int32_t *ug, size_t count);
+void lsm6dso_convert_gyro_mdps(const int16_t *raw, int32_t *mdps, size_t count);
+void lsm6dso_convert_temperature_q8(const int16_t *raw, int16_t *degC_q8, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LSM6DSO_CONVERT_H__ */
@@ -41,93 +41,89 @@
 
 #include "lsm6dso_driver.h"
 #include "lsm6dso_reg.h"
+#include "lsm6dso_convert.h"
+#include "gyro_bias.h"
 
 static int lsm6dso_handle;
 static lsm6dso_ctx_t dev_ctx;
 static axis3bit16_t data_raw_acceleration;
 static axis3bit16_t data_raw_angular_rate;
-static axis3bit16_t raw_angular_rate_calibration;
 static axis1bit16_t data_raw_temperature;
 static float acceleration_mg[3];
 static float angular_rate_dps[3];
 static float lsm6dsoTemperature_degC;
+static gyro_bias_t gyro_bias;
+
+/* Feeds every 8th gyro sample, 13 Hz at 104 Hz ODR, to the bias estimator */
+#define GYRO_BIAS_DECIMATION	8
+
+/*
+ * STATUS_REG to OUTZ_H_A in one burst: status, reserved, temperature, gyro, accel. Longer than the
+ * 8 byte I2C FIFO, so the transfer is done by DMA while the IMU task blocks.
+ */
+#define IMU_BLOCK_LEN			(LSM6DSO_OUTX_L_A + 6 - LSM6DSO_STATUS_REG)
+#define IMU_BLOCK_TEMP			(LSM6DSO_OUT_TEMP_L - LSM6DSO_STATUS_REG)
+#define IMU_BLOCK_GYRO			(LSM6DSO_OUTX_L_G - LSM6DSO_STATUS_REG)
+#define IMU_BLOCK_ACCEL			(LSM6DSO_OUTX_L_A - LSM6DSO_STATUS_REG)
 
 
 /******************************************************************************/
 /* Functions */
 /******************************************************************************/
-void lsm6dso_show_result(void)
+/*
+ * Reads the samples that are ready and returns true with the latest acceleration and bias corrected
+ * angular rate when a new gyro sample was read. Polled by the IMU task faster than the ODR.
+ */
+bool lsm6dso_read_imu(float accel_mg[3], float gyro_dps[3])
 {
-	uint8_t reg;
-
-	/* Read output only if new xl value is available */
-	lsm6dso_xl_flag_data_ready_get(&dev_ctx, &reg);
-	if (reg) {
-		/* Read acceleration field data */
-		memset(data_raw_acceleration.u8bit, 0x00, 3 * sizeof(int16_t));
-		lsm6dso_acceleration_raw_get(&dev_ctx, data_raw_acceleration.u8bit);
-
-		acceleration_mg[0] = lsm6dso_from_fs4_to_mg(data_raw_acceleration.i16bit[0]);
-		acceleration_mg[1] = lsm6dso_from_fs4_to_mg(data_raw_acceleration.i16bit[1]);
-		acceleration_mg[2] = lsm6dso_from_fs4_to_mg(data_raw_acceleration.i16bit[2]);
+	static uint32_t gyro_samples;
+	uint8_t block[IMU_BLOCK_LEN];
+	lsm6dso_status_reg_t status;
 
-		//printf("\n[LSM6DSO] Acceleration [mg]  : %.4lf, %.4lf, %.4lf\n",
-		//	acceleration_mg[0], acceleration_mg[1], acceleration_mg[2]);
+	/* The status flags and all outputs in one transaction, the flags say which outputs are new */
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_STATUS_REG, block, IMU_BLOCK_LEN) != 0) {
+		return false;
 	}
+	memcpy(&status, &block[0], sizeof(status));
 
-	lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-	if (reg) {
-		/* Read angular rate field data */
-		memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-		lsm6dso_angular_rate_raw_get(&dev_ctx, data_raw_angular_rate.u8bit);
-
-		/* Before we store the mdps values subtract the calibration data we captured at startup. */
-		angular_rate_dps[0] = (lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[0] -
-					raw_angular_rate_calibration.i16bit[0])) / 1000.0;
-		angular_rate_dps[1] = (lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[1] -
-					raw_angular_rate_calibration.i16bit[1])) / 1000.0;
-		angular_rate_dps[2] = (lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[2] -
-					raw_angular_rate_calibration.i16bit[2])) / 1000.0;
-
-		//printf("[LSM6DSO] Angular rate [dps] : %4.2f, %4.2f, %4.2f\n",
-		//	angular_rate_dps[0], angular_rate_dps[1], angular_rate_dps[2]);
+	if (status.tda) {
+		memcpy(data_raw_temperature.u8bit, &block[IMU_BLOCK_TEMP], sizeof(int16_t));
+		lsm6dso_convert_temperature_degC(&data_raw_temperature.i16bit, &lsm6dsoTemperature_degC, 1);
 	}
 
-	lsm6dso_temp_flag_data_ready_get(&dev_ctx, &reg);
-	if (reg) {
-		/* Read temperature data */
-		memset(data_raw_temperature.u8bit, 0x00, sizeof(int16_t));
-		lsm6dso_temperature_raw_get(&dev_ctx, data_raw_temperature.u8bit);
-		lsm6dsoTemperature_degC = lsm6dso_from_lsb_to_celsius(data_raw_temperature.i16bit);
-
-		//memset(data_raw_pressure.u8bit, 0x00, sizeof(int32_t));
-		//pressure_hPa = lps22hh_from_lsb_to_hpa(data_raw_pressure.i32bit);
+	if (status.xlda) {
+		memcpy(data_raw_acceleration.u8bit, &block[IMU_BLOCK_ACCEL], 3 * sizeof(int16_t));
+		lsm6dso_convert_accel_mg(data_raw_acceleration.i16bit, acceleration_mg, 3);
+	}
 
-		//printf("[LSM6DSO] Temperature  [degC]: %.2f\n", lsm6dsoTemperature_degC);
+	if (!status.gda) {
+		return false;
 	}
-}
 
-void update_temperature(void)
-{
-	uint8_t reg;
+	memcpy(data_raw_angular_rate.u8bit, &block[IMU_BLOCK_GYRO], 3 * sizeof(int16_t));
+	lsm6dso_convert_gyro_dps(data_raw_angular_rate.i16bit, angular_rate_dps, 3);
 
-	lsm6dso_temp_flag_data_ready_get(&dev_ctx, &reg);
-	if (reg)
-	{
-		/* Read temperature data */
-		memset(data_raw_temperature.u8bit, 0x00, sizeof(int16_t));
-		lsm6dso_temperature_raw_get(&dev_ctx, data_raw_temperature.u8bit);
-		lsm6dsoTemperature_degC = lsm6dso_from_lsb_to_celsius(data_raw_temperature.i16bit);
+	/* The estimator learns the bias while the device is at rest, its window is sized for 12.5 Hz. */
+	if (gyro_samples++ % GYRO_BIAS_DECIMATION == 0) {
+		gyro_bias_update(&gyro_bias, angular_rate_dps, acceleration_mg, lsm6dsoTemperature_degC);
+	}
 
-		//memset(data_raw_pressure.u8bit, 0x00, sizeof(int32_t));
-		//pressure_hPa = lps22hh_from_lsb_to_hpa(data_raw_pressure.i32bit);
+	/* Subtract the bias for the current temperature */
+	float bias_dps[3];
+	gyro_bias_get(&gyro_bias, lsm6dsoTemperature_degC, bias_dps);
 
-		//printf("[LSM6DSO] Temperature  [degC]: %.2f\n", lsm6dsoTemperature_degC);
+	for (int axis = 0; axis < 3; axis++) {
+		accel_mg[axis] = acceleration_mg[axis];
+		gyro_dps[axis] = angular_rate_dps[axis] - bias_dps[axis];
 	}
+
+	return true;
 }
 
+/*
+ * Temperature of the last lsm6dso_read_imu call, the sensor is only accessed from the IMU task.
+ */
 float get_temperature(void) {
-	update_temperature();
 	return lsm6dsoTemperature_degC;
 }
 
@@ -167,8 +163,8 @@ int lsm6dso_init(void *i2c_write, void *i2c_read)
 	lsm6dso_block_data_update_set(&dev_ctx, PROPERTY_ENABLE);
 
 	/* Set Output Data Rate */
-	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_12Hz5);
-	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_12Hz5);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_104Hz);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_104Hz);
 
 	/* Set full scale */
 	lsm6dso_xl_full_scale_set(&dev_ctx, LSM6DSO_4g);
@@ -179,54 +175,16 @@ int lsm6dso_init(void *i2c_write, void *i2c_read)
 	lsm6dso_xl_hp_path_on_out_set(&dev_ctx, LSM6DSO_LP_ODR_DIV_100);
 	lsm6dso_xl_filter_lp2_set(&dev_ctx, PROPERTY_ENABLE);
 
+	calibrate_lsm6dso();
+
 	return 0;
 }
 
-void calibrate_lsm6dso(void) {
-	//printf("LSM6DSO: Calibrating angular rate...\n");
-	//printf("LSM6DSO: Please make sure the device is stationary.\n");
-	//do {
-	//	/* Delay and read the device until we have data! */
-	//	do {
-	//		/* Read the calibration values */
-	//		tx_thread_sleep(500);
-	//		//vTaskDelay(pdMS_TO_TICKS(5000));
-	//		lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-	//	} while (!reg);
-
-	//	printf("LSM6DSO: calibration on-going...\n");
-	//	if (reg) {
-	//		/* Read angular rate field data to use for calibration offsets */
-	//		memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-	//		lsm6dso_angular_rate_raw_get(&dev_ctx, raw_angular_rate_calibration.u8bit);
-	//	}
-
-	//	/* Delay and read the device until we have data! */
-	//	do {
-	//		/* Read the calibration values */
-	//		tx_thread_sleep(500);
-	//		//vTaskDelay(pdMS_TO_TICKS(5000));
-	//		lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-	//	} while (!reg);
-
-	//	/* Read the angular data rate again and verify that after applying the calibration,
-	//	 * we have 0 angular rate in all directions
-	//	*/
-	//	if (reg) {
-	//		/* Read angular rate field data */
-	//		memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-	//		lsm6dso_angular_rate_raw_get(&dev_ctx, data_raw_angular_rate.u8bit);
-
-	//		/* Before we store the mdps values subtract the calibration data we captured at startup. */
-	//		angular_rate_dps[0] = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[0] -
-	//					raw_angular_rate_calibration.i16bit[0]);
-	//		angular_rate_dps[1] = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[1] -
-	//					raw_angular_rate_calibration.i16bit[1]);
-	//		angular_rate_dps[2] = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[2] -
-	//					raw_angular_rate_calibration.i16bit[2]);
-	//	}
-	//	/* If the angular values after applying the offset are not all 0.0s, then do it again! */
-	//} while ((angular_rate_dps[0] != 0.0) || (angular_rate_dps[1] != 0.0) || (angular_rate_dps[2] != 0.0));
-	//printf("LSM6DSO: Calibrating angular rate complete!\n");
+/*
+ * The gyro bias is estimated online by gyro_bias_update from stationary windows, this
+ * drops the learned bias table and starts over.
+ */
+void calibrate_lsm6dso(void)
+{
+	gyro_bias_init(&gyro_bias);
 }
-
@@ -36,12 +36,17 @@
 #ifndef __LSM6DSO_DRIVER_H__
 #define __LSM6DSO_DRIVER_H__
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void lsm6dso_show_result(void);
+#define LSM6DSO_ODR_HZ	104.0f	/* accelerometer and gyroscope output data rate */
+
+bool lsm6dso_read_imu(float accel_mg[3], float gyro_dps[3]);
 int lsm6dso_init(void *i2c_write, void *i2c_read);
+void calibrate_lsm6dso(void);
 float get_temperature(void);
 
 
@@ -57,11 +57,14 @@
 
 #include "semphr.h"
 
+#include "binary_log.h"
+
 
 #ifdef OEM_AVNET
 #include "lsm6dso_driver.h"
 #include "lsm6dso_reg.h"
 #include "i2c.h"
+#include "ahrs.h"
 #endif // OEM_AVNET
 
 
@@ -79,7 +82,8 @@ enum LP_INTER_CORE_CMD
 	LP_IC_TEMPERATURE_PRESSURE_HUMIDITY,
 	LP_IC_EVENT_BUTTON_A,
 	LP_IC_EVENT_BUTTON_B,
-	LP_IC_SET_DESIRED_TEMPERATURE
+	LP_IC_SET_DESIRED_TEMPERATURE,
+	LP_IC_ORIENTATION
 };
 
 typedef struct LP_INTER_CORE_BLOCK
@@ -88,6 +92,10 @@ typedef struct LP_INTER_CORE_BLOCK
 	float	temperature;
 	float	pressure;
 	float	humidity;
+	float	quaternion[4];	// LP_IC_ORIENTATION: w, x, y, z
+	float	roll;			// degrees
+	float	pitch;
+	float	yaw;
 
 } LP_INTER_CORE_BLOCK;
 
@@ -107,7 +115,9 @@ static SemaphoreHandle_t LEDSemphr;
 #include "mt3620-intercore.h" // Support for inter Core Communications
 static const size_t payloadStart = 20;
 static uint8_t buf[256];
+static uint8_t tx_buf[256];
 static uint32_t dataSize;
+static SemaphoreHandle_t ICSendMutex;
 static BufferHeader* outbound, * inbound;
 static uint32_t sharedBufSize = 0;
 
@@ -228,14 +238,15 @@ void free(void* ptr)
 	}
 }
 
-void send_inter_core_msg(void)
+// The button, message and IMU tasks all send, the header of tx_buf addresses the high-level app
+void send_inter_core_msg(const LP_INTER_CORE_BLOCK* block)
 {
 	if (HLAppReady)
 	{
-		memcpy((void*)&buf[payloadStart], (void*)&ic_control_block, sizeof(ic_control_block));
-		dataSize = payloadStart + sizeof(ic_control_block);
-
-		EnqueueData(inbound, outbound, sharedBufSize, buf, dataSize);
+		xSemaphoreTake(ICSendMutex, portMAX_DELAY);
+		memcpy((void*)&tx_buf[payloadStart], (const void*)block, sizeof(*block));
+		EnqueueData(inbound, outbound, sharedBufSize, tx_buf, payloadStart + sizeof(*block));
+		xSemaphoreGive(ICSendMutex);
 	}
 }
 
@@ -253,8 +264,7 @@ static void ButtonTask(void* pParameters)
 		{
 			blinkIntervalIndex = (blinkIntervalIndex + 1) % numBlinkIntervals;
 
-			ic_control_block.cmd = LP_IC_EVENT_BUTTON_A;
-			send_inter_core_msg();
+			send_inter_core_msg(&(LP_INTER_CORE_BLOCK){ .cmd = LP_IC_EVENT_BUTTON_A });
 		}
 		oldStateButtonA = value;
 
@@ -262,8 +272,7 @@ static void ButtonTask(void* pParameters)
 		gpio_input(BUTTON_B, &value);
 		if ((value != oldStateButtonB) && (value == OS_HAL_GPIO_DATA_LOW))
 		{
-			ic_control_block.cmd = LP_IC_EVENT_BUTTON_B;
-			send_inter_core_msg();
+			send_inter_core_msg(&(LP_INTER_CORE_BLOCK){ .cmd = LP_IC_EVENT_BUTTON_B });
 		}
 		oldStateButtonB = value;
 
@@ -326,16 +335,72 @@ void SetTemperatureStatus(int temperature)
 	}
 }
 
-static void RTCoreMsgTask(void* pParameters)
+#ifdef LP_LOG_BINARY
+static void LogFlushTask(void* pParameters)
 {
-	int rand_number;
+	while (1)
+	{
+		binary_log_flush();
+		vTaskDelay(pdMS_TO_TICKS(1000));
+	}
+}
+#endif // LP_LOG_BINARY
 
 #ifdef OEM_AVNET
-	mtk_os_hal_i2c_ctrl_init(i2c_port_num);		// Initialize MT3620 I2C bus
+// Orientation is sent to the high-level app at 4 Hz
+#define ORIENTATION_DECIMATION 26
+
+static void send_orientation(const ahrs_t* ahrs)
+{
+	LP_INTER_CORE_BLOCK block = { .cmd = LP_IC_ORIENTATION };
+
+	memcpy(block.quaternion, ahrs->q, sizeof(block.quaternion));
+	ahrs_get_euler_deg(ahrs, &block.roll, &block.pitch, &block.yaw);
+	send_inter_core_msg(&block);
+}
+
+// Reads the IMU through the I2C bus manager, fuses every IMU sample into the orientation at the sensor ODR
+static void ImuTask(void* pParameters)
+{
+	static ahrs_t ahrs;
+	float accel_mg[3];
+	float gyro_dps[3];
+	uint32_t samples = 0;
+
+	if (i2c_init() != 0)						// Initialize MT3620 I2C bus and its manager task
+	{
+		vTaskDelete(NULL);
+	}
 	i2c_enum();									// Enumerate I2C Bus
-	i2c_init();
-	lsm6dso_init(i2c_write, i2c_read);
-#endif // OEM_AVNET	
+	if (lsm6dso_init(i2c_write, i2c_read) != 0)
+	{
+		vTaskDelete(NULL);
+	}
+
+	ahrs_init(&ahrs, LSM6DSO_ODR_HZ, AHRS_DEFAULT_BETA);
+
+	TickType_t last_wake = xTaskGetTickCount();
+	while (1)
+	{
+		// Polled at over twice the ODR, the data ready flags hand out every sample once
+		if (lsm6dso_read_imu(accel_mg, gyro_dps))
+		{
+			ahrs_update_imu(&ahrs, gyro_dps, accel_mg);
+
+			if (++samples % ORIENTATION_DECIMATION == 0)
+			{
+				send_orientation(&ahrs);
+			}
+		}
+
+		vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(4));
+	}
+}
+#endif // OEM_AVNET
+
+static void RTCoreMsgTask(void* pParameters)
+{
+	int rand_number;
 
 	srand((unsigned int)time(NULL)); // seed the random number generator for fake telemetry
 
@@ -346,9 +411,13 @@ static void RTCoreMsgTask(void* pParameters)
 		
 		if (r == 0 && dataSize > payloadStart)
 		{
+			xSemaphoreTake(ICSendMutex, portMAX_DELAY);
+			memcpy(tx_buf, buf, payloadStart);
+			xSemaphoreGive(ICSendMutex);
 			HLAppReady = true;
 
 			memcpy((void*)&ic_control_block, (void*)&buf[payloadStart], sizeof(ic_control_block));
+			LP_LOG("[RTCore] Inter-core message cmd %d\n", ic_control_block.cmd);
 
 			switch (ic_control_block.cmd)
 			{
@@ -362,7 +431,7 @@ static void RTCoreMsgTask(void* pParameters)
 
 #ifdef OEM_AVNET
 
-				ic_control_block.cmd = LP_IC_TEMPERATURE_HUMIDITY;
+				ic_control_block.cmd = LP_IC_TEMPERATURE_PRESSURE_HUMIDITY;
 				ic_control_block.temperature = get_temperature();
 				ic_control_block.pressure = 1020.0;
 
@@ -381,7 +450,7 @@ static void RTCoreMsgTask(void* pParameters)
 
 #endif // OEM_SEEED_STUDIO
 
-				send_inter_core_msg();
+				send_inter_core_msg(&ic_control_block);
 
 				last_temperature = round(ic_control_block.temperature);
 				SetTemperatureStatus(last_temperature);
@@ -417,11 +486,18 @@ _Noreturn void RTCoreMain(void)
 	}
 
 	LEDSemphr = xSemaphoreCreateBinary();
+	ICSendMutex = xSemaphoreCreateMutex();
 
 	xTaskCreate(SetLedBlinkRateTask, "Periodic Task", APP_STACK_SIZE_BYTES, NULL, 6, NULL);
 	xTaskCreate(LedTask, "LED Task", APP_STACK_SIZE_BYTES, NULL, 5, NULL);
 	xTaskCreate(ButtonTask, "GPIO Task", APP_STACK_SIZE_BYTES, NULL, 4, NULL);
 	xTaskCreate(RTCoreMsgTask, "RTCore Msg Task", APP_STACK_SIZE_BYTES, NULL, 2, NULL);
+#ifdef OEM_AVNET
+	xTaskCreate(ImuTask, "IMU Task", APP_STACK_SIZE_BYTES, NULL, 3, NULL);
+#endif // OEM_AVNET
+#ifdef LP_LOG_BINARY
+	xTaskCreate(LogFlushTask, "Log Flush Task", APP_STACK_SIZE_BYTES, NULL, 1, NULL);
+#endif // LP_LOG_BINARY
 	vTaskStartScheduler();
 
 	for (;;)
@@ -0,0 +1,186 @@
+#include "gyro_bias.h"
+
+static int temperature_bin(float temperature_degC) {
+	int bin = (int)floorf((temperature_degC - GYRO_BIAS_BIN_MIN_DEGC) / GYRO_BIAS_BIN_WIDTH_DEGC);
+
+	if (bin < 0) {
+		return 0;
+	}
+	if (bin >= GYRO_BIAS_TEMPERATURE_BINS) {
+		return GYRO_BIAS_TEMPERATURE_BINS - 1;
+	}
+	return bin;
+}
+
+static float bin_center_degC(int bin) {
+	return GYRO_BIAS_BIN_MIN_DEGC + ((float)bin + 0.5f) * GYRO_BIAS_BIN_WIDTH_DEGC;
+}
+
+static void restart_window(gyro_bias_t* estimator) {
+	estimator->count = 0;
+	estimator->temperature_sum_degC = 0.0f;
+	memset(estimator->mean_dps, 0, sizeof(estimator->mean_dps));
+	memset(estimator->m2, 0, sizeof(estimator->m2));
+}
+
+/// <summary>
+///     True if the accelerometer reads a steady 1 g
+/// </summary>
+static bool is_stationary(gyro_bias_t* estimator, const float accel_mg[3]) {
+	float magnitude = sqrtf(accel_mg[0] * accel_mg[0] + accel_mg[1] * accel_mg[1] + accel_mg[2] * accel_mg[2]);
+	bool stationary = fabsf(magnitude - 1000.0f) <= GYRO_BIAS_MAX_ACCEL_DEVIATION_MG;
+
+	if (estimator->has_last_accel) {
+		for (int axis = 0; axis < 3; axis++) {
+			if (fabsf(accel_mg[axis] - estimator->last_accel_mg[axis]) > GYRO_BIAS_MAX_ACCEL_STEP_MG) {
+				stationary = false;
+			}
+		}
+	}
+
+	memcpy(estimator->last_accel_mg, accel_mg, sizeof(estimator->last_accel_mg));
+	estimator->has_last_accel = true;
+
+	return stationary;
+}
+
+/// <summary>
+///     Blends the completed window into its temperature bin
+/// </summary>
+static void commit_window(gyro_bias_t* estimator) {
+	gyro_bias_bin_t* bin = &estimator->bins[temperature_bin(estimator->temperature_sum_degC / (float)estimator->count)];
+	float weight = (float)bin->weight;
+
+	for (int axis = 0; axis < 3; axis++) {
+		bin->bias_dps[axis] = (bin->bias_dps[axis] * weight + estimator->mean_dps[axis]) / (weight + 1.0f);
+	}
+	if (bin->weight < GYRO_BIAS_MAX_BIN_WEIGHT) {
+		bin->weight++;
+	}
+}
+
+void gyro_bias_init(gyro_bias_t* estimator) {
+	memset(estimator, 0, sizeof(*estimator));
+}
+
+/// <summary>
+///     Restores a previously saved bin table, the restored table counts as saved
+/// </summary>
+void gyro_bias_restore(gyro_bias_t* estimator, const gyro_bias_bin_t bins[GYRO_BIAS_TEMPERATURE_BINS]) {
+	gyro_bias_init(estimator);
+	memcpy(estimator->bins, bins, sizeof(estimator->bins));
+
+	for (int i = 0; i < GYRO_BIAS_TEMPERATURE_BINS; i++) {
+		if (estimator->bins[i].weight > GYRO_BIAS_MAX_BIN_WEIGHT) {
+			estimator->bins[i].weight = GYRO_BIAS_MAX_BIN_WEIGHT;
+		}
+	}
+	gyro_bias_mark_saved(estimator);
+}
+
+/// <summary>
+///     Adds a sample. Returns true when a stationary window completed and updated a bin.
+/// </summary>
+bool gyro_bias_update(gyro_bias_t* estimator, const float gyro_dps[3], const float accel_mg[3], float temperature_degC) {
+	if (!is_stationary(estimator, accel_mg)) {
+		restart_window(estimator);
+		return false;
+	}
+
+	// Welford running mean and sum of squared differences
+	estimator->count++;
+	estimator->temperature_sum_degC += temperature_degC;
+	for (int axis = 0; axis < 3; axis++) {
+		float delta = gyro_dps[axis] - estimator->mean_dps[axis];
+		estimator->mean_dps[axis] += delta / (float)estimator->count;
+		estimator->m2[axis] += delta * (gyro_dps[axis] - estimator->mean_dps[axis]);
+	}
+
+	if (estimator->count < GYRO_BIAS_WINDOW_SAMPLES) {
+		return false;
+	}
+
+	bool quiet = true;
+	for (int axis = 0; axis < 3; axis++) {
+		if (estimator->m2[axis] / (float)estimator->count > GYRO_BIAS_MAX_STDDEV_DPS * GYRO_BIAS_MAX_STDDEV_DPS) {
+			quiet = false;
+		}
+	}
+
+	if (quiet) {
+		commit_window(estimator);
+	}
+	restart_window(estimator);
+
+	return quiet;
+}
+
+/// <summary>
+///     Bias at a temperature, interpolated between the nearest calibrated bins. Returns false and a zero
+///     bias if no bin is calibrated.
+/// </summary>
+bool gyro_bias_get(const gyro_bias_t* estimator, float temperature_degC, float bias_dps[3]) {
+	int below = -1;
+	int above = -1;
+
+	for (int i = 0; i < GYRO_BIAS_TEMPERATURE_BINS; i++) {
+		if (estimator->bins[i].weight == 0) {
+			continue;
+		}
+		if (bin_center_degC(i) <= temperature_degC) {
+			below = i;
+		} else if (above < 0) {
+			above = i;
+		}
+	}
+
+	if (below < 0 && above < 0) {
+		memset(bias_dps, 0, 3 * sizeof(float));
+		return false;
+	}
+	if (below < 0 || above < 0) {
+		memcpy(bias_dps, estimator->bins[below < 0 ? above : below].bias_dps, 3 * sizeof(float));
+		return true;
+	}
+
+	float fraction = (temperature_degC - bin_center_degC(below)) / (bin_center_degC(above) - bin_center_degC(below));
+	for (int axis = 0; axis < 3; axis++) {
+		bias_dps[axis] = estimator->bins[below].bias_dps[axis] +
+			fraction * (estimator->bins[above].bias_dps[axis] - estimator->bins[below].bias_dps[axis]);
+	}
+	return true;
+}
+
+/// <summary>
+///     True if the bin of this temperature has been calibrated
+/// </summary>
+bool gyro_bias_is_calibrated(const gyro_bias_t* estimator, float temperature_degC) {
+	return estimator->bins[temperature_bin(temperature_degC)].weight > 0;
+}
+
+/// <summary>
+///     True if a bin was calibrated, or moved by more than GYRO_BIAS_SAVE_DELTA_DPS, since the last save
+/// </summary>
+bool gyro_bias_needs_save(const gyro_bias_t* estimator) {
+	for (int i = 0; i < GYRO_BIAS_TEMPERATURE_BINS; i++) {
+		if (estimator->bins[i].weight == 0) {
+			continue;
+		}
+		if (!estimator->saved_valid[i]) {
+			return true;
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			if (fabsf(estimator->bins[i].bias_dps[axis] - estimator->saved_dps[i][axis]) > GYRO_BIAS_SAVE_DELTA_DPS) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void gyro_bias_mark_saved(gyro_bias_t* estimator) {
+	for (int i = 0; i < GYRO_BIAS_TEMPERATURE_BINS; i++) {
+		estimator->saved_valid[i] = estimator->bins[i].weight > 0;
+		memcpy(estimator->saved_dps[i], estimator->bins[i].bias_dps, sizeof(estimator->saved_dps[i]));
+	}
+}
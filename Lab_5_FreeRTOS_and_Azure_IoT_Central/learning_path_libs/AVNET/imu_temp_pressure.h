@@ -1,11 +1,16 @@
 #pragma once
 
 #include "hw/azure_sphere_learning_path.h"
+#include "../terminate.h"
+#include "../timer.h"
+#include "../worker_pool.h"
 #include "lps22hh_reg.h"
 #include "lsm6dso_reg.h"
+#include "gyro_bias.h"
 #include <applibs/gpio.h>
 #include <applibs/i2c.h>
 #include <applibs/log.h>
+#include <applibs/storage.h>
 #include <errno.h>
 #include <math.h>
 #include <stdbool.h>
@@ -37,6 +42,8 @@ bool AvnetSkSensorUpdate(void);
 float GetTemperature(void);
 float GetPressure(void);
 int initI2c(void);
+void setSensorsReadyHandler(void (*handler)(bool ready));
+bool AvnetSkSensorsReady(void);
 void closeI2c(void);
 AngularRateDegreesPerSecond GetAngularRate(void);
 AccelerationMilligForce GetAcceleration(void);
\ No newline at end of file
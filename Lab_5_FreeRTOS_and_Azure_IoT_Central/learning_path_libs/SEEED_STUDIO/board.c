@@ -1,9 +1,17 @@
 #include "board.h"
 
+static LP_TELEMETRY_FIELD temperatureTelemetry = { .name = "Temperature", .type = LP_TYPE_FLOAT, .unit = "degC", .precision = 2 };
+static LP_TELEMETRY_FIELD humidityTelemetry = { .name = "Humidity", .type = LP_TYPE_FLOAT, .unit = "%", .precision = 1 };
+static LP_TELEMETRY_FIELD pressureTelemetry = { .name = "Pressure", .type = LP_TYPE_FLOAT, .unit = "hPa", .precision = 1 };
+static LP_TELEMETRY_FIELD lightTelemetry = { .name = "Light", .type = LP_TYPE_INT, .unit = "lux" };
+static LP_TELEMETRY_FIELD msgIdTelemetry = { .name = "MsgId", .type = LP_TYPE_INT };
+
+static LP_TELEMETRY_FIELD* telemetrySet[] = { &temperatureTelemetry, &humidityTelemetry, &pressureTelemetry, &lightTelemetry, &msgIdTelemetry };
+
 /// <summary>
-///     Reads telemetry and returns the length of JSON data.
+///     Reads the sensors into the telemetry fields
 /// </summary>
-int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
+static void ReadTelemetry(void) {
 	static int msgId = 0;
 	int rand_number = 0;
 	float temperature;
@@ -17,18 +25,55 @@ int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
 	rand_number = (rand() % 50) - 25;
 	pressure = (float)(1000.0 + rand_number);
 
-	static const char* MsgTemplate = "{ \"Temperature\": \"%3.2f\", \"Humidity\": \"%3.1f\", \"Pressure\":\"%3.1f\", \"Light\":%d, \"MsgId\":%d }";
-	return snprintf(msgBuffer, bufferLen, MsgTemplate, temperature, humidity, pressure, 0, msgId++);
+	lp_setTelemetryFloat(&temperatureTelemetry, temperature);
+	lp_setTelemetryFloat(&humidityTelemetry, humidity);
+	lp_setTelemetryFloat(&pressureTelemetry, pressure);
+	lp_setTelemetryInt(&lightTelemetry, 0);
+	lp_setTelemetryInt(&msgIdTelemetry, msgId++);
+}
+
+/// <summary>
+///     Reads telemetry and returns the length of JSON data.
+/// </summary>
+int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
+	ReadTelemetry();
+	return lp_encodeTelemetry(&lp_telemetryJsonEncoder, msgBuffer, bufferLen);
+}
+
+/// <summary>
+///     Reads telemetry and sends it with the encoder, JSON or CBOR. Returns the sent length, 0 if no field
+///     changed beyond its deltaThreshold, or -1 if sending failed.
+/// </summary>
+int lp_sendDevKitTelemetry(const LP_TELEMETRY_ENCODER* encoder) {
+	ReadTelemetry();
+	return lp_sendTelemetry(encoder);
+}
+
+static void (*devKitReadyHandler)(bool ready) = NULL;
+
+/// <summary>
+///     The handler is called once the board is initialized, set it before lp_initializeDevKit
+/// </summary>
+void lp_setDevKitReadyHandler(void (*readyHandler)(bool ready)) {
+	devKitReadyHandler = readyHandler;
 }
 
 bool lp_initializeDevKit(void) {
 
 	srand((unsigned int)time(NULL)); // seed the random number generator for fake telemetry
 
+	lp_openTelemetrySet(telemetrySet, NELEMS(telemetrySet));
+
+	// There are no sensors to bring up, the board is ready at once
+	if (devKitReadyHandler != NULL) {
+		devKitReadyHandler(true);
+	}
+
 	return true;
 }
 
 bool lp_closeDevKit(void) {
+	lp_closeTelemetrySet();
 
 	return true;
 }
\ No newline at end of file
@@ -4,6 +4,18 @@
 #include "parson.h"
 #include "peripheral_gpio.h"
 #include <iothub_device_client_ll.h>
+#include <math.h>
+#include <time.h>
+
+/*
+Reported state is sent by exception when the binding sets deltaThreshold. An int, float or bool state is
+then only reported when it moved by at least deltaThreshold (a bool when it changed) since it was last
+reported, or when maxSilence seconds passed (0 = no limit). This also drops the echo of a desired value that
+is already reported, e.g. when the full twin is received again after a reconnect. String states, like events,
+are always reported.
+
+	static LP_DEVICE_TWIN_BINDING relay1 = { .twinProperty = "Relay1", .twinType = LP_TYPE_BOOL, .deltaThreshold = 1, .maxSilence = 3600 };
+*/
 
 typedef enum {
 	LP_TYPE_UNKNOWN = 0,
@@ -18,6 +30,11 @@ struct _deviceTwinBinding {
 	void* twinState;
 	valueType twinType;
 	void (*handler)(struct _deviceTwinBinding* deviceTwinBinding);
+	float deltaThreshold;		// minimum change since last reported, 0 = always report
+	int maxSilence;				// seconds after which the state is reported even if unchanged, 0 = no limit
+	double lastReported;		// int, float and bool states
+	time_t lastReportedTime;	// CLOCK_MONOTONIC seconds
+	bool reported;
 };
 
 typedef struct _deviceTwinBinding LP_DEVICE_TWIN_BINDING;
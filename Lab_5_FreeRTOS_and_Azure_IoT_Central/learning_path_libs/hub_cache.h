@@ -0,0 +1,40 @@
+#pragma once
+
+#include <applibs/log.h>
+#include <applibs/storage.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+Cache of the IoT Hub assigned by the Device Provisioning Service.
+
+The hub hostname and device id from the last successful provisioning are kept in the mutable storage file,
+so reconnects and reboots connect to the hub directly. An entry is only used for the ID scope it was
+provisioned with. The hub rejecting the device credentials drops the entry at once (the device was moved
+to another hub or disabled), other connection failures drop it after LP_HUB_CACHE_MAX_FAILURES attempts
+in a row. Network outages do not count. Without a valid entry the device provisions again.
+
+The entry lives at LP_HUB_CACHE_FILE_OFFSET of the mutable storage file, the AVNET gyro bias table uses
+the start of the file.
+*/
+
+#define LP_HUB_CACHE_FILE_OFFSET 4096
+#define LP_HUB_CACHE_MAX_FAILURES 3
+#define LP_HUB_CACHE_SCOPE_ID_SIZE 32
+#define LP_HUB_CACHE_HOSTNAME_SIZE 128
+#define LP_HUB_CACHE_DEVICE_ID_SIZE 132		// Azure Sphere device ids are 128 hex digits
+
+typedef struct {
+	char hostname[LP_HUB_CACHE_HOSTNAME_SIZE];
+	char deviceId[LP_HUB_CACHE_DEVICE_ID_SIZE];
+} LP_HUB_CACHE_ENTRY;
+
+bool lp_hubCacheLoad(const char* scopeId, LP_HUB_CACHE_ENTRY* entry);
+bool lp_hubCacheStore(const char* scopeId, const char* hostname, const char* deviceId);
+void lp_hubCacheConnected(void);
+void lp_hubCacheConnectFailed(void);
+void lp_hubCacheInvalidate(void);
@@ -0,0 +1,152 @@
+#include "init_graph.h"
+#include "boot_profile.h"
+
+static LP_INIT_NODE** _initSet = NULL;
+static size_t _initCount = 0;
+static void (*_readyHandler)(void) = NULL;
+static struct timespec graphStartTime;
+static bool initReady = false;
+static bool scheduling = false;
+static bool rescan = false;
+
+static double ElapsedMs(const struct timespec* from, const struct timespec* to) {
+	return (double)(to->tv_sec - from->tv_sec) * 1000.0 + (double)(to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+static void FinishNode(LP_INIT_NODE* node, bool success) {
+	clock_gettime(CLOCK_MONOTONIC, &node->doneTime);
+	node->state = success ? LP_INIT_DONE : LP_INIT_FAILED;
+
+	Log_Debug("INIT: %s %s after %.1f ms, at %.1f ms\n", node->name, success ? "done" : "FAILED",
+		ElapsedMs(&node->startTime, &node->doneTime), ElapsedMs(&graphStartTime, &node->doneTime));
+}
+
+/// <summary>
+///     Returns LP_INIT_DONE when all dependencies are done, LP_INIT_FAILED when one failed, else LP_INIT_PENDING
+/// </summary>
+static LP_INIT_STATE DependencyState(const LP_INIT_NODE* node) {
+	LP_INIT_STATE state = LP_INIT_DONE;
+
+	for (LP_INIT_NODE** dependency = node->dependsOn; dependency != NULL && *dependency != NULL; dependency++) {
+		if ((*dependency)->state == LP_INIT_FAILED) {
+			return LP_INIT_FAILED;
+		}
+		if ((*dependency)->state != LP_INIT_DONE) {
+			state = LP_INIT_PENDING;
+		}
+	}
+	return state;
+}
+
+static void CheckReady(void) {
+	static bool failureReported = false;
+
+	if (initReady) {
+		return;
+	}
+
+	for (size_t i = 0; i < _initCount; i++) {
+		if (_initSet[i]->critical && _initSet[i]->state == LP_INIT_FAILED && !failureReported) {
+			failureReported = true;
+			Log_Debug("INIT: %s failed, the app will not be ready\n", _initSet[i]->name);
+		}
+		if (_initSet[i]->critical && _initSet[i]->state != LP_INIT_DONE) {
+			return;
+		}
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	initReady = true;
+	Log_Debug("INIT: ready after %.1f ms\n", ElapsedMs(&graphStartTime, &now));
+
+	if (_readyHandler != NULL) {
+		_readyHandler();
+	}
+}
+
+/// <summary>
+///     Starts every pending node whose dependencies are done, until no node changes state.
+///     Completions reported from inside a start function are picked up by the next pass.
+/// </summary>
+static void ScheduleInitGraph(void) {
+	if (scheduling) {
+		rescan = true;
+		return;
+	}
+	scheduling = true;
+
+	do {
+		rescan = false;
+
+		for (size_t i = 0; i < _initCount; i++) {
+			LP_INIT_NODE* node = _initSet[i];
+
+			if (node->state != LP_INIT_PENDING) {
+				continue;
+			}
+
+			switch (DependencyState(node)) {
+			case LP_INIT_FAILED:
+				clock_gettime(CLOCK_MONOTONIC, &node->startTime);
+				Log_Debug("INIT: %s not started, a dependency failed\n", node->name);
+				FinishNode(node, false);
+				rescan = true;
+				break;
+			case LP_INIT_DONE:
+				node->state = LP_INIT_RUNNING;
+				clock_gettime(CLOCK_MONOTONIC, &node->startTime);
+
+				bool started = true;
+				if (node->start != NULL) {
+					LP_BOOT_PHASE(node->name) started = node->start();
+				}
+
+				// an asynchronous node may have completed inside start
+				if (node->state == LP_INIT_RUNNING && (!started || !node->async || node->start == NULL)) {
+					FinishNode(node, started);
+				}
+				rescan = true;
+				break;
+			default:
+				break;
+			}
+		}
+	} while (rescan);
+
+	scheduling = false;
+	CheckReady();
+}
+
+/// <summary>
+///     Starts the nodes of the set in dependency order, readyHandler runs once all critical nodes are done
+/// </summary>
+void lp_startInitGraph(LP_INIT_NODE* initSet[], size_t initCount, void (*readyHandler)(void)) {
+	_initSet = initSet;
+	_initCount = initCount;
+	_readyHandler = readyHandler;
+	initReady = false;
+
+	clock_gettime(CLOCK_MONOTONIC, &graphStartTime);
+	for (size_t i = 0; i < _initCount; i++) {
+		_initSet[i]->state = LP_INIT_PENDING;
+	}
+
+	ScheduleInitGraph();
+}
+
+/// <summary>
+///     Completes an asynchronous node and starts the nodes waiting for it
+/// </summary>
+void lp_initNodeDone(LP_INIT_NODE* node, bool success) {
+	if (node == NULL || node->state != LP_INIT_RUNNING) {
+		return;
+	}
+
+	FinishNode(node, success);
+	ScheduleInitGraph();
+}
+
+bool lp_isInitReady(void) {
+	return initReady;
+}
@@ -65,10 +65,19 @@ int lp_enableInterCoreCommunications(const char* rtAppComponentId, void (*interC
 /// </summary>
 void SocketEventHandler(EventLoop* el, int fd, EventLoop_IoEvents events, void* context)
 {
+#ifdef LP_HANDLER_STATS
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
 	if (!ProcessMsg())
 	{
 		lp_terminate(ExitCode_InterCoreHandler);
 	}
+
+#ifdef LP_HANDLER_STATS
+	lp_handlerStatsRecord(lp_handlerStats("interCore"), NULL, &start);
+#endif
 }
 
 
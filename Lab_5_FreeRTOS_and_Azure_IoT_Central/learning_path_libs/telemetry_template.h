@@ -0,0 +1,65 @@
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+Compile-time specialized JSON telemetry serializers.
+
+A telemetry schema is an X-macro listing the fields as FIELD(name, kind, decimals):
+
+	#define BOARD_TELEMETRY(FIELD) \
+		FIELD(Temperature, LP_TELEMETRY_FLOAT_STRING, 2) \
+		FIELD(MsgId, LP_TELEMETRY_INT, 0)
+
+	LP_TELEMETRY_SCHEMA(BoardTelemetry, BOARD_TELEMETRY)
+
+LP_TELEMETRY_SCHEMA declares the struct BoardTelemetry with one member per field and the function
+int BoardTelemetry_serialize(const BoardTelemetry* telemetry, char* buffer, size_t bufferLen).
+The JSON keys and separators are pre-baked string literals, numbers are appended directly, no format
+string is parsed at runtime. The serializer returns the JSON length, or -1 if the buffer is too small.
+
+Kinds:
+	LP_TELEMETRY_INT			int32_t, "name":123
+	LP_TELEMETRY_FLOAT			float with fixed decimals, "name":23.45 (null if not finite)
+	LP_TELEMETRY_FLOAT_STRING	float with fixed decimals as JSON string, "name":"23.45"
+*/
+
+#define LP_TELEMETRY_MAX_DECIMALS 6
+
+char* lp_jsonAppendLiteral(char* p, const char* end, const char* literal, size_t len);
+char* lp_jsonAppendInt(char* p, const char* end, int32_t value);
+char* lp_jsonAppendFloat(char* p, const char* end, float value, int decimals);
+int lp_jsonClose(char* buffer, char* p, const char* end);
+
+// every field starts with ",\"name\":", lp_jsonClose replaces the first ',' with '{'
+#define LP_TELEMETRY_KEY(name, suffix) ",\"" #name "\":" suffix
+#define LP_TELEMETRY_APPEND_KEY(p, name, suffix) \
+	lp_jsonAppendLiteral(p, end, LP_TELEMETRY_KEY(name, suffix), sizeof(LP_TELEMETRY_KEY(name, suffix)) - 1)
+
+#define LP_TELEMETRY_INT_CTYPE int32_t
+#define LP_TELEMETRY_INT_APPEND(p, name, value, decimals) \
+	lp_jsonAppendInt(LP_TELEMETRY_APPEND_KEY(p, name, ""), end, value)
+
+#define LP_TELEMETRY_FLOAT_CTYPE float
+#define LP_TELEMETRY_FLOAT_APPEND(p, name, value, decimals) \
+	lp_jsonAppendFloat(LP_TELEMETRY_APPEND_KEY(p, name, ""), end, value, decimals)
+
+#define LP_TELEMETRY_FLOAT_STRING_CTYPE float
+#define LP_TELEMETRY_FLOAT_STRING_APPEND(p, name, value, decimals) \
+	lp_jsonAppendLiteral(lp_jsonAppendFloat(LP_TELEMETRY_APPEND_KEY(p, name, "\""), end, value, decimals), end, "\"", 1)
+
+#define LP_TELEMETRY_MEMBER(name, kind, decimals) kind##_CTYPE name;
+#define LP_TELEMETRY_APPEND(name, kind, decimals) p = kind##_APPEND(p, name, telemetry->name, decimals);
+
+#define LP_TELEMETRY_SCHEMA(typeName, schema) \
+	typedef struct { schema(LP_TELEMETRY_MEMBER) } typeName; \
+	static int typeName##_serialize(const typeName* telemetry, char* buffer, size_t bufferLen) { \
+		char* p = buffer; \
+		const char* end = buffer + bufferLen; \
+		schema(LP_TELEMETRY_APPEND) \
+		return lp_jsonClose(buffer, p, end); \
+	}
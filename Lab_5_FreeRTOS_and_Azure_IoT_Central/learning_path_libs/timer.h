@@ -7,6 +7,7 @@
 typedef struct {
 	void (*handler)(EventLoopTimer* timer);
 	struct timespec period;
+	struct timespec slack;			// optional, expiries may be delayed this much to share a wakeup
 	EventLoopTimer* eventLoopTimer;
 	const char* name;
 } LP_TIMER;
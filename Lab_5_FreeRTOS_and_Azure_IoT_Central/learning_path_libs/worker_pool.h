@@ -0,0 +1,55 @@
+#pragma once
+
+#include "eventloop_timer_utilities.h"
+#include "handler_stats.h"
+#include "timer.h"
+#include <applibs/eventloop.h>
+#include <applibs/log.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/*
+Worker threads for blocking calls.
+
+The work function of an LP_WORK_ITEM runs on one of LP_WORKER_POOL_THREADS threads, e.g. an I2C transfer or DPS
+provisioning. Its done function then runs on the event loop thread, the workers signal completions through an
+eventfd registered with the timer event loop. Items belong to the caller, like timers, and are queued at most
+once: lp_submitWork returns false for an item that is already queued or running. Items that touch the same
+device must not be in flight together, the pool runs queued items in parallel.
+
+The work function must not call the event loop or the learning path libs that use it, pass results to done
+through the item context. The pool starts with the first submitted item.
+
+	static LP_WORK_ITEM readSensorWork = { .name = "readSensor", .work = ReadSensor, .done = SensorRead };
+*/
+
+#define LP_WORKER_POOL_THREADS 2
+
+typedef enum {
+	LP_WORK_IDLE,
+	LP_WORK_QUEUED,
+	LP_WORK_RUNNING,
+	LP_WORK_COMPLETED		// waiting for done on the event loop
+} LP_WORK_STATE;
+
+struct _workItem {
+	const char* name;
+	void (*work)(struct _workItem* item);	// worker thread
+	void (*done)(struct _workItem* item);	// event loop thread, may resubmit the item
+	void* context;
+	LP_WORK_STATE state;
+	struct _workItem* next;
+};
+
+typedef struct _workItem LP_WORK_ITEM;
+
+bool lp_submitWork(LP_WORK_ITEM* item);
+bool lp_isWorkPending(const LP_WORK_ITEM* item);
+void lp_waitForWork(LP_WORK_ITEM* item);
+void lp_stopWorkerPool(void);
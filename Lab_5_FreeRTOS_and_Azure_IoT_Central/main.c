@@ -40,6 +40,7 @@
 #include "learning_path_libs/globals.h"
 #include "learning_path_libs/inter_core.h"
 #include "learning_path_libs/peripheral_gpio.h"
+#include "learning_path_libs/telemetry_template.h"
 #include "learning_path_libs/terminate.h"
 #include "learning_path_libs/timer.h"
 
@@ -64,7 +65,19 @@
 #include "learning_path_libs/SEEED_STUDIO/board.h"
 #endif // SEEED_STUDIO
 
-#define JSON_MESSAGE_BYTES 128  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+#define JSON_MESSAGE_BYTES 256  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+
+#define INTER_CORE_TELEMETRY(FIELD) \
+	FIELD(Temperature, LP_TELEMETRY_FLOAT_STRING, 2) \
+	FIELD(Humidity, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(Pressure, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(Light, LP_TELEMETRY_INT, 0) \
+	FIELD(Roll, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(Pitch, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(Yaw, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(MsgId, LP_TELEMETRY_INT, 0)
+
+LP_TELEMETRY_SCHEMA(InterCoreTelemetry, INTER_CORE_TELEMETRY)
 
 // Forward signatures
 static void InitPeripheralGpiosAndHandlers(void);
@@ -79,6 +92,7 @@ static char msgBuffer[JSON_MESSAGE_BYTES] = { 0 };
 static const char cstrJsonEvent[] = "{\"%s\":\"occurred\"}";
 static const struct timespec led2BlinkPeriod = { 0, 500 * 1000 * 1000 };
 LP_INTER_CORE_BLOCK ic_control_block;
+static LP_INTER_CORE_BLOCK orientation;	// latest LP_IC_ORIENTATION from the real-time core
 
 
 // GPIO Output PeripheralGpios
@@ -179,8 +193,8 @@ static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 /// </summary>
 static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
 {
-	static const char* msgTemplate = "{ \"Temperature\": \"%3.2f\", \"Humidity\": \"%3.1f\", \"Pressure\":\"%3.1f\", \"Light\":%d, \"MsgId\":%d }";
 	static int msgId = 0;
+	InterCoreTelemetry telemetry;
 	int len = 0;
 
 	switch (ic_message_block->cmd)
@@ -194,7 +208,14 @@ static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
 		lp_deviceTwinReportState(&buttonPressed, "ButtonB");					// TwinType = TYPE_STRING
 		break;
 	case LP_IC_TEMPERATURE_PRESSURE_HUMIDITY:
-		len = snprintf(msgBuffer, JSON_MESSAGE_BYTES, msgTemplate, ic_message_block->temperature, ic_message_block->humidity, ic_message_block->pressure, 0, msgId++);
+		telemetry = (InterCoreTelemetry){ .Temperature = ic_message_block->temperature, .Humidity = ic_message_block->humidity,
+			.Pressure = ic_message_block->pressure, .Light = 0, .Roll = orientation.roll, .Pitch = orientation.pitch,
+			.Yaw = orientation.yaw, .MsgId = msgId++ };
+		len = InterCoreTelemetry_serialize(&telemetry, msgBuffer, JSON_MESSAGE_BYTES);
+		break;
+	case LP_IC_ORIENTATION:
+		// streamed at 4 Hz, the latest orientation is sent with the next telemetry message
+		orientation = *ic_message_block;
 		break;
 	default:
 		break;
@@ -216,6 +237,7 @@ static void InitPeripheralGpiosAndHandlers(void)
 	lp_openDeviceTwinSet(deviceTwinBindingSet, NELEMS(deviceTwinBindingSet));
 
 	lp_startTimerSet(timerSet, NELEMS(timerSet));
+	lp_logStart();
 	lp_startCloudToDevice();
 
 	lp_enableInterCoreCommunications(rtAppComponentId, InterCoreHandler);  // Initialize Inter Core Communications
@@ -233,6 +255,7 @@ static void ClosePeripheralGpiosAndHandlers(void)
 
 	lp_stopTimerSet();
 	lp_stopCloudToDevice();
+	lp_logStop();
 
 	lp_closePeripheralGpioSet();
 	lp_closeDeviceTwinSet();
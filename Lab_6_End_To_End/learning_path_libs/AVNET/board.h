@@ -1,6 +1,8 @@
 #pragma once
 
 #include "hw/azure_sphere_learning_path.h"
+#include "../aggregate.h"
+#include "../telemetry.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,5 +12,7 @@
 
 
 int lp_readTelemetry(char* msgBuffer, size_t bufferLen);
+int lp_sendDevKitTelemetry(const LP_TELEMETRY_ENCODER* encoder);
 bool lp_initializeDevKit(void);
+void lp_setDevKitReadyHandler(void (*readyHandler)(bool ready));
 bool lp_closeDevKit(void);
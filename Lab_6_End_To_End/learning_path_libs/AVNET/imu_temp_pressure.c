@@ -37,22 +37,60 @@
 /* Private variables ---------------------------------------------------------*/
 static axis3bit16_t data_raw_acceleration;
 static axis3bit16_t data_raw_angular_rate;
-static axis3bit16_t raw_angular_rate_calibration;
 static axis1bit32_t data_raw_pressure;
 static axis1bit16_t data_raw_temperature;
 //static float acceleration_mg[3];
 //static float angular_rate_dps[3];
-//static float lsm6dsoTemperature_degC;
+static float lsm6dsoTemperature_degC;
 static float pressure_hPa;
 static float lps22hhTemperature_degC;
 
 static uint8_t whoamI, rst;
+
+// Burst read lengths, register auto-increment is enabled by default on both devices (LSM6DSO CTRL3_C IF_INC,
+// LPS22HH CTRL_REG2 IF_ADD_INC). The sensor hub reads up to 7 bytes per transaction.
+#define LSM6DSO_BURST_LEN	(LSM6DSO_OUTZ_H_A - LSM6DSO_STATUS_REG + 1)		// STATUS_REG, OUT_TEMP, OUTX_G..OUTZ_A
+#define LPS22HH_BURST_LEN	(LPS22HH_TEMP_OUT_H - LPS22HH_STATUS + 1)		// STATUS, PRESS_OUT, TEMP_OUT
 int accelTimerFd;
 const uint8_t lsm6dsOAddress = LSM6DSO_ADDRESS;     // Addr = 0x6A
 lsm6dso_ctx_t dev_ctx;
 lps22hh_ctx_t pressure_ctx;
 bool lps22hhDetected;
 
+typedef enum {
+	SENSOR_INIT_CONFIGURE_LSM6DSO,
+	SENSOR_INIT_DETECT_LPS22HH,
+	SENSOR_INIT_CONFIGURE_LPS22HH,
+	SENSOR_INIT_CALIBRATE_GYRO,
+	SENSOR_INIT_READY,
+	SENSOR_INIT_FAILED
+} SensorInitState;
+
+#define LPS22HH_DETECT_ATTEMPTS				10
+#define LPS22HH_DETECT_RETRY_MS				100
+#define GYRO_CALIBRATION_SAMPLE_MS			80		// gyro ODR 12.5 Hz
+#define GYRO_CALIBRATION_ATTEMPTS			5		// stationary windows to wait for before starting uncalibrated
+
+// The gyro bias table is kept in the mutable storage file of the application
+#define GYRO_BIAS_FILE_MAGIC				0x47425331	// "GBS1"
+#define GYRO_BIAS_SAVE_INTERVAL_SECONDS		600		// limits flash writes while the table is still settling
+
+typedef struct {
+	uint32_t magic;
+	uint32_t binCount;
+	gyro_bias_bin_t bins[GYRO_BIAS_TEMPERATURE_BINS];
+} GyroBiasFile;
+
+static SensorInitState sensorInitState = SENSOR_INIT_CONFIGURE_LSM6DSO;	// owned by the worker running a step
+static int sensorInitDelayMs;
+static bool sensorsReady = false;	// event loop copy of sensorInitState == SENSOR_INIT_READY
+static void (*sensorsReadyHandler)(bool ready) = NULL;
+static int lps22hhDetectAttempts;
+static int calibrationSamples;
+static gyro_bias_t gyroBias;
+static struct timespec gyroBiasSavedTime;
+static bool gyroBiasSaved;
+
 
 //Extern variables
 int i2cFd = -1;
@@ -70,36 +108,63 @@ static int32_t platform_read(int *fD, uint8_t reg, uint8_t *bufp, uint16_t len);
 // Routines to read/write to the LPS22HH device connected to the LSM6DSO sensor hub
 static int32_t lsm6dso_write_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data, uint16_t len);
 static int32_t lsm6dso_read_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data, uint16_t len);
+static int32_t lsm6dso_start_lps22hh_auto_read(void);
+
+// LSM6DSO acquisition and gyro bias persistence
+static bool ReadImu(void);
+static bool LoadGyroBias(void);
+static void SaveGyroBias(void);
+
+// Sensor initialization state machine, driven by a one-shot timer. Each step does blocking I2C transfers
+// and runs on a worker thread, so the event loop is never blocked.
+static void SensorInitHandler(EventLoopTimer* eventLoopTimer);
+static void ScheduleSensorInit(int delayMs);
+static void RunSensorInitStep(LP_WORK_ITEM* item);
+static void SensorInitStepDone(LP_WORK_ITEM* item);
+
+static LP_WORK_ITEM sensorInitWork = { .name = "sensorInit", .work = RunSensorInitStep, .done = SensorInitStepDone };
+
+static LP_TIMER sensorInitTimer = {
+	.period = { 0, 0 },			// one-shot timer
+	.name = "sensorInit",
+	.handler = &SensorInitHandler
+};
 
 /// <summary>
 ///     Sleep for delayTime ms
 /// </summary>
 void HAL_Delay(int delayTime) {
 	struct timespec ts;
-	ts.tv_sec = 0;
-	ts.tv_nsec = delayTime * 10000;
+	ts.tv_sec = delayTime / 1000;
+	ts.tv_nsec = (delayTime % 1000) * 1000000;
 	nanosleep(&ts, NULL);
 }
 
 /// <summary>
-///     Print latest data from on-board sensors.
+///     Reads the LSM6DSO outputs in one burst, feeds the gyro bias estimator and applies the bias for
+///     the current temperature. Returns true if new angular rate data was read.
 /// </summary>
-bool AvnetSkSensorUpdate(void)
-{
+static bool ReadImu(void) {
+	uint8_t imuBurst[LSM6DSO_BURST_LEN];
 
-	uint8_t reg;
-	lps22hh_reg_t lps22hhReg;
+	// One auto-increment read of STATUS_REG through OUTZ_H_A, all channels are decoded from this buffer
+	if (lsm6dso_read_reg(&dev_ctx, LSM6DSO_STATUS_REG, imuBurst, LSM6DSO_BURST_LEN) != 0) {
+		return false;
+	}
 
-	// Read the sensors on the lsm6dso device
+	lsm6dso_status_reg_t* status = (lsm6dso_status_reg_t*)&imuBurst[0];
+
+	if (status->tda) {
+		// Temperature data, indexes the gyro bias table
+		memcpy(data_raw_temperature.u8bit, &imuBurst[LSM6DSO_OUT_TEMP_L - LSM6DSO_STATUS_REG], sizeof(int16_t));
+		lsm6dsoTemperature_degC = lsm6dso_from_lsb_to_celsius(data_raw_temperature.i16bit);
+	}
 
 	//Read output only if new xl value is available
-	lsm6dso_xl_flag_data_ready_get(&dev_ctx, &reg);
-	if (reg)
-	{
-		// Read acceleration field data
-		memset(data_raw_acceleration.u8bit, 0x00, 3 * sizeof(int16_t));
-		lsm6dso_acceleration_raw_get(&dev_ctx, data_raw_acceleration.u8bit);
-		
+	if (status->xlda) {
+		// Acceleration field data
+		memcpy(data_raw_acceleration.u8bit, &imuBurst[LSM6DSO_OUTX_L_A - LSM6DSO_STATUS_REG], 3 * sizeof(int16_t));
+
 		accelerationMilligForce.x = lsm6dso_from_fs4_to_mg(data_raw_acceleration.i16bit[0]);
 		accelerationMilligForce.y = lsm6dso_from_fs4_to_mg(data_raw_acceleration.i16bit[1]);
 		accelerationMilligForce.z = lsm6dso_from_fs4_to_mg(data_raw_acceleration.i16bit[2]);
@@ -108,34 +173,111 @@ bool AvnetSkSensorUpdate(void)
 		//	accelerationMilligForce.x, accelerationMilligForce.y, accelerationMilligForce.z);
 	}
 
-	lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-	if (reg)
-	{
-		// Read angular rate field data
-		memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-		lsm6dso_angular_rate_raw_get(&dev_ctx, data_raw_angular_rate.u8bit);
+	if (!status->gda) {
+		return false;
+	}
+
+	// Angular rate field data
+	memcpy(data_raw_angular_rate.u8bit, &imuBurst[LSM6DSO_OUTX_L_G - LSM6DSO_STATUS_REG], 3 * sizeof(int16_t));
+
+	float rateDps[3];
+	float accelMg[3] = { accelerationMilligForce.x, accelerationMilligForce.y, accelerationMilligForce.z };
+	float biasDps[3];
+
+	for (int axis = 0; axis < 3; axis++) {
+		rateDps[axis] = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[axis]) / 1000.0f;
+	}
+
+	// While the device is at rest the raw rate is the bias, the estimator only uses stationary windows
+	gyro_bias_update(&gyroBias, rateDps, accelMg, lsm6dsoTemperature_degC);
+	gyro_bias_get(&gyroBias, lsm6dsoTemperature_degC, biasDps);
+
+	angularRateDps.x = rateDps[0] - biasDps[0];
+	angularRateDps.y = rateDps[1] - biasDps[1];
+	angularRateDps.z = rateDps[2] - biasDps[2];
+
+	//Log_Debug("LSM6DSO: Angular rate [dps] : %4.2f, %4.2f, %4.2f\r\n",
+	//	angularRateDps.x, angularRateDps.y, angularRateDps.z);
+
+	if (gyro_bias_needs_save(&gyroBias)) {
+		SaveGyroBias();
+	}
+
+	return true;
+}
+
+/// <summary>
+///     Restores the gyro bias table from mutable storage. Returns false if there is no valid table.
+/// </summary>
+static bool LoadGyroBias(void) {
+	GyroBiasFile file;
+
+	int fd = Storage_OpenMutableFile();
+	if (fd < 0) {
+		Log_Debug("ERROR: Storage_OpenMutableFile: errno=%d (%s)\n", errno, strerror(errno));
+		return false;
+	}
+
+	ssize_t len = read(fd, &file, sizeof(file));
+	close(fd);
+
+	if (len != sizeof(file) || file.magic != GYRO_BIAS_FILE_MAGIC || file.binCount != GYRO_BIAS_TEMPERATURE_BINS) {
+		return false;
+	}
+
+	gyro_bias_restore(&gyroBias, file.bins);
+	return true;
+}
 
-		// Before we store the mdps values subtract the calibration data we captured at startup.
-		angularRateDps.x = (lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[0] - raw_angular_rate_calibration.i16bit[0])) / 1000.0;
-		angularRateDps.y = (lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[1] - raw_angular_rate_calibration.i16bit[1])) / 1000.0;
-		angularRateDps.z = (lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[2] - raw_angular_rate_calibration.i16bit[2])) / 1000.0;
+/// <summary>
+///     Writes the gyro bias table to mutable storage, at most once every GYRO_BIAS_SAVE_INTERVAL_SECONDS
+/// </summary>
+static void SaveGyroBias(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
 
-		//Log_Debug("LSM6DSO: Angular rate [dps] : %4.2f, %4.2f, %4.2f\r\n",
-		//	angularRateDps.x, angularRateDps.y, angularRateDps.z);
+	if (gyroBiasSaved && now.tv_sec - gyroBiasSavedTime.tv_sec < GYRO_BIAS_SAVE_INTERVAL_SECONDS) {
+		return;
+	}
 
+	GyroBiasFile file = { .magic = GYRO_BIAS_FILE_MAGIC, .binCount = GYRO_BIAS_TEMPERATURE_BINS };
+	memcpy(file.bins, gyroBias.bins, sizeof(file.bins));
 
+	int fd = Storage_OpenMutableFile();
+	if (fd < 0) {
+		Log_Debug("ERROR: Storage_OpenMutableFile: errno=%d (%s)\n", errno, strerror(errno));
+		return;
 	}
 
-	//lsm6dso_temp_flag_data_ready_get(&dev_ctx, &reg);
-	//if (reg)
-	//{
-	//	// Read temperature data
-	//	memset(data_raw_temperature.u8bit, 0x00, sizeof(int16_t));
-	//	lsm6dso_temperature_raw_get(&dev_ctx, data_raw_temperature.u8bit);
-	//	lsm6dsoTemperature_degC = lsm6dso_from_lsb_to_celsius(data_raw_temperature.i16bit);
+	ssize_t len = -1;
+	if (lseek(fd, 0, SEEK_SET) == 0) {
+		len = write(fd, &file, sizeof(file));
+	}
+	close(fd);
 
-	//	Log_Debug("LSM6DSO: Temperature  [degC]: %.2f\r\n", lsm6dsoTemperature_degC);
-	//}
+	if (len != sizeof(file)) {
+		Log_Debug("ERROR: Could not save the gyro calibration: errno=%d (%s)\n", errno, strerror(errno));
+		return;
+	}
+
+	gyro_bias_mark_saved(&gyroBias);
+	gyroBiasSaved = true;
+	gyroBiasSavedTime = now;
+}
+
+/// <summary>
+///     Print latest data from on-board sensors.
+/// </summary>
+bool AvnetSkSensorUpdate(void)
+{
+	uint8_t pressureBurst[LPS22HH_BURST_LEN] = { 0 };
+
+	if (sensorInitState != SENSOR_INIT_READY) {
+		return false;
+	}
+
+	// Read the sensors on the lsm6dso device
+	ReadImu();
 
 	// Read the lps22hh sensor on the lsm6dso device
 
@@ -144,17 +286,19 @@ bool AvnetSkSensorUpdate(void)
 	memset(data_raw_temperature.u8bit, 0x00, sizeof(int16_t));
 
 	if (lps22hhDetected) {
-		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t *)&lps22hhReg, 1);
+		// The sensor hub polls STATUS through TEMP_OUT_H on every accelerometer sample, read the latest copy
+		lsm6dso_sh_read_data_raw_get(&dev_ctx, (lsm6dso_emb_sh_read_t*)pressureBurst, LPS22HH_BURST_LEN);
+
+		lps22hh_status_t* status = (lps22hh_status_t*)&pressureBurst[0];
 
 		//Read output only if new value is available
 
-		if ((lps22hhReg.status.p_da == 1) && (lps22hhReg.status.t_da == 1))
+		if ((status->p_da == 1) && (status->t_da == 1))
 		{
-			lps22hh_pressure_raw_get(&pressure_ctx, data_raw_pressure.u8bit);
-
+			memcpy(data_raw_pressure.u8bit, &pressureBurst[LPS22HH_PRESS_OUT_XL - LPS22HH_STATUS], 3);
 			pressure_hPa = lps22hh_from_lsb_to_hpa(data_raw_pressure.i32bit);
 
-			lps22hh_temperature_raw_get(&pressure_ctx, data_raw_temperature.u8bit);
+			memcpy(data_raw_temperature.u8bit, &pressureBurst[LPS22HH_TEMP_OUT_L - LPS22HH_STATUS], sizeof(int16_t));
 			lps22hhTemperature_degC = lps22hh_from_lsb_to_celsius(data_raw_temperature.i16bit);
 
 			//Log_Debug("LPS22HH: Pressure     [hPa] : %.2f\r\n", pressure_hPa);
@@ -212,18 +356,49 @@ int initI2c(void) {
 		return -1;
 	}
 
-	// Start lsm6dso specific init
-
 	// Initialize lsm6dso mems driver interface
 	dev_ctx.write_reg = platform_write;
 	dev_ctx.read_reg = platform_read;
 	dev_ctx.handle = &i2cFd;
 
+	// lps22hh specific init
+
+	// Default the flag to false.  If we fail to communicate with the LPS22HH device, this flag
+	// will cause application execution to skip over LPS22HH specific code.
+	lps22hhDetected = false;
+	lps22hhDetectAttempts = 0;
+
+	// Initialize lps22hh mems driver interface
+	pressure_ctx.read_reg = lsm6dso_read_lps22hh_cx;
+	pressure_ctx.write_reg = lsm6dso_write_lps22hh_cx;
+	pressure_ctx.handle = &i2cFd;
+
+	// The LSM6DSO set up, LPS22HH detection and angular rate calibration continue from the event loop,
+	// the sensors are read once sensorInitState reaches SENSOR_INIT_READY
+	sensorInitState = SENSOR_INIT_CONFIGURE_LSM6DSO;
+	sensorsReady = false;
+	if (!lp_startTimer(&sensorInitTimer)) {
+		return -1;
+	}
+	ScheduleSensorInit(1);
+
+	return 0;
+}
+
+static void ScheduleSensorInit(int delayMs) {
+	lp_setOneShotTimer(&sensorInitTimer, &(struct timespec){delayMs / 1000, (delayMs % 1000) * 1000000});
+}
+
+/// <summary>
+///     Checks the LSM6DSO answers and configures it, returns the delay to the next step in ms
+/// </summary>
+static int ConfigureLsm6dso(void) {
 	// Check device ID
 	lsm6dso_device_id_get(&dev_ctx, &whoamI);
 	if (whoamI != LSM6DSO_ID) {
 		Log_Debug("LSM6DSO not found!\n");
-		return -1;
+		sensorInitState = SENSOR_INIT_FAILED;
+		return 0;
 	}
 	else {
 		Log_Debug("LSM6DSO Found!\n");
@@ -254,123 +429,176 @@ int initI2c(void) {
 	lsm6dso_xl_hp_path_on_out_set(&dev_ctx, LSM6DSO_LP_ODR_DIV_100);
 	lsm6dso_xl_filter_lp2_set(&dev_ctx, PROPERTY_ENABLE);
 
-	// lps22hh specific init
-
-	// Default the flag to false.  If we fail to communicate with the LPS22HH device, this flag
-	// will cause application execution to skip over LPS22HH specific code.
-	lps22hhDetected = false;
+	// Restore the gyro bias table of the previous boot, a calibrated bin for the current temperature skips calibration
+	gyro_bias_init(&gyroBias);
+	if (LoadGyroBias()) {
+		Log_Debug("LSM6DSO: Restored the angular rate calibration\n");
+	}
 
-	// Initialize lps22hh mems driver interface
-	pressure_ctx.read_reg = lsm6dso_read_lps22hh_cx;
-	pressure_ctx.write_reg = lsm6dso_write_lps22hh_cx;
-	pressure_ctx.handle = &i2cFd;
+	sensorInitState = SENSOR_INIT_DETECT_LPS22HH;
+	return 1;
+}
 
-	int failCount = 10;
+static void StartGyroCalibration(void) {
+	calibrationSamples = 0;
+	sensorInitState = SENSOR_INIT_CALIBRATE_GYRO;
+}
 
-	while (!lps22hhDetected) {
-		
-		// Enable pull up on master I2C interface.
-		lsm6dso_sh_pin_mode_set(&dev_ctx, LSM6DSO_INTERNAL_PULL_UP);
+/// <summary>
+///     Checks once if the LPS22HH answers on the sensor hub, returns the delay to the next step in ms
+/// </summary>
+static int DetectLps22hh(void) {
+	// Enable pull up on master I2C interface.
+	lsm6dso_sh_pin_mode_set(&dev_ctx, LSM6DSO_INTERNAL_PULL_UP);
+
+	// Check if LPS22HH is connected to Sensor Hub
+	lps22hh_device_id_get(&pressure_ctx, &whoamI);
+	if (whoamI == LPS22HH_ID) {
+		lps22hhDetected = true;
+		Log_Debug("LPS22HH Found!\n");
+		sensorInitState = SENSOR_INIT_CONFIGURE_LPS22HH;
+		return 1;
+	}
 
-		// Check if LPS22HH is connected to Sensor Hub
-		lps22hh_device_id_get(&pressure_ctx, &whoamI);
-		if (whoamI != LPS22HH_ID) {
-			Log_Debug("LPS22HH not found!\n");
-		}
-		else {
-			lps22hhDetected = true;
-			Log_Debug("LPS22HH Found!\n");
-		}
+	Log_Debug("LPS22HH not found!\n");
 
-		// Restore the default configuration
-		lps22hh_reset_set(&pressure_ctx, PROPERTY_ENABLE);
-		do {
-			lps22hh_reset_get(&pressure_ctx, &rst);
-		} while (rst);
+	if (++lps22hhDetectAttempts >= LPS22HH_DETECT_ATTEMPTS) {
+		Log_Debug("Failed to read LPS22HH device ID, disabling all access to LPS22HH device!\n");
+		Log_Debug("Usually a power cycle will correct this issue\n");
+		StartGyroCalibration();
+	}
 
-		// Enable Block Data Update
-		lps22hh_block_data_update_set(&pressure_ctx, PROPERTY_ENABLE);
+	return LPS22HH_DETECT_RETRY_MS;
+}
 
-		//Set Output Data Rate
-		lps22hh_data_rate_set(&pressure_ctx, LPS22HH_10_Hz_LOW_NOISE);
+/// <summary>
+///     Configures the LPS22HH and hands it over to the sensor hub, returns the delay to the next step in ms
+/// </summary>
+static int ConfigureLps22hh(void) {
+	// Restore the default configuration
+	lps22hh_reset_set(&pressure_ctx, PROPERTY_ENABLE);
+	do {
+		lps22hh_reset_get(&pressure_ctx, &rst);
+	} while (rst);
 
-		// If we failed to detect the lps22hh device, then pause before trying again.
-		if (!lps22hhDetected) {
-			HAL_Delay(100);
-		}
+	// Enable Block Data Update
+	lps22hh_block_data_update_set(&pressure_ctx, PROPERTY_ENABLE);
 
-		if (failCount-- == 0) {
-			lps22hhDetected = false;
-			Log_Debug("Failed to read LPS22HH device ID, disabling all access to LPS22HH device!\n");
-			Log_Debug("Usually a power cycle will correct this issue\n");
-			break;
-		}
-	}
+	//Set Output Data Rate
+	lps22hh_data_rate_set(&pressure_ctx, LPS22HH_10_Hz_LOW_NOISE);
 
-	// Read the raw angular rate data from the device to use as offsets.  We're making the assumption that the device
-	// is stationary.
+	// From here on the sensor hub reads the LPS22HH autonomously, the passthrough routines must not be used
+	lsm6dso_start_lps22hh_auto_read();
 
-	uint8_t reg;
-	
-	Log_Debug("LSM6DSO: Calibrating angular rate . . .\n"); 
-	Log_Debug("LSM6DSO: Please make sure the device is stationary.\n");
+	StartGyroCalibration();
 
-	do {
+	return GYRO_CALIBRATION_SAMPLE_MS;
+}
 
-		// Delay and read the device until we have data!
-		do {
-			// Read the calibration values
-			HAL_Delay(5000);
-			lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-		} while (!reg);
+/// <summary>
+///     Feeds one sample to the gyro bias estimator until the bin of the current temperature is calibrated,
+///     either restored from storage or from a stationary window. After GYRO_CALIBRATION_ATTEMPTS windows
+///     the sensors start anyway and the estimator calibrates once the device is at rest.
+///     Returns the delay to the next step in ms.
+/// </summary>
+static int CalibrateGyro(void) {
+	if (!ReadImu()) {
+		return GYRO_CALIBRATION_SAMPLE_MS;
+	}
 
-		if (reg)
-		{
-			// Read angular rate field data to use for calibration offsets
-			memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-			lsm6dso_angular_rate_raw_get(&dev_ctx, raw_angular_rate_calibration.u8bit);
-		}
+	if (gyro_bias_is_calibrated(&gyroBias, lsm6dsoTemperature_degC)) {
+		Log_Debug("LSM6DSO: Calibrating angular rate complete!\n");
+		sensorInitState = SENSOR_INIT_READY;
+		return 0;
+	}
 
-		// Delay and read the device until we have data!
-		do {
-			// Read the calibration values
-			HAL_Delay(5000);
-			lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
-		} while (!reg);
+	if (calibrationSamples++ == 0) {
+		Log_Debug("LSM6DSO: Calibrating angular rate . . .\n");
+		Log_Debug("LSM6DSO: Please make sure the device is stationary.\n");
+	}
 
-		// Read the angular data rate again and verify that after applying the calibration, we have 0 angular rate in all directions
-		if (reg)
-		{
+	if (calibrationSamples >= GYRO_CALIBRATION_ATTEMPTS * GYRO_BIAS_WINDOW_SAMPLES) {
+		Log_Debug("LSM6DSO: Device not stationary, the angular rate is calibrated once it is at rest\n");
+		sensorInitState = SENSOR_INIT_READY;
+		return 0;
+	}
 
-			// Read angular rate field data
-			memset(data_raw_angular_rate.u8bit, 0x00, 3 * sizeof(int16_t));
-			lsm6dso_angular_rate_raw_get(&dev_ctx, data_raw_angular_rate.u8bit);
+	return GYRO_CALIBRATION_SAMPLE_MS;
+}
 
-			// Before we store the mdps values subtract the calibration data we captured at startup.
-			angularRateDps.x = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[0] - raw_angular_rate_calibration.i16bit[0]);
-			angularRateDps.y = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[1] - raw_angular_rate_calibration.i16bit[1]);
-			angularRateDps.z = lsm6dso_from_fs2000_to_mdps(data_raw_angular_rate.i16bit[2] - raw_angular_rate_calibration.i16bit[2]);
+/// <summary>
+///     Queues the next step of the sensor initialization state machine
+/// </summary>
+static void SensorInitHandler(EventLoopTimer* eventLoopTimer) {
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+		return;
+	}
 
+	if (!lp_submitWork(&sensorInitWork)) {
+		Log_Debug("ERROR: could not queue the sensor initialization\n");
+		if (sensorsReadyHandler != NULL) {
+			sensorsReadyHandler(false);
 		}
+	}
+}
 
-	// If the angular values after applying the offset are not all 0.0s, then do it again!
-	} while ((angularRateDps.x != 0.0) || (angularRateDps.y != 0.0) || (angularRateDps.z != 0.0));
+/// <summary>
+///     Runs one step of the sensor initialization state machine on a worker thread
+/// </summary>
+static void RunSensorInitStep(LP_WORK_ITEM* item) {
+	switch (sensorInitState) {
+	case SENSOR_INIT_CONFIGURE_LSM6DSO:
+		sensorInitDelayMs = ConfigureLsm6dso();
+		break;
+	case SENSOR_INIT_DETECT_LPS22HH:
+		sensorInitDelayMs = DetectLps22hh();
+		break;
+	case SENSOR_INIT_CONFIGURE_LPS22HH:
+		sensorInitDelayMs = ConfigureLps22hh();
+		break;
+	case SENSOR_INIT_CALIBRATE_GYRO:
+		sensorInitDelayMs = CalibrateGyro();
+		break;
+	default:
+		break;
+	}
+}
 
-	Log_Debug("LSM6DSO: Calibrating angular rate complete!\n");
+/// <summary>
+///     Schedules the next step on the event loop, or reports the sensors ready or failed
+/// </summary>
+static void SensorInitStepDone(LP_WORK_ITEM* item) {
+	switch (sensorInitState) {
+	case SENSOR_INIT_READY:
+		sensorsReady = true;
+		if (sensorsReadyHandler != NULL) {
+			sensorsReadyHandler(true);
+		}
+		break;
+	case SENSOR_INIT_FAILED:
+		if (sensorsReadyHandler != NULL) {
+			sensorsReadyHandler(false);
+		}
+		break;
+	default:
+		ScheduleSensorInit(sensorInitDelayMs);
+		break;
+	}
+}
 
-	// Init the epoll interface to periodically run the AccelTimerEventHandler routine where we read the sensors
+/// <summary>
+///     The handler is called once the sensor initialization started by initI2c completes, or failed
+/// </summary>
+void setSensorsReadyHandler(void (*handler)(bool ready)) {
+	sensorsReadyHandler = handler;
+}
 
-	//// Define the period in the build_options.h file
-	//struct timespec accelReadPeriod = { .tv_sec = ACCEL_READ_PERIOD_SECONDS,.tv_nsec = ACCEL_READ_PERIOD_NANO_SECONDS };
-	//// event handler data structures. Only the event handler field needs to be populated.
-	//static EventData accelEventData = { .eventHandler = &AccelTimerEventHandler };
-	//accelTimerFd = -1;
-	//accelTimerFd = CreateTimerFdAndAddToEpoll(epollFd, &accelReadPeriod, &accelEventData, EPOLLIN);
-	//if (accelTimerFd < 0) {
-	//	return -1;
-	//}
-	
-	return 0;
+/// <summary>
+///     True once the sensors are initialized, AvnetSkSensorUpdate must not run before. Event loop only.
+/// </summary>
+bool AvnetSkSensorsReady(void) {
+	return sensorsReady;
 }
 
 /// <summary>
@@ -392,6 +620,9 @@ void CloseFdPrintError(int fd, const char* fdName)
 ///     Closes the I2C interface File Descriptors.
 /// </summary>
 void closeI2c(void) {
+	lp_stopTimer(&sensorInitTimer);
+	lp_waitForWork(&sensorInitWork);
+	sensorsReady = false;
 	CloseFdPrintError(i2cFd, "i2c");
 }
 
@@ -532,13 +763,13 @@ static int32_t lsm6dso_write_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data,
 	lsm6dso_acceleration_raw_get(&dev_ctx, data_raw_acceleration.u8bit);
 	do
 	{
-		HAL_Delay(20);
+		HAL_Delay(1);
 		lsm6dso_xl_flag_data_ready_get(&dev_ctx, &drdy);
 	} while (!drdy);
 
 	do
 	{
-		HAL_Delay(20);
+		HAL_Delay(1);
 		lsm6dso_sh_status_get(&dev_ctx, &master_status);
 	} while (!master_status.sens_hub_endop);
 
@@ -592,12 +823,12 @@ static int32_t lsm6dso_read_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data, ui
 	/* Wait Sensor Hub operation flag set. */
 	lsm6dso_acceleration_raw_get(&dev_ctx, buf_raw);
 	do {
-		HAL_Delay(20);
+		HAL_Delay(1);
 		lsm6dso_xl_flag_data_ready_get(&dev_ctx, &drdy);
 	} while (!drdy);
 
 	do {
-		HAL_Delay(20);
+		HAL_Delay(1);
 		lsm6dso_sh_status_get(&dev_ctx, &master_status);
 	} while (!master_status.sens_hub_endop);
 
@@ -622,3 +853,30 @@ static int32_t lsm6dso_read_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data, ui
 	return ret;
 }
 
+/*
+ * @brief  Configure the sensor hub to read the LPS22HH STATUS through TEMP_OUT_H
+ *         registers into SENSOR_HUB_1..6 on every accelerometer sample
+ *
+ */
+static int32_t lsm6dso_start_lps22hh_auto_read(void)
+{
+	lsm6dso_sh_cfg_read_t sh_cfg_read;
+	int32_t ret;
+
+	/* Stop the trigger while the sensor hub is configured. */
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_OFF);
+
+	sh_cfg_read.slv_add = (LPS22HH_I2C_ADD_L & 0xFEU) >> 1; /* 7bit I2C address */
+	sh_cfg_read.slv_subadd = LPS22HH_STATUS;
+	sh_cfg_read.slv_len = LPS22HH_BURST_LEN;
+	ret = lsm6dso_sh_slv0_cfg_read(&dev_ctx, &sh_cfg_read);
+
+	// Using slave 0 only
+	lsm6dso_sh_slave_connected_set(&dev_ctx, LSM6DSO_SLV_0);
+
+	/* Leave the I2C master enabled, the accelerometer ODR paces the LPS22HH reads. */
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_ENABLE);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_12Hz5);
+
+	return ret;
+}
@@ -23,6 +23,8 @@ void lp_closeDeviceTwinSet(void) {
 }
 
 void lp_openDeviceTwin(LP_DEVICE_TWIN_BINDING* deviceTwinBinding) {
+	deviceTwinBinding->reported = false;
+
 	if (deviceTwinBinding->twinType == LP_TYPE_UNKNOWN) {
 		Log_Debug("\n\nDevice Twin '%s' missing type information.\nInclude .twinType option in LP_DEVICE_TWIN_BINDING definition.\nExample .twinType=LP_TYPE_BOOL. Valid types include LP_TYPE_BOOL, LP_TYPE_INT, LP_TYPE_FLOAT, LP_TYPE_STRING.\n\n", deviceTwinBinding->twinProperty);
 		lp_terminate(ExitCode_OpenDeviceTwin);
@@ -61,6 +63,8 @@ void lp_twinCallback(DEVICE_TWIN_UPDATE_STATE updateState, const unsigned char*
 	JSON_Value* root_value = NULL;
 	JSON_Object* root_object = NULL;
 
+	lp_azureClientActivity();
+
 	char* payLoadString = (char*)malloc(payloadSize + 1);
 	if (payLoadString == NULL) {
 		goto cleanup;
@@ -155,16 +159,81 @@ void SetDesiredState(JSON_Object* jsonObject, LP_DEVICE_TWIN_BINDING* deviceTwin
 	}
 }
 
+static time_t MonotonicSeconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+static bool StateAsNumber(LP_DEVICE_TWIN_BINDING* deviceTwinBinding, void* state, double* number) {
+	switch (deviceTwinBinding->twinType) {
+	case LP_TYPE_INT:
+		*number = *(int*)state;
+		return true;
+	case LP_TYPE_FLOAT:
+		*number = *(float*)state;
+		return true;
+	case LP_TYPE_BOOL:
+		*number = *(bool*)state ? 1.0 : 0.0;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+///     True if the state moved by at least deltaThreshold, or was silent for maxSilence seconds, since it was last reported
+/// </summary>
+static bool IsReportPending(LP_DEVICE_TWIN_BINDING* deviceTwinBinding, void* state, time_t now) {
+	double number;
+
+	if (!deviceTwinBinding->reported || deviceTwinBinding->deltaThreshold <= 0 || !StateAsNumber(deviceTwinBinding, state, &number)) {
+		return true;
+	}
+	if (deviceTwinBinding->maxSilence > 0 && now - deviceTwinBinding->lastReportedTime >= deviceTwinBinding->maxSilence) {
+		return true;
+	}
+	if (deviceTwinBinding->twinType == LP_TYPE_BOOL) {
+		return number != deviceTwinBinding->lastReported;
+	}
+	return isnan(number) != isnan(deviceTwinBinding->lastReported) || fabs(number - deviceTwinBinding->lastReported) >= deviceTwinBinding->deltaThreshold;
+}
+
+/// <summary>
+///     Updates the local copy of the state without reporting it
+/// </summary>
+static void StoreState(LP_DEVICE_TWIN_BINDING* deviceTwinBinding, void* state) {
+	switch (deviceTwinBinding->twinType) {
+	case LP_TYPE_INT:
+		*(int*)deviceTwinBinding->twinState = *(int*)state;
+		break;
+	case LP_TYPE_FLOAT:
+		*(float*)deviceTwinBinding->twinState = *(float*)state;
+		break;
+	case LP_TYPE_BOOL:
+		*(bool*)deviceTwinBinding->twinState = *(bool*)state;
+		break;
+	default:
+		break;
+	}
+}
+
 bool lp_deviceTwinReportState(LP_DEVICE_TWIN_BINDING* deviceTwinBinding, void* state) {
 	int len = 0;
 	size_t reportLen = 10; // initialize to 10 chars to allow for JSON and NULL termination. This is generous by a couple of bytes
 	bool result = false;
+	time_t now = MonotonicSeconds();
 
 	if (deviceTwinBinding == NULL) {
 		return false;
 	}
 
-	if (!lp_connectToAzureIot()) {
+	if (!IsReportPending(deviceTwinBinding, state, now)) {
+		StoreState(deviceTwinBinding, state);
+		return true;
+	}
+
+	if (!lp_isAzureClientReady()) {
 		return false;
 	}
 
@@ -215,6 +284,11 @@ bool lp_deviceTwinReportState(LP_DEVICE_TWIN_BINDING* deviceTwinBinding, void* s
 		result = DeviceTwinUpdateReportedState(reportedPropertiesString);
 	}
 
+	if (result && StateAsNumber(deviceTwinBinding, state, &deviceTwinBinding->lastReported)) {
+		deviceTwinBinding->lastReportedTime = now;
+		deviceTwinBinding->reported = true;
+	}
+
 	if (reportedPropertiesString != NULL) {
 		free(reportedPropertiesString);
 		reportedPropertiesString = NULL;
@@ -234,10 +308,9 @@ bool DeviceTwinUpdateReportedState(char* reportedPropertiesString) {
 	}
 	else {
 		Log_Debug("INFO: Reported state updated '%s'.\n", reportedPropertiesString);
+		lp_azureClientActivity();
 		return true;
 	}
-
-	IoTHubDeviceClient_LL_DoWork(lp_getAzureIotClientHandle());
 }
 
 
@@ -245,5 +318,6 @@ bool DeviceTwinUpdateReportedState(char* reportedPropertiesString) {
 ///     Callback invoked when the Device Twin reported properties are accepted by IoT Hub.
 /// </summary>
 void lp_deviceTwinsReportStatusCallback(int result, void* context) {
-	Log_Debug("INFO: Device Twin reported properties update result: HTTP status code %d\n", result);
+	LP_LOG("INFO: Device Twin reported properties update result: HTTP status code %d\n", result);
+	lp_azureClientActivity();
 }
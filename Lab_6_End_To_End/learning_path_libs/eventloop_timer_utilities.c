@@ -13,18 +13,183 @@
 #include <applibs/eventloop.h>
 
 #include "eventloop_timer_utilities.h"
+#include "handler_stats.h"
 
-static int SetTimerPeriod(int timerFd, const struct timespec *initial,
-                          const struct timespec *repeat);
+// All timers of an event loop share one timerfd and one wakeup runs every handler that is due, so
+// the event loop holds one registration and each wakeup costs one read() however many timers fire.
+//
+// A timer may expire anywhere from its deadline to its deadline plus its slack. The timers are kept
+// in a binary min-heap on that latest time and the timerfd is armed for the earliest of them, so
+// the wakeup is put off as long as every timer allows. It then runs all timers whose deadline has
+// passed, timers with overlapping windows share the wakeup. Without slack a timer fires at its
+// deadline as before.
 
-static int SetTimerPeriod(int timerFd, const struct timespec *initial,
-                          const struct timespec *repeat)
+#define NOT_QUEUED ((size_t)-1)
+
+typedef struct TimerQueue TimerQueue;
+
+struct EventLoopTimer {
+    TimerQueue *queue;
+    EventLoopTimerHandler handler;
+    struct timespec deadline; // CLOCK_MONOTONIC, earliest expiry
+    struct timespec latest;   // deadline + slack, the heap key
+    struct timespec period;   // zero for one-shot
+    struct timespec slack;
+    size_t heapIndex;         // NOT_QUEUED while disarmed
+    const char *name;
+#ifdef LP_HANDLER_STATS
+    LP_HANDLER_STATS_ENTRY *stats;
+#endif
+};
+
+struct TimerQueue {
+    EventLoop *eventLoop;
+    int fd;
+    EventRegistration *registration;
+    EventLoopTimer **heap;
+    size_t heapCount;
+    size_t heapCapacity;
+    size_t timerCount; // created and not yet disposed, armed or not
+    bool dispatching;  // handlers are running, rearm and cleanup wait until they are done
+    TimerQueue *next;
+};
+
+static TimerQueue *timerQueues = NULL;
+
+static bool IsZero(const struct timespec *ts)
 {
-    static const struct timespec nullTimeSpec = {.tv_sec = 0, .tv_nsec = 0};
-    struct itimerspec newValue = {.it_value = initial ? *initial : nullTimeSpec,
-                                  .it_interval = repeat ? *repeat : nullTimeSpec};
+    return ts == NULL || (ts->tv_sec == 0 && ts->tv_nsec == 0);
+}
+
+static int Compare(const struct timespec *a, const struct timespec *b)
+{
+    if (a->tv_sec != b->tv_sec) {
+        return a->tv_sec < b->tv_sec ? -1 : 1;
+    }
+    if (a->tv_nsec != b->tv_nsec) {
+        return a->tv_nsec < b->tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
+
+static struct timespec Add(const struct timespec *a, const struct timespec *b)
+{
+    struct timespec sum = {.tv_sec = a->tv_sec + b->tv_sec, .tv_nsec = a->tv_nsec + b->tv_nsec};
 
-    if (timerfd_settime(timerFd, /* flags */ 0, &newValue, /* old_value */ NULL) < 0) {
+    if (sum.tv_nsec >= 1000000000L) {
+        sum.tv_sec++;
+        sum.tv_nsec -= 1000000000L;
+    }
+    return sum;
+}
+
+static struct timespec Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now;
+}
+
+static void HeapSet(TimerQueue *queue, size_t index, EventLoopTimer *timer)
+{
+    queue->heap[index] = timer;
+    timer->heapIndex = index;
+}
+
+static void SiftUp(TimerQueue *queue, size_t index)
+{
+    EventLoopTimer *timer = queue->heap[index];
+
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (Compare(&queue->heap[parent]->latest, &timer->latest) <= 0) {
+            break;
+        }
+        HeapSet(queue, index, queue->heap[parent]);
+        index = parent;
+    }
+    HeapSet(queue, index, timer);
+}
+
+static void SiftDown(TimerQueue *queue, size_t index)
+{
+    EventLoopTimer *timer = queue->heap[index];
+
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= queue->heapCount) {
+            break;
+        }
+        if (child + 1 < queue->heapCount &&
+            Compare(&queue->heap[child + 1]->latest, &queue->heap[child]->latest) < 0) {
+            child++;
+        }
+        if (Compare(&timer->latest, &queue->heap[child]->latest) <= 0) {
+            break;
+        }
+        HeapSet(queue, index, queue->heap[child]);
+        index = child;
+    }
+    HeapSet(queue, index, timer);
+}
+
+static int HeapInsert(TimerQueue *queue, EventLoopTimer *timer)
+{
+    if (queue->heapCount == queue->heapCapacity) {
+        size_t capacity = queue->heapCapacity == 0 ? 8 : queue->heapCapacity * 2;
+        EventLoopTimer **heap = realloc(queue->heap, capacity * sizeof(EventLoopTimer *));
+        if (heap == NULL) {
+            return -1;
+        }
+        queue->heap = heap;
+        queue->heapCapacity = capacity;
+    }
+
+    HeapSet(queue, queue->heapCount++, timer);
+    SiftUp(queue, timer->heapIndex);
+    return 0;
+}
+
+static void HeapRemove(TimerQueue *queue, EventLoopTimer *timer)
+{
+    size_t index = timer->heapIndex;
+
+    if (index == NOT_QUEUED) {
+        return;
+    }
+    timer->heapIndex = NOT_QUEUED;
+
+    EventLoopTimer *last = queue->heap[--queue->heapCount];
+    if (last == timer) {
+        return;
+    }
+
+    // The last timer fills the hole and moves whichever way its latest expiry says
+    HeapSet(queue, index, last);
+    if (index > 0 && Compare(&last->latest, &queue->heap[(index - 1) / 2]->latest) < 0) {
+        SiftUp(queue, index);
+    } else {
+        SiftDown(queue, index);
+    }
+}
+
+/// <summary>
+/// Arms the shared timerfd for the earliest latest expiry, or disarms it when no timer is armed.
+/// </summary>
+static int ArmQueue(TimerQueue *queue)
+{
+    struct itimerspec newValue = {0};
+
+    if (queue->dispatching) {
+        return 0;
+    }
+
+    if (queue->heapCount > 0) {
+        newValue.it_value = queue->heap[0]->latest;
+    }
+
+    if (timerfd_settime(queue->fd, TFD_TIMER_ABSTIME, &newValue, /* old_value */ NULL) < 0) {
         Log_Debug("ERROR: Could not set timer period: %s (%d).\n", strerror(errno), errno);
         return -1;
     }
@@ -32,19 +197,166 @@ static int SetTimerPeriod(int timerFd, const struct timespec *initial,
     return 0;
 }
 
-struct EventLoopTimer {
-    EventLoop *eventLoop;
-    EventLoopTimerHandler handler;
-    int fd;
-    EventRegistration *registration;
-};
+static void DisposeTimerQueue(TimerQueue *queue)
+{
+    for (TimerQueue **link = &timerQueues; *link != NULL; link = &(*link)->next) {
+        if (*link == queue) {
+            *link = queue->next;
+            break;
+        }
+    }
+
+    EventLoop_UnregisterIo(queue->eventLoop, queue->registration);
+
+    if (queue->fd != -1) {
+        close(queue->fd);
+    }
+
+    free(queue->heap);
+    free(queue);
+}
+
+/// <summary>
+/// The due timer with the earliest deadline, or NULL. The heap is ordered by latest expiry, so the
+/// timers are scanned, an event loop has a handful.
+/// </summary>
+static EventLoopTimer *NextDueTimer(TimerQueue *queue, const struct timespec *now)
+{
+    EventLoopTimer *next = NULL;
+
+    for (size_t i = 0; i < queue->heapCount; i++) {
+        EventLoopTimer *timer = queue->heap[i];
+        if (Compare(&timer->deadline, now) <= 0 &&
+            (next == NULL || Compare(&timer->deadline, &next->deadline) < 0)) {
+            next = timer;
+        }
+    }
+    return next;
+}
 
 // This satisfies the EventLoopIoCallback signature.
-static void TimerCallback(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
+static void TimerQueueCallback(EventLoop *el, int fd, EventLoop_IoEvents events, void *context)
 {
-    EventLoopTimer *timer = (EventLoopTimer *)context;
+    TimerQueue *queue = (TimerQueue *)context;
+    uint64_t expirations = 0;
+
+    // EAGAIN when the timer was rearmed after it fired, the deadlines below decide what is due
+    if (read(queue->fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+        Log_Debug("ERROR: Could not read timerfd %s (%d).\n", strerror(errno), errno);
+    }
+
+    struct timespec now = Now();
+    queue->dispatching = true;
 
-    timer->handler(timer);
+    // Handlers may arm, disarm or dispose any timer. A rearmed timer is due after now, so the loop
+    // ends once the timers that were due at the wakeup have run.
+    EventLoopTimer *timer;
+    while ((timer = NextDueTimer(queue, &now)) != NULL) {
+        HeapRemove(queue, timer);
+
+#ifdef LP_HANDLER_STATS
+        // The handler may dispose the timer, keep what the record needs
+        LP_HANDLER_STATS_ENTRY *stats = timer->stats;
+        struct timespec deadline = timer->deadline;
+        struct timespec start = Now();
+#endif
+
+        if (!IsZero(&timer->period)) {
+            // Missed periods are coalesced into this one expiry, as the timerfd did. The next
+            // deadline follows the previous one, not the possibly late wakeup, so slack does not
+            // accumulate as drift.
+            timer->deadline = Add(&timer->deadline, &timer->period);
+            if (Compare(&timer->deadline, &now) <= 0) {
+                timer->deadline = Add(&now, &timer->period);
+            }
+            timer->latest = Add(&timer->deadline, &timer->slack);
+            HeapInsert(queue, timer);
+        }
+
+        timer->handler(timer);
+
+#ifdef LP_HANDLER_STATS
+        lp_handlerStatsRecord(stats, &deadline, &start);
+#endif
+    }
+
+    queue->dispatching = false;
+
+    if (queue->timerCount == 0) {
+        DisposeTimerQueue(queue);
+        return;
+    }
+
+    ArmQueue(queue);
+}
+
+static TimerQueue *GetTimerQueue(EventLoop *eventLoop)
+{
+    for (TimerQueue *queue = timerQueues; queue != NULL; queue = queue->next) {
+        if (queue->eventLoop == eventLoop) {
+            return queue;
+        }
+    }
+
+    TimerQueue *queue = calloc(1, sizeof(TimerQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    queue->eventLoop = eventLoop;
+    queue->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (queue->fd == -1) {
+        Log_Debug("ERROR: Unable to create timer: %s (%d).\n", strerror(errno), errno);
+        goto failed;
+    }
+
+    queue->registration =
+        EventLoop_RegisterIo(eventLoop, queue->fd, EventLoop_Input, TimerQueueCallback, queue);
+    if (queue->registration == NULL) {
+        Log_Debug("ERROR: Unable to register timer event: %s (%d).\n", strerror(errno), errno);
+        goto failed;
+    }
+
+    queue->next = timerQueues;
+    timerQueues = queue;
+    return queue;
+
+failed:
+    if (queue->fd != -1) {
+        close(queue->fd);
+    }
+    free(queue);
+    return NULL;
+}
+
+/// <summary>
+/// Arms the timer to expire after initial and then every repeat, a zero or NULL initial disarms it.
+/// </summary>
+static int ScheduleTimer(EventLoopTimer *timer, const struct timespec *initial,
+                         const struct timespec *repeat)
+{
+    static const struct timespec nullTimeSpec = {.tv_sec = 0, .tv_nsec = 0};
+    TimerQueue *queue = timer->queue;
+    bool wasFirst = queue->heapCount > 0 && queue->heap[0] == timer;
+
+    HeapRemove(queue, timer);
+    timer->period = repeat ? *repeat : nullTimeSpec;
+
+    if (!IsZero(initial)) {
+        struct timespec now = Now();
+        timer->deadline = Add(&now, initial);
+        timer->latest = Add(&timer->deadline, &timer->slack);
+        if (HeapInsert(queue, timer) == -1) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    // The timerfd only follows the earliest deadline
+    if (wasFirst || (queue->heapCount > 0 && queue->heap[0] == timer)) {
+        return ArmQueue(queue);
+    }
+    return 0;
 }
 
 EventLoopTimer *CreateEventLoopPeriodicTimer(EventLoop *eventLoop, EventLoopTimerHandler handler,
@@ -60,35 +372,27 @@ EventLoopTimer *CreateEventLoopPeriodicTimer(EventLoop *eventLoop, EventLoopTime
         return NULL;
     }
 
-    timer->eventLoop = eventLoop;
-    timer->handler = handler;
-
-    // Initialize to unused values in case have to clean up partially initialized object.
-    timer->fd = -1;
-    timer->registration = NULL;
-
-    timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-    if (timer->fd == -1) {
-        Log_Debug("ERROR: Unable to create timer: %s (%d).\n", strerror(errno), errno);
-        goto failed;
+    timer->queue = GetTimerQueue(eventLoop);
+    if (timer->queue == NULL) {
+        free(timer);
+        return NULL;
     }
 
-    if (SetTimerPeriod(timer->fd, /* initial */ period, /* repeat */ period) == -1) {
-        goto failed;
-    }
+    timer->handler = handler;
+    timer->slack = (struct timespec){.tv_sec = 0, .tv_nsec = 0};
+    timer->heapIndex = NOT_QUEUED;
+    timer->name = NULL;
+#ifdef LP_HANDLER_STATS
+    timer->stats = NULL; // recorded once named
+#endif
+    timer->queue->timerCount++;
 
-    timer->registration =
-        EventLoop_RegisterIo(eventLoop, timer->fd, EventLoop_Input, TimerCallback, timer);
-    if (timer->registration == NULL) {
-        Log_Debug("ERROR: Unable to register timer event: %s (%d).\n", strerror(errno), errno);
-        goto failed;
+    if (ScheduleTimer(timer, /* initial */ period, /* repeat */ period) == -1) {
+        DisposeEventLoopTimer(timer);
+        return NULL;
     }
 
     return timer;
-
-failed:
-    DisposeEventLoopTimer(timer);
-    return NULL;
 }
 
 EventLoopTimer *CreateEventLoopDisarmedTimer(EventLoop *eventLoop, EventLoopTimerHandler handler)
@@ -102,21 +406,25 @@ void DisposeEventLoopTimer(EventLoopTimer *timer)
         return;
     }
 
-    EventLoop_UnregisterIo(timer->eventLoop, timer->registration);
-
-    if (timer->fd != -1) {
-        close(timer->fd);
-    }
+    TimerQueue *queue = timer->queue;
+    bool wasFirst = queue->heapCount > 0 && queue->heap[0] == timer;
 
+    HeapRemove(queue, timer);
     free(timer);
+
+    // The last timer takes the timerfd with it, unless the dispatch loop is still running
+    if (--queue->timerCount == 0 && !queue->dispatching) {
+        DisposeTimerQueue(queue);
+    } else if (wasFirst) {
+        ArmQueue(queue);
+    }
 }
 
 int ConsumeEventLoopTimerEvent(EventLoopTimer *timer)
 {
-    uint64_t timerData = 0;
-
-    if (read(timer->fd, &timerData, sizeof(timerData)) == -1) {
-        Log_Debug("ERROR: Could not read timerfd %s (%d).\n", strerror(errno), errno);
+    // The dispatcher has read the shared timerfd before calling the handler
+    if (timer == NULL) {
+        errno = EINVAL;
         return -1;
     }
 
@@ -125,15 +433,56 @@ int ConsumeEventLoopTimerEvent(EventLoopTimer *timer)
 
 int SetEventLoopTimerPeriod(EventLoopTimer *timer, const struct timespec *period)
 {
-    return SetTimerPeriod(timer->fd, /* initial */ period, /* period */ period);
+    return ScheduleTimer(timer, /* initial */ period, /* period */ period);
 }
 
 int SetEventLoopTimerOneShot(EventLoopTimer *timer, const struct timespec *delay)
 {
-    return SetTimerPeriod(timer->fd, /* initial */ delay, /* repeat */ NULL);
+    return ScheduleTimer(timer, /* initial */ delay, /* repeat */ NULL);
+}
+
+int SetEventLoopTimerSlack(EventLoopTimer *timer, const struct timespec *slack)
+{
+    static const struct timespec nullTimeSpec = {.tv_sec = 0, .tv_nsec = 0};
+
+    if (timer == NULL || (slack != NULL && (slack->tv_sec < 0 || slack->tv_nsec < 0 ||
+                                            slack->tv_nsec >= 1000000000L))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    timer->slack = slack ? *slack : nullTimeSpec;
+
+    if (timer->heapIndex == NOT_QUEUED) {
+        return 0;
+    }
+
+    // Requeue on the new latest expiry and follow it with the timerfd
+    TimerQueue *queue = timer->queue;
+    HeapRemove(queue, timer);
+    timer->latest = Add(&timer->deadline, &timer->slack);
+    if (HeapInsert(queue, timer) == -1) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return ArmQueue(queue);
+}
+
+int SetEventLoopTimerName(EventLoopTimer *timer, const char *name)
+{
+    if (timer == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    timer->name = name;
+#ifdef LP_HANDLER_STATS
+    timer->stats = lp_handlerStats(name);
+#endif
+    return 0;
 }
 
 int DisarmEventLoopTimer(EventLoopTimer *timer)
 {
-    return SetTimerPeriod(timer->fd, /* initial */ NULL, /* repeat */ NULL);
+    return ScheduleTimer(timer, /* initial */ NULL, /* repeat */ NULL);
 }
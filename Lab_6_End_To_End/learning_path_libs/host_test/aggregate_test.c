@@ -0,0 +1,189 @@
+/* Host tests of the streaming aggregator. Tumbling and sliding windows over synthetic streams are
+   compared with a naive recomputation over the samples of the window: a two pass mean and standard
+   deviation in double, and a linear scan for min and max. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../aggregate.h"
+#include "check.h"
+
+#define STREAM_SAMPLES 1000000
+#define MAX_WINDOW 4096
+
+// float results against the double reference, relative to the spread of the window
+#define TOLERANCE 1e-5
+
+typedef struct {
+	const char *name;
+	float offset;
+	float amplitude;
+} STREAM;
+
+// a raw sensor range, then readings with a large offset and little spread, where a naive sum of
+// squares in float loses every digit
+static const STREAM streams[] = {
+	{ "uniform", 0.0f, 1000.0f },
+	{ "pressure", 1013.25f, 0.05f },
+	{ "temperature", 25.0f, 0.01f },
+};
+
+static float window[MAX_WINDOW];
+
+static float Sample(const STREAM *stream, int i)
+{
+	double noise = (double)rand() / RAND_MAX * 2 - 1;
+
+	// a slow drift plus noise, and an outlier now and then for min and max
+	if (rand() % 1000 == 0) {
+		noise *= 20;
+	}
+	return (float)(stream->offset + stream->amplitude * (noise + sin(i * 0.001)));
+}
+
+static bool MatchesReference(const LP_AGGREGATOR *aggregator, const float *samples, size_t count)
+{
+	LP_AGGREGATE aggregate;
+	double sum = 0;
+	double squares = 0;
+	float min = samples[0];
+	float max = samples[0];
+
+	for (size_t i = 0; i < count; i++) {
+		sum += samples[i];
+		min = samples[i] < min ? samples[i] : min;
+		max = samples[i] > max ? samples[i] : max;
+	}
+	double mean = sum / (double)count;
+	for (size_t i = 0; i < count; i++) {
+		squares += (samples[i] - mean) * (samples[i] - mean);
+	}
+	double stddev = sqrt(squares / (double)count);
+
+	// the spread of the window bounds the accumulated error, the float mean also rounds by up to one ulp
+	double spread = (double)(max - min);
+	double ulp = (double)nextafterf(fabsf((float)mean), INFINITY) - fabs((double)(float)mean);
+
+	if (!lp_aggregateGet(aggregator, &aggregate) || aggregate.count != count || aggregate.min != min ||
+		aggregate.max != max || aggregate.last != samples[count - 1] ||
+		fabs(aggregate.mean - mean) > TOLERANCE * spread + ulp ||
+		fabs(aggregate.stddev - stddev) > TOLERANCE * spread) {
+		fprintf(stderr, "count %u/%zu min %.9g/%.9g max %.9g/%.9g mean %.9g/%.9g stddev %.9g/%.9g\n", aggregate.count,
+				count, (double)aggregate.min, (double)min, (double)aggregate.max, (double)max, (double)aggregate.mean,
+				mean, (double)aggregate.stddev, stddev);
+		return false;
+	}
+	return true;
+}
+
+static void TestKnownValues(void)
+{
+	static const float values[] = { 2, 4, 4, 4, 5, 5, 7, 9 };
+	LP_AGGREGATOR aggregator = { .type = LP_WINDOW_TUMBLING };
+	LP_AGGREGATE aggregate;
+
+	lp_aggregateReset(&aggregator);
+	CHECK(!lp_aggregateGet(&aggregator, &aggregate));
+
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		lp_aggregateAdd(&aggregator, values[i]);
+	}
+	CHECK(lp_aggregateGet(&aggregator, &aggregate));
+	CHECK(aggregate.count == 8);
+	CHECK(aggregate.mean == 5.0f);
+	CHECK(aggregate.stddev == 2.0f);
+	CHECK(aggregate.min == 2.0f);
+	CHECK(aggregate.max == 9.0f);
+	CHECK(aggregate.last == 9.0f);
+
+	// not finite samples are left out
+	lp_aggregateAdd(&aggregator, NAN);
+	lp_aggregateAdd(&aggregator, INFINITY);
+	lp_aggregateAdd(&aggregator, -INFINITY);
+	CHECK(lp_aggregateGet(&aggregator, &aggregate));
+	CHECK(aggregate.count == 8 && aggregate.mean == 5.0f && aggregate.last == 9.0f);
+
+	// one sample, no spread
+	lp_aggregateReset(&aggregator);
+	lp_aggregateAdd(&aggregator, -3.5f);
+	CHECK(lp_aggregateGet(&aggregator, &aggregate));
+	CHECK(aggregate.count == 1 && aggregate.mean == -3.5f && aggregate.stddev == 0.0f);
+	CHECK(aggregate.min == -3.5f && aggregate.max == -3.5f);
+}
+
+// Windows of random length, reset after each one as a telemetry send does
+static void TestTumbling(const STREAM *stream)
+{
+	LP_AGGREGATOR aggregator = { .type = LP_WINDOW_TUMBLING };
+	size_t count = 0;
+	size_t length = 1;
+	int windows = 0;
+	int mismatches = 0;
+
+	lp_aggregateReset(&aggregator);
+	for (int i = 0; i < STREAM_SAMPLES && mismatches < 10; i++) {
+		window[count++] = Sample(stream, i);
+		lp_aggregateAdd(&aggregator, window[count - 1]);
+
+		if (count == length) {
+			mismatches += !MatchesReference(&aggregator, window, count);
+			lp_aggregateReset(&aggregator);
+			count = 0;
+			length = 1 + (size_t)rand() % MAX_WINDOW;
+			windows++;
+		}
+	}
+	printf("tumbling %s: %d windows, %d mismatches\n", stream->name, windows, mismatches);
+	CHECK(mismatches == 0);
+}
+
+// The aggregate of the last `length` samples after every sample, over the whole stream
+static void TestSliding(const STREAM *stream, size_t length, int checkEvery)
+{
+	static float samples[MAX_WINDOW];
+	static uint32_t minQueue[MAX_WINDOW];
+	static uint32_t maxQueue[MAX_WINDOW];
+	LP_AGGREGATOR aggregator = { .type = LP_WINDOW_SLIDING, .length = length, .samples = samples,
+								.minQueue = minQueue, .maxQueue = maxQueue };
+	int mismatches = 0;
+
+	lp_aggregateReset(&aggregator);
+	for (int i = 0; i < STREAM_SAMPLES && mismatches < 10; i++) {
+		float value = Sample(stream, i);
+
+		window[(size_t)i % length] = value;
+		lp_aggregateAdd(&aggregator, value);
+
+		if (i % checkEvery == 0 || i == STREAM_SAMPLES - 1) {
+			size_t count = (size_t)i + 1 < length ? (size_t)i + 1 : length;
+			float ordered[MAX_WINDOW];
+
+			// oldest first, so the last sample is the newest
+			for (size_t j = 0; j < count; j++) {
+				ordered[j] = window[((size_t)i + 1 - count + j) % length];
+			}
+			mismatches += !MatchesReference(&aggregator, ordered, count);
+		}
+	}
+	printf("sliding %s, length %zu: %d mismatches\n", stream->name, length, mismatches);
+	CHECK(mismatches == 0);
+}
+
+int main(void)
+{
+	srand(1);
+
+	TestKnownValues();
+
+	for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+		TestTumbling(&streams[i]);
+		TestSliding(&streams[i], 1, 1);
+		TestSliding(&streams[i], 2, 1);
+		TestSliding(&streams[i], 37, 1);
+		TestSliding(&streams[i], 60, 7);
+		TestSliding(&streams[i], MAX_WINDOW, 997);
+	}
+
+	return CheckResult("aggregate");
+}
@@ -0,0 +1,32 @@
+/* Host stand-in for the Azure Sphere applibs event loop, the subset the learning path libs use.
+   Implemented over epoll in eventloop_host.c. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct EventLoop EventLoop;
+typedef struct EventRegistration EventRegistration;
+
+typedef uint32_t EventLoop_IoEvents;
+#define EventLoop_Input 0x01u
+#define EventLoop_Output 0x04u
+#define EventLoop_Error 0x08u
+
+typedef void EventLoopIoCallback(EventLoop *el, int fd, EventLoop_IoEvents events, void *context);
+
+typedef enum {
+	EventLoop_Run_Failed = -1,
+	EventLoop_Run_FinishedEmpty = 0,
+	EventLoop_Run_Finished = 1
+} EventLoop_Run_Result;
+
+EventLoop *EventLoop_Create(void);
+void EventLoop_Close(EventLoop *el);
+EventLoop_Run_Result EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event);
+int EventLoop_Stop(EventLoop *el);
+int EventLoop_GetWaitDescriptor(EventLoop *el);
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+										EventLoopIoCallback *callback, void *context);
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg);
@@ -0,0 +1,5 @@
+/* Host stand-in for the Azure Sphere applibs GPIO, the types the learning path lib headers use. */
+
+#pragma once
+
+typedef enum { GPIO_Value_Low = 0, GPIO_Value_High = 1 } GPIO_Value;
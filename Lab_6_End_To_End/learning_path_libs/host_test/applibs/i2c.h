@@ -0,0 +1,19 @@
+/* Host stand-in for the Azure Sphere applibs I2C master, implemented over sensor register files in
+   i2c_host.c. */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef int I2C_InterfaceId;
+typedef uint32_t I2C_DeviceAddress;
+
+#define I2C_BUS_SPEED_STANDARD 100000
+
+int I2CMaster_Open(I2C_InterfaceId id);
+int I2CMaster_SetBusSpeed(int fd, uint32_t speedInHz);
+int I2CMaster_SetTimeout(int fd, uint32_t timeoutInMs);
+ssize_t I2CMaster_Write(int fd, I2C_DeviceAddress address, const uint8_t *data, size_t length);
+ssize_t I2CMaster_Read(int fd, I2C_DeviceAddress address, uint8_t *buffer, size_t maxLength);
@@ -0,0 +1,7 @@
+/* Host stand-in for the Azure Sphere applibs log. */
+
+#pragma once
+
+#include <stdio.h>
+
+#define Log_Debug(...) fprintf(stderr, __VA_ARGS__)
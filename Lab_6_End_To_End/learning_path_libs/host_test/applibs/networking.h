@@ -0,0 +1,3 @@
+/* Host stand-in for the Azure Sphere applibs networking, nothing of it is used on the host. */
+
+#pragma once
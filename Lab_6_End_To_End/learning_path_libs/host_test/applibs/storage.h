@@ -0,0 +1,6 @@
+/* Host stand-in for the Azure Sphere applibs mutable storage, backed by a file, see storage_host.h. */
+
+#pragma once
+
+int Storage_OpenMutableFile(void);
+int Storage_DeleteMutableFile(void);
@@ -0,0 +1,99 @@
+/* Host run of the boot profiler: checks the recorded phases against known sleeps, then profiles the part
+   of the Lab 6 init sequence that runs off device and fails if it goes over its time budget. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../boot_profile.h"
+#include "../timer.h"
+#include "eventloop_host.h"
+#include "check.h"
+
+// Host budgets of the Lab 6 init phases, generous for loaded CI machines
+#define EVENT_LOOP_BUDGET_MS 20.0
+#define TIMERS_BUDGET_MS 20.0
+#define INIT_BUDGET_MS 50.0
+
+static void SleepMs(long ms)
+{
+	struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L};
+	nanosleep(&ts, NULL);
+}
+
+static void TimerHandler(EventLoopTimer *eventLoopTimer)
+{
+	ConsumeEventLoopTimerEvent(eventLoopTimer);
+}
+
+// The Lab 6 timer set
+static LP_TIMER led2BlinkOffOneShotTimer = {.period = {0, 0}, .name = "led2BlinkOffOneShotTimer", .handler = TimerHandler};
+static LP_TIMER networkConnectionStatusTimer = {.period = {5, 0}, .slack = {1, 0}, .name = "networkConnectionStatusTimer", .handler = TimerHandler};
+static LP_TIMER measureSensorTimer = {.period = {10, 0}, .slack = {2, 0}, .name = "measureSensorTimer", .handler = TimerHandler};
+static LP_TIMER resetDeviceOneShotTimer = {.period = {0, 0}, .name = "resetDeviceOneShotTimer", .handler = TimerHandler};
+static LP_TIMER realTimeCoreHeatBeatTimer = {.period = {30, 0}, .slack = {5, 0}, .name = "rtCoreSend", .handler = TimerHandler};
+static LP_TIMER *timerSet[] = {&led2BlinkOffOneShotTimer, &networkConnectionStatusTimer, &resetDeviceOneShotTimer,
+							&measureSensorTimer, &realTimeCoreHeatBeatTimer};
+
+static bool Near(double measuredMs, double expectedMs)
+{
+	// nanosleep oversleeps, never undersleeps
+	return measuredMs >= expectedMs - 0.5 && measuredMs < expectedMs + 15.0;
+}
+
+int main(void)
+{
+	char json[512];
+
+	LP_BOOT_PHASE("init")
+	{
+		LP_BOOT_PHASE("eventLoop") lp_getTimerEventLoop();
+		LP_BOOT_PHASE("timers") lp_startTimerSet(timerSet, sizeof(timerSet) / sizeof(timerSet[0]));
+
+		// Stand-ins with a known duration for the phases that need the device
+		LP_BOOT_PHASE("devKit")
+		{
+			LP_BOOT_PHASE("imu") SleepMs(20);
+			LP_BOOT_PHASE("light") SleepMs(10);
+		}
+		LP_BOOT_PHASE("interCore") SleepMs(5);
+	}
+	lp_bootProfileDone();
+
+	// Phases after the end of boot are not recorded
+	LP_BOOT_PHASE("late") SleepMs(1);
+	CHECK(lp_bootPhaseMs("late") < 0);
+
+	CHECK(Near(lp_bootPhaseMs("init/devKit/imu"), 20));
+	CHECK(Near(lp_bootPhaseMs("init/devKit/light"), 10));
+	CHECK(Near(lp_bootPhaseMs("init/devKit"), 30));
+	CHECK(Near(lp_bootPhaseMs("init/interCore"), 5));
+	CHECK(lp_bootPhaseMs("init/imu") < 0);
+	CHECK(lp_bootPhaseMs("init") >= lp_bootPhaseMs("init/devKit") + lp_bootPhaseMs("init/interCore"));
+	CHECK(lp_bootProfileTotalMs() >= lp_bootPhaseMs("init"));
+
+	// Regressions in the host runnable init phases
+	double eventLoopMs = lp_bootPhaseMs("init/eventLoop");
+	double timersMs = lp_bootPhaseMs("init/timers");
+	double initMs = lp_bootPhaseMs("init") - lp_bootPhaseMs("init/devKit") - lp_bootPhaseMs("init/interCore");
+	printf("host init: event loop %.3f ms, %zu timers %.3f ms, init without stand-ins %.3f ms\n", eventLoopMs,
+		sizeof(timerSet) / sizeof(timerSet[0]), timersMs, initMs);
+	CHECK(eventLoopMs >= 0 && eventLoopMs < EVENT_LOOP_BUDGET_MS);
+	CHECK(timersMs >= 0 && timersMs < TIMERS_BUDGET_MS);
+	CHECK(initMs < INIT_BUDGET_MS);
+
+	// The telemetry message carries every phase by path
+	size_t len = lp_bootProfileToJson(json, sizeof(json));
+	printf("%s\n", json);
+	CHECK(len == strlen(json));
+	CHECK(strncmp(json, "{\"BootTimeMs\":", 14) == 0);
+	CHECK(strstr(json, "\"init/devKit/light\":") != NULL);
+	CHECK(json[len - 1] == '}' && json[len - 2] == '}');
+	CHECK(lp_bootProfileToJson(json, 40) == 0);
+
+	lp_stopTimerSet();
+	lp_stopTimerEventLoop();
+
+	return CheckResult("boot profile");
+}
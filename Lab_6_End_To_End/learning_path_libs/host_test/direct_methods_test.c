@@ -0,0 +1,187 @@
+/* Host tests of the direct method responses. Messages are escaped in place into a JSON string, JSON is sent
+   as formatted, responses that fill the buffer exactly fit and one byte more overflows, nothing is written
+   past the buffer. lp_azureDirectMethodHandler runs with bindings that set each kind of response. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../direct_methods.h"
+#include "check.h"
+
+#define GUARD_BYTES 16
+#define SENTINEL 0x5A
+
+// longer than the stack copy of the payload
+#define LONG_TEXT_BYTES (LP_DIRECT_METHOD_PAYLOAD_STACK_BYTES + 44)
+
+void lp_azureClientActivity(void)
+{
+}
+
+static char responseBuffer[LP_DIRECT_METHOD_RESPONSE_BYTES + GUARD_BYTES];
+
+static LP_DIRECT_METHOD_RESPONSE NewResponse(void)
+{
+	memset(responseBuffer, SENTINEL, sizeof(responseBuffer));
+	return (LP_DIRECT_METHOD_RESPONSE){ .buffer = responseBuffer, .size = LP_DIRECT_METHOD_RESPONSE_BYTES };
+}
+
+static bool GuardIntact(void)
+{
+	for (size_t i = LP_DIRECT_METHOD_RESPONSE_BYTES; i < sizeof(responseBuffer); i++) {
+		if (responseBuffer[i] != SENTINEL) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool Sent(const LP_DIRECT_METHOD_RESPONSE *response, const char *expected)
+{
+	return response->length == strlen(expected) && memcmp(response->buffer, expected, response->length) == 0 && !response->overflow;
+}
+
+static char *Repeat(char c, size_t count)
+{
+	static char text[LONG_TEXT_BYTES + 1];
+
+	memset(text, c, count);
+	text[count] = '\0';
+	return text;
+}
+
+static void TestMessage(void)
+{
+	LP_DIRECT_METHOD_RESPONSE response = NewResponse();
+
+	CHECK(lp_setDirectMethodMessage(&response, "Light %s", "on"));
+	CHECK(Sent(&response, "\"Light on\""));
+
+	CHECK(lp_setDirectMethodMessage(&response, "%s", ""));
+	CHECK(Sent(&response, "\"\""));
+
+	// quotes and backslashes are escaped, leading, trailing and in a row
+	CHECK(lp_setDirectMethodMessage(&response, "%s", "\"say \"\"hi\"\" to C:\\dev\\\\\""));
+	CHECK(Sent(&response, "\"\\\"say \\\"\\\"hi\\\"\\\" to C:\\\\dev\\\\\\\\\\\"\""));
+
+	// control characters become spaces
+	CHECK(lp_setDirectMethodMessage(&response, "%s", "\tline 1\nline 2\r\x01\x1f"));
+	CHECK(Sent(&response, "\" line 1 line 2   \""));
+
+	CHECK(GuardIntact());
+}
+
+static void TestJson(void)
+{
+	LP_DIRECT_METHOD_RESPONSE response = NewResponse();
+
+	CHECK(lp_setDirectMethodJson(&response, "{\"uptime\":%d,\"name\":\"%s\"}", 42, "a\\\"b"));
+	CHECK(Sent(&response, "{\"uptime\":42,\"name\":\"a\\\"b\"}"));
+
+	CHECK(GuardIntact());
+}
+
+// 128 bytes with the quotes fit, 129 overflow, whether the last byte is a character or an escape
+static void TestFit(void)
+{
+	LP_DIRECT_METHOD_RESPONSE response = NewResponse();
+	char expected[LP_DIRECT_METHOD_RESPONSE_BYTES + 1];
+
+	CHECK(lp_setDirectMethodMessage(&response, "%s", Repeat('x', LP_DIRECT_METHOD_RESPONSE_BYTES - 2)));
+	snprintf(expected, sizeof(expected), "\"%s\"", Repeat('x', LP_DIRECT_METHOD_RESPONSE_BYTES - 2));
+	CHECK(Sent(&response, expected));
+	CHECK(response.length == LP_DIRECT_METHOD_RESPONSE_BYTES);
+
+	CHECK(!lp_setDirectMethodMessage(&response, "%s", Repeat('x', LP_DIRECT_METHOD_RESPONSE_BYTES - 1)));
+	CHECK(response.overflow && response.length == 0);
+
+	// the escape of the last character takes the last byte
+	char *text = Repeat('x', LP_DIRECT_METHOD_RESPONSE_BYTES - 3);
+	text[LP_DIRECT_METHOD_RESPONSE_BYTES - 4] = '"';
+	CHECK(lp_setDirectMethodMessage(&response, "%s", text));
+	CHECK(response.length == LP_DIRECT_METHOD_RESPONSE_BYTES && !response.overflow);
+	CHECK(memcmp(&response.buffer[LP_DIRECT_METHOD_RESPONSE_BYTES - 3], "\\\"\"", 3) == 0);
+
+	text = Repeat('x', LP_DIRECT_METHOD_RESPONSE_BYTES - 2);
+	text[LP_DIRECT_METHOD_RESPONSE_BYTES - 3] = '\\';
+	CHECK(!lp_setDirectMethodMessage(&response, "%s", text));
+	CHECK(response.overflow && response.length == 0);
+
+	// JSON needs the formatting terminator, 127 bytes fit
+	CHECK(lp_setDirectMethodJson(&response, "[%s]", Repeat('1', LP_DIRECT_METHOD_RESPONSE_BYTES - 3)));
+	CHECK(response.length == LP_DIRECT_METHOD_RESPONSE_BYTES - 1 && !response.overflow);
+	CHECK(!lp_setDirectMethodJson(&response, "[%s]", Repeat('1', LP_DIRECT_METHOD_RESPONSE_BYTES - 2)));
+	CHECK(response.overflow && response.length == 0);
+
+	CHECK(GuardIntact());
+}
+
+static LP_DirectMethodResponseCode SilentHandler(JSON_Object *json, LP_DIRECT_METHOD_BINDING *binding, LP_DIRECT_METHOD_RESPONSE *response)
+{
+	return (LP_DirectMethodResponseCode)(int)json_object_get_number(json, "result");
+}
+
+static LP_DirectMethodResponseCode EchoHandler(JSON_Object *json, LP_DIRECT_METHOD_BINDING *binding, LP_DIRECT_METHOD_RESPONSE *response)
+{
+	const char *text = json_object_get_string(json, "text");
+
+	lp_setDirectMethodMessage(response, "%s", text != NULL ? text : "");
+	return LP_METHOD_SUCCEEDED;
+}
+
+static LP_DIRECT_METHOD_BINDING silentMethod = { .methodName = "Silent", .handler = SilentHandler };
+static LP_DIRECT_METHOD_BINDING echoMethod = { .methodName = "Echo", .handler = EchoHandler };
+static LP_DIRECT_METHOD_BINDING longEchoMethod = { .methodName = "LongEcho", .handler = EchoHandler, .responseBytes = 512 };
+
+static LP_DIRECT_METHOD_BINDING *directMethodSet[] = { &silentMethod, &echoMethod, &longEchoMethod };
+
+// Calls the method with the payload, true if it returns result with the response
+static bool Calls(const char *method, const char *payload, int result, const char *expected)
+{
+	unsigned char *response = NULL;
+	size_t responseSize = 0;
+	int status = lp_azureDirectMethodHandler(method, (const unsigned char *)payload, strlen(payload), &response, &responseSize, NULL);
+	bool ok = status == result && responseSize == strlen(expected) && memcmp(response, expected, responseSize) == 0;
+
+	if (!ok) {
+		fprintf(stderr, "%s %s: %d '%.*s', expected %d '%s'\n", method, payload, status, (int)responseSize,
+			response != NULL ? (const char *)response : "", result, expected);
+	}
+	free(response);
+	return ok;
+}
+
+static void TestHandler(void)
+{
+	char payload[LONG_TEXT_BYTES + 16];
+	char expected[LONG_TEXT_BYTES + 3];
+
+	lp_openDirectMethodSet(directMethodSet, sizeof(directMethodSet) / sizeof(directMethodSet[0]));
+
+	CHECK(Calls("Silent", "{\"result\":200}", LP_METHOD_SUCCEEDED, "\"Method Succeeded\""));
+	CHECK(Calls("Silent", "{\"result\":500}", LP_METHOD_FAILED, "\"Method Error\""));
+	CHECK(Calls("Missing", "{}", LP_METHOD_NOT_FOUND, "\"Method not found\""));
+	CHECK(Calls("Echo", "{", LP_METHOD_FAILED, "\"Invalid JSON\""));
+	CHECK(Calls("Echo", "[1]", LP_METHOD_FAILED, "\"Invalid JSON\""));
+	CHECK(Calls("Echo", "{\"text\":\"a \\\"b\\\"\"}", LP_METHOD_SUCCEEDED, "\"a \\\"b\\\"\""));
+
+	// a payload longer than the stack copy, a response longer than the default buffer
+	snprintf(payload, sizeof(payload), "{\"text\":\"%s\"}", Repeat('y', LONG_TEXT_BYTES));
+	CHECK(Calls("Echo", payload, LP_METHOD_FAILED, "\"Response too large\""));
+	snprintf(expected, sizeof(expected), "\"%s\"", Repeat('y', LONG_TEXT_BYTES));
+	CHECK(Calls("LongEcho", payload, LP_METHOD_SUCCEEDED, expected));
+
+	lp_closeDirectMethodSet();
+	CHECK(Calls("Echo", "{}", LP_METHOD_NOT_FOUND, "\"Method not found\""));
+}
+
+int main(void)
+{
+	TestMessage();
+	TestJson();
+	TestFit();
+	TestHandler();
+
+	return CheckResult("direct method");
+}
@@ -0,0 +1,129 @@
+/* Host implementation of the applibs event loop over epoll, enough to run the learning path libs
+   timers and I/O handlers off device. */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include <applibs/eventloop.h>
+
+#include "eventloop_host.h"
+
+struct EventLoop {
+	int epollFd;
+	bool stopped;
+};
+
+struct EventRegistration {
+	int fd;
+	EventLoopIoCallback *callback;
+	void *context;
+};
+
+unsigned long eventLoopHostWakeups = 0;
+
+EventLoop *EventLoop_Create(void)
+{
+	EventLoop *el = calloc(1, sizeof(EventLoop));
+	if (el == NULL) {
+		return NULL;
+	}
+
+	el->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (el->epollFd == -1) {
+		free(el);
+		return NULL;
+	}
+
+	return el;
+}
+
+void EventLoop_Close(EventLoop *el)
+{
+	if (el == NULL) {
+		return;
+	}
+
+	close(el->epollFd);
+	free(el);
+}
+
+EventLoop_Run_Result EventLoop_Run(EventLoop *el, int duration_in_milliseconds, bool process_one_event)
+{
+	struct epoll_event event;
+
+	el->stopped = false;
+
+	// One event per epoll_wait, a callback may unregister any registration
+	do {
+		int count = epoll_wait(el->epollFd, &event, 1, duration_in_milliseconds);
+		if (count == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return EventLoop_Run_Failed;
+		}
+		if (count == 0) {
+			return EventLoop_Run_FinishedEmpty;
+		}
+
+		eventLoopHostWakeups++;
+
+		EventRegistration *reg = event.data.ptr;
+		EventLoop_IoEvents ioEvents = (event.events & EPOLLIN ? EventLoop_Input : 0) |
+									(event.events & EPOLLOUT ? EventLoop_Output : 0) |
+									(event.events & EPOLLERR ? EventLoop_Error : 0);
+
+		// The callback may unregister itself, it is the last use of reg
+		reg->callback(el, reg->fd, ioEvents, reg->context);
+	} while (!process_one_event && !el->stopped);
+
+	return EventLoop_Run_Finished;
+}
+
+int EventLoop_Stop(EventLoop *el)
+{
+	el->stopped = true;
+	return 0;
+}
+
+int EventLoop_GetWaitDescriptor(EventLoop *el)
+{
+	return el->epollFd;
+}
+
+EventRegistration *EventLoop_RegisterIo(EventLoop *el, int fd, EventLoop_IoEvents eventBitmask,
+										EventLoopIoCallback *callback, void *context)
+{
+	EventRegistration *reg = malloc(sizeof(EventRegistration));
+	if (reg == NULL) {
+		return NULL;
+	}
+
+	reg->fd = fd;
+	reg->callback = callback;
+	reg->context = context;
+
+	struct epoll_event event = {
+		.events = (eventBitmask & EventLoop_Input ? EPOLLIN : 0u) | (eventBitmask & EventLoop_Output ? EPOLLOUT : 0u),
+		.data.ptr = reg};
+
+	if (epoll_ctl(el->epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+		free(reg);
+		return NULL;
+	}
+
+	return reg;
+}
+
+int EventLoop_UnregisterIo(EventLoop *el, EventRegistration *reg)
+{
+	if (reg == NULL) {
+		return -1;
+	}
+
+	int result = epoll_ctl(el->epollFd, EPOLL_CTL_DEL, reg->fd, NULL);
+	free(reg);
+	return result;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Number of epoll wakeups that dispatched an event, for tests that count wakeups
+extern unsigned long eventLoopHostWakeups;
@@ -0,0 +1,83 @@
+/* Host tests of the handler stats: a handler that blocks the loop shows in its own run time and in the lateness
+   of a fast timer queued behind it, and the JSON snapshot. Built with LP_HANDLER_STATS. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../handler_stats.h"
+#include "../timer.h"
+#include "eventloop_host.h"
+#include "check.h"
+
+static double NowMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+#define HOG_MS 30
+
+static void HogHandler(EventLoopTimer *t)
+{
+	ConsumeEventLoopTimerEvent(t);
+	double start = NowMs();
+	while (NowMs() - start < HOG_MS) {
+	}
+}
+
+static void FastHandler(EventLoopTimer *t)
+{
+	ConsumeEventLoopTimerEvent(t);
+}
+
+static LP_TIMER hogTimer = {.name = "hog", .period = {0, 100 * 1000 * 1000}, .handler = HogHandler};
+static LP_TIMER fastTimer = {.name = "fast", .period = {0, 10 * 1000 * 1000}, .handler = FastHandler};
+
+int main(void)
+{
+	char json[1024];
+
+	lp_getTimerEventLoop();
+	CHECK(lp_startTimer(&hogTimer));
+	CHECK(lp_startTimer(&fastTimer));
+
+	double start = NowMs();
+	while (NowMs() - start < 1000) {
+		EventLoop_Run(lp_getTimerEventLoop(), 10, true);
+	}
+
+	LP_HANDLER_STATS_ENTRY *hog = lp_handlerStats("hog");
+	LP_HANDLER_STATS_ENTRY *fast = lp_handlerStats("fast");
+
+	printf("hog:  %u calls, run mean %.2f max %.2f ms\n", hog->run.count, hog->run.totalMs / hog->run.count, hog->run.maxMs);
+	printf("fast: %u calls, run max %.3f ms, late mean %.2f max %.2f ms\n", fast->run.count, fast->run.maxMs,
+		fast->late.totalMs / fast->late.count, fast->late.maxMs);
+
+	CHECK(hog->run.count >= 8 && hog->run.count <= 11);
+	CHECK(hog->run.buckets[3] == hog->run.count);   // 10 to 100 ms
+	CHECK(hog->run.maxMs >= HOG_MS);
+	CHECK(fast->run.count > 40 && fast->run.buckets[0] + fast->run.buckets[1] == fast->run.count);
+	CHECK(fast->late.count == fast->run.count);
+	// Queued behind the hog: late by up to its run time
+	CHECK(fast->late.maxMs >= HOG_MS / 2 && fast->late.maxMs < HOG_MS + 20);
+
+	size_t len = lp_handlerStatsToJson(json, sizeof(json));
+	printf("%s\n", json);
+	CHECK(len > 0 && len == strlen(json));
+	CHECK(strncmp(json, "{\"HandlerStatsWindowS\":", 23) == 0);
+	CHECK(strstr(json, "\"hog\":{\"n\":") != NULL && strstr(json, "\"fast\":{\"n\":") != NULL);
+	CHECK(strstr(json, "\"lateMs\":[") != NULL && json[len - 1] == '}' && json[len - 2] == '}');
+	CHECK(lp_handlerStatsToJson(json, 40) == 0 && json[0] == '\0');
+
+	lp_handlerStatsReset();
+	CHECK(hog->run.count == 0 && fast->late.count == 0 && lp_handlerStats("hog") == hog);
+
+	lp_stopTimer(&hogTimer);
+	lp_stopTimer(&fastTimer);
+	lp_stopTimerEventLoop();
+
+	return CheckResult("handler stats");
+}
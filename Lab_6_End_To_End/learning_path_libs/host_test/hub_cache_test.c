@@ -0,0 +1,125 @@
+/* Host tests of the IoT Hub cache policy. Each step stands for what the IoT client reports to
+   azure_iot.c and the calls it makes on the cache in response. */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../hub_cache.h"
+#include "storage_host.h"
+#include "check.h"
+
+#define SCOPE_ID "0ne000BDC00"
+#define HUB "iotc-088280bc-3305-4cba-885e-6573fc4cf701.azure-devices.net"
+#define OTHER_HUB "iotc-2.azure-devices.net"
+
+// 128 hex digits like an Azure Sphere device id
+static char deviceId[129];
+
+static bool Cached(const char *scopeId, const char *hostname)
+{
+	LP_HUB_CACHE_ENTRY entry;
+
+	if (!lp_hubCacheLoad(scopeId, &entry)) {
+		return false;
+	}
+	return strcmp(entry.hostname, hostname) == 0 && strcmp(entry.deviceId, deviceId) == 0;
+}
+
+// DPS assigned hostname and the client authenticated with it
+static void ProvisionedAndAuthenticated(const char *hostname)
+{
+	CHECK(lp_hubCacheStore(SCOPE_ID, hostname, deviceId));
+}
+
+static int FileByteAt(off_t offset)
+{
+	unsigned char byte = 0;
+	int fd = open(storageHostPath, O_RDONLY);
+
+	if (fd < 0 || pread(fd, &byte, 1, offset) != 1) {
+		byte = 0xFF;
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+	return byte;
+}
+
+int main(void)
+{
+	char path[] = "/tmp/hub_cache_testXXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	close(fd);
+	storageHostPath = path;
+
+	for (size_t i = 0; i < sizeof(deviceId) - 1; i++) {
+		deviceId[i] = "0123456789abcdef"[i % 16];
+	}
+
+	// The start of the file belongs to the gyro bias table and is left alone
+	fd = open(path, O_RDWR);
+	CHECK(write(fd, "GBS1", 4) == 4);
+	close(fd);
+
+	// First boot, nothing cached: provision
+	CHECK(!Cached(SCOPE_ID, HUB));
+
+	ProvisionedAndAuthenticated(HUB);
+	CHECK(Cached(SCOPE_ID, HUB));
+	CHECK(FileByteAt(0) == 'G');
+
+	// Another ID scope, for example the device was moved to another application: provision
+	CHECK(!Cached("0ne000AAA00", HUB));
+
+	// Transient failures with the cached hub, then it authenticates: the count starts over
+	lp_hubCacheConnectFailed();
+	lp_hubCacheConnectFailed();
+	CHECK(Cached(SCOPE_ID, HUB));
+	lp_hubCacheConnected();
+	lp_hubCacheConnectFailed();
+	lp_hubCacheConnectFailed();
+	CHECK(Cached(SCOPE_ID, HUB));
+
+	// LP_HUB_CACHE_MAX_FAILURES in a row drop it
+	lp_hubCacheConnectFailed();
+	CHECK(!Cached(SCOPE_ID, HUB));
+
+	// Failures without an entry do nothing
+	lp_hubCacheConnectFailed();
+	lp_hubCacheConnected();
+	CHECK(!Cached(SCOPE_ID, HUB));
+
+	// Credentials rejected, the device was reassigned: provision and cache the new hub
+	ProvisionedAndAuthenticated(HUB);
+	lp_hubCacheInvalidate();
+	CHECK(!Cached(SCOPE_ID, HUB));
+	ProvisionedAndAuthenticated(OTHER_HUB);
+	CHECK(Cached(SCOPE_ID, OTHER_HUB));
+
+	// A corrupted entry is not used
+	fd = open(path, O_RDWR);
+	CHECK(pwrite(fd, "X", 1, LP_HUB_CACHE_FILE_OFFSET + 40) == 1);
+	close(fd);
+	CHECK(!Cached(SCOPE_ID, OTHER_HUB));
+
+	// Values that do not fit are not stored
+	char longHostname[LP_HUB_CACHE_HOSTNAME_SIZE + 1];
+	memset(longHostname, 'h', sizeof(longHostname) - 1);
+	longHostname[sizeof(longHostname) - 1] = '\0';
+	CHECK(!lp_hubCacheStore(SCOPE_ID, longHostname, deviceId));
+
+	// The entry survives a restart, it lives in the file only
+	ProvisionedAndAuthenticated(HUB);
+	CHECK(Cached(SCOPE_ID, HUB));
+	CHECK(FileByteAt(0) == 'G');
+
+	unlink(path);
+
+	return CheckResult("hub cache");
+}
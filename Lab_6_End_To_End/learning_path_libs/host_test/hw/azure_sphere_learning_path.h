@@ -0,0 +1,5 @@
+/* Host stand-in for the AVNET Starter Kit hardware definition, the I2C interface of the on-board sensors. */
+
+#pragma once
+
+#define AVNET_MT3620_SK_ISU2_I2C 2
@@ -0,0 +1,257 @@
+/* Host implementation of the applibs I2C master over register files of the LSM6DSO and the LPS22HH on its
+   sensor hub, see i2c_host.h. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <applibs/i2c.h>
+
+#include "../AVNET/lps22hh_reg.h"
+#include "../AVNET/lsm6dso_reg.h"
+#include "i2c_host.h"
+
+#define LSM6DSO_I2C_ADDRESS 0x6A
+#define LPS22HH_HUB_ADDRESS (LPS22HH_I2C_ADD_L >> 1)
+
+#define STATUS_XLDA 0x01
+#define STATUS_GDA 0x02
+#define STATUS_TDA 0x04
+#define MASTER_ON 0x04
+#define SENS_HUB_ENDOP 0x01
+#define SLAVE0_NACK 0x08
+#define CTRL3_C_SW_RESET 0x01
+#define CTRL3_C_IF_INC 0x04
+#define LPS22HH_SWRESET 0x04
+#define LPS22HH_IF_ADD_INC 0x10
+
+uint8_t lsm6dsoRegisters[256];
+uint8_t lsm6dsoHubRegisters[256];
+uint8_t lps22hhRegisters[256];
+
+bool lsm6dsoPresent;
+bool lps22hhPresent;
+bool i2cHostSampling;
+
+I2C_HOST_TRANSFER i2cHostTransfers[I2C_HOST_MAX_TRANSFERS];
+size_t i2cHostTransferCount;
+
+unsigned long i2cHostSamples;
+unsigned long i2cHostHubReads;
+unsigned long i2cHostHubWrites;
+unsigned long i2cHostHubNacks;
+unsigned long i2cHostLps22hhIdReads;
+unsigned long i2cHostCallerThreadTransfers;
+
+static uint8_t lsm6dsoAddress;     // register address pointer
+static pthread_t callerThread;
+
+static void Lsm6dsoReset(void)
+{
+	// the output registers keep their last sample
+	for (int reg = 0; reg < 256; reg++) {
+		if (reg < LSM6DSO_OUT_TEMP_L || reg > LSM6DSO_OUTZ_H_A) {
+			lsm6dsoRegisters[reg] = 0;
+		}
+	}
+	lsm6dsoRegisters[LSM6DSO_WHO_AM_I] = LSM6DSO_ID;
+	lsm6dsoRegisters[LSM6DSO_CTRL3_C] = CTRL3_C_IF_INC;
+}
+
+static void Lps22hhReset(void)
+{
+	for (int reg = 0; reg < 256; reg++) {
+		if (reg < LPS22HH_STATUS || reg > LPS22HH_TEMP_OUT_H) {
+			lps22hhRegisters[reg] = 0;
+		}
+	}
+	lps22hhRegisters[LPS22HH_WHO_AM_I] = LPS22HH_ID;
+	lps22hhRegisters[LPS22HH_CTRL_REG2] = LPS22HH_IF_ADD_INC;
+}
+
+void i2cHostPowerOn(void)
+{
+	memset(lsm6dsoRegisters, 0, sizeof(lsm6dsoRegisters));
+	memset(lsm6dsoHubRegisters, 0, sizeof(lsm6dsoHubRegisters));
+	memset(lps22hhRegisters, 0, sizeof(lps22hhRegisters));
+	Lsm6dsoReset();
+	Lps22hhReset();
+
+	lsm6dsoPresent = true;
+	lps22hhPresent = true;
+	i2cHostSampling = true;
+	lsm6dsoAddress = 0;
+
+	i2cHostTransferCount = 0;
+	i2cHostSamples = 0;
+	i2cHostHubReads = 0;
+	i2cHostHubWrites = 0;
+	i2cHostHubNacks = 0;
+	i2cHostLps22hhIdReads = 0;
+	i2cHostCallerThreadTransfers = 0;
+	callerThread = pthread_self();
+}
+
+void i2cHostSetImuOutputs(int16_t temperature, const int16_t angularRate[3], const int16_t acceleration[3])
+{
+	memcpy(&lsm6dsoRegisters[LSM6DSO_OUT_TEMP_L], &temperature, sizeof(temperature));
+	memcpy(&lsm6dsoRegisters[LSM6DSO_OUTX_L_G], angularRate, 3 * sizeof(int16_t));
+	memcpy(&lsm6dsoRegisters[LSM6DSO_OUTX_L_A], acceleration, 3 * sizeof(int16_t));
+}
+
+void i2cHostSetPressureOutputs(int32_t pressure, int16_t temperature)
+{
+	lps22hhRegisters[LPS22HH_STATUS] = 0x03;   // P_DA, T_DA
+	lps22hhRegisters[LPS22HH_PRESS_OUT_XL] = (uint8_t)pressure;
+	lps22hhRegisters[LPS22HH_PRESS_OUT_XL + 1] = (uint8_t)(pressure >> 8);
+	lps22hhRegisters[LPS22HH_PRESS_OUT_XL + 2] = (uint8_t)(pressure >> 16);
+	memcpy(&lps22hhRegisters[LPS22HH_TEMP_OUT_L], &temperature, sizeof(temperature));
+}
+
+static void Lps22hhWrite(uint8_t reg, uint8_t value)
+{
+	if (reg == LPS22HH_CTRL_REG2 && (value & LPS22HH_SWRESET)) {
+		Lps22hhReset();
+		return;
+	}
+	lps22hhRegisters[reg] = value;
+}
+
+// The slave 0 operation the sensor hub runs at the end of an accelerometer sample
+static void RunSensorHub(void)
+{
+	uint8_t slave = lsm6dsoHubRegisters[LSM6DSO_SLV0_ADD] >> 1;
+	bool read = lsm6dsoHubRegisters[LSM6DSO_SLV0_ADD] & 1;
+	uint8_t subAddress = lsm6dsoHubRegisters[LSM6DSO_SLV0_SUBADD];
+	int length = lsm6dsoHubRegisters[LSM6DSO_SLV0_CONFIG] & 0x07;
+	uint8_t status = SENS_HUB_ENDOP;
+
+	if (!lps22hhPresent || slave != LPS22HH_HUB_ADDRESS) {
+		status |= SLAVE0_NACK;
+		i2cHostHubNacks++;
+	} else if (read) {
+		bool increment = lps22hhRegisters[LPS22HH_CTRL_REG2] & LPS22HH_IF_ADD_INC;
+		for (int i = 0; i < length; i++) {
+			lsm6dsoHubRegisters[LSM6DSO_SENSOR_HUB_1 + i] = lps22hhRegisters[(uint8_t)(subAddress + (increment ? i : 0))];
+		}
+		i2cHostHubReads++;
+		i2cHostLps22hhIdReads += subAddress == LPS22HH_WHO_AM_I;
+	} else {
+		Lps22hhWrite(subAddress, lsm6dsoHubRegisters[LSM6DSO_DATAWRITE_SLV0]);
+		i2cHostHubWrites++;
+	}
+
+	lsm6dsoHubRegisters[LSM6DSO_STATUS_MASTER] = status;
+	lsm6dsoRegisters[LSM6DSO_STATUS_MASTER_MAINPAGE] = status;
+}
+
+static void Sample(void)
+{
+	if (!i2cHostSampling || (lsm6dsoRegisters[LSM6DSO_CTRL1_XL] >> 4) == 0) {
+		lsm6dsoRegisters[LSM6DSO_STATUS_REG] = 0;
+		return;
+	}
+
+	i2cHostSamples++;
+	lsm6dsoRegisters[LSM6DSO_STATUS_REG] = STATUS_XLDA | STATUS_TDA | ((lsm6dsoRegisters[LSM6DSO_CTRL2_G] >> 4) != 0 ? STATUS_GDA : 0);
+
+	if (lsm6dsoHubRegisters[LSM6DSO_MASTER_CONFIG] & MASTER_ON) {
+		RunSensorHub();
+	}
+}
+
+static int Bank(void)
+{
+	return (lsm6dsoRegisters[LSM6DSO_FUNC_CFG_ACCESS] >> 6) & 0x03;
+}
+
+// FUNC_CFG_ACCESS is mapped in every bank
+static uint8_t *Register(uint8_t reg)
+{
+	if (reg == LSM6DSO_FUNC_CFG_ACCESS || Bank() == 0) {
+		return &lsm6dsoRegisters[reg];
+	}
+	return &lsm6dsoHubRegisters[reg];
+}
+
+static void LogTransfer(bool write, uint8_t reg, size_t len)
+{
+	if (i2cHostTransferCount < I2C_HOST_MAX_TRANSFERS) {
+		i2cHostTransfers[i2cHostTransferCount++] = (I2C_HOST_TRANSFER){ .write = write, .bank = Bank(), .reg = reg, .len = len };
+	}
+}
+
+static bool Answers(I2C_DeviceAddress address)
+{
+	if (pthread_equal(pthread_self(), callerThread)) {
+		i2cHostCallerThreadTransfers++;
+	}
+	if (address != LSM6DSO_I2C_ADDRESS || !lsm6dsoPresent) {
+		errno = ENXIO;
+		return false;
+	}
+	return true;
+}
+
+int I2CMaster_Open(I2C_InterfaceId id)
+{
+	return open("/dev/null", O_RDWR | O_CLOEXEC);
+}
+
+int I2CMaster_SetBusSpeed(int fd, uint32_t speedInHz)
+{
+	return 0;
+}
+
+int I2CMaster_SetTimeout(int fd, uint32_t timeoutInMs)
+{
+	return 0;
+}
+
+ssize_t I2CMaster_Write(int fd, I2C_DeviceAddress address, const uint8_t *data, size_t length)
+{
+	if (!Answers(address) || length == 0) {
+		return -1;
+	}
+
+	lsm6dsoAddress = data[0];
+	if (length > 1) {
+		LogTransfer(true, lsm6dsoAddress, length - 1);
+	}
+
+	for (size_t i = 1; i < length; i++) {
+		uint8_t reg = lsm6dsoAddress;
+
+		if (reg == LSM6DSO_CTRL3_C && Bank() == 0 && (data[i] & CTRL3_C_SW_RESET)) {
+			Lsm6dsoReset();
+		} else {
+			*Register(reg) = data[i];
+		}
+		if (lsm6dsoRegisters[LSM6DSO_CTRL3_C] & CTRL3_C_IF_INC) {
+			lsm6dsoAddress++;
+		}
+	}
+	return (ssize_t)length;
+}
+
+ssize_t I2CMaster_Read(int fd, I2C_DeviceAddress address, uint8_t *buffer, size_t maxLength)
+{
+	if (!Answers(address)) {
+		return -1;
+	}
+
+	LogTransfer(false, lsm6dsoAddress, maxLength);
+
+	for (size_t i = 0; i < maxLength; i++) {
+		if (lsm6dsoAddress == LSM6DSO_STATUS_REG && Bank() == 0) {
+			Sample();
+		}
+		buffer[i] = *Register(lsm6dsoAddress);
+		if (lsm6dsoRegisters[LSM6DSO_CTRL3_C] & CTRL3_C_IF_INC) {
+			lsm6dsoAddress++;
+		}
+	}
+	return (ssize_t)maxLength;
+}
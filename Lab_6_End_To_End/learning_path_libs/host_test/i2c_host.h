@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Register files of the AVNET Starter Kit sensors behind the host applibs I2C master. The LSM6DSO answers at
+// 0x6A, the LPS22HH is only reachable through the LSM6DSO sensor hub, which runs its slave 0 operation on
+// every accelerometer sample. A sample is taken whenever STATUS_REG is read with the accelerometer on.
+
+#define I2C_HOST_MAX_TRANSFERS 4096
+
+typedef struct {
+	bool write;
+	int bank;           // LSM6DSO register bank, 0 user, 1 sensor hub
+	uint8_t reg;        // first register
+	size_t len;         // data bytes, register auto-increment
+} I2C_HOST_TRANSFER;
+
+extern uint8_t lsm6dsoRegisters[256];       // user bank
+extern uint8_t lsm6dsoHubRegisters[256];    // sensor hub bank
+extern uint8_t lps22hhRegisters[256];
+
+extern bool lsm6dsoPresent;
+extern bool lps22hhPresent;
+extern bool i2cHostSampling;                // false, STATUS_REG reads no new data
+
+// LSM6DSO data transfers, the register address writes that start a read are not logged
+extern I2C_HOST_TRANSFER i2cHostTransfers[I2C_HOST_MAX_TRANSFERS];
+extern size_t i2cHostTransferCount;
+
+extern unsigned long i2cHostSamples;
+extern unsigned long i2cHostHubReads;           // slave 0 reads of the LPS22HH
+extern unsigned long i2cHostHubWrites;          // slave 0 writes to the LPS22HH
+extern unsigned long i2cHostHubNacks;           // slave 0 operations nobody answered
+extern unsigned long i2cHostLps22hhIdReads;     // slave 0 reads starting at the LPS22HH WHO_AM_I
+extern unsigned long i2cHostCallerThreadTransfers;  // transfers on the thread that called i2cHostPowerOn
+
+// Power on register values, both devices present, logs and counters cleared
+void i2cHostPowerOn(void);
+
+// Output registers with new data flags
+void i2cHostSetImuOutputs(int16_t temperature, const int16_t angularRate[3], const int16_t acceleration[3]);
+void i2cHostSetPressureOutputs(int32_t pressure, int16_t temperature);
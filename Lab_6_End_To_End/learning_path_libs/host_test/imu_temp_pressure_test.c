@@ -0,0 +1,243 @@
+/* Host tests of the AVNET Starter Kit sensor driver over register files of the LSM6DSO and the LPS22HH,
+   i2c_host.c. Covers the initialization state machine, the sensor hub slave 0 auto-read of the LPS22HH
+   and the burst reads of both sensors. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../AVNET/imu_temp_pressure.h"
+#include "eventloop_host.h"
+#include "i2c_host.h"
+#include "storage_host.h"
+#include "check.h"
+
+#define NEAR(a, b, tolerance) (fabs((double)(a) - (double)(b)) <= (tolerance))
+
+// STATUS_REG through OUTZ_H_A, and the LPS22HH STATUS through TEMP_OUT_H
+#define IMU_BURST_LEN (LSM6DSO_OUTZ_H_A - LSM6DSO_STATUS_REG + 1)
+#define PRESSURE_BURST_LEN (LPS22HH_TEMP_OUT_H - LPS22HH_STATUS + 1)
+
+#define INIT_TIMEOUT_MS 10000
+
+// At rest: 1 g on z at 4 g full scale, a gyro zero rate offset, 25 degC
+static const int16_t restAcceleration[3] = { 0, 0, 8197 };
+static const int16_t gyroOffset[3] = { 15, -10, 5 };
+
+// 1013.25 hPa, 21.5 degC
+#define PRESSURE_LSB 4150272
+#define PRESSURE_TEMPERATURE_LSB 2150
+
+void lp_terminate(int exitCode)
+{
+	fprintf(stderr, "lp_terminate(%d)\n", exitCode);
+	failures++;
+}
+
+static double NowMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+static int readyCalls;
+static bool readyResult;
+
+static void SensorsReady(bool ready)
+{
+	readyCalls++;
+	readyResult = ready;
+}
+
+// Starts the initialization and runs the event loop until it reports, returns the time it took
+static double InitSensors(void)
+{
+	double start = NowMs();
+
+	readyCalls = 0;
+	CHECK(initI2c() == 0);
+	while (readyCalls == 0 && NowMs() - start < INIT_TIMEOUT_MS) {
+		EventLoop_Run(lp_getTimerEventLoop(), 10, true);
+	}
+	CHECK(readyCalls == 1);
+	return NowMs() - start;
+}
+
+static float RateDps(int16_t lsb)
+{
+	return lsm6dso_from_fs2000_to_mdps(lsb) / 1000.0f;
+}
+
+static void TestLsm6dsoMissing(void)
+{
+	i2cHostPowerOn();
+	lsm6dsoPresent = false;
+
+	InitSensors();
+	CHECK(!readyResult);
+	CHECK(!AvnetSkSensorsReady());
+	CHECK(!AvnetSkSensorUpdate());
+
+	closeI2c();
+}
+
+// LSM6DSO and LPS22HH present, no stored gyro calibration, the device is at rest
+static void TestInitAndCalibrate(void)
+{
+	struct stat storage;
+
+	unlink(storageHostPath);
+	i2cHostPowerOn();
+	i2cHostSetImuOutputs(0, gyroOffset, restAcceleration);
+	i2cHostSetPressureOutputs(PRESSURE_LSB, PRESSURE_TEMPERATURE_LSB);
+
+	double elapsedMs = InitSensors();
+	printf("init with calibration from a stationary window took %.0f ms\n", elapsedMs);
+	CHECK(readyResult);
+	CHECK(AvnetSkSensorsReady());
+
+	// every step ran on a worker thread
+	CHECK(i2cHostCallerThreadTransfers == 0);
+
+	// LSM6DSO configuration: 12.5 Hz, 4 g, 2000 dps, block data update, back on the user bank
+	CHECK(lsm6dsoRegisters[LSM6DSO_CTRL1_XL] >> 4 == LSM6DSO_XL_ODR_12Hz5);
+	CHECK((lsm6dsoRegisters[LSM6DSO_CTRL1_XL] >> 2 & 0x03) == LSM6DSO_4g);
+	CHECK(lsm6dsoRegisters[LSM6DSO_CTRL2_G] >> 4 == LSM6DSO_GY_ODR_12Hz5);
+	CHECK((lsm6dsoRegisters[LSM6DSO_CTRL2_G] >> 1 & 0x07) == LSM6DSO_2000dps);
+	CHECK(lsm6dsoRegisters[LSM6DSO_CTRL3_C] & 0x40);
+	CHECK((lsm6dsoRegisters[LSM6DSO_FUNC_CFG_ACCESS] & 0xC0) == 0);
+
+	// LPS22HH found once and configured through the sensor hub: 10 Hz low noise, block data update
+	CHECK(i2cHostLps22hhIdReads == 1);
+	CHECK(i2cHostHubWrites > 0);
+	CHECK((lps22hhRegisters[LPS22HH_CTRL_REG1] >> 4 & 0x07) == (LPS22HH_10_Hz_LOW_NOISE & 0x07));
+	CHECK(lps22hhRegisters[LPS22HH_CTRL_REG1] & 0x02);
+	CHECK(lps22hhRegisters[LPS22HH_CTRL_REG2] & 0x02);
+
+	// slave 0 auto-read: STATUS through TEMP_OUT_H of the LPS22HH, master left on, paced by the accelerometer
+	CHECK(lsm6dsoHubRegisters[LSM6DSO_SLV0_ADD] == (LPS22HH_I2C_ADD_L | 0x01));
+	CHECK(lsm6dsoHubRegisters[LSM6DSO_SLV0_SUBADD] == LPS22HH_STATUS);
+	CHECK((lsm6dsoHubRegisters[LSM6DSO_SLV0_CONFIG] & 0x07) == PRESSURE_BURST_LEN);
+	CHECK((lsm6dsoHubRegisters[LSM6DSO_MASTER_CONFIG] & 0x03) == LSM6DSO_SLV_0);
+	CHECK(lsm6dsoHubRegisters[LSM6DSO_MASTER_CONFIG] & 0x04);
+	CHECK(lsm6dsoHubRegisters[LSM6DSO_MASTER_CONFIG] & 0x08);
+
+	// the offset was learned while at rest, and the table saved
+	CHECK(AvnetSkSensorUpdate());
+	AngularRateDegreesPerSecond rate = GetAngularRate();
+	CHECK(NEAR(rate.x, 0, 0.01) && NEAR(rate.y, 0, 0.01) && NEAR(rate.z, 0, 0.01));
+	CHECK(stat(storageHostPath, &storage) == 0 && storage.st_size > 0);
+}
+
+// With the auto-read running, an update is one burst of each sensor and no sensor hub reconfiguration
+static void TestBurstRead(void)
+{
+	const int16_t turning[3] = { gyroOffset[0] + 143, gyroOffset[1] - 286, gyroOffset[2] };
+	const int16_t tilted[3] = { 1000, -2000, 7800 };
+	int imuBursts = 0;
+	int pressureBursts = 0;
+	int otherReads = 0;
+	int configWrites = 0;
+
+	i2cHostSetImuOutputs(512, turning, tilted);
+	i2cHostSetPressureOutputs(PRESSURE_LSB + 4096, PRESSURE_TEMPERATURE_LSB + 50);
+
+	unsigned long hubReads = i2cHostHubReads;
+	i2cHostTransferCount = 0;
+	CHECK(AvnetSkSensorUpdate());
+
+	for (size_t i = 0; i < i2cHostTransferCount; i++) {
+		const I2C_HOST_TRANSFER *t = &i2cHostTransfers[i];
+
+		if (!t->write && t->bank == 0 && t->reg == LSM6DSO_STATUS_REG && t->len == IMU_BURST_LEN) {
+			imuBursts++;
+		} else if (!t->write && t->bank == 1 && t->reg == LSM6DSO_SENSOR_HUB_1 && t->len == PRESSURE_BURST_LEN) {
+			pressureBursts++;
+		} else if (t->reg != LSM6DSO_FUNC_CFG_ACCESS) {
+			// only the bank switches around the sensor hub read are allowed
+			*(t->write ? &configWrites : &otherReads) += 1;
+		}
+	}
+	CHECK(imuBursts == 1);
+	CHECK(pressureBursts == 1);
+	CHECK(otherReads == 0);
+	CHECK(configWrites == 0);
+
+	// the sensor hub read the LPS22HH on the sample of the burst, not through the passthrough
+	CHECK(i2cHostHubReads == hubReads + 1);
+
+	// every channel decoded from the bursts
+	AccelerationMilligForce acceleration = GetAcceleration();
+	CHECK(acceleration.x == lsm6dso_from_fs4_to_mg(tilted[0]));
+	CHECK(acceleration.y == lsm6dso_from_fs4_to_mg(tilted[1]));
+	CHECK(acceleration.z == lsm6dso_from_fs4_to_mg(tilted[2]));
+
+	AngularRateDegreesPerSecond rate = GetAngularRate();
+	CHECK(NEAR(rate.x, RateDps(143), 0.01));
+	CHECK(NEAR(rate.y, RateDps(-286), 0.01));
+	CHECK(NEAR(rate.z, 0, 0.01));
+
+	CHECK(GetPressure() == lps22hh_from_lsb_to_hpa(PRESSURE_LSB + 4096));
+	CHECK(GetTemperature() == lps22hh_from_lsb_to_celsius(PRESSURE_TEMPERATURE_LSB + 50));
+
+	// no new LPS22HH data, the last values stay
+	i2cHostSetPressureOutputs(PRESSURE_LSB, PRESSURE_TEMPERATURE_LSB);
+	lps22hhRegisters[LPS22HH_STATUS] = 0;
+	CHECK(!AvnetSkSensorUpdate());
+	CHECK(GetPressure() == lps22hh_from_lsb_to_hpa(PRESSURE_LSB + 4096));
+
+	// no new LSM6DSO data, the last values stay
+	i2cHostSampling = false;
+	i2cHostSetImuOutputs(0, gyroOffset, restAcceleration);
+	AvnetSkSensorUpdate();
+	CHECK(GetAcceleration().x == lsm6dso_from_fs4_to_mg(tilted[0]));
+	i2cHostSampling = true;
+
+	closeI2c();
+}
+
+// No LPS22HH, the gyro calibration of the previous run is restored from storage
+static void TestNoLps22hhRestoredCalibration(void)
+{
+	i2cHostPowerOn();
+	lps22hhPresent = false;
+	i2cHostSetImuOutputs(0, gyroOffset, restAcceleration);
+
+	double elapsedMs = InitSensors();
+	printf("init without LPS22HH and a restored calibration took %.0f ms\n", elapsedMs);
+	CHECK(readyResult);
+	CHECK(i2cHostCallerThreadTransfers == 0);
+
+	// ten detection attempts 100 ms apart, then ready on the first sample with the stored calibration
+	CHECK(i2cHostHubNacks == 10);
+	CHECK(elapsedMs >= 900 && elapsedMs < 2000);
+	CHECK((lsm6dsoHubRegisters[LSM6DSO_MASTER_CONFIG] & 0x04) == 0);
+
+	CHECK(!AvnetSkSensorUpdate());
+	AngularRateDegreesPerSecond rate = GetAngularRate();
+	CHECK(NEAR(rate.x, 0, 0.01) && NEAR(rate.y, 0, 0.01) && NEAR(rate.z, 0, 0.01));
+
+	closeI2c();
+}
+
+int main(void)
+{
+	storageHostPath = "imu_temp_pressure_test.bin";
+	setSensorsReadyHandler(SensorsReady);
+	lp_getTimerEventLoop();
+
+	TestLsm6dsoMissing();
+	TestInitAndCalibrate();
+	TestBurstRead();
+	TestNoLps22hhRestoredCalibration();
+
+	lp_stopWorkerPool();
+	lp_stopTimerEventLoop();
+	unlink(storageHostPath);
+
+	return CheckResult("IMU");
+}
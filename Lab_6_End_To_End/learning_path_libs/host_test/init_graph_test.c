@@ -0,0 +1,149 @@
+/* Host tests of the init graph: dependency order, failures, and the Lab 6 init sequence with timers standing
+   in for the slow subsystems, run in parallel and compared with running them one after the other. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../init_graph.h"
+#include "../timer.h"
+#include "eventloop_host.h"
+#include "check.h"
+
+static double NowMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+static void RunUntilReady(long timeoutMs)
+{
+	double start = NowMs();
+	while (!lp_isInitReady() && NowMs() - start < timeoutMs) {
+		EventLoop_Run(lp_getTimerEventLoop(), 10, true);
+	}
+}
+
+// Order in which the start functions ran
+static char started[16][16];
+static int startedCount;
+static int readyCount;
+
+static void Started(const char *name)
+{
+	snprintf(started[startedCount++], sizeof(started[0]), "%s", name);
+}
+
+static int StartIndex(const char *name)
+{
+	for (int i = 0; i < startedCount; i++) {
+		if (strcmp(started[i], name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void ReadyHandler(void)
+{
+	readyCount++;
+}
+
+// Lab 6 graph, the asynchronous subsystems complete from one-shot timers
+static LP_INIT_NODE devKitInit, gpioInit, cloudBindingsInit, timersInit, cloudInit, interCoreInit;
+
+static void DevKitReady(EventLoopTimer *t) { ConsumeEventLoopTimerEvent(t); lp_initNodeDone(&devKitInit, true); }
+static void CloudReady(EventLoopTimer *t) { ConsumeEventLoopTimerEvent(t); lp_initNodeDone(&cloudInit, true); }
+static void InterCoreReady(EventLoopTimer *t) { ConsumeEventLoopTimerEvent(t); lp_initNodeDone(&interCoreInit, true); }
+
+static LP_TIMER devKitTimer = {.name = "devKitWork", .handler = DevKitReady};
+static LP_TIMER cloudTimer = {.name = "cloudWork", .handler = CloudReady};
+static LP_TIMER interCoreTimer = {.name = "interCoreWork", .handler = InterCoreReady};
+
+// Host durations of the asynchronous work, scaled from the device: sensor calibration ~2 s, DPS and hub ~3 s
+#define DEVKIT_MS 200
+#define CLOUD_MS 300
+#define INTERCORE_MS 50
+
+static bool StartAfter(LP_TIMER *timer, long ms, const char *name)
+{
+	Started(name);
+	return lp_startTimer(timer) && lp_setOneShotTimer(timer, &(struct timespec){0, ms * 1000 * 1000});
+}
+
+static bool StartDevKit(void) { return StartAfter(&devKitTimer, DEVKIT_MS, "devKit"); }
+static bool StartCloud(void) { return StartAfter(&cloudTimer, CLOUD_MS, "cloud"); }
+static bool StartInterCore(void) { return StartAfter(&interCoreTimer, INTERCORE_MS, "interCore"); }
+static bool StartGpio(void) { Started("gpio"); return true; }
+static bool StartCloudBindings(void) { Started("cloudBindings"); return true; }
+static bool StartTimers(void) { Started("timers"); return true; }
+
+static LP_INIT_NODE devKitInit = {.name = "devKit", .start = StartDevKit, .async = true, .critical = true};
+static LP_INIT_NODE gpioInit = {.name = "gpio", .start = StartGpio};
+static LP_INIT_NODE cloudBindingsInit = {.name = "cloudBindings", .start = StartCloudBindings};
+static LP_INIT_NODE timersInit = {.name = "timers", .start = StartTimers, .dependsOn = (LP_INIT_NODE *[]){&gpioInit, NULL}};
+static LP_INIT_NODE cloudInit = {.name = "cloud", .start = StartCloud, .async = true, .critical = true,
+								.dependsOn = (LP_INIT_NODE *[]){&cloudBindingsInit, NULL}};
+static LP_INIT_NODE interCoreInit = {.name = "interCore", .start = StartInterCore, .async = true};
+static LP_INIT_NODE *lab6Set[] = {&devKitInit, &gpioInit, &cloudBindingsInit, &timersInit, &cloudInit, &interCoreInit};
+
+// Dependencies listed after their dependents, a synchronous failure and a node completing inside start
+static LP_INIT_NODE aInit, bInit, cInit, dInit, eInit;
+static bool StartA(void) { Started("a"); return true; }
+static bool StartB(void) { Started("b"); return false; }
+static bool StartC(void) { Started("c"); return true; }
+static bool StartD(void) { Started("d"); lp_initNodeDone(&dInit, true); return true; }
+static bool StartE(void) { Started("e"); return true; }
+static LP_INIT_NODE cInit = {.name = "c", .start = StartC, .dependsOn = (LP_INIT_NODE *[]){&dInit, &aInit, NULL}};
+static LP_INIT_NODE eInit = {.name = "e", .start = StartE, .dependsOn = (LP_INIT_NODE *[]){&bInit, NULL}};
+static LP_INIT_NODE aInit = {.name = "a", .start = StartA, .critical = true};
+static LP_INIT_NODE bInit = {.name = "b", .start = StartB};
+static LP_INIT_NODE dInit = {.name = "d", .start = StartD, .async = true, .critical = true};
+static LP_INIT_NODE *orderSet[] = {&cInit, &eInit, &aInit, &bInit, &dInit};
+
+int main(void)
+{
+	lp_getTimerEventLoop();
+
+	// Dependency order, failure propagation
+	lp_startInitGraph(orderSet, sizeof(orderSet) / sizeof(orderSet[0]), ReadyHandler);
+	CHECK(StartIndex("c") > StartIndex("a") && StartIndex("c") > StartIndex("d"));
+	CHECK(bInit.state == LP_INIT_FAILED);
+	CHECK(eInit.state == LP_INIT_FAILED && StartIndex("e") == -1);
+	CHECK(dInit.state == LP_INIT_DONE && cInit.state == LP_INIT_DONE);
+	CHECK(lp_isInitReady() && readyCount == 1);
+
+	// Lab 6 sequence
+	startedCount = 0;
+	readyCount = 0;
+	double start = NowMs();
+	lp_startInitGraph(lab6Set, sizeof(lab6Set) / sizeof(lab6Set[0]), ReadyHandler);
+	CHECK(!lp_isInitReady());
+	CHECK(StartIndex("timers") > StartIndex("gpio") && StartIndex("cloud") > StartIndex("cloudBindings"));
+	// The slow subsystems all start before any of them completes
+	CHECK(StartIndex("devKit") >= 0 && StartIndex("cloud") >= 0 && StartIndex("interCore") >= 0);
+
+	RunUntilReady(2000);
+	double readyMs = NowMs() - start;
+	double serialMs = DEVKIT_MS + CLOUD_MS + INTERCORE_MS;
+
+	printf("Lab 6 init ready after %.1f ms, %.0f ms when run one after the other\n", readyMs, serialMs);
+	CHECK(lp_isInitReady() && readyCount == 1);
+	CHECK(devKitInit.state == LP_INIT_DONE && cloudInit.state == LP_INIT_DONE);
+	// The critical path is the slowest critical subsystem, not the sum
+	CHECK(readyMs >= CLOUD_MS - 1 && readyMs < CLOUD_MS + 50);
+	CHECK(interCoreInit.state == LP_INIT_DONE);
+
+	// Late completions do not report ready again
+	lp_initNodeDone(&cloudInit, true);
+	CHECK(readyCount == 1);
+
+	lp_stopTimer(&devKitTimer);
+	lp_stopTimer(&cloudTimer);
+	lp_stopTimer(&interCoreTimer);
+	lp_stopTimerEventLoop();
+
+	return CheckResult("init graph");
+}
@@ -0,0 +1,3 @@
+/* Host stand-in for the Azure IoT client options, nothing of it is used on the host. */
+
+#pragma once
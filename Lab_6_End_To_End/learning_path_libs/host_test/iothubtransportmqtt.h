@@ -0,0 +1,3 @@
+/* Host stand-in for the Azure IoT MQTT transport, nothing of it is used on the host. */
+
+#pragma once
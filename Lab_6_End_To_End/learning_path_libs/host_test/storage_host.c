@@ -0,0 +1,20 @@
+/* Host implementation of the applibs mutable storage over a regular file. */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <applibs/storage.h>
+
+#include "storage_host.h"
+
+const char *storageHostPath = "mutable_storage.bin";
+
+int Storage_OpenMutableFile(void)
+{
+	return open(storageHostPath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+}
+
+int Storage_DeleteMutableFile(void)
+{
+	return unlink(storageHostPath);
+}
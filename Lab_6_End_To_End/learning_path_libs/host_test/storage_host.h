@@ -0,0 +1,4 @@
+#pragma once
+
+// File that stands in for the mutable storage file, set before the first Storage_OpenMutableFile
+extern const char *storageHostPath;
@@ -0,0 +1,432 @@
+/* Host tests of the CBOR telemetry encoder. Records are decoded by an independent CBOR decoder and must
+   give the same values as the JSON encoder writes, the size and the encode time of both are reported.
+   lp_sendTelemetry runs over a fake lp_sendMsgBytes. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../telemetry.h"
+#include "check.h"
+
+#define RANDOM_RECORDS 20000
+#define TIMED_RECORDS 200000
+
+// the fake Azure IoT client, see lp_sendMsgBytes
+static bool sendSucceeds = true;
+static int sendCount = 0;
+static unsigned char sentData[LP_TELEMETRY_MAX_BYTES];
+static size_t sentLength = 0;
+static const char *sentContentType = NULL;
+static const char *sentContentEncoding = NULL;
+
+bool lp_sendMsgBytes(const unsigned char *data, size_t length, const char *contentType, const char *contentEncoding)
+{
+	sendCount++;
+	if (!sendSucceeds || length > sizeof(sentData)) {
+		return false;
+	}
+	memcpy(sentData, data, length);
+	sentLength = length;
+	sentContentType = contentType;
+	sentContentEncoding = contentEncoding;
+	return true;
+}
+
+void lp_terminate(int exitCode)
+{
+	fprintf(stderr, "lp_terminate(%d)\n", exitCode);
+	failures++;
+}
+
+// an IMU record, every field is encoded every time
+static LP_TELEMETRY_FIELD accelX = { .name = "AccelX", .type = LP_TYPE_FLOAT, .precision = 4 };
+static LP_TELEMETRY_FIELD accelY = { .name = "AccelY", .type = LP_TYPE_FLOAT, .precision = 4 };
+static LP_TELEMETRY_FIELD accelZ = { .name = "AccelZ", .type = LP_TYPE_FLOAT, .precision = 4 };
+static LP_TELEMETRY_FIELD gyroX = { .name = "GyroX", .type = LP_TYPE_FLOAT, .precision = 2 };
+static LP_TELEMETRY_FIELD gyroY = { .name = "GyroY", .type = LP_TYPE_FLOAT, .precision = 2 };
+static LP_TELEMETRY_FIELD gyroZ = { .name = "GyroZ", .type = LP_TYPE_FLOAT, .precision = 2 };
+static LP_TELEMETRY_FIELD temperature = { .name = "Temperature", .type = LP_TYPE_FLOAT, .precision = 2 };
+static LP_TELEMETRY_FIELD pressure = { .name = "Pressure", .type = LP_TYPE_FLOAT, .precision = 1 };
+static LP_TELEMETRY_FIELD moving = { .name = "Moving", .type = LP_TYPE_BOOL };
+static LP_TELEMETRY_FIELD msgId = { .name = "MsgId", .type = LP_TYPE_INT };
+
+static LP_TELEMETRY_FIELD *imuSet[] = { &accelX, &accelY, &accelZ, &gyroX, &gyroY, &gyroZ, &temperature, &pressure, &moving, &msgId };
+
+#define IMU_FIELDS (sizeof(imuSet) / sizeof(imuSet[0]))
+
+// CBOR integers change their length at these
+static const int edgeInts[] = { 0, 1, 23, 24, 255, 256, 65535, 65536, INT_MAX, -1, -24, -25, -256, -257, -65536, -65537, INT_MIN };
+
+/* Minimal CBOR decoder for the subset the encoder writes */
+
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+	bool ok;
+} CBOR_READER;
+
+static uint8_t ReadByte(CBOR_READER *reader)
+{
+	if (reader->p >= reader->end) {
+		reader->ok = false;
+		return 0;
+	}
+	return *reader->p++;
+}
+
+// the argument of a major type, additional information 0 to 23 or 1, 2, 4 following bytes
+static uint32_t ReadArgument(CBOR_READER *reader, uint8_t initial)
+{
+	uint8_t info = initial & 0x1F;
+	int bytes = info < 24 ? 0 : info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : -1;
+	uint32_t argument = info < 24 ? info : 0;
+
+	if (bytes < 0) {
+		reader->ok = false;
+		return 0;
+	}
+	for (int i = 0; i < bytes; i++) {
+		argument = (argument << 8) | ReadByte(reader);
+	}
+	return argument;
+}
+
+static double DecodeHalf(uint16_t half)
+{
+	int exponent = (half >> 10) & 0x1F;
+	int mantissa = half & 0x3FF;
+	double value = exponent == 0 ? ldexp(mantissa, -24)
+				: exponent == 31 ? (mantissa == 0 ? INFINITY : NAN)
+				: ldexp(mantissa + 1024, exponent - 25);
+	return (half & 0x8000) ? -value : value;
+}
+
+// decodes one value, into an int, a bool or a float
+static bool ReadValue(CBOR_READER *reader, valueType type, LP_TELEMETRY_VALUE *value, int *floatBytes)
+{
+	uint8_t initial = ReadByte(reader);
+
+	switch (type) {
+	case LP_TYPE_INT:
+		if ((initial & 0xE0) == 0x00) {
+			int64_t n = ReadArgument(reader, initial);
+			value->i = (int)n;
+			return n <= INT_MAX;
+		}
+		if ((initial & 0xE0) == 0x20) {
+			int64_t n = -1 - (int64_t)ReadArgument(reader, initial);
+			value->i = (int)n;
+			return n >= INT_MIN;
+		}
+		return false;
+	case LP_TYPE_BOOL:
+		value->b = initial == 0xF5;
+		return initial == 0xF4 || initial == 0xF5;
+	case LP_TYPE_FLOAT:
+		if (initial == 0xF9) {
+			*floatBytes = 3;
+			value->f = (float)DecodeHalf((uint16_t)ReadArgument(reader, initial));
+			return true;
+		}
+		if (initial == 0xFA) {
+			uint32_t bits = ReadArgument(reader, initial);
+			*floatBytes = 5;
+			memcpy(&value->f, &bits, sizeof(bits));
+			return true;
+		}
+		return false;
+	default:
+		return false;
+	}
+}
+
+// the text the JSON encoder writes for a field, value up to the next ',' or '}'
+static bool JsonValue(const char *json, const char *name, char *text, size_t textLen)
+{
+	char key[64];
+	snprintf(key, sizeof(key), "\"%s\":", name);
+
+	const char *start = strstr(json, key);
+	if (start == NULL) {
+		return false;
+	}
+	start += strlen(key);
+	size_t len = strcspn(start, ",}");
+	if (len >= textLen) {
+		return false;
+	}
+	memcpy(text, start, len);
+	text[len] = '\0';
+	return true;
+}
+
+/// Decodes a CBOR record of the fields and compares every value with the JSON record
+static bool SameAsJson(const uint8_t *cbor, size_t cborLen, const char *json, LP_TELEMETRY_FIELD *fields[], size_t fieldCount)
+{
+	CBOR_READER reader = { .p = cbor, .end = cbor + cborLen, .ok = true };
+	uint8_t initial = ReadByte(&reader);
+
+	if ((initial & 0xE0) != 0xA0 || ReadArgument(&reader, initial) != fieldCount) {
+		return false;
+	}
+
+	for (size_t i = 0; i < fieldCount; i++) {
+		char key[64];
+		char decodedText[64];
+		char jsonText[64];
+		LP_TELEMETRY_VALUE value;
+		int floatBytes = 0;
+
+		initial = ReadByte(&reader);
+		uint32_t keyLen = ReadArgument(&reader, initial);
+		if ((initial & 0xE0) != 0x60 || keyLen >= sizeof(key) || (size_t)(reader.end - reader.p) < keyLen) {
+			return false;
+		}
+		memcpy(key, reader.p, keyLen);
+		key[keyLen] = '\0';
+		reader.p += keyLen;
+
+		if (strcmp(key, fields[i]->name) != 0 || !ReadValue(&reader, fields[i]->type, &value, &floatBytes)) {
+			return false;
+		}
+
+		switch (fields[i]->type) {
+		case LP_TYPE_INT:
+			snprintf(decodedText, sizeof(decodedText), "%d", value.i);
+			break;
+		case LP_TYPE_BOOL:
+			snprintf(decodedText, sizeof(decodedText), "%s", value.b ? "true" : "false");
+			break;
+		default:
+			// a single precision float is the value itself
+			if (floatBytes == 5 && memcmp(&value.f, &fields[i]->value.f, sizeof(float)) != 0) {
+				return false;
+			}
+			snprintf(decodedText, sizeof(decodedText), "%.*f", fields[i]->precision, value.f);
+			break;
+		}
+
+		if (!JsonValue(json, fields[i]->name, jsonText, sizeof(jsonText)) || strcmp(decodedText, jsonText) != 0) {
+			fprintf(stderr, "%s: CBOR %s, JSON %s\n", fields[i]->name, decodedText, jsonText);
+			return false;
+		}
+	}
+
+	return reader.ok && reader.p == reader.end;
+}
+
+static int64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static float RandomFloat(float range)
+{
+	return (float)(((double)rand() / RAND_MAX * 2 - 1) * range);
+}
+
+static void RandomImuRecord(int i)
+{
+	lp_setTelemetryFloat(&accelX, RandomFloat(2000.0f));
+	lp_setTelemetryFloat(&accelY, RandomFloat(2000.0f));
+	lp_setTelemetryFloat(&accelZ, 1000.0f + RandomFloat(50.0f));
+	lp_setTelemetryFloat(&gyroX, RandomFloat(250.0f));
+	lp_setTelemetryFloat(&gyroY, RandomFloat(250.0f));
+	lp_setTelemetryFloat(&gyroZ, (float)(rand() % 200 - 100) / 4);
+	lp_setTelemetryFloat(&temperature, 25.0f + RandomFloat(15.0f));
+	lp_setTelemetryFloat(&pressure, 1000.0f + RandomFloat(50.0f));
+	lp_setTelemetryBool(&moving, rand() % 2 == 0);
+	lp_setTelemetryInt(&msgId, i % 4 == 0 ? edgeInts[(i / 4) % (sizeof(edgeInts) / sizeof(edgeInts[0]))] : rand() - RAND_MAX / 2);
+}
+
+static void TestKnownEncodings(void)
+{
+	static LP_TELEMETRY_FIELD intField = { .name = "I", .type = LP_TYPE_INT };
+	static LP_TELEMETRY_FIELD floatField = { .name = "F", .type = LP_TYPE_FLOAT, .precision = 2 };
+	static LP_TELEMETRY_FIELD boolField = { .name = "B", .type = LP_TYPE_BOOL };
+	LP_TELEMETRY_FIELD *fields[] = { &intField, &floatField, &boolField };
+	uint8_t buffer[32];
+
+	// {"I":24,"F":1.5,"B":true}, 1.5 fits half precision
+	intField.value.i = 24;
+	floatField.value.f = 1.5f;
+	boolField.value.b = true;
+	static const uint8_t small[] = { 0xA3, 0x61, 'I', 0x18, 0x18, 0x61, 'F', 0xF9, 0x3E, 0x00, 0x61, 'B', 0xF5 };
+	CHECK(lp_telemetryCborEncoder.encode(fields, 3, (char *)buffer, sizeof(buffer)) == sizeof(small));
+	CHECK(memcmp(buffer, small, sizeof(small)) == 0);
+
+	// -1 - 0x7FFFFFFF, and 1013.25 needs single precision at 2 decimals
+	intField.value.i = INT_MIN;
+	floatField.value.f = 1013.25f;
+	boolField.value.b = false;
+	static const uint8_t large[] = { 0xA3, 0x61, 'I', 0x3A, 0x7F, 0xFF, 0xFF, 0xFF, 0x61, 'F', 0xFA, 0x44, 0x7D, 0x50, 0x00, 0x61, 'B', 0xF4 };
+	CHECK(lp_telemetryCborEncoder.encode(fields, 3, (char *)buffer, sizeof(buffer)) == sizeof(large));
+	CHECK(memcmp(buffer, large, sizeof(large)) == 0);
+
+	// every shorter buffer fails
+	for (size_t size = 0; size < sizeof(large); size++) {
+		CHECK(lp_telemetryCborEncoder.encode(fields, 3, (char *)buffer, size) == -1);
+	}
+
+	// not finite stays single precision, the JSON encoder writes null
+	floatField.value.f = NAN;
+	CHECK(lp_telemetryCborEncoder.encode(fields, 3, (char *)buffer, sizeof(buffer)) == (int)sizeof(large));
+	uint32_t bits = (uint32_t)buffer[11] << 24 | (uint32_t)buffer[12] << 16 | (uint32_t)buffer[13] << 8 | buffer[14];
+	float decoded;
+	memcpy(&decoded, &bits, sizeof(decoded));
+	CHECK(buffer[10] == 0xFA && isnan(decoded));
+}
+
+static void TestRandomRecords(void)
+{
+	char json[LP_TELEMETRY_MAX_BYTES];
+	uint8_t cbor[LP_TELEMETRY_MAX_BYTES];
+	int mismatches = 0;
+	int halfFloats = 0;
+
+	lp_openTelemetrySet(imuSet, IMU_FIELDS);
+
+	for (int i = 0; i < RANDOM_RECORDS && mismatches < 10; i++) {
+		RandomImuRecord(i);
+
+		int jsonLen = lp_encodeTelemetry(&lp_telemetryJsonEncoder, json, sizeof(json));
+		int cborLen = lp_encodeTelemetry(&lp_telemetryCborEncoder, (char *)cbor, sizeof(cbor));
+
+		CHECK(jsonLen > 0 && cborLen > 0 && cborLen < jsonLen);
+		if (!SameAsJson(cbor, (size_t)cborLen, json, imuSet, IMU_FIELDS)) {
+			fprintf(stderr, "record %d: %s\n", i, json);
+			mismatches++;
+		}
+		// the gyro Z quarter steps always fit half precision
+		halfFloats += memchr(cbor, 0xF9, (size_t)cborLen) != NULL;
+	}
+
+	CHECK(mismatches == 0);
+	CHECK(halfFloats == RANDOM_RECORDS);
+	lp_closeTelemetrySet();
+}
+
+static void TestSendTelemetry(void)
+{
+	static LP_TELEMETRY_FIELD temperatureField = { .name = "Temperature", .type = LP_TYPE_FLOAT, .precision = 2, .deltaThreshold = 0.5f };
+	LP_TELEMETRY_FIELD *fields[] = { &temperatureField };
+
+	lp_openTelemetrySet(fields, 1);
+	CHECK(lp_sendTelemetry(&lp_telemetryCborEncoder) == 0);
+	CHECK(sendCount == 0);
+
+	// a failed send keeps the field pending
+	lp_setTelemetryFloat(&temperatureField, 21.5f);
+	sendSucceeds = false;
+	CHECK(lp_sendTelemetry(&lp_telemetryCborEncoder) == -1);
+	CHECK(sendCount == 1);
+
+	sendSucceeds = true;
+	int len = lp_sendTelemetry(&lp_telemetryCborEncoder);
+	CHECK(len == (int)sentLength && sendCount == 2);
+	CHECK(sentContentType != NULL && strcmp(sentContentType, "application/cbor") == 0);
+	CHECK(sentContentEncoding == NULL);
+	CHECK(SameAsJson(sentData, sentLength, "{\"Temperature\":21.50}", fields, 1));
+
+	// below the threshold nothing is sent, above it as JSON
+	lp_setTelemetryFloat(&temperatureField, 21.7f);
+	CHECK(lp_sendTelemetry(&lp_telemetryCborEncoder) == 0);
+	CHECK(sendCount == 2);
+	lp_setTelemetryFloat(&temperatureField, 22.0f);
+	CHECK(lp_sendTelemetry(&lp_telemetryJsonEncoder) > 0);
+	CHECK(sendCount == 3);
+	CHECK(strcmp(sentContentType, "application/json") == 0 && strcmp(sentContentEncoding, "utf-8") == 0);
+	CHECK(sentLength == strlen("{\"Temperature\":22.00}") && memcmp(sentData, "{\"Temperature\":22.00}", sentLength) == 0);
+
+	lp_closeTelemetrySet();
+}
+
+// the Lab 6 AVNET telemetry set, AVNET/board.c, with the widest values fits the lp_sendTelemetry buffer
+static void TestBoardTelemetryFits(void)
+{
+	static LP_TELEMETRY_FIELD fields[] = {
+		{ .name = "Temperature", .type = LP_TYPE_FLOAT, .precision = 2 },
+		{ .name = "TemperatureMin", .type = LP_TYPE_FLOAT, .precision = 2 },
+		{ .name = "TemperatureMax", .type = LP_TYPE_FLOAT, .precision = 2 },
+		{ .name = "TemperatureStdDev", .type = LP_TYPE_FLOAT, .precision = 2 },
+		{ .name = "Humidity", .type = LP_TYPE_FLOAT, .precision = 1 },
+		{ .name = "Pressure", .type = LP_TYPE_FLOAT, .precision = 1 },
+		{ .name = "PressureMin", .type = LP_TYPE_FLOAT, .precision = 1 },
+		{ .name = "PressureMax", .type = LP_TYPE_FLOAT, .precision = 1 },
+		{ .name = "PressureStdDev", .type = LP_TYPE_FLOAT, .precision = 2 },
+		{ .name = "Light", .type = LP_TYPE_INT },
+		{ .name = "MsgId", .type = LP_TYPE_INT },
+	};
+	LP_TELEMETRY_FIELD *set[sizeof(fields) / sizeof(fields[0])];
+
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		set[i] = &fields[i];
+	}
+	lp_openTelemetrySet(set, sizeof(fields) / sizeof(fields[0]));
+
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		if (fields[i].type == LP_TYPE_INT) {
+			lp_setTelemetryInt(&fields[i], INT_MIN);
+		} else {
+			lp_setTelemetryFloat(&fields[i], fields[i].precision == 1 ? -1260.5f : -150.25f);
+		}
+	}
+
+	int len = lp_sendTelemetry(&lp_telemetryJsonEncoder);
+	CHECK(len > 0 && len < LP_TELEMETRY_MAX_BYTES);
+	printf("Lab 6 AVNET telemetry, widest JSON %d of %d bytes\n", len, LP_TELEMETRY_MAX_BYTES);
+
+	lp_closeTelemetrySet();
+}
+
+static void BenchmarkImuRecords(void)
+{
+	char json[LP_TELEMETRY_MAX_BYTES];
+	char cbor[LP_TELEMETRY_MAX_BYTES];
+	int64_t jsonNs = 0;
+	int64_t cborNs = 0;
+	long jsonBytes = 0;
+	long cborBytes = 0;
+
+	lp_openTelemetrySet(imuSet, IMU_FIELDS);
+
+	for (int i = 0; i < TIMED_RECORDS; i++) {
+		RandomImuRecord(i);
+
+		int64_t start = NowNs();
+		jsonBytes += lp_encodeTelemetry(&lp_telemetryJsonEncoder, json, sizeof(json));
+		int64_t middle = NowNs();
+		cborBytes += lp_encodeTelemetry(&lp_telemetryCborEncoder, cbor, sizeof(cbor));
+		int64_t end = NowNs();
+
+		jsonNs += middle - start;
+		cborNs += end - middle;
+	}
+
+	lp_closeTelemetrySet();
+
+	CHECK(cborBytes < jsonBytes);
+	printf("IMU record, %d records: JSON %.1f bytes %.1f ns, CBOR %.1f bytes %.1f ns\n", TIMED_RECORDS,
+		(double)jsonBytes / TIMED_RECORDS, (double)jsonNs / TIMED_RECORDS,
+		(double)cborBytes / TIMED_RECORDS, (double)cborNs / TIMED_RECORDS);
+}
+
+int main(void)
+{
+	srand(1);
+
+	TestKnownEncodings();
+	TestRandomRecords();
+	TestSendTelemetry();
+	TestBoardTelemetryFits();
+	BenchmarkImuRecords();
+
+	return CheckResult("telemetry CBOR");
+}
@@ -0,0 +1,208 @@
+/* Host tests of the compile-time specialized telemetry serializers. The output must be byte
+   identical to snprintf of the equivalent compact format, and the time per message of both is
+   reported. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../telemetry_template.h"
+#include "check.h"
+
+#define RANDOM_MESSAGES 200000
+#define TIMED_MESSAGES 1000000
+
+// the Lab 6 inter-core telemetry, main.c
+#define INTER_CORE_TELEMETRY(FIELD) \
+	FIELD(Temperature, LP_TELEMETRY_FLOAT_STRING, 2) \
+	FIELD(Pressure, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(MsgId, LP_TELEMETRY_INT, 0)
+
+LP_TELEMETRY_SCHEMA(InterCoreTelemetry, INTER_CORE_TELEMETRY)
+
+static const char interCoreFormat[] = "{\"Temperature\":\"%.2f\",\"Pressure\":\"%.1f\",\"MsgId\":%d}";
+
+// every kind, and every number of decimals
+#define ALL_KINDS(FIELD) \
+	FIELD(I, LP_TELEMETRY_INT, 0) \
+	FIELD(F0, LP_TELEMETRY_FLOAT, 0) \
+	FIELD(F1, LP_TELEMETRY_FLOAT, 1) \
+	FIELD(F2, LP_TELEMETRY_FLOAT_STRING, 2) \
+	FIELD(F3, LP_TELEMETRY_FLOAT, 3) \
+	FIELD(F4, LP_TELEMETRY_FLOAT_STRING, 4) \
+	FIELD(F5, LP_TELEMETRY_FLOAT, 5) \
+	FIELD(F6, LP_TELEMETRY_FLOAT, 6)
+
+LP_TELEMETRY_SCHEMA(AllKinds, ALL_KINDS)
+
+static const char allKindsFormat[] =
+	"{\"I\":%d,\"F0\":%.0f,\"F1\":%.1f,\"F2\":\"%.2f\",\"F3\":%.3f,\"F4\":\"%.4f\",\"F5\":%.5f,\"F6\":%.6f}";
+
+static int64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// uniform in [-range, range], with a share of values exactly on a rounding tie
+static float RandomFloat(float range, int decimals)
+{
+	if (rand() % 8 == 0) {
+		double unit = pow(10, -decimals);
+		return (float)((rand() % 2001 - 1000) * unit + unit / 2);
+	}
+	return (float)(((double)rand() / RAND_MAX * 2 - 1) * range);
+}
+
+static int32_t RandomInt(void)
+{
+	return (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+}
+
+static bool SameAsSnprintfInterCore(const InterCoreTelemetry *telemetry)
+{
+	char expected[128];
+	char actual[128];
+	int expectedLen = snprintf(expected, sizeof(expected), interCoreFormat, telemetry->Temperature,
+							telemetry->Pressure, telemetry->MsgId);
+	int actualLen = InterCoreTelemetry_serialize(telemetry, actual, sizeof(actual));
+
+	if (actualLen != expectedLen || memcmp(actual, expected, (size_t)expectedLen + 1) != 0) {
+		fprintf(stderr, "serializer %s\nsnprintf   %s\n", actual, expected);
+		return false;
+	}
+	return true;
+}
+
+static bool SameAsSnprintfAllKinds(const AllKinds *telemetry)
+{
+	char expected[256];
+	char actual[256];
+	int expectedLen = snprintf(expected, sizeof(expected), allKindsFormat, telemetry->I, telemetry->F0,
+							telemetry->F1, telemetry->F2, telemetry->F3, telemetry->F4, telemetry->F5,
+							telemetry->F6);
+	int actualLen = AllKinds_serialize(telemetry, actual, sizeof(actual));
+
+	if (actualLen != expectedLen || memcmp(actual, expected, (size_t)expectedLen + 1) != 0) {
+		fprintf(stderr, "serializer %s\nsnprintf   %s\n", actual, expected);
+		return false;
+	}
+	return true;
+}
+
+static void TestKnownValues(void)
+{
+	char buffer[128];
+
+	InterCoreTelemetry telemetry = { .Temperature = 23.456f, .Pressure = 1013.25f, .MsgId = 42 };
+	CHECK(InterCoreTelemetry_serialize(&telemetry, buffer, sizeof(buffer)) > 0);
+	CHECK(strcmp(buffer, "{\"Temperature\":\"23.46\",\"Pressure\":\"1013.2\",\"MsgId\":42}") == 0);
+	CHECK(SameAsSnprintfInterCore(&telemetry));
+
+	// ties round half to even on the exact binary value, as printf does
+	telemetry = (InterCoreTelemetry){ .Temperature = 0.125f, .Pressure = 0.25f, .MsgId = -1 };
+	CHECK(SameAsSnprintfInterCore(&telemetry));
+	telemetry = (InterCoreTelemetry){ .Temperature = 2.375f, .Pressure = -0.75f, .MsgId = INT32_MIN };
+	CHECK(SameAsSnprintfInterCore(&telemetry));
+	telemetry = (InterCoreTelemetry){ .Temperature = 99.995f, .Pressure = 9.95f, .MsgId = INT32_MAX };
+	CHECK(SameAsSnprintfInterCore(&telemetry));
+
+	// negative values that round to zero keep the sign
+	telemetry = (InterCoreTelemetry){ .Temperature = -0.001f, .Pressure = -0.0f, .MsgId = 0 };
+	CHECK(SameAsSnprintfInterCore(&telemetry));
+
+	AllKinds all = { .I = -123456, .F0 = 0.5f, .F1 = 1.05f, .F2 = -3.14159f, .F3 = 1e6f, .F4 = 0.00005f,
+					.F5 = -123.456789f, .F6 = 16777216.0f };
+	CHECK(SameAsSnprintfAllKinds(&all));
+
+	// not finite is JSON null, snprintf would write nan or inf
+	all.F1 = NAN;
+	all.F3 = INFINITY;
+	CHECK(AllKinds_serialize(&all, buffer, sizeof(buffer)) > 0);
+	CHECK(strstr(buffer, "\"F1\":null,") != NULL);
+	CHECK(strstr(buffer, "\"F3\":null,") != NULL);
+}
+
+static void TestBufferTooSmall(void)
+{
+	char buffer[128];
+	InterCoreTelemetry telemetry = { .Temperature = 23.45f, .Pressure = 1013.2f, .MsgId = 42 };
+	int len = InterCoreTelemetry_serialize(&telemetry, buffer, sizeof(buffer));
+
+	// the JSON plus the terminator fits exactly, one byte less does not
+	CHECK(InterCoreTelemetry_serialize(&telemetry, buffer, (size_t)len + 1) == len);
+	for (size_t size = 0; size <= (size_t)len; size++) {
+		memset(buffer, 'x', sizeof(buffer));
+		CHECK(InterCoreTelemetry_serialize(&telemetry, buffer, size) == -1);
+		CHECK(size == 0 || buffer[0] == '\0');
+		CHECK(buffer[size] == 'x');
+	}
+}
+
+static void TestRandomMessages(void)
+{
+	int mismatches = 0;
+
+	for (int i = 0; i < RANDOM_MESSAGES && mismatches < 10; i++) {
+		InterCoreTelemetry telemetry = {
+			.Temperature = RandomFloat(60.0f, 2), .Pressure = 900.0f + RandomFloat(200.0f, 1), .MsgId = RandomInt()
+		};
+		AllKinds all = { .I = RandomInt(), .F0 = RandomFloat(1e9f, 0), .F1 = RandomFloat(1e6f, 1),
+						.F2 = RandomFloat(1e5f, 2), .F3 = RandomFloat(1e4f, 3), .F4 = RandomFloat(1e3f, 4),
+						.F5 = RandomFloat(100.0f, 5), .F6 = RandomFloat(10.0f, 6) };
+
+		mismatches += !SameAsSnprintfInterCore(&telemetry);
+		mismatches += !SameAsSnprintfAllKinds(&all);
+	}
+	CHECK(mismatches == 0);
+}
+
+static void BenchmarkInterCore(void)
+{
+	static InterCoreTelemetry messages[1024];
+	char buffer[128];
+	size_t total = 0;
+
+	for (size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); i++) {
+		messages[i] = (InterCoreTelemetry){ .Temperature = RandomFloat(60.0f, 2),
+											.Pressure = 900.0f + RandomFloat(200.0f, 1),
+											.MsgId = (int32_t)i };
+	}
+
+	int64_t start = NowNs();
+	for (int i = 0; i < TIMED_MESSAGES; i++) {
+		const InterCoreTelemetry *t = &messages[i & 1023];
+		total += (size_t)snprintf(buffer, sizeof(buffer), interCoreFormat, t->Temperature, t->Pressure, t->MsgId);
+	}
+	int64_t snprintfNs = NowNs() - start;
+
+	start = NowNs();
+	for (int i = 0; i < TIMED_MESSAGES; i++) {
+		total -= (size_t)InterCoreTelemetry_serialize(&messages[i & 1023], buffer, sizeof(buffer));
+	}
+	int64_t serializerNs = NowNs() - start;
+
+	// both wrote the same number of bytes
+	CHECK(total == 0);
+
+	printf("inter-core telemetry, %d messages: snprintf %.1f ns/message, serializer %.1f ns/message (%.1fx)\n",
+		TIMED_MESSAGES, (double)snprintfNs / TIMED_MESSAGES, (double)serializerNs / TIMED_MESSAGES,
+		(double)snprintfNs / (double)(serializerNs > 0 ? serializerNs : 1));
+}
+
+int main(void)
+{
+	srand(1);
+
+	TestKnownValues();
+	TestBufferTooSmall();
+	TestRandomMessages();
+	BenchmarkInterCore();
+
+	return CheckResult("telemetry template");
+}
@@ -0,0 +1,167 @@
+/* Host tests of the declarative telemetry model with the JSON encoder: the encoded output of each field
+   type, reporting by exception with deltaThreshold, maxSilence and piggyback fields, and a buffer too
+   small for the message. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../exit_codes.h"
+#include "../telemetry.h"
+#include "check.h"
+
+static int exitCode = 0;
+
+// lp_encodeTelemetry does not send, lp_sendTelemetry is covered by telemetry_cbor_test
+bool lp_sendMsgBytes(const unsigned char *data, size_t length, const char *contentType, const char *contentEncoding)
+{
+	return false;
+}
+
+void lp_terminate(int code)
+{
+	exitCode = code;
+}
+
+static LP_TELEMETRY_FIELD temperature = { .name = "Temperature", .type = LP_TYPE_FLOAT, .precision = 2, .deltaThreshold = 0.5f };
+static LP_TELEMETRY_FIELD light = { .name = "Light", .type = LP_TYPE_INT, .deltaThreshold = 10, .maxSilence = 600 };
+static LP_TELEMETRY_FIELD moving = { .name = "Moving", .type = LP_TYPE_BOOL, .deltaThreshold = 1 };
+static LP_TELEMETRY_FIELD counter = { .name = "Counter", .type = LP_TYPE_INT };
+static LP_TELEMETRY_FIELD msgId = { .name = "MsgId", .type = LP_TYPE_INT, .piggyback = true };
+
+static LP_TELEMETRY_FIELD *telemetrySet[] = { &temperature, &light, &moving, &counter, &msgId };
+
+#define FIELDS (sizeof(telemetrySet) / sizeof(telemetrySet[0]))
+
+// Encodes the pending fields, true if the JSON is `expected`, or nothing was encoded for NULL
+static bool Encodes(const char *expected)
+{
+	char buffer[LP_TELEMETRY_MAX_BYTES];
+	int len = lp_encodeTelemetry(&lp_telemetryJsonEncoder, buffer, sizeof(buffer));
+
+	if (expected == NULL) {
+		return len == 0;
+	}
+	if (len != (int)strlen(expected) || strcmp(buffer, expected) != 0) {
+		fprintf(stderr, "encoded %d '%s', expected '%s'\n", len, len > 0 ? buffer : "", expected);
+		return false;
+	}
+	return true;
+}
+
+static void TestFieldTypes(void)
+{
+	lp_openTelemetrySet(telemetrySet, FIELDS);
+	CHECK(Encodes(NULL));
+
+	// numbers and booleans are unquoted, fields without a value are left out
+	lp_setTelemetryFloat(&temperature, 21.456f);
+	lp_setTelemetryInt(&light, -42);
+	lp_setTelemetryBool(&moving, true);
+	CHECK(Encodes("{\"Temperature\":21.46,\"Light\":-42,\"Moving\":true}"));
+
+	lp_setTelemetryFloat(&temperature, NAN);
+	lp_setTelemetryInt(&light, INT_MIN);
+	lp_setTelemetryBool(&moving, false);
+	lp_setTelemetryInt(&counter, INT_MAX);
+	CHECK(Encodes("{\"Temperature\":null,\"Light\":-2147483648,\"Moving\":false,\"Counter\":2147483647}"));
+
+	lp_closeTelemetrySet();
+}
+
+static void TestReportByException(void)
+{
+	lp_openTelemetrySet(telemetrySet, FIELDS);
+
+	lp_setTelemetryFloat(&temperature, 20.0f);
+	lp_setTelemetryInt(&light, 100);
+	lp_setTelemetryBool(&moving, false);
+	CHECK(Encodes("{\"Temperature\":20.00,\"Light\":100,\"Moving\":false}"));
+
+	// below the threshold since the last encoded value, not since the last set value
+	lp_setTelemetryFloat(&temperature, 20.3f);
+	lp_setTelemetryInt(&light, 109);
+	CHECK(Encodes(NULL));
+	lp_setTelemetryFloat(&temperature, 19.5f);
+	lp_setTelemetryInt(&light, 91);
+	CHECK(Encodes("{\"Temperature\":19.50}"));
+	lp_setTelemetryInt(&light, 90);
+	CHECK(Encodes("{\"Light\":90}"));
+
+	// a boolean on any change, a float on a change to or from not a number
+	lp_setTelemetryBool(&moving, true);
+	CHECK(Encodes("{\"Moving\":true}"));
+	lp_setTelemetryFloat(&temperature, NAN);
+	CHECK(Encodes("{\"Temperature\":null}"));
+	CHECK(Encodes(NULL));
+	lp_setTelemetryFloat(&temperature, 19.5f);
+	CHECK(Encodes("{\"Temperature\":19.50}"));
+
+	// a piggyback field only goes along with another pending field
+	lp_setTelemetryInt(&msgId, 1);
+	CHECK(Encodes(NULL));
+	lp_setTelemetryBool(&moving, false);
+	CHECK(Encodes("{\"Moving\":false,\"MsgId\":1}"));
+	CHECK(Encodes(NULL));
+
+	// a threshold of 0 encodes every time
+	lp_setTelemetryInt(&counter, 5);
+	CHECK(Encodes("{\"Counter\":5,\"MsgId\":1}"));
+	CHECK(Encodes("{\"Counter\":5,\"MsgId\":1}"));
+	lp_closeTelemetrySet();
+
+	// an unchanged field is encoded again after maxSilence seconds
+	LP_TELEMETRY_FIELD *quietSet[] = { &light };
+	lp_openTelemetrySet(quietSet, 1);
+	lp_setTelemetryInt(&light, 90);
+	CHECK(Encodes("{\"Light\":90}"));
+	light.lastEncodedTime -= light.maxSilence / 2;
+	CHECK(Encodes(NULL));
+	light.lastEncodedTime -= light.maxSilence / 2;
+	CHECK(Encodes("{\"Light\":90}"));
+	CHECK(Encodes(NULL));
+	lp_closeTelemetrySet();
+}
+
+static void TestBufferTooSmall(void)
+{
+	static const char expected[] = "{\"Temperature\":-12.25,\"Light\":1000}";
+	char buffer[sizeof(expected)];
+
+	lp_openTelemetrySet(telemetrySet, FIELDS);
+	lp_setTelemetryFloat(&temperature, -12.25f);
+	lp_setTelemetryInt(&light, 1000);
+
+	// every shorter buffer fails and keeps the fields pending
+	for (size_t size = 0; size < sizeof(expected); size++) {
+		CHECK(lp_encodeTelemetry(&lp_telemetryJsonEncoder, buffer, size) == -1);
+	}
+	CHECK(lp_encodeTelemetry(&lp_telemetryJsonEncoder, buffer, sizeof(buffer)) == (int)strlen(expected));
+	CHECK(strcmp(buffer, expected) == 0);
+	CHECK(Encodes(NULL));
+
+	lp_closeTelemetrySet();
+}
+
+// A field without a valid type terminates the app
+static void TestInvalidType(void)
+{
+	static LP_TELEMETRY_FIELD untyped = { .name = "Untyped" };
+	LP_TELEMETRY_FIELD *untypedSet[] = { &temperature, &untyped };
+
+	lp_openTelemetrySet(untypedSet, 2);
+	CHECK(exitCode == ExitCode_OpenTelemetry);
+	lp_closeTelemetrySet();
+}
+
+int main(void)
+{
+	TestFieldTypes();
+	TestReportByException();
+	TestBufferTooSmall();
+	TestInvalidType();
+
+	return CheckResult("telemetry");
+}
@@ -0,0 +1,139 @@
+/* Host simulation of timer coalescing: the Lab 6 A7 timer mix, time compressed, run once without
+   and once with the slack the app gives each timer. Prints the event loop wakeups of both runs. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../timer.h"
+#include "eventloop_host.h"
+
+#define TIME_SCALE 50 // simulated seconds per real second
+#define SIMULATED_SECONDS 150
+
+typedef struct {
+	LP_TIMER timer;
+	struct timespec period;    // as configured in the app
+	struct timespec slack;
+	long startOffsetMs;        // after the first timer, the app starts its timers at different times
+	bool oneShot;              // rearmed from its handler, like DoWork
+	struct timespec oneShotDelay;
+	int count;
+} SIM_TIMER;
+
+static void SimHandler(EventLoopTimer *eventLoopTimer);
+
+static SIM_TIMER simTimers[] = {
+	{.timer.name = "sampleSensorsTimer", .period = {1, 0}, .slack = {0, 100 * 1000 * 1000}, .startOffsetMs = 130},
+	{.timer.name = "logFlush", .period = {1, 0}, .slack = {0, 500 * 1000 * 1000}, .startOffsetMs = 370},
+	{.timer.name = "DoWork", .slack = {0, 500 * 1000 * 1000}, .startOffsetMs = 610, .oneShot = true, .oneShotDelay = {2, 0}}, // idle
+	{.timer.name = "networkConnectionStatusTimer", .period = {5, 0}, .slack = {1, 0}},
+	{.timer.name = "measureSensorTimer", .period = {10, 0}, .slack = {2, 0}},
+	{.timer.name = "rtCoreSend", .period = {30, 0}, .slack = {5, 0}}};
+
+#define SIM_TIMER_COUNT (sizeof(simTimers) / sizeof(simTimers[0]))
+
+static struct timespec Scaled(struct timespec ts)
+{
+	long long ns = ((long long)ts.tv_sec * 1000000000LL + ts.tv_nsec) / TIME_SCALE;
+	return (struct timespec){.tv_sec = (time_t)(ns / 1000000000LL), .tv_nsec = (long)(ns % 1000000000LL)};
+}
+
+static void SleepMs(long ms)
+{
+	struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L};
+	nanosleep(&ts, NULL);
+}
+
+static void RunFor(long durationMs)
+{
+	struct timespec start, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (long elapsed = 0; elapsed < durationMs;) {
+		EventLoop_Run(lp_getTimerEventLoop(), (int)(durationMs - elapsed), true);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+	}
+}
+
+static void SimHandler(EventLoopTimer *eventLoopTimer)
+{
+	ConsumeEventLoopTimerEvent(eventLoopTimer);
+
+	for (size_t i = 0; i < SIM_TIMER_COUNT; i++) {
+		if (simTimers[i].timer.eventLoopTimer == eventLoopTimer) {
+			simTimers[i].count++;
+			if (simTimers[i].oneShot) {
+				struct timespec delay = Scaled(simTimers[i].oneShotDelay);
+				lp_setOneShotTimer(&simTimers[i].timer, &delay);
+			}
+		}
+	}
+}
+
+static unsigned long Simulate(bool coalesce, int counts[])
+{
+	unsigned long wakeupsBefore = eventLoopHostWakeups;
+	long startedMs = 0;
+
+	for (size_t i = 0; i < SIM_TIMER_COUNT; i++) {
+		SIM_TIMER *sim = &simTimers[i];
+		long offsetMs = sim->startOffsetMs / TIME_SCALE;
+
+		SleepMs(offsetMs - startedMs > 0 ? offsetMs - startedMs : 0);
+		startedMs = offsetMs;
+
+		sim->count = 0;
+		sim->timer.handler = SimHandler;
+		sim->timer.period = Scaled(sim->period);
+		sim->timer.slack = coalesce ? Scaled(sim->slack) : (struct timespec){0, 0};
+		lp_startTimer(&sim->timer);
+		if (sim->oneShot) {
+			struct timespec delay = Scaled(sim->oneShotDelay);
+			lp_setOneShotTimer(&sim->timer, &delay);
+		}
+	}
+
+	RunFor(SIMULATED_SECONDS * 1000L / TIME_SCALE);
+
+	for (size_t i = 0; i < SIM_TIMER_COUNT; i++) {
+		lp_stopTimer(&simTimers[i].timer);
+		counts[i] = simTimers[i].count;
+	}
+
+	return eventLoopHostWakeups - wakeupsBefore;
+}
+
+int main(void)
+{
+	int plainCounts[SIM_TIMER_COUNT], coalescedCounts[SIM_TIMER_COUNT];
+	int failures = 0;
+
+	lp_getTimerEventLoop();
+
+	unsigned long plainWakeups = Simulate(false, plainCounts);
+	unsigned long coalescedWakeups = Simulate(true, coalescedCounts);
+
+	printf("%d simulated seconds of the Lab 6 timers\n", SIMULATED_SECONDS);
+	printf("%-30s %10s %10s\n", "timer", "no slack", "slack");
+	for (size_t i = 0; i < SIM_TIMER_COUNT; i++) {
+		printf("%-30s %10d %10d\n", simTimers[i].timer.name, plainCounts[i], coalescedCounts[i]);
+
+		// Slack delays single expiries of periodic timers, it does not change their rate
+		if (!simTimers[i].oneShot && abs(plainCounts[i] - coalescedCounts[i]) > 1) {
+			fprintf(stderr, "%s ran %d times without slack and %d times with\n", simTimers[i].timer.name,
+					plainCounts[i], coalescedCounts[i]);
+			failures++;
+		}
+	}
+	printf("%-30s %10lu %10lu\n", "wakeups", plainWakeups, coalescedWakeups);
+
+	if (coalescedWakeups >= plainWakeups) {
+		fprintf(stderr, "slack did not reduce the wakeups\n");
+		failures++;
+	}
+
+	lp_stopTimerEventLoop();
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
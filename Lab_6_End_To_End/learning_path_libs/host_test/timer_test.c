@@ -0,0 +1,177 @@
+/* Host tests of the LP_TIMER multiplexing, all timers of the event loop share one timerfd. */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../timer.h"
+#include "eventloop_host.h"
+#include "check.h"
+
+static int OpenFdCount(void)
+{
+	int count = 0;
+	DIR *dir = opendir("/proc/self/fd");
+
+	if (dir == NULL) {
+		return -1;
+	}
+	while (readdir(dir) != NULL) {
+		count++;
+	}
+	closedir(dir);
+	return count;
+}
+
+static long ElapsedMs(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void RunFor(long durationMs)
+{
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (long elapsed = 0; elapsed < durationMs; elapsed = ElapsedMs(&start)) {
+		EventLoop_Run(lp_getTimerEventLoop(), (int)(durationMs - elapsed), true);
+	}
+}
+
+// Handlers record their calls
+static int fastCount, mediumCount, slowCount, oneShotCount, selfRearmCount;
+static int order[4], orderCount;
+
+static void FastHandler(EventLoopTimer *timer)
+{
+	CHECK(ConsumeEventLoopTimerEvent(timer) == 0);
+	fastCount++;
+}
+
+static void MediumHandler(EventLoopTimer *timer)
+{
+	CHECK(ConsumeEventLoopTimerEvent(timer) == 0);
+	mediumCount++;
+}
+
+static void SlowHandler(EventLoopTimer *timer)
+{
+	CHECK(ConsumeEventLoopTimerEvent(timer) == 0);
+	slowCount++;
+}
+
+static void OneShotHandler(EventLoopTimer *timer)
+{
+	CHECK(ConsumeEventLoopTimerEvent(timer) == 0);
+	oneShotCount++;
+}
+
+static LP_TIMER fastTimer = {.period = {0, 10 * 1000 * 1000}, .name = "fast", .handler = FastHandler};
+static LP_TIMER mediumTimer = {.period = {0, 25 * 1000 * 1000}, .name = "medium", .handler = MediumHandler};
+static LP_TIMER slowTimer = {.period = {0, 50 * 1000 * 1000}, .name = "slow", .handler = SlowHandler};
+static LP_TIMER oneShotTimer = {.period = {0, 0}, .name = "oneShot", .handler = OneShotHandler};
+
+#define ORDER_HANDLER(n)                                                       \
+	static void OrderHandler##n(EventLoopTimer *timer)                         \
+	{                                                                          \
+		ConsumeEventLoopTimerEvent(timer);                                     \
+		order[orderCount++] = n;                                               \
+	}
+ORDER_HANDLER(0)
+ORDER_HANDLER(1)
+ORDER_HANDLER(2)
+ORDER_HANDLER(3)
+
+static LP_TIMER orderTimers[4] = {
+	{.handler = OrderHandler0, .name = "order0"},
+	{.handler = OrderHandler1, .name = "order1"},
+	{.handler = OrderHandler2, .name = "order2"},
+	{.handler = OrderHandler3, .name = "order3"}};
+
+// Rearms itself twice from its own handler, then stops the fast timer
+static LP_TIMER selfRearmTimer;
+static void SelfRearmHandler(EventLoopTimer *timer)
+{
+	ConsumeEventLoopTimerEvent(timer);
+	if (++selfRearmCount < 3) {
+		lp_setOneShotTimer(&selfRearmTimer, &(struct timespec){0, 5 * 1000 * 1000});
+	} else {
+		lp_stopTimer(&fastTimer);
+	}
+}
+static LP_TIMER selfRearmTimer = {.handler = SelfRearmHandler, .name = "selfRearm"};
+
+static LP_TIMER *timerSet[] = {&fastTimer, &mediumTimer, &slowTimer, &oneShotTimer};
+
+int main(void)
+{
+	lp_getTimerEventLoop();
+	int baselineFds = OpenFdCount();
+
+	// Four timers, one timerfd
+	lp_startTimerSet(timerSet, sizeof(timerSet) / sizeof(timerSet[0]));
+	CHECK(OpenFdCount() == baselineFds + 1);
+
+	CHECK(lp_setOneShotTimer(&oneShotTimer, &(struct timespec){0, 30 * 1000 * 1000}));
+
+	unsigned long wakeupsBefore = eventLoopHostWakeups;
+	RunFor(500);
+	unsigned long wakeups = eventLoopHostWakeups - wakeupsBefore;
+	int handlerCalls = fastCount + mediumCount + slowCount + oneShotCount;
+
+	printf("periodic 10/25/50 ms over 500 ms: %d/%d/%d calls, one-shot %d, %lu wakeups for %d handler calls\n",
+		fastCount, mediumCount, slowCount, oneShotCount, wakeups, handlerCalls);
+	CHECK(fastCount >= 45 && fastCount <= 50);
+	CHECK(mediumCount >= 18 && mediumCount <= 20);
+	CHECK(slowCount >= 9 && slowCount <= 10);
+	CHECK(oneShotCount == 1);
+	// Timers due together (every 50 ms all three periodic ones) run in one wakeup
+	CHECK(wakeups < (unsigned long)handlerCalls);
+
+	// Changing the period moves the deadline
+	int slowBefore = slowCount;
+	CHECK(lp_changeTimer(&slowTimer, &(struct timespec){0, 20 * 1000 * 1000}));
+	RunFor(200);
+	CHECK(slowCount - slowBefore >= 8 && slowCount - slowBefore <= 10);
+
+	// One-shots run in deadline order whatever the arming order
+	const long delaysMs[4] = {40, 10, 30, 20};
+	for (int i = 0; i < 4; i++) {
+		CHECK(lp_startTimer(&orderTimers[i]));
+		CHECK(lp_setOneShotTimer(&orderTimers[i], &(struct timespec){0, delaysMs[i] * 1000 * 1000}));
+	}
+	RunFor(60);
+	CHECK(orderCount == 4);
+	CHECK(order[0] == 1 && order[1] == 3 && order[2] == 2 && order[3] == 0);
+
+	// A handler rearms itself and stops another timer
+	CHECK(lp_startTimer(&selfRearmTimer));
+	CHECK(lp_setOneShotTimer(&selfRearmTimer, &(struct timespec){0, 5 * 1000 * 1000}));
+	RunFor(50);
+	CHECK(selfRearmCount == 3);
+	CHECK(fastTimer.eventLoopTimer == NULL);
+	int fastAfterStop = fastCount;
+	RunFor(30);
+	CHECK(fastCount == fastAfterStop);
+
+	// Stopping every timer releases the shared timerfd
+	lp_stopTimerSet();
+	lp_stopTimer(&selfRearmTimer);
+	for (int i = 0; i < 4; i++) {
+		lp_stopTimer(&orderTimers[i]);
+	}
+	CHECK(OpenFdCount() == baselineFds);
+
+	// And the next timer creates it again
+	CHECK(lp_startTimer(&mediumTimer));
+	CHECK(OpenFdCount() == baselineFds + 1);
+	lp_stopTimer(&mediumTimer);
+
+	lp_stopTimerEventLoop();
+
+	return CheckResult("timer");
+}
@@ -0,0 +1,127 @@
+/* Host tests of the worker pool: done runs on the event loop thread, timers keep firing while the workers
+   block, an item can be resubmitted from done, and lp_waitForWork for shutdown. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../timer.h"
+#include "../worker_pool.h"
+#include "eventloop_host.h"
+#include "check.h"
+
+static double NowMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+static pthread_t loopThread;
+
+// Stands in for a blocking I2C transfer or DPS registration
+#define BLOCKING_MS 200
+
+static int workRuns;
+static int doneRuns;
+static int resubmits;
+static bool workOnLoopThread;
+static bool doneOffLoopThread;
+
+static void BlockingWork(LP_WORK_ITEM *item)
+{
+	workOnLoopThread |= pthread_equal(pthread_self(), loopThread);
+	__atomic_add_fetch(&workRuns, 1, __ATOMIC_SEQ_CST);
+	usleep(BLOCKING_MS * 1000);
+}
+
+static void WorkDone(LP_WORK_ITEM *item)
+{
+	doneOffLoopThread |= !pthread_equal(pthread_self(), loopThread);
+	doneRuns++;
+
+	// Chained steps, like the sensor initialization
+	if (item->context != NULL && resubmits < 2) {
+		resubmits++;
+		CHECK(lp_submitWork(item));
+	}
+}
+
+static LP_WORK_ITEM firstWork = {.name = "first", .work = BlockingWork, .done = WorkDone};
+static LP_WORK_ITEM secondWork = {.name = "second", .work = BlockingWork, .done = WorkDone};
+static LP_WORK_ITEM chainedWork = {.name = "chained", .work = BlockingWork, .done = WorkDone, .context = &chainedWork};
+static LP_WORK_ITEM queuedWork = {.name = "queued", .work = BlockingWork, .done = WorkDone};
+
+// 10 ms timer, must keep its rate while the workers block
+static int ticks;
+static void TickHandler(EventLoopTimer *t)
+{
+	ConsumeEventLoopTimerEvent(t);
+	ticks++;
+}
+static LP_TIMER tickTimer = {.name = "tick", .period = {0, 10 * 1000 * 1000}, .handler = TickHandler};
+
+static void RunWhilePending(LP_WORK_ITEM *item, long timeoutMs)
+{
+	double start = NowMs();
+	while (lp_isWorkPending(item) && NowMs() - start < timeoutMs) {
+		EventLoop_Run(lp_getTimerEventLoop(), 10, true);
+	}
+}
+
+int main(void)
+{
+	loopThread = pthread_self();
+	lp_getTimerEventLoop();
+	CHECK(lp_startTimer(&tickTimer));
+
+	// Two items run side by side, the event loop keeps serving the timer
+	double start = NowMs();
+	CHECK(lp_submitWork(&firstWork));
+	CHECK(lp_submitWork(&secondWork));
+	CHECK(!lp_submitWork(&firstWork));
+	CHECK(lp_isWorkPending(&firstWork));
+	RunWhilePending(&firstWork, 2000);
+	RunWhilePending(&secondWork, 2000);
+	double elapsedMs = NowMs() - start;
+
+	printf("2 x %d ms of blocking work done after %.1f ms, %d timer ticks meanwhile\n", BLOCKING_MS, elapsedMs, ticks);
+	CHECK(workRuns == 2 && doneRuns == 2);
+	CHECK(!workOnLoopThread && !doneOffLoopThread);
+	CHECK(elapsedMs < 2 * BLOCKING_MS);
+	CHECK(ticks >= BLOCKING_MS / 10 / 2);
+	CHECK(firstWork.state == LP_WORK_IDLE && secondWork.state == LP_WORK_IDLE);
+
+	// Resubmitted from done
+	workRuns = doneRuns = 0;
+	CHECK(lp_submitWork(&chainedWork));
+	RunWhilePending(&chainedWork, 2000);
+	CHECK(workRuns == 3 && doneRuns == 3 && resubmits == 2);
+
+	// Shutdown: waits for running items, drops queued ones without done
+	workRuns = doneRuns = 0;
+	CHECK(lp_submitWork(&firstWork));
+	CHECK(lp_submitWork(&secondWork));
+	CHECK(lp_submitWork(&queuedWork));
+	usleep(20 * 1000);
+	lp_waitForWork(&queuedWork);
+	CHECK(queuedWork.state == LP_WORK_IDLE);
+	lp_waitForWork(&firstWork);
+	CHECK(firstWork.state == LP_WORK_COMPLETED);
+	lp_waitForWork(&secondWork);
+	RunWhilePending(&firstWork, 2000);
+	RunWhilePending(&secondWork, 2000);
+	CHECK(workRuns == 2 && doneRuns == 2);
+
+	lp_stopWorkerPool();
+	CHECK(lp_submitWork(&firstWork));
+	lp_waitForWork(&firstWork);
+	lp_stopWorkerPool();
+
+	lp_stopTimer(&tickTimer);
+	lp_stopTimerEventLoop();
+
+	return CheckResult("worker pool");
+}
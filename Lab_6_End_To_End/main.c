@@ -36,10 +36,14 @@
 #include "hw/azure_sphere_learning_path.h"
 
 #include "learning_path_libs/azure_iot.h"
+#include "learning_path_libs/boot_profile.h"
 #include "learning_path_libs/exit_codes.h"
 #include "learning_path_libs/globals.h"
+#include "learning_path_libs/handler_stats.h"
+#include "learning_path_libs/init_graph.h"
 #include "learning_path_libs/inter_core.h"
 #include "learning_path_libs/peripheral_gpio.h"
+#include "learning_path_libs/telemetry_template.h"
 #include "learning_path_libs/terminate.h"
 #include "learning_path_libs/timer.h"
 
@@ -64,19 +68,46 @@
 #include "learning_path_libs/SEEED_STUDIO/board.h"
 #endif // SEEED_STUDIO
 
-#define JSON_MESSAGE_BYTES 128  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+#define JSON_MESSAGE_BYTES 512  // Number of bytes to allocate for the JSON telemetry message for IoT Central
+
+// The sensor telemetry is JSON for IoT Central, LP_TELEMETRY_CBOR sends it as CBOR for an IoT Hub route that decodes it
+#ifdef LP_TELEMETRY_CBOR
+#define TELEMETRY_ENCODER lp_telemetryCborEncoder
+#else
+#define TELEMETRY_ENCODER lp_telemetryJsonEncoder
+#endif
+
+#define INTER_CORE_TELEMETRY(FIELD) \
+	FIELD(Temperature, LP_TELEMETRY_FLOAT_STRING, 2) \
+	FIELD(Pressure, LP_TELEMETRY_FLOAT_STRING, 1) \
+	FIELD(MsgId, LP_TELEMETRY_INT, 0)
+
+LP_TELEMETRY_SCHEMA(InterCoreTelemetry, INTER_CORE_TELEMETRY)
 
 // Forward signatures
 static void InitPeripheralGpiosAndHandlers(void);
+static bool StartDevKit(void);
+static bool OpenPeripheralGpios(void);
+static bool OpenCloudBindings(void);
+static bool StartTimers(void);
+static bool StartCloud(void);
+static bool StartInterCore(void);
+static void InitReadyHandler(void);
 static void ClosePeripheralGpiosAndHandlers(void);
 static void Led2OffHandler(EventLoopTimer* eventLoopTimer);
 static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer);
+static void MeasureSensors(void);
+static void DeviceTwinTelemetryPeriodHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
 static void NetworkConnectionStatusHandler(EventLoopTimer* eventLoopTimer);
 static void ResetDeviceHandler(EventLoopTimer* eventLoopTimer);
 static void DeviceTwinRelay1RateHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding);
-static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, char** responseMsg);
+static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, LP_DIRECT_METHOD_RESPONSE* response);
 static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block);
 static void RealTimeCoreHeartBeat(EventLoopTimer* eventLoopTimer);
+#ifdef LP_HANDLER_STATS
+static void HandlerStatsHandler(EventLoopTimer* eventLoopTimer);
+static LP_DirectMethodResponseCode HandlerStatsDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, LP_DIRECT_METHOD_RESPONSE* response);
+#endif // LP_HANDLER_STATS
 
 static char msgBuffer[JSON_MESSAGE_BYTES] = { 0 };
 static const char cstrJsonEvent[] = "{\"%s\":\"occurred\"}";
@@ -95,24 +126,47 @@ static LP_PERIPHERAL_GPIO relay1 = { .pin = RELAY, .direction = LP_OUTPUT, .init
 
 // Timers
 static LP_TIMER led2BlinkOffOneShotTimer = { .period = { 0, 0 }, .name = "led2BlinkOffOneShotTimer", .handler = Led2OffHandler };
-static LP_TIMER networkConnectionStatusTimer = { .period = { 5, 0 }, .name = "networkConnectionStatusTimer", .handler = NetworkConnectionStatusHandler };
-static LP_TIMER measureSensorTimer = { .period = { 10, 0 }, .name = "measureSensorTimer", .handler = MeasureSensorHandler };
+static LP_TIMER networkConnectionStatusTimer = { .period = { 5, 0 }, .slack = { 1, 0 }, .name = "networkConnectionStatusTimer", .handler = NetworkConnectionStatusHandler };
+static LP_TIMER measureSensorTimer = { .period = { 10, 0 }, .slack = { 2, 0 }, .name = "measureSensorTimer", .handler = MeasureSensorHandler };
 static LP_TIMER resetDeviceOneShotTimer = { .period = { 0, 0 }, .name = "resetDeviceOneShotTimer", .handler = ResetDeviceHandler };
-static LP_TIMER realTimeCoreHeatBeatTimer = { .period = { 30, 0 }, .name = "rtCoreSend", .handler = RealTimeCoreHeartBeat };
+static LP_TIMER realTimeCoreHeatBeatTimer = { .period = { 30, 0 }, .slack = { 5, 0 }, .name = "rtCoreSend", .handler = RealTimeCoreHeartBeat };
+#ifdef LP_HANDLER_STATS
+static LP_TIMER handlerStatsTimer = { .period = { 300, 0 }, .slack = { 30, 0 }, .name = "handlerStats", .handler = HandlerStatsHandler };
+#endif // LP_HANDLER_STATS
 
 // Azure IoT Device Twins
+static LP_DEVICE_TWIN_BINDING telemetryPeriod = { .twinProperty = "TelemetryPeriod", .twinType = LP_TYPE_INT, .handler = DeviceTwinTelemetryPeriodHandler, .deltaThreshold = 1 };
 static LP_DEVICE_TWIN_BINDING buttonPressed = { .twinProperty = "ButtonPressed", .twinType = LP_TYPE_STRING };
-static LP_DEVICE_TWIN_BINDING relay1DeviceTwin = { .twinProperty = "Relay1", .twinType = LP_TYPE_BOOL, .handler = DeviceTwinRelay1RateHandler };
+static LP_DEVICE_TWIN_BINDING relay1DeviceTwin = { .twinProperty = "Relay1", .twinType = LP_TYPE_BOOL, .handler = DeviceTwinRelay1RateHandler, .deltaThreshold = 1 };
 static LP_DEVICE_TWIN_BINDING deviceResetUtc = { .twinProperty = "DeviceResetUTC", .twinType = LP_TYPE_STRING };
 
 // Azure IoT Direct Methods
 static LP_DIRECT_METHOD_BINDING resetDevice = { .methodName = "ResetMethod", .handler = ResetDirectMethodHandler };
+#ifdef LP_HANDLER_STATS
+static LP_DIRECT_METHOD_BINDING handlerStatsMethod = { .methodName = "HandlerStats", .handler = HandlerStatsDirectMethodHandler, .responseBytes = 2048 };
+#endif // LP_HANDLER_STATS
 
 // Initialize Sets
 LP_PERIPHERAL_GPIO* peripheralGpioSet[] = { &led2, &networkConnectedLed, &relay1 };
+#ifdef LP_HANDLER_STATS
+LP_TIMER* timerSet[] = { &led2BlinkOffOneShotTimer, &networkConnectionStatusTimer, &resetDeviceOneShotTimer, &measureSensorTimer, &realTimeCoreHeatBeatTimer, &handlerStatsTimer };
+LP_DIRECT_METHOD_BINDING* directMethodBindingSet[] = { &resetDevice, &handlerStatsMethod };
+#else
 LP_TIMER* timerSet[] = { &led2BlinkOffOneShotTimer, &networkConnectionStatusTimer, &resetDeviceOneShotTimer, &measureSensorTimer, &realTimeCoreHeatBeatTimer };
-LP_DEVICE_TWIN_BINDING* deviceTwinBindingSet[] = { &buttonPressed, &relay1DeviceTwin };
 LP_DIRECT_METHOD_BINDING* directMethodBindingSet[] = { &resetDevice };
+#endif // LP_HANDLER_STATS
+LP_DEVICE_TWIN_BINDING* deviceTwinBindingSet[] = { &telemetryPeriod, &buttonPressed, &relay1DeviceTwin };
+
+// Initialization graph, the sensors, the cloud connection and the real-time core come up side by side.
+// The app is ready for its first telemetry message once the sensors are calibrated and IoT Hub authenticated the device.
+static LP_INIT_NODE devKitInit = { .name = "devKit", .start = StartDevKit, .async = true, .critical = true };
+static LP_INIT_NODE gpioInit = { .name = "gpio", .start = OpenPeripheralGpios };
+static LP_INIT_NODE cloudBindingsInit = { .name = "cloudBindings", .start = OpenCloudBindings };
+static LP_INIT_NODE timersInit = { .name = "timers", .start = StartTimers, .dependsOn = (LP_INIT_NODE*[]){ &gpioInit, NULL } };
+static LP_INIT_NODE cloudInit = { .name = "cloud", .start = StartCloud, .async = true, .critical = true,
+	.dependsOn = (LP_INIT_NODE*[]){ &cloudBindingsInit, NULL } };
+static LP_INIT_NODE interCoreInit = { .name = "interCore", .start = StartInterCore, .async = true };
+LP_INIT_NODE* initSet[] = { &devKitInit, &gpioInit, &cloudBindingsInit, &timersInit, &cloudInit, &interCoreInit };
 
 
 int main(int argc, char* argv[])
@@ -156,9 +210,17 @@ static void NetworkConnectionStatusHandler(EventLoopTimer* eventLoopTimer)
 		return;
 	}
 
+	static bool bootProfileSent = false;
+
 	if (lp_connectToAzureIot())
 	{
 		lp_gpioOn(&networkConnectedLed);
+
+		// One-off, the boot profile goes out once the app is ready
+		if (!bootProfileSent && lp_isInitReady() && lp_bootProfileToJson(msgBuffer, sizeof(msgBuffer)) > 0)
+		{
+			bootProfileSent = lp_sendMsg(msgBuffer);
+		}
 	}
 	else
 	{
@@ -166,15 +228,23 @@ static void NetworkConnectionStatusHandler(EventLoopTimer* eventLoopTimer)
 	}
 }
 
+/// <summary>
+/// Turn on LED2 and set a one shot timer to turn it off
+/// </summary>
+static void Led2Blink(void)
+{
+	lp_gpioOn(&led2);
+	lp_setOneShotTimer(&led2BlinkOffOneShotTimer, &led2BlinkPeriod);
+}
+
 /// <summary>
 /// Turn on LED2, send message to Azure IoT and set a one shot timer to turn LED2 off
 /// </summary>
 static void SendMsgLed2On(char* message)
 {
-	lp_gpioOn(&led2);
+	Led2Blink();
 	Log_Debug("%s\n", message);
 	lp_sendMsg(message);
-	lp_setOneShotTimer(&led2BlinkOffOneShotTimer, &led2BlinkPeriod);
 }
 
 /// <summary>
@@ -201,13 +271,38 @@ static void MeasureSensorHandler(EventLoopTimer* eventLoopTimer)
 		return;
 	}
 
-	ic_control_block.cmd = LP_IC_TEMPERATURE_HUMIDITY;
+	MeasureSensors();
+}
+
+/// <summary>
+/// Read sensor and send to Azure IoT
+/// </summary>
+static void MeasureSensors(void)
+{
+	int len = lp_sendDevKitTelemetry(&TELEMETRY_ENCODER);
 
+	if (len > 0)
+	{
+		Log_Debug("Telemetry sent, %d bytes of %s\n", len, TELEMETRY_ENCODER.contentType);
+		Led2Blink();
+	}
+}
 
+/// <summary>
+/// Set the telemetry period in seconds using Device Twin "TelemetryPeriod": {"value": 60}, the sensors are sampled
+/// every second in between and each message carries the aggregates of the samples since the last message
+/// </summary>
+static void DeviceTwinTelemetryPeriodHandler(LP_DEVICE_TWIN_BINDING* deviceTwinBinding)
+{
+	int seconds = *(int*)deviceTwinBinding->twinState;
 
-	if (lp_readTelemetry(msgBuffer, JSON_MESSAGE_BYTES) > 0)
+	if (seconds > 0 && seconds <= 3600)
 	{
-		SendMsgLed2On(msgBuffer);
+		lp_changeTimer(&measureSensorTimer, &(struct timespec){ seconds, 0 });
+	}
+	else
+	{
+		Log_Debug("\nTelemetryPeriod out of range: %d\n", seconds);
 	}
 }
 
@@ -253,15 +348,11 @@ static void ResetDeviceHandler(EventLoopTimer* eventLoopTimer)
 /// <summary>
 /// Start Device Power Restart Direct Method 'ResetMethod' {"reset_timer":5}
 /// </summary>
-static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, char** responseMsg)
+static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, LP_DIRECT_METHOD_RESPONSE* response)
 {
 	const char propertyName[] = "reset_timer";
-	const size_t responseLen = 60; // Allocate and initialize a response message buffer. The calling function is responsible for the freeing memory
 	static struct timespec period;
 
-	*responseMsg = (char*)malloc(responseLen);
-	memset(*responseMsg, 0, responseLen);
-
 	if (!json_object_has_value_of_type(json, propertyName, JSONNumber))
 	{
 		return LP_METHOD_FAILED;
@@ -275,7 +366,7 @@ static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, L
 		lp_deviceTwinReportState(&deviceResetUtc, lp_getCurrentUtc(msgBuffer, sizeof(msgBuffer)));			// TYPE_STRING
 
 		// Create Direct Method Response
-		snprintf(*responseMsg, responseLen, "%s called. Reset in %d seconds", directMethodBinding->methodName, seconds);
+		lp_setDirectMethodMessage(response, "%s called. Reset in %d seconds", directMethodBinding->methodName, seconds);
 
 		// Set One Shot LP_TIMER
 		period = (struct timespec){ .tv_sec = seconds, .tv_nsec = 0 };
@@ -285,20 +376,67 @@ static LP_DirectMethodResponseCode ResetDirectMethodHandler(JSON_Object* json, L
 	}
 	else
 	{
-		snprintf(*responseMsg, responseLen, "%s called. Reset Failed. Seconds out of range: %d", directMethodBinding->methodName, seconds);
+		lp_setDirectMethodMessage(response, "%s called. Reset Failed. Seconds out of range: %d", directMethodBinding->methodName, seconds);
 		return LP_METHOD_FAILED;
 	}
 }
 
+#ifdef LP_HANDLER_STATS
+/// <summary>
+/// Send the handler stats since the last message and start a new window
+/// </summary>
+static bool SendHandlerStats(void)
+{
+	static char statsBuffer[2048];
+
+	if (lp_handlerStatsToJson(statsBuffer, sizeof(statsBuffer)) == 0)
+	{
+		Log_Debug("Handler stats do not fit in %zu bytes\n", sizeof(statsBuffer));
+		return false;
+	}
+
+	if (!lp_sendMsg(statsBuffer))
+	{
+		return false;
+	}
+
+	lp_handlerStatsReset();
+	return true;
+}
+
+static void HandlerStatsHandler(EventLoopTimer* eventLoopTimer)
+{
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0)
+	{
+		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+		return;
+	}
+	SendHandlerStats();
+}
+
+/// <summary>
+/// Respond with the handler stats of the current window, Direct Method 'HandlerStats' {}
+/// </summary>
+static LP_DirectMethodResponseCode HandlerStatsDirectMethodHandler(JSON_Object* json, LP_DIRECT_METHOD_BINDING* directMethodBinding, LP_DIRECT_METHOD_RESPONSE* response)
+{
+	response->length = lp_handlerStatsToJson(response->buffer, response->size);
+	response->overflow = response->length == 0;
+
+	return LP_METHOD_SUCCEEDED;
+}
+#endif // LP_HANDLER_STATS
+
 /// <summary>
 /// Callback handler for Inter-Core Messaging - Does Device Twin Update, and Event Message
 /// </summary>
 static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
 {
-	static const char* MsgTemplate = "{ \"Temperature\": \"%3.2f\", \"Pressure\":\"%3.1f\", \"MsgId\":%d }";
-	static msgId = 0;
+	static int msgId = 0;
+	InterCoreTelemetry telemetry;
 	int len = 0;
 
+	lp_initNodeDone(&interCoreInit, true);
+
 	switch (ic_control_block.cmd)
 	{
 	case LP_IC_EVENT_BUTTON_A:
@@ -309,8 +447,9 @@ static void InterCoreHandler(LP_INTER_CORE_BLOCK* ic_message_block)
 		len = snprintf(msgBuffer, JSON_MESSAGE_BYTES, cstrJsonEvent, "ButtonB");
 		lp_deviceTwinReportState(&buttonPressed, "ButtonB");					// TwinType = TYPE_STRING
 		break;
-	case LP_IC_TEMPERATURE_HUMIDITY:		
-		len = snprintf(msgBuffer, JSON_MESSAGE_BYTES, MsgTemplate, ic_control_block.temperature, ic_control_block.pressure, msgId++);
+	case LP_IC_TEMPERATURE_PRESSURE_HUMIDITY:
+		telemetry = (InterCoreTelemetry){ .Temperature = ic_control_block.temperature, .Pressure = ic_control_block.pressure, .MsgId = msgId++ };
+		len = InterCoreTelemetry_serialize(&telemetry, msgBuffer, JSON_MESSAGE_BYTES);
 		break;
 	default:
 		break;
@@ -343,19 +482,73 @@ static void RealTimeCoreHeartBeat(EventLoopTimer* eventLoopTimer)
 /// <returns>0 on success, or -1 on failure</returns>
 static void InitPeripheralGpiosAndHandlers(void)
 {
-	lp_initializeDevKit();
+	lp_startInitGraph(initSet, NELEMS(initSet), InitReadyHandler);
+}
 
+/// <summary>
+/// Critical path complete, send the first telemetry now rather than a measure period later
+/// </summary>
+static void InitReadyHandler(void)
+{
+	lp_bootProfileDone();
+	MeasureSensors();
+}
+
+static void DevKitReadyHandler(bool ready)
+{
+	lp_initNodeDone(&devKitInit, ready);
+}
+
+static bool StartDevKit(void)
+{
+	lp_setDevKitReadyHandler(DevKitReadyHandler);
+	return lp_initializeDevKit();
+}
+
+static bool OpenPeripheralGpios(void)
+{
 	lp_openPeripheralGpioSet(peripheralGpioSet, NELEMS(peripheralGpioSet));
+	return true;
+}
+
+static bool OpenCloudBindings(void)
+{
 	lp_openDeviceTwinSet(deviceTwinBindingSet, NELEMS(deviceTwinBindingSet));
 	lp_openDirectMethodSet(directMethodBindingSet, NELEMS(directMethodBindingSet));
+	return true;
+}
 
+static bool StartTimers(void)
+{
 	lp_startTimerSet(timerSet, NELEMS(timerSet));
+	return lp_logStart();
+}
+
+static void AzureConnectionStateHandler(LP_AZURE_CONNECTION_STATE state)
+{
+	if (state == LP_AZURE_AUTHENTICATED)
+	{
+		lp_initNodeDone(&cloudInit, true);
+	}
+}
+
+static bool StartCloud(void)
+{
+	// DPS provisioning, or the cached IoT Hub, and authentication continue from the event loop
+	lp_setAzureConnectionStateHandler(AzureConnectionStateHandler);
 	lp_startCloudToDevice();
+	return true;
+}
 
+static bool StartInterCore(void)
+{
 	lp_enableInterCoreCommunications(rtAppComponentId, InterCoreHandler);  // Initialize Inter Core Communications
 
 	ic_control_block.cmd = LP_IC_HEARTBEAT;		// Prime RT Core with Component ID Signature
 	lp_sendInterCoreMessage(&ic_control_block);  
+
+	// The handshake completes with the first message from the real-time core, see InterCoreHandler
+	return true;
 }
 
 /// <summary>
@@ -367,6 +560,7 @@ static void ClosePeripheralGpiosAndHandlers(void)
 
 	lp_stopTimerSet();
 	lp_stopCloudToDevice();
+	lp_logStop();
 
 	lp_closePeripheralGpioSet();
 	lp_closeDeviceTwinSet();
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Decode deferred-format binary logs (LP_LOG with LP_LOG_BINARY defined).
+
+The format strings are read from the lp_log_fmt section of the application ELF, the
+records from "LPLOG:" lines in the captured debug (high-level app) or UART (real-time app)
+output. Works for both the A7 and the M4 images.
+
+usage: lp_log_decode.py <app.out> [captured_log.txt]     (reads stdin when no log file given)
+"""
+
+import re
+import struct
+import sys
+
+FORMAT_SECTION = "lp_log_fmt"
+DROPPED_ID = 0xFFFFFFFF
+SPECIFIER = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diuxXoeEfFgGcsp%])")
+
+
+def read_format_section(elf_path):
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF":
+        raise ValueError("%s is not an ELF file" % elf_path)
+
+    is64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        header = endian + "IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        header = endian + "IIIIIIIIII"
+
+    sections = [struct.unpack_from(header, elf, shoff + i * shentsize) for i in range(shnum)]
+    names_offset = sections[shstrndx][4]
+
+    for section in sections:
+        name_start = names_offset + section[0]
+        name = elf[name_start:elf.index(b"\0", name_start)].decode()
+        if name == FORMAT_SECTION:
+            offset, size = section[4], section[5]
+            return elf[offset:offset + size]
+
+    raise ValueError("%s has no %s section, was it built with LP_LOG_BINARY?" % (elf_path, FORMAT_SECTION))
+
+
+def format_string(section, format_id):
+    end = section.index(b"\0", format_id)
+    return section[format_id:end].decode(errors="replace")
+
+
+def expand(fmt, args):
+    values = iter(args)
+
+    def convert(match):
+        flags, _, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        raw = next(values, 0)
+        if conversion in "di":
+            return ("%" + flags + "d") % struct.unpack("<i", struct.pack("<I", raw))[0]
+        if conversion in "eEfFgG":
+            return ("%" + flags + conversion) % struct.unpack("<f", struct.pack("<I", raw))[0]
+        if conversion == "c":
+            return chr(raw & 0xFF)
+        if conversion in "sp":
+            return "0x%08X" % raw
+        return ("%" + flags + conversion) % raw
+
+    return SPECIFIER.sub(convert, fmt)
+
+
+def decode_line(section, line):
+    record = line[line.index("LPLOG:") + 6:].strip()
+    format_id = int(record[0:8], 16)
+    timestamp = int(record[8:16], 16)
+    arg_count = int(record[16:18], 16)
+    args = [int(record[18 + i * 8:26 + i * 8], 16) for i in range(arg_count)]
+
+    if format_id == DROPPED_ID:
+        text = "<%d log records dropped>\n" % args[0]
+    else:
+        text = expand(format_string(section, format_id), args)
+
+    return "[%10u] %s" % (timestamp, text)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+
+    section = read_format_section(sys.argv[1])
+    log = open(sys.argv[2], errors="replace") if len(sys.argv) > 2 else sys.stdin
+
+    for line in log:
+        if "LPLOG:" in line:
+            sys.stdout.write(decode_line(section, line))
+        else:
+            sys.stdout.write(line)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,9 +1,15 @@
 #include "board.h"
 
+static LP_TELEMETRY_FIELD temperatureTelemetry = { .name = "Temperature", .type = LP_TYPE_FLOAT, .unit = "degC", .precision = 2 };
+static LP_TELEMETRY_FIELD humidityTelemetry = { .name = "Humidity", .type = LP_TYPE_FLOAT, .unit = "%", .precision = 1 };
+static LP_TELEMETRY_FIELD msgIdTelemetry = { .name = "MsgId", .type = LP_TYPE_INT };
+
+static LP_TELEMETRY_FIELD* telemetrySet[] = { &temperatureTelemetry, &humidityTelemetry, &msgIdTelemetry };
+
 /// <summary>
-///     Reads telemetry and returns the length of JSON data.
+///     Reads the sensors into the telemetry fields
 /// </summary>
-int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
+static void ReadTelemetry(void) {
 	static int msgId = 0;
 	float temperature;
 	float humidity;	
@@ -12,18 +18,53 @@ int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
 	temperature = (float)(25.0 + rnd);
 	humidity = (float)(50.0 + rnd);
 
-	static const char* MsgTemplate = "{ \"Temperature\": \"%3.2f\", \"Humidity\": \"%3.1f\", \"MsgId\":%d }";
-	return snprintf(msgBuffer, bufferLen, MsgTemplate, temperature, humidity, msgId++);
+	lp_setTelemetryFloat(&temperatureTelemetry, temperature);
+	lp_setTelemetryFloat(&humidityTelemetry, humidity);
+	lp_setTelemetryInt(&msgIdTelemetry, msgId++);
+}
+
+/// <summary>
+///     Reads telemetry and returns the length of JSON data.
+/// </summary>
+int lp_readTelemetry(char * msgBuffer, size_t bufferLen) {
+	ReadTelemetry();
+	return lp_encodeTelemetry(&lp_telemetryJsonEncoder, msgBuffer, bufferLen);
+}
+
+/// <summary>
+///     Reads telemetry and sends it with the encoder, JSON or CBOR. Returns the sent length, 0 if no field
+///     changed beyond its deltaThreshold, or -1 if sending failed.
+/// </summary>
+int lp_sendDevKitTelemetry(const LP_TELEMETRY_ENCODER* encoder) {
+	ReadTelemetry();
+	return lp_sendTelemetry(encoder);
+}
+
+static void (*devKitReadyHandler)(bool ready) = NULL;
+
+/// <summary>
+///     The handler is called once the board is initialized, set it before lp_initializeDevKit
+/// </summary>
+void lp_setDevKitReadyHandler(void (*readyHandler)(bool ready)) {
+	devKitReadyHandler = readyHandler;
 }
 
 bool lp_initializeDevKit(void) {
 
 	srand((unsigned int)time(NULL)); // seed the random number generator for fake telemetry
 
+	lp_openTelemetrySet(telemetrySet, NELEMS(telemetrySet));
+
+	// There are no sensors to bring up, the board is ready at once
+	if (devKitReadyHandler != NULL) {
+		devKitReadyHandler(true);
+	}
+
 	return true;
 }
 
 bool lp_closeDevKit(void) {
+	lp_closeTelemetrySet();
 
 	return true;
 }
\ No newline at end of file
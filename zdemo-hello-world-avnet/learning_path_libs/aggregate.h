@@ -0,0 +1,68 @@
+#pragma once
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Streaming aggregation of sensor samples.
+
+An LP_AGGREGATOR summarizes a stream of samples as count, min, max, mean, standard deviation and last
+value, every sample is added in O(1) (amortized for the sliding min and max).
+
+Tumbling window: all samples since the last lp_aggregateReset, typically reset after each send.
+
+	static LP_AGGREGATOR temperatureAggregate = { .type = LP_WINDOW_TUMBLING };
+
+Sliding window: the last `length` samples, the sample storage is declared with LP_SLIDING_AGGREGATOR.
+
+	LP_SLIDING_AGGREGATOR(pressureAggregate, 60);
+
+The engine has no platform dependencies.
+*/
+
+typedef enum {
+	LP_WINDOW_TUMBLING,
+	LP_WINDOW_SLIDING
+} LP_WINDOW_TYPE;
+
+typedef struct {
+	uint32_t count;
+	float min;
+	float max;
+	float mean;
+	float stddev;		// population standard deviation
+	float last;
+} LP_AGGREGATE;
+
+typedef struct {
+	LP_WINDOW_TYPE type;
+
+	// sliding window storage, `length` entries each
+	size_t length;
+	float* samples;					// ring of the last samples
+	uint32_t* minQueue;				// sample sequence numbers with increasing values
+	uint32_t* maxQueue;				// sample sequence numbers with decreasing values
+
+	uint32_t count;					// samples in the window
+	uint32_t sequence;				// sliding: samples added since reset
+	double mean;
+	double m2;						// sum of squared differences from the mean
+	float min;
+	float max;
+	float last;
+	size_t minHead, minSize;
+	size_t maxHead, maxSize;
+} LP_AGGREGATOR;
+
+#define LP_SLIDING_AGGREGATOR(name, windowLength) \
+	static float name##_samples[windowLength]; \
+	static uint32_t name##_minQueue[windowLength]; \
+	static uint32_t name##_maxQueue[windowLength]; \
+	static LP_AGGREGATOR name = { .type = LP_WINDOW_SLIDING, .length = windowLength, \
+		.samples = name##_samples, .minQueue = name##_minQueue, .maxQueue = name##_maxQueue }
+
+void lp_aggregateReset(LP_AGGREGATOR* aggregator);
+void lp_aggregateAdd(LP_AGGREGATOR* aggregator, float value);
+bool lp_aggregateGet(const LP_AGGREGATOR* aggregator, LP_AGGREGATE* aggregate);
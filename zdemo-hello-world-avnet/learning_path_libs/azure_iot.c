@@ -1,19 +1,77 @@
 #include "azure_iot.h"
+#include "hub_cache.h"
+#include "worker_pool.h"
+#include <iothub_security_factory.h>
+#include <prov_device_ll_client.h>
+#include <prov_security_factory.h>
+#include <prov_transport_mqtt_client.h>
 #include <time.h>
 
-const char* getAzureSphereProvisioningResultString(AZURE_SPHERE_PROV_RETURN_VALUE provisioningResult);
 const char* GetReasonString(IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason);
 void SendMessageCallback(IOTHUB_CLIENT_CONFIRMATION_RESULT, void*);
-bool SetupAzureClient(void);
 void HubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS, IOTHUB_CLIENT_CONNECTION_STATUS_REASON, void*);
 void AzureCloudToDeviceHandler(EventLoopTimer*);
+static void ConnectionBackoffHandler(EventLoopTimer*);
 
 IOTHUB_DEVICE_CLIENT_LL_HANDLE iothubClientHandle = NULL;
-bool iothubAuthenticated = false;
 const int keepalivePeriodSeconds = 20;
 const char* _connectionString = NULL;
 
-const int maxPeriodSeconds = 5; // defines the max back off period for DoWork with lost network
+/*
+Connection state machine. Only lp_connectToAzureIot starts a connection, it is called from the DoWork
+timer and the apps' network status timers and never blocks:
+
+	DISCONNECTED -> CONNECTING		the IoT Hub assigned at the last provisioning is cached, see hub_cache.h
+	DISCONNECTED -> PROVISIONING	otherwise DPS provisioning runs on a worker thread, it takes up to 10 seconds
+	PROVISIONING -> CONNECTING		the client is configured back on the event loop, see worker_pool.h
+	CONNECTING -> AUTHENTICATED		reported by the connection status callback
+	any failure -> BACKOFF			the client is destroyed when the back off expires, then DISCONNECTED
+
+The back off doubles from connectionBackoffMinSeconds up to connectionBackoffMaxSeconds after each failed
+attempt, the delay is drawn from the upper half of that range so devices that lost the network together
+do not retry together. Authentication resets it. Senders only queue on an existing client.
+*/
+static const int connectionBackoffMinSeconds = 2;
+static const int connectionBackoffMaxSeconds = 300;
+static LP_AZURE_CONNECTION_STATE connectionState = LP_AZURE_DISCONNECTED;
+static unsigned int connectionFailures = 0;
+static void (*connectionStateHandler)(LP_AZURE_CONNECTION_STATE) = NULL;
+
+static LP_TIMER connectionBackoffTimer = {
+	.period = { 0, 0 },			// one-shot timer
+	.name = "connectionBackoff",
+	.handler = &ConnectionBackoffHandler
+};
+
+static void ProvisionDevice(LP_WORK_ITEM* item);
+static void DeviceProvisioned(LP_WORK_ITEM* item);
+
+// Written by the provisioning work, read on the event loop once it is done
+static const char* dpsGlobalEndpoint = "global.azure-devices-provisioning.net";
+static const int provisioningTimeoutMs = 10000;
+static LP_WORK_ITEM provisioningWork = { .name = "provisioning", .work = ProvisionDevice, .done = DeviceProvisioned };
+static PROV_DEVICE_RESULT provisioningResult;
+static bool provisioningRegistered;
+static LP_HUB_CACHE_ENTRY provisionedHub;
+
+// Where the hub of the current client came from, decides what its connection status does to the cache
+typedef enum {
+	HUB_FROM_CONNECTION_STRING,
+	HUB_FROM_CACHE,
+	HUB_FROM_PROVISIONING
+} HubSource;
+
+static HubSource hubSource = HUB_FROM_CONNECTION_STRING;
+static bool hubConfirmed = false;		// the client authenticated with its hub at least once
+static LP_HUB_CACHE_ENTRY connectedHub;
+
+// While connected DoWork runs every doWorkActivePeriodMs while the client has messages in flight or
+// traffic arrived since the last DoWork, then backs off doubling up to doWorkIdlePeriodMs. The IoT
+// client does not expose its socket, so the timer stands in for readiness on it.
+static const long doWorkActivePeriodMs = 100;
+static const long doWorkIdlePeriodMs = 2000;
+static long doWorkPeriodMs = 1000;
+static bool clientActivity = false;
 
 static LP_TIMER cloudToDeviceTimer = {
 	.period = { 0, 0 },			// one-shot timer
@@ -21,10 +79,44 @@ static LP_TIMER cloudToDeviceTimer = {
 	.handler = &AzureCloudToDeviceHandler
 };
 
+/// <summary>
+///     Arms DoWork, the timer may share a wakeup within a quarter of the period
+/// </summary>
+static void ScheduleDoWork(long periodMs) {
+	struct timespec period = { periodMs / 1000, (periodMs % 1000) * 1000 * 1000 };
+	long slackMs = periodMs / 4;
+	struct timespec slack = { slackMs / 1000, (slackMs % 1000) * 1000 * 1000 };
+
+	doWorkPeriodMs = periodMs;
+	SetEventLoopTimerSlack(cloudToDeviceTimer.eventLoopTimer, &slack);
+	lp_setOneShotTimer(&cloudToDeviceTimer, &period);
+}
+
+/// <summary>
+///     Called for traffic to or from IoT Hub, brings the next DoWork forward to the active period
+/// </summary>
+void lp_azureClientActivity(void) {
+	clientActivity = true;
+
+	if (cloudToDeviceTimer.eventLoopTimer != NULL && lp_isAzureClientReady() && doWorkPeriodMs > doWorkActivePeriodMs) {
+		ScheduleDoWork(doWorkActivePeriodMs);
+	}
+}
+
+/// <summary>
+///     True while the client holds telemetry that IoT Hub has not confirmed yet
+/// </summary>
+static bool IsClientSending(void) {
+	IOTHUB_CLIENT_STATUS status;
+
+	return IoTHubDeviceClient_LL_GetSendStatus(iothubClientHandle, &status) == IOTHUB_CLIENT_OK &&
+		status == IOTHUB_CLIENT_SEND_STATUS_BUSY;
+}
+
 void lp_startCloudToDevice(void) {
 	if (cloudToDeviceTimer.eventLoopTimer == NULL) {
 		lp_startTimer(&cloudToDeviceTimer);
-		lp_setOneShotTimer(&cloudToDeviceTimer, &(struct timespec){1, 0});
+		ScheduleDoWork(1000);
 	}
 }
 
@@ -32,6 +124,7 @@ void lp_stopCloudToDevice(void) {
 	if (cloudToDeviceTimer.eventLoopTimer != NULL) {
 		lp_stopTimer(&cloudToDeviceTimer);
 	}
+	lp_stopTimer(&connectionBackoffTimer);
 }
 
 void lp_setConnectionString(const char* connectionString) {
@@ -44,46 +137,42 @@ void lp_setConnectionString(const char* connectionString) {
 /// <param name="result">Message delivery status</param>
 /// <param name="context">User specified context</param>
 void SendMessageCallback(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* context) {
-	Log_Debug("INFO: Message received by IoT Hub. Result is: %d\n", result);
+	LP_LOG("INFO: Message received by IoT Hub. Result is: %d\n", result);
+	lp_azureClientActivity();
 }
 
 /// <summary>
-///     Azure IoT Hub DoWork Handler with back off up to 5 seconds for network disconnect
+///     Azure IoT Hub DoWork Handler, adaptive while there is a client and starting a connection while there is none
 /// </summary>
 void AzureCloudToDeviceHandler(EventLoopTimer* eventLoopTimer) {
-	static int period = 1; //  initialize period to 1 second
-
 	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
 		lp_terminate(ExitCode_AzureCloudToDeviceHandler);
 		return;
 	}
 
-	if (iothubAuthenticated && iothubClientHandle != NULL) {
+	if (lp_isAzureClientReady()) {
+		// callbacks from this DoWork flag activity again
+		clientActivity = false;
 		IoTHubDeviceClient_LL_DoWork(iothubClientHandle);
-		period = 1;
-	}
-	else {
-		if (lp_connectToAzureIot()) {
-			period = 1;
+
+		if (clientActivity || IsClientSending()) {
+			ScheduleDoWork(doWorkActivePeriodMs);
 		}
 		else {
-			if (period < maxPeriodSeconds) { period++; }
+			ScheduleDoWork(doWorkPeriodMs * 2 < doWorkIdlePeriodMs ? doWorkPeriodMs * 2 : doWorkIdlePeriodMs);
 		}
-	}
-	lp_setOneShotTimer(&cloudToDeviceTimer, &(struct timespec){period, 0});
-}
-
-bool lp_sendMsg(const char* msg) {
-	if (strlen(msg) < 1) {
-		return true;
-	}
-
-	if (!lp_connectToAzureIot()) {
-		return false;
+		return;
 	}
 
-	IOTHUB_MESSAGE_HANDLE messageHandle = IoTHubMessage_CreateFromString(msg);
+	// Provisioning and back off finish on their own, configuring the client brings DoWork forward
+	lp_connectToAzureIot();
+	ScheduleDoWork(doWorkIdlePeriodMs);
+}
 
+/// <summary>
+///     Hands the message over to the IoT Hub client, the message handle is destroyed
+/// </summary>
+static bool SendMessage(IOTHUB_MESSAGE_HANDLE messageHandle) {
 	if (messageHandle == 0) {
 		Log_Debug("WARNING: unable to create a new IoTHubMessage\n");
 		return false;
@@ -92,19 +181,58 @@ bool lp_sendMsg(const char* msg) {
 	if (IoTHubDeviceClient_LL_SendEventAsync(iothubClientHandle, messageHandle, SendMessageCallback,
 		/*&callback_param*/ 0) != IOTHUB_CLIENT_OK) {
 		Log_Debug("WARNING: failed to hand over the message to IoTHubClient\n");
+		IoTHubMessage_Destroy(messageHandle);
 		return false;
 	}
 	else {
-		Log_Debug("INFO: IoTHubClient accepted the message for delivery\n");
+		LP_LOG("INFO: IoTHubClient accepted the message for delivery\n");
 	}
 
 	IoTHubMessage_Destroy(messageHandle);
 
 	IoTHubDeviceClient_LL_DoWork(iothubClientHandle);
+	lp_azureClientActivity();
 
 	return true;
 }
 
+bool lp_sendMsg(const char* msg) {
+	if (strlen(msg) < 1) {
+		return true;
+	}
+
+	if (!lp_isAzureClientReady()) {
+		return false;
+	}
+
+	return SendMessage(IoTHubMessage_CreateFromString(msg));
+}
+
+/// <summary>
+///     Sends a binary message, contentType and contentEncoding (may be NULL) are set as message system properties
+/// </summary>
+bool lp_sendMsgBytes(const unsigned char* data, size_t length, const char* contentType, const char* contentEncoding) {
+	if (length < 1) {
+		return true;
+	}
+
+	if (!lp_isAzureClientReady()) {
+		return false;
+	}
+
+	IOTHUB_MESSAGE_HANDLE messageHandle = IoTHubMessage_CreateFromByteArray(data, length);
+
+	if (messageHandle != 0 && contentType != NULL && IoTHubMessage_SetContentTypeSystemProperty(messageHandle, contentType) != IOTHUB_MESSAGE_OK) {
+		Log_Debug("WARNING: unable to set the message content type\n");
+	}
+
+	if (messageHandle != 0 && contentEncoding != NULL && IoTHubMessage_SetContentEncodingSystemProperty(messageHandle, contentEncoding) != IOTHUB_MESSAGE_OK) {
+		Log_Debug("WARNING: unable to set the message content encoding\n");
+	}
+
+	return SendMessage(messageHandle);
+}
+
 bool lp_isNetworkReady(void) {
 	bool isNetworkReady = false;
 	if (Networking_IsNetworkingReady(&isNetworkReady) != -1) {
@@ -128,67 +256,271 @@ IOTHUB_DEVICE_CLIENT_LL_HANDLE lp_getAzureIotClientHandle(void) {
 }
 
 
+LP_AZURE_CONNECTION_STATE lp_getAzureConnectionState(void) {
+	return connectionState;
+}
+
 /// <summary>
-///     Check if network connected or already connected, else sets up connection to Azure IoT
+///     The handler is called on every connection state change, e.g. to learn when the device is first authenticated
 /// </summary>
-bool lp_connectToAzureIot(void) {
-	if (!lp_isNetworkReady()) {
-		return false;
+void lp_setAzureConnectionStateHandler(void (*handler)(LP_AZURE_CONNECTION_STATE state)) {
+	connectionStateHandler = handler;
+}
+
+static void SetConnectionState(LP_AZURE_CONNECTION_STATE state) {
+	if (state == connectionState) {
+		return;
 	}
-	else {
-		if (iothubAuthenticated) {
-			return true;
-		}
-		else {
-			return SetupAzureClient();
-		}
+	connectionState = state;
+
+	if (connectionStateHandler != NULL) {
+		connectionStateHandler(state);
 	}
 }
 
+/// <summary>
+///     True while there is a client that queues messages, it may still be authenticating
+/// </summary>
+bool lp_isAzureClientReady(void) {
+	return iothubClientHandle != NULL &&
+		(connectionState == LP_AZURE_CONNECTING || connectionState == LP_AZURE_AUTHENTICATED);
+}
+
+/// <summary>
+///     Waits out a failed connection attempt, see the state machine above
+/// </summary>
+static void EnterBackoff(void) {
+	static unsigned int jitterSeed = 0;
+
+	if (jitterSeed == 0) {
+		// Boot timing differs between devices in the nanoseconds
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		jitterSeed = ((unsigned int)now.tv_nsec ^ (unsigned int)now.tv_sec) | 1;
+	}
+
+	int ceilingSeconds = connectionBackoffMaxSeconds;
+	if (connectionFailures < 16 && (connectionBackoffMinSeconds << connectionFailures) < connectionBackoffMaxSeconds) {
+		ceilingSeconds = connectionBackoffMinSeconds << connectionFailures;
+	}
+	connectionFailures++;
+
+	long ceilingMs = ceilingSeconds * 1000L;
+	long delayMs = ceilingMs / 2 + rand_r(&jitterSeed) % (ceilingMs / 2 + 1);
+
+	SetConnectionState(LP_AZURE_BACKOFF);
+	Log_Debug("INFO: Azure IoT connection attempt %u failed, retrying in %ld ms\n", connectionFailures, delayMs);
+
+	if (connectionBackoffTimer.eventLoopTimer == NULL && !lp_startTimer(&connectionBackoffTimer)) {
+		SetConnectionState(LP_AZURE_DISCONNECTED);
+		return;
+	}
+	lp_setOneShotTimer(&connectionBackoffTimer, &(struct timespec){delayMs / 1000, (delayMs % 1000) * 1000 * 1000});
+}
 
 /// <summary>
-///     Sets up the Azure IoT Hub connection (creates the iothubClientHandle)
-///     When the SAS Token for a device expires the connection needs to be recreated
-///     which is why this is not simply a one time call.
+///     Back off expired, drops the failed client. The next lp_connectToAzureIot tries again.
 /// </summary>
-bool SetupAzureClient() {
+static void ConnectionBackoffHandler(EventLoopTimer* eventLoopTimer) {
+	if (ConsumeEventLoopTimerEvent(eventLoopTimer) != 0) {
+		lp_terminate(ExitCode_ConsumeEventLoopTimeEvent);
+		return;
+	}
+
 	if (iothubClientHandle != NULL) {
 		IoTHubDeviceClient_LL_Destroy(iothubClientHandle);
+		iothubClientHandle = NULL;
 	}
+	SetConnectionState(LP_AZURE_DISCONNECTED);
+
+	lp_connectToAzureIot();
+}
+
+/// <summary>
+///     Takes a new client into use, IoT Hub authentication follows in DoWork
+/// </summary>
+static void ConfigureClient(IOTHUB_DEVICE_CLIENT_LL_HANDLE clientHandle) {
+	iothubClientHandle = clientHandle;
+
+	if (IoTHubDeviceClient_LL_SetOption(iothubClientHandle, OPTION_KEEP_ALIVE, &keepalivePeriodSeconds) != IOTHUB_CLIENT_OK) {
+		Log_Debug("ERROR: failure setting option \"%s\"\n", OPTION_KEEP_ALIVE);
+		EnterBackoff();
+		return;
+	}
+
+	IoTHubDeviceClient_LL_SetDeviceTwinCallback(iothubClientHandle, lp_twinCallback, NULL);
+	IoTHubDeviceClient_LL_SetDeviceMethodCallback(iothubClientHandle, lp_azureDirectMethodHandler, NULL);
+	IoTHubDeviceClient_LL_SetConnectionStatusCallback(iothubClientHandle, HubConnectionStatusCallback, NULL);
+
+	SetConnectionState(LP_AZURE_CONNECTING);
+	lp_azureClientActivity();
+}
+
+/// <summary>
+///     Creates a device authenticated client for the hub, from the cache or just provisioned
+/// </summary>
+static void ConnectToHub(const LP_HUB_CACHE_ENTRY* hub, HubSource source) {
+	static bool securityInitialized = false;
+
+	if (!securityInitialized) {
+		if (iothub_security_init(IOTHUB_SECURITY_TYPE_X509) != 0) {
+			Log_Debug("ERROR: iothub_security_init failed.\n");
+			EnterBackoff();
+			return;
+		}
+		securityInitialized = true;
+	}
+
+	IOTHUB_DEVICE_CLIENT_LL_HANDLE clientHandle = IoTHubDeviceClient_LL_CreateFromDeviceAuth(hub->hostname, hub->deviceId, MQTT_Protocol);
+	if (clientHandle == NULL) {
+		Log_Debug("ERROR: failure to create IoTHub Handle for %s.\n", hub->hostname);
+		if (source == HUB_FROM_CACHE) {
+			lp_hubCacheInvalidate();
+		}
+		EnterBackoff();
+		return;
+	}
+
+	Log_Debug("INFO: Connecting to IoT Hub %s (%s)\n", hub->hostname, source == HUB_FROM_CACHE ? "cached" : "provisioned");
+	connectedHub = *hub;
+	hubSource = source;
+	hubConfirmed = false;
+
+	ConfigureClient(clientHandle);
+}
+
+static void RegisterDeviceCallback(PROV_DEVICE_RESULT registerResult, const char* iothubUri, const char* deviceId, void* context) {
+	provisioningResult = registerResult;
+	provisioningRegistered = true;
+
+	if (registerResult == PROV_DEVICE_RESULT_OK) {
+		if (iothubUri == NULL || deviceId == NULL ||
+			strlen(iothubUri) >= sizeof(provisionedHub.hostname) || strlen(deviceId) >= sizeof(provisionedHub.deviceId)) {
+			provisioningResult = PROV_DEVICE_RESULT_ERROR;
+			return;
+		}
+		strcpy(provisionedHub.hostname, iothubUri);
+		strcpy(provisionedHub.deviceId, deviceId);
+	}
+}
+
+/// <summary>
+///     Registers with DPS to learn the assigned hub, runs on a worker thread
+/// </summary>
+static void ProvisionDevice(LP_WORK_ITEM* item) {
+	static const struct timespec doWorkSleep = { 0, 100 * 1000 * 1000 };
+	int deviceIdForDaaCertUsage = 1;	// the DAA certificate identifies the device
+	PROV_DEVICE_LL_HANDLE provHandle = NULL;
+
+	provisioningResult = PROV_DEVICE_RESULT_ERROR;
+	provisioningRegistered = false;
+
+	if (prov_dev_security_init(SECURE_DEVICE_TYPE_X509) != 0) {
+		Log_Debug("ERROR: prov_dev_security_init failed.\n");
+	}
+	else {
+		provHandle = Prov_Device_LL_Create(dpsGlobalEndpoint, scopeId, Prov_Device_MQTT_Protocol);
+	}
+
+	if (provHandle != NULL &&
+		Prov_Device_LL_SetOption(provHandle, "SetDeviceId", &deviceIdForDaaCertUsage) == PROV_DEVICE_RESULT_OK &&
+		Prov_Device_LL_Register_Device(provHandle, RegisterDeviceCallback, NULL, NULL, NULL) == PROV_DEVICE_RESULT_OK) {
+
+		for (int elapsedMs = 0; !provisioningRegistered && elapsedMs < provisioningTimeoutMs; elapsedMs += 100) {
+			Prov_Device_LL_DoWork(provHandle);
+			nanosleep(&doWorkSleep, NULL);
+		}
+		if (!provisioningRegistered) {
+			provisioningResult = PROV_DEVICE_RESULT_TIMEOUT;
+		}
+	}
+
+	if (provHandle != NULL) {
+		Prov_Device_LL_Destroy(provHandle);
+	}
+	prov_dev_security_deinit();
+}
+
+/// <summary>
+///     Creates the hub client on the event loop once provisioning is done
+/// </summary>
+static void DeviceProvisioned(LP_WORK_ITEM* item) {
+	if (provisioningResult != PROV_DEVICE_RESULT_OK) {
+		Log_Debug("ERROR: DPS provisioning failed (%d).\n", provisioningResult);
+		EnterBackoff();
+		return;
+	}
+
+	ConnectToHub(&provisionedHub, HUB_FROM_PROVISIONING);
+}
+
+/// <summary>
+///     Creates the client from the lab connection string or the cached hub, or queues DPS provisioning
+/// </summary>
+static void StartConnecting(void) {
+	LP_HUB_CACHE_ENTRY cachedHub;
 
 	// For lab purposes only where the device tenant and associated x500 certificate may not be available
 	// DO NOT use connection strings in production
 	if (_connectionString != NULL && strlen(_connectionString) != 0) {
 		IOTHUB_CLIENT_TRANSPORT_PROVIDER protocol = MQTT_Protocol;
-		iothubClientHandle = IoTHubDeviceClient_LL_CreateFromConnectionString(_connectionString, protocol);
-		if (iothubClientHandle == NULL) {
+		IOTHUB_DEVICE_CLIENT_LL_HANDLE clientHandle = IoTHubDeviceClient_LL_CreateFromConnectionString(_connectionString, protocol);
+		if (clientHandle == NULL) {
 			Log_Debug("Failure to create IoT Hub Client from connection string");
-			return false;
-		}
-	}
-	else {
-		AZURE_SPHERE_PROV_RETURN_VALUE provResult = IoTHubDeviceClient_LL_CreateWithAzureSphereDeviceAuthProvisioning(scopeId, 10000, &iothubClientHandle);
-		Log_Debug("IoTHubDeviceClient_LL_CreateWithAzureSphereDeviceAuthProvisioning returned '%s'.\n", getAzureSphereProvisioningResultString(provResult));
-		if (provResult.result != AZURE_SPHERE_PROV_RESULT_OK) {
-			Log_Debug("ERROR: failure to create IoTHub Handle.\n");
-			return false;
+			EnterBackoff();
+			return;
 		}
+		hubSource = HUB_FROM_CONNECTION_STRING;
+		ConfigureClient(clientHandle);
+		return;
 	}
-	   
-	if (IoTHubDeviceClient_LL_SetOption(iothubClientHandle, OPTION_KEEP_ALIVE, &keepalivePeriodSeconds) != IOTHUB_CLIENT_OK) {
-		Log_Debug("ERROR: failure setting option \"%s\"\n", OPTION_KEEP_ALIVE);
-		return false;
+
+	if (lp_hubCacheLoad(scopeId, &cachedHub)) {
+		ConnectToHub(&cachedHub, HUB_FROM_CACHE);
+		return;
 	}
 
-	iothubAuthenticated = true;
+	SetConnectionState(LP_AZURE_PROVISIONING);
 
-	IoTHubDeviceClient_LL_SetDeviceTwinCallback(iothubClientHandle, lp_twinCallback, NULL);
-	IoTHubDeviceClient_LL_SetDeviceMethodCallback(iothubClientHandle, lp_azureDirectMethodHandler, NULL);
-	IoTHubDeviceClient_LL_SetConnectionStatusCallback(iothubClientHandle, HubConnectionStatusCallback, NULL);
+	if (!lp_submitWork(&provisioningWork)) {
+		Log_Debug("ERROR: could not queue DPS provisioning.\n");
+		EnterBackoff();
+	}
+}
 
-	IoTHubDeviceClient_LL_DoWork(iothubClientHandle);
+/// <summary>
+///     Returns true when authenticated with IoT Hub. When disconnected and the network is up a connection
+///     attempt is started, it completes in the background.
+/// </summary>
+bool lp_connectToAzureIot(void) {
+	switch (connectionState) {
+	case LP_AZURE_AUTHENTICATED:
+		return true;
+	case LP_AZURE_DISCONNECTED:
+		if (lp_isNetworkReady()) {
+			StartConnecting();
+		}
+		return false;
+	default:
+		return false;
+	}
+}
 
-	return true;
+/// <summary>
+///     A rejected device provisions again, other failures count against the cached hub until it
+///     has authenticated the device once
+/// </summary>
+static void RecordHubFailure(IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason) {
+	if (hubSource == HUB_FROM_CONNECTION_STRING || reason == IOTHUB_CLIENT_CONNECTION_NO_NETWORK) {
+		return;
+	}
+
+	if (reason == IOTHUB_CLIENT_CONNECTION_BAD_CREDENTIAL || reason == IOTHUB_CLIENT_CONNECTION_DEVICE_DISABLED) {
+		lp_hubCacheInvalidate();
+	}
+	else if (hubSource == HUB_FROM_CACHE && !hubConfirmed) {
+		lp_hubCacheConnectFailed();
+	}
 }
 
 /// <summary>
@@ -196,30 +528,25 @@ bool SetupAzureClient() {
 ///     The SAS Token expires which will set the authentication state
 /// </summary>
 void HubConnectionStatusCallback(IOTHUB_CLIENT_CONNECTION_STATUS result, IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason, void* userContextCallback) {
-	iothubAuthenticated = (result == IOTHUB_CLIENT_CONNECTION_AUTHENTICATED);
 	Log_Debug("IoT Hub Connection Status: %s\n", GetReasonString(reason));
-}
 
-/// <summary>
-///     Converts AZURE_SPHERE_PROV_RETURN_VALUE to a string.
-/// </summary>
-const char* getAzureSphereProvisioningResultString(
-	AZURE_SPHERE_PROV_RETURN_VALUE provisioningResult) {
-	switch (provisioningResult.result) {
-	case AZURE_SPHERE_PROV_RESULT_OK:
-		return "AZURE_SPHERE_PROV_RESULT_OK";
-	case AZURE_SPHERE_PROV_RESULT_INVALID_PARAM:
-		return "AZURE_SPHERE_PROV_RESULT_INVALID_PARAM";
-	case AZURE_SPHERE_PROV_RESULT_NETWORK_NOT_READY:
-		return "AZURE_SPHERE_PROV_RESULT_NETWORK_NOT_READY";
-	case AZURE_SPHERE_PROV_RESULT_DEVICEAUTH_NOT_READY:
-		return "AZURE_SPHERE_PROV_RESULT_DEVICEAUTH_NOT_READY";
-	case AZURE_SPHERE_PROV_RESULT_PROV_DEVICE_ERROR:
-		return "AZURE_SPHERE_PROV_RESULT_PROV_DEVICE_ERROR";
-	case AZURE_SPHERE_PROV_RESULT_GENERIC_ERROR:
-		return "AZURE_SPHERE_PROV_RESULT_GENERIC_ERROR";
-	default:
-		return "UNKNOWN_RETURN_VALUE";
+	if (result == IOTHUB_CLIENT_CONNECTION_AUTHENTICATED) {
+		if (!hubConfirmed && hubSource == HUB_FROM_PROVISIONING) {
+			lp_hubCacheStore(scopeId, connectedHub.hostname, connectedHub.deviceId);
+		}
+		else if (!hubConfirmed && hubSource == HUB_FROM_CACHE) {
+			lp_hubCacheConnected();
+		}
+		hubConfirmed = true;
+
+		SetConnectionState(LP_AZURE_AUTHENTICATED);
+		connectionFailures = 0;
+		lp_azureClientActivity();
+	}
+	else if (connectionState == LP_AZURE_CONNECTING || connectionState == LP_AZURE_AUTHENTICATED) {
+		RecordHubFailure(reason);
+		// The client is called from its own DoWork here, the back off handler destroys it
+		EnterBackoff();
 	}
 }
 
@@ -0,0 +1,130 @@
+#include "handler_stats.h"
+
+static LP_HANDLER_STATS_ENTRY handlerStats[LP_HANDLER_STATS_MAX];
+static size_t handlerCount = 0;
+static struct timespec windowStart;		// first record, or the last reset
+static const double bucketLimitsMs[LP_HANDLER_STATS_BUCKETS - 1] = { 0.1, 1, 10, 100, 1000 };
+
+static double ElapsedMs(const struct timespec* from, const struct timespec* to) {
+	return (double)(to->tv_sec - from->tv_sec) * 1000.0 + (double)(to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+static void HistogramAdd(LP_HANDLER_HISTOGRAM* histogram, double ms) {
+	int bucket = 0;
+
+	while (bucket < LP_HANDLER_STATS_BUCKETS - 1 && ms >= bucketLimitsMs[bucket]) {
+		bucket++;
+	}
+
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->totalMs += ms;
+	if (ms > histogram->maxMs) {
+		histogram->maxMs = ms;
+	}
+}
+
+/// <summary>
+///     The stats of the handler, added on first use. NULL when the table is full.
+/// </summary>
+LP_HANDLER_STATS_ENTRY* lp_handlerStats(const char* name) {
+	if (name == NULL) {
+		name = "unnamed";
+	}
+
+	for (size_t i = 0; i < handlerCount; i++) {
+		if (handlerStats[i].name == name || strcmp(handlerStats[i].name, name) == 0) {
+			return &handlerStats[i];
+		}
+	}
+
+	if (handlerCount == LP_HANDLER_STATS_MAX) {
+		return NULL;
+	}
+
+	if (handlerCount == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &windowStart);
+	}
+
+	memset(&handlerStats[handlerCount], 0, sizeof(LP_HANDLER_STATS_ENTRY));
+	handlerStats[handlerCount].name = name;
+	return &handlerStats[handlerCount++];
+}
+
+/// <summary>
+///     Records a call that started at start and ends now. Deadline is the scheduled expiry of a timer, NULL for
+///     other handlers.
+/// </summary>
+void lp_handlerStatsRecord(LP_HANDLER_STATS_ENTRY* stats, const struct timespec* deadline, const struct timespec* start) {
+	struct timespec end;
+
+	if (stats == NULL) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	HistogramAdd(&stats->run, ElapsedMs(start, &end));
+
+	if (deadline != NULL) {
+		double lateMs = ElapsedMs(deadline, start);
+		HistogramAdd(&stats->late, lateMs > 0 ? lateMs : 0);
+	}
+}
+
+static int HistogramToJson(const char* key, const LP_HANDLER_HISTOGRAM* histogram, char* buffer, size_t bufferSize) {
+	const uint32_t* b = histogram->buckets;
+
+	return snprintf(buffer, bufferSize, ",\"%sMs\":[%.2f,%.2f],\"%s\":[%u,%u,%u,%u,%u,%u]", key,
+		histogram->count > 0 ? histogram->totalMs / histogram->count : 0, histogram->maxMs, key,
+		b[0], b[1], b[2], b[3], b[4], b[5]);
+}
+
+/// <summary>
+///     Formats the stats since the last reset as a JSON telemetry message, mean and max in ms and the bucket
+///     counts per handler. Returns the length, 0 if it did not fit.
+/// </summary>
+size_t lp_handlerStatsToJson(char* buffer, size_t bufferSize) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	int len = snprintf(buffer, bufferSize, "{\"HandlerStatsWindowS\":%.0f,\"BucketsMs\":[0.1,1,10,100,1000],\"Handlers\":{",
+		handlerCount > 0 ? ElapsedMs(&windowStart, &now) / 1000.0 : 0);
+
+	for (size_t i = 0; i < handlerCount && len > 0 && (size_t)len < bufferSize; i++) {
+		len += snprintf(buffer + len, bufferSize - (size_t)len, "%s\"%s\":{\"n\":%u", i == 0 ? "" : ",",
+			handlerStats[i].name, handlerStats[i].run.count);
+
+		if ((size_t)len < bufferSize) {
+			len += HistogramToJson("run", &handlerStats[i].run, buffer + len, bufferSize - (size_t)len);
+		}
+		if ((size_t)len < bufferSize && handlerStats[i].late.count > 0) {
+			len += HistogramToJson("late", &handlerStats[i].late, buffer + len, bufferSize - (size_t)len);
+		}
+		if ((size_t)len < bufferSize) {
+			len += snprintf(buffer + len, bufferSize - (size_t)len, "}");
+		}
+	}
+
+	if (len > 0 && (size_t)len < bufferSize) {
+		len += snprintf(buffer + len, bufferSize - (size_t)len, "}}");
+	}
+
+	if (len <= 0 || (size_t)len >= bufferSize) {
+		if (bufferSize > 0) {
+			buffer[0] = '\0';
+		}
+		return 0;
+	}
+	return (size_t)len;
+}
+
+/// <summary>
+///     Starts a new window, the handlers keep their entries
+/// </summary>
+void lp_handlerStatsReset(void) {
+	for (size_t i = 0; i < handlerCount; i++) {
+		memset(&handlerStats[i].run, 0, sizeof(LP_HANDLER_HISTOGRAM));
+		memset(&handlerStats[i].late, 0, sizeof(LP_HANDLER_HISTOGRAM));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &windowStart);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <applibs/log.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+Event loop handler instrumentation.
+
+With LP_HANDLER_STATS defined, the timer dispatcher, the inter-core socket handler and the worker pool
+completions record per handler name (LP_TIMER.name, "interCore", LP_WORK_ITEM.name) the number of calls,
+how long each call ran and, for timers, how late it started after its deadline. Both are kept as a
+maximum, a mean and a histogram with decade buckets from 0.1 ms to 1 s. A handler that hogs the loop
+shows in its own run time and in the lateness of the timers queued behind it. Lateness includes the
+slack of a timer, up to the slack is by design.
+
+Without LP_HANDLER_STATS nothing is recorded and the hooks compile away, the functions below still build.
+*/
+
+#define LP_HANDLER_STATS_MAX 24
+#define LP_HANDLER_STATS_BUCKETS 6		// < 0.1 ms, < 1 ms, < 10 ms, < 100 ms, < 1 s, longer
+
+typedef struct {
+	uint32_t count;
+	double totalMs;
+	double maxMs;
+	uint32_t buckets[LP_HANDLER_STATS_BUCKETS];
+} LP_HANDLER_HISTOGRAM;
+
+typedef struct {
+	const char* name;
+	LP_HANDLER_HISTOGRAM run;		// count is the number of calls
+	LP_HANDLER_HISTOGRAM late;		// timers only
+} LP_HANDLER_STATS_ENTRY;
+
+LP_HANDLER_STATS_ENTRY* lp_handlerStats(const char* name);
+void lp_handlerStatsRecord(LP_HANDLER_STATS_ENTRY* stats, const struct timespec* deadline, const struct timespec* start);
+size_t lp_handlerStatsToJson(char* buffer, size_t bufferSize);
+void lp_handlerStatsReset(void);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "eventloop_timer_utilities.h"
+#include "handler_stats.h"
 #include "terminate.h"
 #include <applibs/application.h>
 #include <applibs/eventloop.h>
@@ -22,7 +23,8 @@ enum LP_INTER_CORE_CMD
 	LP_IC_TEMPERATURE_HUMIDITY,
 	LP_IC_EVENT_BUTTON_A,
 	LP_IC_EVENT_BUTTON_B,
-	LP_IC_SET_DESIRED_TEMPERATURE
+	LP_IC_SET_DESIRED_TEMPERATURE,
+	LP_IC_ORIENTATION
 };
 
 typedef struct LP_INTER_CORE_BLOCK
@@ -30,6 +32,11 @@ typedef struct LP_INTER_CORE_BLOCK
 	enum LP_INTER_CORE_CMD cmd;
 	float	temperature;
 	float	pressure;
+	float	humidity;
+	float	quaternion[4];	// LP_IC_ORIENTATION: w, x, y, z
+	float	roll;			// degrees
+	float	pitch;
+	float	yaw;
 
 } LP_INTER_CORE_BLOCK;
 
@@ -0,0 +1,128 @@
+#include "telemetry_template.h"
+
+// decimal digit pairs "00" to "99", two digits are converted per division
+static const char digitPairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const uint32_t powersOf10[LP_TELEMETRY_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+/// <summary>
+///     Writes value as decimal digits, at least minDigits with leading zeros. Returns NULL if there is no room.
+/// </summary>
+static char* AppendDigits(char* p, const char* end, uint64_t value, int minDigits) {
+	char digits[20];
+	int len = 0;
+
+	while (value >= 100) {
+		unsigned pair = (unsigned)(value % 100) * 2;
+		value /= 100;
+		digits[len++] = digitPairs[pair + 1];
+		digits[len++] = digitPairs[pair];
+	}
+	if (value >= 10) {
+		digits[len++] = digitPairs[value * 2 + 1];
+		digits[len++] = digitPairs[value * 2];
+	} else {
+		digits[len++] = (char)('0' + value);
+	}
+	while (len < minDigits) {
+		digits[len++] = '0';
+	}
+
+	if (p == NULL || end - p < len) {
+		return NULL;
+	}
+	while (len > 0) {
+		*p++ = digits[--len];
+	}
+	return p;
+}
+
+/// <summary>
+///     Appends a literal of known length. Returns NULL if p is NULL or there is no room.
+/// </summary>
+char* lp_jsonAppendLiteral(char* p, const char* end, const char* literal, size_t len) {
+	if (p == NULL || (size_t)(end - p) < len) {
+		return NULL;
+	}
+	memcpy(p, literal, len);
+	return p + len;
+}
+
+/// <summary>
+///     Appends a signed integer. Returns NULL if p is NULL or there is no room.
+/// </summary>
+char* lp_jsonAppendInt(char* p, const char* end, int32_t value) {
+	if (value < 0) {
+		p = lp_jsonAppendLiteral(p, end, "-", 1);
+		return AppendDigits(p, end, (uint64_t)(-(int64_t)value), 1);
+	}
+	return AppendDigits(p, end, (uint64_t)value, 1);
+}
+
+/// <summary>
+///     Appends a float rounded to a fixed number of decimals (0 to LP_TELEMETRY_MAX_DECIMALS), null if not finite.
+///     Returns NULL if p is NULL or there is no room.
+/// </summary>
+char* lp_jsonAppendFloat(char* p, const char* end, float value, int decimals) {
+	if (!isfinite(value)) {
+		return lp_jsonAppendLiteral(p, end, "null", 4);
+	}
+
+	if (decimals < 0) {
+		decimals = 0;
+	} else if (decimals > LP_TELEMETRY_MAX_DECIMALS) {
+		decimals = LP_TELEMETRY_MAX_DECIMALS;
+	}
+
+	// scale to an integer, a float times 10^6 fits the double mantissa so this is exact
+	double scaled = fabs((double)value) * powersOf10[decimals];
+	if (scaled >= 1e18) {
+		return lp_jsonAppendLiteral(p, end, "null", 4);
+	}
+
+	// round half to even, same as printf
+	uint64_t fixed = (uint64_t)scaled;
+	double remainder = scaled - (double)fixed;
+	if (remainder > 0.5 || (remainder == 0.5 && (fixed & 1))) {
+		fixed++;
+	}
+	// the sign is kept when a negative value rounds to zero, as printf writes -0.00
+	if (signbit(value)) {
+		p = lp_jsonAppendLiteral(p, end, "-", 1);
+	}
+
+	if (decimals == 0) {
+		return AppendDigits(p, end, fixed, 1);
+	}
+
+	p = AppendDigits(p, end, fixed / powersOf10[decimals], 1);
+	p = lp_jsonAppendLiteral(p, end, ".", 1);
+	return AppendDigits(p, end, fixed % powersOf10[decimals], decimals);
+}
+
+/// <summary>
+///     Completes the JSON object started by the pre-baked ",\"name\":" field literals.
+///     Returns the JSON length, or -1 if the buffer was too small or no field was written.
+/// </summary>
+int lp_jsonClose(char* buffer, char* p, const char* end) {
+	if (p == NULL || p == buffer || end - p < 2) {
+		if (end > buffer) {
+			buffer[0] = '\0';
+		}
+		return -1;
+	}
+	buffer[0] = '{';
+	*p++ = '}';
+	*p = '\0';
+	return (int)(p - buffer);
+}
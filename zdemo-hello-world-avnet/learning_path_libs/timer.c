@@ -44,6 +44,10 @@ bool lp_startTimer(LP_TIMER* timer) {
 		}
 	}
 
+	if (SetEventLoopTimerSlack(timer->eventLoopTimer, &timer->slack) != 0 || SetEventLoopTimerName(timer->eventLoopTimer, timer->name) != 0) {
+		lp_stopTimer(timer);
+		return false;
+	}
 
 	return true;
 }
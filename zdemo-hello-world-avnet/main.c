@@ -84,6 +84,7 @@ static void InitPeripheralsAndHandlers(void) {
 	lp_openDeviceTwinSet(deviceTwinBindingSet, NELEMS(deviceTwinBindingSet));
 
 	lp_startTimerSet(timerSet, NELEMS(timerSet));
+	lp_logStart();
 	lp_startCloudToDevice();
 }
 
@@ -92,6 +93,7 @@ static void ClosePeripheralsAndHandlers(void) {
 
 	lp_stopTimerSet();
 	lp_stopCloudToDevice();
+	lp_logStop();
 
 	lp_closePeripheralGpioSet();
 	lp_closeDeviceTwinSet();